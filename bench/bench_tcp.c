@@ -0,0 +1,295 @@
+/*
+ * Modbus TCP loopback benchmark
+ *
+ * Runs the server on one thread and drives it from a second thread over
+ * loopback with a number of client connections, each keeping a fixed
+ * number of Read Holding Registers requests in flight. Reports the request
+ * rate, the round trip latency distribution and the requests answered per
+ * send of each server backend.
+ *
+ *     bench_tcp [epoll|uring|all] [connections] [depth] [seconds]
+ */
+#define _GNU_SOURCE
+
+#include "modbus_tcp_server.h"
+#include "modbus_tcp_uring.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#define BENCH_REGISTERS    10
+#define BENCH_REQUEST_LEN  12
+#define BENCH_RESPONSE_LEN (9 + BENCH_REGISTERS * 2)
+#define BENCH_MAX_SAMPLES  (1u << 22)
+
+typedef struct {
+    int fd;
+    uint16_t next_id;        /* Transaction id of the next request */
+    uint16_t rx_len;
+    uint8_t rx[BENCH_RESPONSE_LEN * 64];
+    uint64_t sent_ns[64];    /* Send time, indexed by transaction id modulo 64 */
+} BenchClient;
+
+typedef struct {
+    const char *name;
+    int (*init)(void *server, ModbusSlave *slave, const ModbusTcpServerConfig *cfg);
+    uint16_t (*port)(const void *server);
+    int (*poll)(void *server, int timeout_ms);
+    void (*close)(void *server);
+    const ModbusTcpServerStats *(*stats)(const void *server);
+} BenchBackend;
+
+static atomic_bool stop;
+static uint16_t registers[BENCH_REGISTERS];
+static ModbusSlave slave;
+
+static void bench_write(const uint8_t *data, uint16_t length) {
+    (void)data;
+    (void)length;
+}
+
+static ModbusExceptionCode bench_read_holding_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    if ((uint32_t)addr + count > BENCH_REGISTERS) return MODBUS_EX_ILLEGAL_DATA_ADDRESS;
+
+    for (uint16_t i = 0; i < count; i++) {
+        modbus_be16_set(&dest[i * 2], registers[addr + i]);
+    }
+    return MODBUS_EX_NONE;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int epoll_init(void *server, ModbusSlave *slave, const ModbusTcpServerConfig *cfg) {
+    return modbus_tcp_server_init(server, slave, cfg);
+}
+
+static uint16_t epoll_port(const void *server) {
+    return modbus_tcp_server_port(server);
+}
+
+static int epoll_poll(void *server, int timeout_ms) {
+    return modbus_tcp_server_poll(server, timeout_ms);
+}
+
+static void epoll_close(void *server) {
+    modbus_tcp_server_close(server);
+}
+
+static const ModbusTcpServerStats *epoll_stats(const void *server) {
+    return &((const ModbusTcpServer *)server)->stats;
+}
+
+#if MODBUS_ENABLE_TCP_URING
+static int uring_init(void *server, ModbusSlave *slave, const ModbusTcpServerConfig *cfg) {
+    return modbus_tcp_uring_server_init(server, slave, cfg);
+}
+
+static uint16_t uring_port(const void *server) {
+    return modbus_tcp_uring_server_port(server);
+}
+
+static int uring_poll(void *server, int timeout_ms) {
+    return modbus_tcp_uring_server_poll(server, timeout_ms);
+}
+
+static void uring_close(void *server) {
+    modbus_tcp_uring_server_close(server);
+}
+
+static const ModbusTcpServerStats *uring_stats(const void *server) {
+    return &((const ModbusTcpUringServer *)server)->stats;
+}
+#endif
+
+static const BenchBackend backends[] = {
+    { "epoll", epoll_init, epoll_port, epoll_poll, epoll_close, epoll_stats },
+#if MODBUS_ENABLE_TCP_URING
+    { "uring", uring_init, uring_port, uring_poll, uring_close, uring_stats },
+#endif
+};
+
+typedef struct {
+    const BenchBackend *backend;
+    void *server;
+} BenchServer;
+
+static void *server_thread(void *arg) {
+    BenchServer *bench = arg;
+
+    while (!atomic_load(&stop)) {
+        if (bench->backend->poll(bench->server, 10) < 0) {
+            perror("poll");
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void send_request(BenchClient *client) {
+    uint8_t request[BENCH_REQUEST_LEN] = {0, 0, 0x00, 0x00, 0x00, 0x06, 0xFF, 0x03, 0x00, 0x00, 0x00, BENCH_REGISTERS};
+    uint16_t id = client->next_id++;
+
+    modbus_be16_set(request, id);
+    client->sent_ns[id & 63] = now_ns();
+    if (send(client->fd, request, sizeof(request), MSG_NOSIGNAL) != (ssize_t)sizeof(request)) {
+        perror("send");
+        exit(1);
+    }
+}
+
+/**
+ * Benchmark one backend, 0 on success
+ */
+static int run_backend(const BenchBackend *backend, unsigned connections, unsigned depth, unsigned seconds) {
+    static union {
+        ModbusTcpServer epoll;
+#if MODBUS_ENABLE_TCP_URING
+        ModbusTcpUringServer uring;
+#endif
+    } storage;
+    BenchServer bench = { backend, &storage };
+
+    ModbusTcpServerConfig server_config = { .address = "127.0.0.1", .port = 0, .max_connections = connections };
+    if (backend->init(bench.server, &slave, &server_config) != 0) {
+        fprintf(stderr, "tcp %s: ", backend->name);
+        perror("init");
+        return 1;
+    }
+
+    atomic_store(&stop, false);
+    pthread_t thread;
+    pthread_create(&thread, NULL, server_thread, &bench);
+
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(backend->port(bench.server)) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int epoll_fd = epoll_create1(0);
+    BenchClient *clients = calloc(connections, sizeof(*clients));
+    uint32_t *samples = malloc(BENCH_MAX_SAMPLES * sizeof(*samples));
+    if (!clients || !samples) exit(1);
+
+    for (unsigned i = 0; i < connections; i++) {
+        int one = 1;
+        clients[i].fd = socket(AF_INET, SOCK_STREAM, 0);
+        setsockopt(clients[i].fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(clients[i].fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            perror("connect");
+            exit(1);
+        }
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &clients[i] };
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clients[i].fd, &ev);
+        for (unsigned d = 0; d < depth; d++) {
+            send_request(&clients[i]);
+        }
+    }
+
+    uint64_t completed = 0;
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)seconds * 1000000000u;
+    struct epoll_event events[256];
+
+    while (now_ns() < end) {
+        int count = epoll_wait(epoll_fd, events, 256, 100);
+        for (int e = 0; e < count; e++) {
+            BenchClient *client = events[e].data.ptr;
+            ssize_t n = recv(client->fd, &client->rx[client->rx_len], sizeof(client->rx) - client->rx_len, 0);
+            if (n <= 0) {
+                fprintf(stderr, "connection lost\n");
+                exit(1);
+            }
+            client->rx_len += (uint16_t)n;
+
+            uint16_t offset = 0;
+            uint64_t t = now_ns();
+            while (client->rx_len - offset >= BENCH_RESPONSE_LEN) {
+                uint16_t id = modbus_be16_get(&client->rx[offset]);
+                if (completed < BENCH_MAX_SAMPLES) samples[completed] = (uint32_t)(t - client->sent_ns[id & 63]);
+                completed++;
+                offset += BENCH_RESPONSE_LEN;
+                send_request(client);
+            }
+            client->rx_len -= offset;
+            memmove(client->rx, &client->rx[offset], client->rx_len);
+        }
+    }
+
+    double elapsed = (double)(now_ns() - start) / 1e9;
+    atomic_store(&stop, true);
+    pthread_join(thread, NULL);
+
+    uint32_t n = completed < BENCH_MAX_SAMPLES ? (uint32_t)completed : BENCH_MAX_SAMPLES;
+    qsort(samples, n, sizeof(*samples), compare_u32);
+
+    printf("tcp %s: %u connections, depth %u, %.1f s\n", backend->name, connections, depth, elapsed);
+    printf("  %.0f requests/s\n", (double)completed / elapsed);
+    if (n) {
+        printf("  latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+               samples[n / 2] / 1e3, samples[(uint64_t)n * 99 / 100] / 1e3, samples[n - 1] / 1e3);
+    }
+
+    const ModbusTcpServerStats *stats = backend->stats(bench.server);
+    if (stats->sends) printf("  %.2f requests per send\n", (double)stats->requests / (double)stats->sends);
+
+    for (unsigned i = 0; i < connections; i++) {
+        close(clients[i].fd);
+    }
+    close(epoll_fd);
+    backend->close(bench.server);
+    free(clients);
+    free(samples);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *name = argc > 1 ? argv[1] : "all";
+    unsigned connections = argc > 2 ? (unsigned)atoi(argv[2]) : 64;
+    unsigned depth = argc > 3 ? (unsigned)atoi(argv[3]) : 1;
+    unsigned seconds = argc > 4 ? (unsigned)atoi(argv[4]) : 2;
+
+    if (connections == 0 || depth == 0 || depth > 64) {
+        fprintf(stderr, "usage: %s [epoll|uring|all] [connections] [depth 1-64] [seconds]\n", argv[0]);
+        return 1;
+    }
+
+    ModbusSlaveConfig config = {
+        .address = 0x01,
+        .write = bench_write,
+        .read_holding_registers = bench_read_holding_registers,
+    };
+    if (modbus_slave_init(&slave, &config) != 0) return 1;
+
+    int result = 0;
+    bool found = false;
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        if (strcmp(name, "all") != 0 && strcmp(name, backends[i].name) != 0) continue;
+        found = true;
+        result |= run_backend(&backends[i], connections, depth, seconds);
+    }
+
+    if (!found) {
+        fprintf(stderr, "unknown backend %s\n", name);
+        return 1;
+    }
+    return result;
+}
@@ -0,0 +1,223 @@
+/*
+ * Modbus UDP loopback benchmark
+ *
+ * Runs the server on one thread and drives it from a second thread over
+ * loopback with a number of client sockets, each keeping a fixed number of
+ * Read Holding Registers requests in flight. Clients send and receive in
+ * batches too. Reports the datagram rate, the datagrams handled per server
+ * system call and the requests lost (re-sent after 20 ms of silence).
+ *
+ *     bench_udp [clients] [depth] [seconds]
+ */
+#define _GNU_SOURCE
+
+#include "modbus_udp_server.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#define BENCH_REGISTERS    10
+#define BENCH_REQUEST_LEN  12
+#define BENCH_RESPONSE_LEN (9 + BENCH_REGISTERS * 2)
+#define BENCH_MAX_DEPTH    64
+#define BENCH_LOSS_MS      20
+
+typedef struct {
+    int fd;
+    uint16_t next_id;    /* Transaction id of the next request */
+    unsigned in_flight;  /* Requests sent and not answered yet */
+} BenchClient;
+
+static atomic_bool stop;
+static uint16_t registers[BENCH_REGISTERS];
+static ModbusSlave slave;
+static ModbusUdpServer server;
+
+static void bench_write(const uint8_t *data, uint16_t length) {
+    (void)data;
+    (void)length;
+}
+
+static ModbusExceptionCode bench_read_holding_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    if ((uint32_t)addr + count > BENCH_REGISTERS) return MODBUS_EX_ILLEGAL_DATA_ADDRESS;
+
+    for (uint16_t i = 0; i < count; i++) {
+        modbus_be16_set(&dest[i * 2], registers[addr + i]);
+    }
+    return MODBUS_EX_NONE;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void *server_thread(void *arg) {
+    (void)arg;
+
+    while (!atomic_load(&stop)) {
+        if (modbus_udp_server_poll(&server, 10) < 0) {
+            perror("poll");
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Send count requests from a client with one system call
+ */
+static void send_requests(BenchClient *client, unsigned count) {
+    uint8_t requests[BENCH_MAX_DEPTH][BENCH_REQUEST_LEN];
+    struct iovec iov[BENCH_MAX_DEPTH];
+    struct mmsghdr msgs[BENCH_MAX_DEPTH];
+
+    memset(msgs, 0, count * sizeof(msgs[0]));
+    for (unsigned i = 0; i < count; i++) {
+        const uint8_t request[BENCH_REQUEST_LEN] = {0, 0, 0x00, 0x00, 0x00, 0x06, 0xFF, 0x03, 0x00, 0x00, 0x00, BENCH_REGISTERS};
+        memcpy(requests[i], request, sizeof(request));
+        modbus_be16_set(requests[i], client->next_id++);
+        iov[i].iov_base = requests[i];
+        iov[i].iov_len = BENCH_REQUEST_LEN;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int sent = sendmmsg(client->fd, msgs, count, 0);
+    if (sent < 0) {
+        perror("sendmmsg");
+        exit(1);
+    }
+    client->in_flight += (unsigned)sent;
+}
+
+/**
+ * Receive the responses waiting for a client with one system call
+ * @return Number of responses
+ */
+static unsigned recv_responses(BenchClient *client) {
+    static uint8_t responses[BENCH_MAX_DEPTH][BENCH_RESPONSE_LEN];
+    struct iovec iov[BENCH_MAX_DEPTH];
+    struct mmsghdr msgs[BENCH_MAX_DEPTH];
+
+    memset(msgs, 0, sizeof(msgs));
+    for (unsigned i = 0; i < BENCH_MAX_DEPTH; i++) {
+        iov[i].iov_base = responses[i];
+        iov[i].iov_len = BENCH_RESPONSE_LEN;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int count = recvmmsg(client->fd, msgs, BENCH_MAX_DEPTH, MSG_DONTWAIT, NULL);
+    if (count <= 0) return 0;
+
+    unsigned answered = (unsigned)count < client->in_flight ? (unsigned)count : client->in_flight;
+    client->in_flight -= answered;
+    return (unsigned)count;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned clients_count = argc > 1 ? (unsigned)atoi(argv[1]) : 16;
+    unsigned depth = argc > 2 ? (unsigned)atoi(argv[2]) : 8;
+    unsigned seconds = argc > 3 ? (unsigned)atoi(argv[3]) : 2;
+
+    if (clients_count == 0 || depth == 0 || depth > BENCH_MAX_DEPTH) {
+        fprintf(stderr, "usage: %s [clients] [depth 1-%u] [seconds]\n", argv[0], BENCH_MAX_DEPTH);
+        return 1;
+    }
+
+    ModbusSlaveConfig config = {
+        .address = 0x01,
+        .write = bench_write,
+        .read_holding_registers = bench_read_holding_registers,
+    };
+    if (modbus_slave_init(&slave, &config) != 0) return 1;
+
+    ModbusUdpServerConfig server_config = { .address = "127.0.0.1", .port = 0, .rcvbuf = 1u << 20 };
+    if (modbus_udp_server_init(&server, &slave, &server_config) != 0) {
+        perror("udp init");
+        return 1;
+    }
+
+    atomic_store(&stop, false);
+    pthread_t thread;
+    pthread_create(&thread, NULL, server_thread, NULL);
+
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(modbus_udp_server_port(&server)) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int epoll_fd = epoll_create1(0);
+    BenchClient *clients = calloc(clients_count, sizeof(*clients));
+    if (!clients) return 1;
+
+    for (unsigned i = 0; i < clients_count; i++) {
+        clients[i].fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (connect(clients[i].fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            perror("connect");
+            return 1;
+        }
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &clients[i] };
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clients[i].fd, &ev);
+        send_requests(&clients[i], depth);
+    }
+
+    uint64_t completed = 0;
+    uint64_t lost = 0;
+    uint64_t start = now_ns();
+    uint64_t end = start + (uint64_t)seconds * 1000000000u;
+    struct epoll_event events[256];
+
+    while (now_ns() < end) {
+        int count = epoll_wait(epoll_fd, events, 256, BENCH_LOSS_MS);
+
+        if (count == 0) {
+            // Nothing came back for a while: what is still in flight is lost
+            for (unsigned i = 0; i < clients_count; i++) {
+                lost += clients[i].in_flight;
+                clients[i].in_flight = 0;
+                send_requests(&clients[i], depth);
+            }
+            continue;
+        }
+
+        for (int e = 0; e < count; e++) {
+            BenchClient *client = events[e].data.ptr;
+            unsigned answered = recv_responses(client);
+
+            completed += answered;
+            if (client->in_flight < depth) send_requests(client, depth - client->in_flight);
+        }
+    }
+
+    double elapsed = (double)(now_ns() - start) / 1e9;
+    atomic_store(&stop, true);
+    pthread_join(thread, NULL);
+
+    printf("udp: %u clients, depth %u, %.1f s\n", clients_count, depth, elapsed);
+    printf("  %.0f datagrams/s\n", (double)completed / elapsed);
+    if (server.stats.receives) {
+        printf("  %.2f requests per receive, %.2f per send\n",
+               (double)server.stats.requests / (double)server.stats.receives,
+               (double)server.stats.requests / (double)(server.stats.sends ? server.stats.sends : 1));
+    }
+    printf("  %llu requests lost\n", (unsigned long long)lost);
+
+    for (unsigned i = 0; i < clients_count; i++) {
+        close(clients[i].fd);
+    }
+    close(epoll_fd);
+    modbus_udp_server_close(&server);
+    free(clients);
+    return 0;
+}
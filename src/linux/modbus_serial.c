@@ -0,0 +1,317 @@
+#define _GNU_SOURCE
+
+#include "modbus_serial.h"
+#include "modbus_rtu.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+
+/* Port whose frame is being processed, for modbus_serial_write() */
+static _Thread_local ModbusSerialPort *serial_current;
+
+// =============================================================================
+// Line settings
+// =============================================================================
+
+/**
+ * Get the termios constant of a bit rate
+ * @return Speed, 0 if the rate is not supported
+ */
+static speed_t serial_speed(uint32_t baud) {
+    switch (baud) {
+        case 1200: return B1200;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return 0;
+    }
+}
+
+/**
+ * Get the silence that ends a frame, 3.5 character times of 11 bits or
+ * 1750 us above 19200 bit/s as the specification fixes it
+ */
+static uint32_t serial_t35_us(uint32_t baud) {
+    if (baud > 19200) return 1750;
+    return (38500000u + baud - 1) / baud; // 3.5 * 11 bits in microseconds, rounded up
+}
+
+/**
+ * Put the tty in raw mode with the configured character format
+ * @return 0 on success, -1 on error (errno is set)
+ */
+static int serial_configure(int fd, const ModbusSerialConfig *cfg) {
+    speed_t speed = serial_speed(cfg->baud);
+    char parity = cfg->parity ? cfg->parity : 'E';
+    uint8_t stop_bits = cfg->stop_bits ? cfg->stop_bits : (parity == 'N' ? 2 : 1);
+    struct termios tio;
+
+    if (!speed || (parity != 'N' && parity != 'E' && parity != 'O') || stop_bits > 2) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (tcgetattr(fd, &tio) != 0) return -1;
+
+    cfmakeraw(&tio);
+    tio.c_cflag &= ~(CSIZE | PARENB | PARODD | CSTOPB | CRTSCTS);
+    tio.c_cflag |= CS8 | CLOCAL | CREAD;
+    if (parity != 'N') tio.c_cflag |= PARENB;
+    if (parity == 'O') tio.c_cflag |= PARODD;
+    if (stop_bits == 2) tio.c_cflag |= CSTOPB;
+
+    // Reads return what is buffered at once, frame gaps are timed by the timerfd
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+
+    if (cfsetispeed(&tio, speed) != 0 || cfsetospeed(&tio, speed) != 0) return -1;
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) return -1;
+    return tcflush(fd, TCIOFLUSH);
+}
+
+/**
+ * Apply the driver options of the configuration
+ * @return 0 on success, -1 if RS-485 mode was refused (errno is set)
+ */
+static int serial_configure_driver(int fd, const ModbusSerialConfig *cfg) {
+    if (cfg->low_latency) {
+        struct serial_struct serial;
+
+        // Ignored where unsupported, e.g. on ptys
+        if (ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+            serial.flags |= ASYNC_LOW_LATENCY;
+            (void)ioctl(fd, TIOCSSERIAL, &serial);
+        }
+    }
+
+    if (cfg->rs485) {
+        struct serial_rs485 rs485;
+
+        memset(&rs485, 0, sizeof(rs485));
+        rs485.flags = SER_RS485_ENABLED;
+        rs485.flags |= cfg->rs485_rts_active_low ? SER_RS485_RTS_AFTER_SEND : SER_RS485_RTS_ON_SEND;
+        rs485.delay_rts_before_send = cfg->rs485_delay_before_ms;
+        rs485.delay_rts_after_send = cfg->rs485_delay_after_ms;
+        if (ioctl(fd, TIOCSRS485, &rs485) != 0) return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Restart the frame timer after bytes were received, or stop it if gap_us is 0
+ */
+static void serial_arm_timer(ModbusSerialPort *port, uint32_t gap_us) {
+    struct itimerspec timer;
+
+    memset(&timer, 0, sizeof(timer));
+    timer.it_value.tv_sec = gap_us / 1000000u;
+    timer.it_value.tv_nsec = (long)(gap_us % 1000000u) * 1000;
+    (void)timerfd_settime(port->timer_fd, 0, &timer, NULL);
+}
+
+/**
+ * Check whether the bytes received since the frame started are a complete
+ * request, by the length rules of its function code and its CRC
+ */
+static bool serial_frame_complete(const ModbusSerialPort *port) {
+    if (port->frame_len > sizeof(port->frame)) return false;
+
+    int32_t frame_len = modbus_rtu_request_length(port->frame, port->frame_len);
+    return frame_len > 0 && (uint32_t)frame_len == port->frame_len;
+}
+
+/**
+ * End the frame being received and answer it
+ */
+static void serial_end_frame(ModbusSerialPort *port) {
+    // Bulk reads do not show gaps inside a frame, so 1.5t is only signalled at its end
+    port->stats.frames++;
+    port->frame_len = 0;
+    modbus_slave_1_5t_elapsed(port->slave);
+    modbus_slave_3_5t_elapsed(port->slave);
+
+    serial_current = port;
+    modbus_slave_poll(port->slave);
+    serial_current = NULL;
+}
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+/**
+ * Open and configure a serial port serving a slave
+ *
+ * The slave must be initialized with modbus_serial_write() as its write
+ * callback, which sends the response on the port whose frame is processed.
+ * @param port  Port instance
+ * @param slave Initialized slave answering the requests
+ * @param cfg   Device, character format and driver options
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int modbus_serial_open(ModbusSerialPort *port, ModbusSlave *slave, const ModbusSerialConfig *cfg) {
+    if (!port || !slave || !cfg || !cfg->path) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(port, 0, sizeof(*port));
+    port->slave = slave;
+    port->gap_us = serial_t35_us(cfg->baud);
+    if (cfg->frame_gap_us > port->gap_us) port->gap_us = cfg->frame_gap_us;
+    port->timer_fd = -1;
+
+    port->fd = open(cfg->path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (port->fd < 0) return -1;
+
+    port->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (port->timer_fd < 0 || serial_configure(port->fd, cfg) != 0 || serial_configure_driver(port->fd, cfg) != 0) {
+        int saved = errno;
+        modbus_serial_close(port);
+        errno = saved;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Feed the slave with the bytes buffered by the tty - call when the tty is
+ * readable
+ *
+ * Answers the frame at once if the bytes make up a complete request,
+ * otherwise restarts the frame timer once per call, however many bytes
+ * were read.
+ * @return Number of bytes received, -1 on error
+ */
+int modbus_serial_on_readable(ModbusSerialPort *port) {
+    uint8_t buffer[MODBUS_SERIAL_READ_SIZE];
+    int total = 0;
+
+    for (;;) {
+        ssize_t n = read(port->fd, buffer, sizeof(buffer));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+
+        for (ssize_t i = 0; i < n; ++i) {
+            modbus_slave_rx_byte(port->slave, buffer[i]);
+        }
+        if (port->frame_len < sizeof(port->frame)) {
+            size_t room = sizeof(port->frame) - port->frame_len;
+            memcpy(&port->frame[port->frame_len], buffer, (size_t)n < room ? (size_t)n : room);
+        }
+        port->frame_len += (uint32_t)n;
+        total += (int)n;
+        if (n < (ssize_t)sizeof(buffer)) break; // A short read emptied the tty
+    }
+
+    if (total) {
+        port->stats.reads++;
+        port->stats.bytes += (uint64_t)total;
+        if (serial_frame_complete(port)) {
+            serial_arm_timer(port, 0);
+            serial_end_frame(port);
+        } else {
+            serial_arm_timer(port, port->gap_us);
+        }
+    }
+    return total;
+}
+
+/**
+ * End a frame whose length was not recognized and answer it - call when
+ * the timer is readable
+ *
+ * Handle a readable tty first when both are reported at once: receiving
+ * restarts the timer, and this call then finds it unexpired and returns.
+ * @return 1 if a frame ended, 0 if the timer had not expired, -1 on error
+ */
+int modbus_serial_on_timer(ModbusSerialPort *port) {
+    uint64_t expirations;
+
+    if (read(port->timer_fd, &expirations, sizeof(expirations)) < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+
+    port->stats.timed_frames++;
+    serial_end_frame(port);
+    return 1;
+}
+
+/**
+ * Wait for input or the end of a frame and handle them - call in a loop
+ * @param port       Port instance
+ * @param timeout_ms Longest wait in milliseconds, -1 to wait indefinitely
+ * @return Number of events handled, -1 on error
+ */
+int modbus_serial_poll(ModbusSerialPort *port, int timeout_ms) {
+    struct pollfd pfd[2] = {
+        { .fd = port->fd, .events = POLLIN },
+        { .fd = port->timer_fd, .events = POLLIN },
+    };
+
+    int ready = poll(pfd, 2, timeout_ms);
+    if (ready <= 0) return (ready < 0 && errno != EINTR) ? -1 : 0;
+
+    if ((pfd[0].revents & POLLIN) && modbus_serial_on_readable(port) < 0) return -1;
+    if ((pfd[1].revents & POLLIN) && modbus_serial_on_timer(port) < 0) return -1;
+    return ready;
+}
+
+/**
+ * Write callback for slaves served by modbus_serial_open()
+ *
+ * Sends the frame on the port whose frame is being processed by this
+ * thread, waiting up to MODBUS_SERIAL_TX_TIMEOUT_MS for the tty to take it.
+ */
+void modbus_serial_write(const uint8_t *data, uint16_t length) {
+    ModbusSerialPort *port = serial_current;
+    if (!port) return;
+
+    while (length) {
+        ssize_t n = write(port->fd, data, length);
+
+        if (n > 0) {
+            data += n;
+            length = (uint16_t)(length - n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd pfd = { .fd = port->fd, .events = POLLOUT };
+            if (poll(&pfd, 1, MODBUS_SERIAL_TX_TIMEOUT_MS) > 0) continue;
+        }
+
+        port->stats.tx_errors++;
+        return;
+    }
+
+    port->stats.responses++;
+}
+
+/**
+ * Close the port and its timer
+ */
+void modbus_serial_close(ModbusSerialPort *port) {
+    if (port->timer_fd >= 0) close(port->timer_fd);
+    if (port->fd >= 0) close(port->fd);
+    port->timer_fd = -1;
+    port->fd = -1;
+}
@@ -0,0 +1,97 @@
+#ifndef MODBUS_SERIAL_H
+#define MODBUS_SERIAL_H
+
+#include "modbus_slave.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Modbus RTU slave on a Linux serial port.
+ *
+ * The port is put in raw mode and read without blocking: every read takes
+ * all the bytes the tty has buffered and feeds them to the slave. A frame
+ * ends as soon as the bytes received make up a request whose length follows
+ * from its function code and whose CRC checks out, as with RTU over TCP.
+ * Otherwise a timerfd armed after each read ends it once no bytes arrived
+ * for 3.5 character times, or for frame_gap_us if that is longer. The frame
+ * is then processed and its response written before the next read, so a
+ * request costs a few system calls however it is split by the UART.
+ *
+ * The timer measures the silence between reads, not on the wire. USB serial
+ * adapters hand over received bytes in packets, by default every 16 ms for
+ * FTDI chips unless low_latency is set, so a frame whose length is not
+ * recognized would be cut at every packet; set frame_gap_us above the
+ * packet interval for them.
+ *
+ * RS-485 direction control is left to the UART driver (TIOCSRS485), which
+ * drives RTS around every transmission without software timing.
+ */
+
+/* Bytes taken from the tty per read */
+#ifndef MODBUS_SERIAL_READ_SIZE
+#define MODBUS_SERIAL_READ_SIZE 512
+#endif
+
+/* Longest wait for the tty to take a response */
+#ifndef MODBUS_SERIAL_TX_TIMEOUT_MS
+#define MODBUS_SERIAL_TX_TIMEOUT_MS 1000
+#endif
+
+/*==============================
+    Configuration
+==============================*/
+typedef struct {
+    const char *path;               /* Device, e.g. "/dev/ttyS1" */
+    uint32_t baud;                  /* Bit rate, one of the standard termios rates */
+    char parity;                    /* 'N', 'E' or 'O', 0 for 'E' as the Modbus default */
+    uint8_t stop_bits;              /* 1 or 2, 0 for 2 without parity and 1 with it */
+    uint32_t frame_gap_us;          /* Silence ending a frame of unrecognized length, 0 for 3.5 character times */
+    bool low_latency;               /* ASYNC_LOW_LATENCY, best effort: not every driver supports it */
+    bool rs485;                     /* Let the UART driver drive RTS for RS-485 direction control */
+    bool rs485_rts_active_low;      /* RTS low while sending instead of high */
+    uint32_t rs485_delay_before_ms; /* RTS asserted this long before the first bit */
+    uint32_t rs485_delay_after_ms;  /* RTS held this long after the last bit */
+} ModbusSerialConfig;
+
+typedef struct {
+    uint64_t bytes;        /* Bytes received */
+    uint32_t reads;        /* Reads that returned data */
+    uint32_t frames;       /* Frames ended, by their length or the frame timer */
+    uint32_t timed_frames; /* Frames ended by the frame timer */
+    uint32_t responses;    /* Responses written */
+    uint32_t tx_errors;    /* Responses the port would not take */
+} ModbusSerialStats;
+
+/*==============================
+    Port structure
+==============================*/
+typedef struct {
+    ModbusSlave *slave;
+    int fd;             /* tty, watch for input */
+    int timer_fd;       /* Frame timer, watch for input */
+    uint32_t gap_us;    /* Silence that ends a frame of unrecognized length */
+    uint32_t frame_len; /* Bytes received since the frame started */
+    uint8_t frame[MODBUS_MAX_FRAME_LENGTH]; /* Their copy, to recognize the end of the frame */
+    ModbusSerialStats stats;
+} ModbusSerialPort;
+
+/*==============================
+    Public API
+==============================*/
+int modbus_serial_open(ModbusSerialPort *port, ModbusSlave *slave, const ModbusSerialConfig *cfg);
+int modbus_serial_on_readable(ModbusSerialPort *port);
+int modbus_serial_on_timer(ModbusSerialPort *port);
+int modbus_serial_poll(ModbusSerialPort *port, int timeout_ms);
+void modbus_serial_write(const uint8_t *data, uint16_t length);
+void modbus_serial_close(ModbusSerialPort *port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_SERIAL_H */
@@ -0,0 +1,225 @@
+#define _GNU_SOURCE
+
+#include "modbus_serial_server.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+/* Longest time a worker takes to notice modbus_serial_server_close() */
+#define MODBUS_SERIAL_SERVER_POLL_MS 100
+
+/* Set in the epoll data of a frame timer, the other bits hold the port index */
+#define SERIAL_TIMER_TAG 1u
+
+// =============================================================================
+// Event loops
+// =============================================================================
+
+/**
+ * Stop watching a port whose tty failed; the port itself stays open
+ */
+static void serial_server_drop(ModbusSerialServer *server, ModbusSerialWorker *loop, unsigned index) {
+    ModbusSerialPort *port = server->ports[index];
+
+    (void)epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, port->fd, NULL);
+    (void)epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, port->timer_fd, NULL);
+    server->ports[index] = NULL;
+    loop->ports--;
+    atomic_fetch_add_explicit(&server->lost, 1, memory_order_relaxed);
+}
+
+/**
+ * Wait for input or frame ends on the ports of a loop and handle them
+ * @return Number of events handled, -1 on error
+ */
+static int serial_loop_poll(ModbusSerialServer *server, ModbusSerialWorker *loop, int timeout_ms) {
+    struct epoll_event events[MODBUS_SERIAL_SERVER_EVENTS];
+
+    int ready = epoll_wait(loop->epoll_fd, events, MODBUS_SERIAL_SERVER_EVENTS, timeout_ms);
+    if (ready <= 0) return (ready < 0 && errno != EINTR) ? -1 : 0;
+
+    // Every tty first: receiving restarts the frame timer, so an expiry reported in the same batch is stale
+    for (int i = 0; i < ready; ++i) {
+        if (events[i].data.u64 & SERIAL_TIMER_TAG) continue;
+
+        unsigned index = (unsigned)(events[i].data.u64 >> 1);
+        ModbusSerialPort *port = server->ports[index];
+        if (!port) continue;
+
+        int received = modbus_serial_on_readable(port);
+        if (received < 0 || (received == 0 && (events[i].events & (EPOLLHUP | EPOLLERR)))) {
+            serial_server_drop(server, loop, index);
+        }
+    }
+
+    for (int i = 0; i < ready; ++i) {
+        if (!(events[i].data.u64 & SERIAL_TIMER_TAG)) continue;
+
+        unsigned index = (unsigned)(events[i].data.u64 >> 1);
+        ModbusSerialPort *port = server->ports[index];
+        if (port && modbus_serial_on_timer(port) < 0) serial_server_drop(server, loop, index);
+    }
+
+    return ready;
+}
+
+/**
+ * Worker thread: serve the ports of its loop until the server is closed
+ */
+static void *serial_worker_main(void *arg) {
+    ModbusSerialWorker *loop = arg;
+    ModbusSerialServer *server = loop->owner;
+
+    while (atomic_load_explicit(&server->running, memory_order_relaxed)) {
+        if (serial_loop_poll(server, loop, MODBUS_SERIAL_SERVER_POLL_MS) < 0) break;
+    }
+    return NULL;
+}
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+/**
+ * Initialize a multi-port serial server
+ * @param server Server instance
+ * @param cfg    Number of worker threads, NULL for none
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int modbus_serial_server_init(ModbusSerialServer *server, const ModbusSerialServerConfig *cfg) {
+    unsigned workers = cfg ? cfg->workers : 0;
+
+    if (!server || workers > MODBUS_SERIAL_SERVER_MAX_WORKERS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->threaded = workers > 0;
+    server->loop_count = workers ? workers : 1;
+    atomic_init(&server->running, false);
+    atomic_init(&server->lost, 0);
+
+    for (unsigned i = 0; i < MODBUS_SERIAL_SERVER_MAX_WORKERS; ++i) {
+        server->loops[i].epoll_fd = -1;
+    }
+
+    for (unsigned i = 0; i < server->loop_count; ++i) {
+        ModbusSerialWorker *loop = &server->loops[i];
+
+        loop->owner = server;
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epoll_fd < 0) {
+            int saved = errno;
+            modbus_serial_server_close(server);
+            errno = saved;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Serve an open port, on the loop with the fewest ports
+ *
+ * Ports are added before modbus_serial_server_start(). The port stays owned
+ * by the caller and must outlive the server.
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int modbus_serial_server_add(ModbusSerialServer *server, ModbusSerialPort *port) {
+    if (!port || port->fd < 0 || port->timer_fd < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (server->started) {
+        errno = EBUSY;
+        return -1;
+    }
+    if (server->port_count >= MODBUS_SERIAL_SERVER_MAX_PORTS) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    ModbusSerialWorker *loop = &server->loops[0];
+    for (unsigned i = 1; i < server->loop_count; ++i) {
+        if (server->loops[i].ports < loop->ports) loop = &server->loops[i];
+    }
+
+    unsigned index = server->port_count;
+    struct epoll_event tty = { .events = EPOLLIN, .data.u64 = (uint64_t)index << 1 };
+    struct epoll_event timer = { .events = EPOLLIN, .data.u64 = ((uint64_t)index << 1) | SERIAL_TIMER_TAG };
+
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, port->fd, &tty) != 0) return -1;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, port->timer_fd, &timer) != 0) {
+        int saved = errno;
+        (void)epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, port->fd, NULL);
+        errno = saved;
+        return -1;
+    }
+
+    server->ports[index] = port;
+    server->port_count++;
+    loop->ports++;
+    return 0;
+}
+
+/**
+ * Wait for input or frame ends on any port and handle them - call in a loop
+ * when the server has no workers
+ * @param server     Server instance
+ * @param timeout_ms Longest wait in milliseconds, -1 to wait indefinitely
+ * @return Number of events handled, -1 on error
+ */
+int modbus_serial_server_poll(ModbusSerialServer *server, int timeout_ms) {
+    if (server->threaded) {
+        errno = EINVAL;
+        return -1;
+    }
+    return serial_loop_poll(server, &server->loops[0], timeout_ms);
+}
+
+/**
+ * Start the worker threads of a server configured with workers
+ * @return 0 on success, -1 on error (errno is set, no worker runs)
+ */
+int modbus_serial_server_start(ModbusSerialServer *server) {
+    if (!server->threaded || server->started) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    atomic_store(&server->running, true);
+    for (; server->started < server->loop_count; ++server->started) {
+        ModbusSerialWorker *loop = &server->loops[server->started];
+        int err = pthread_create(&loop->thread, NULL, serial_worker_main, loop);
+
+        if (err != 0) {
+            atomic_store(&server->running, false);
+            while (server->started) {
+                pthread_join(server->loops[--server->started].thread, NULL);
+            }
+            errno = err;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Stop the workers and release the event loops; the ports stay open
+ */
+void modbus_serial_server_close(ModbusSerialServer *server) {
+    atomic_store(&server->running, false);
+    while (server->started) {
+        pthread_join(server->loops[--server->started].thread, NULL);
+    }
+
+    for (unsigned i = 0; i < server->loop_count; ++i) {
+        if (server->loops[i].epoll_fd >= 0) close(server->loops[i].epoll_fd);
+        server->loops[i].epoll_fd = -1;
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef MODBUS_SERIAL_SERVER_H
+#define MODBUS_SERIAL_SERVER_H
+
+#include "modbus_serial.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Modbus RTU slaves on many Linux serial ports, served by one process.
+ *
+ * Every port keeps its own ModbusSlave and frame timer, and the server
+ * watches the tty and timer descriptors of all of them through one epoll
+ * instance per loop. Without workers the caller drives the single loop with
+ * modbus_serial_server_poll(); with workers every worker thread runs a loop
+ * of its own and the ports are spread over the workers, least loaded first.
+ * A port is only ever served by its worker, so nothing is locked, but the
+ * application data behind the callbacks of slaves on different workers must
+ * be thread-safe.
+ *
+ * A port whose tty fails, e.g. an unplugged USB adapter, is dropped from its
+ * loop and counted in lost; the other ports keep being served.
+ */
+
+/* Ports per server */
+#ifndef MODBUS_SERIAL_SERVER_MAX_PORTS
+#define MODBUS_SERIAL_SERVER_MAX_PORTS 32
+#endif
+
+/* Worker threads per server */
+#ifndef MODBUS_SERIAL_SERVER_MAX_WORKERS
+#define MODBUS_SERIAL_SERVER_MAX_WORKERS 8
+#endif
+
+/* Events taken from epoll per wait */
+#ifndef MODBUS_SERIAL_SERVER_EVENTS
+#define MODBUS_SERIAL_SERVER_EVENTS 64
+#endif
+
+/*==============================
+    Configuration
+==============================*/
+typedef struct {
+    unsigned workers; /* Worker threads, 0 to poll from the caller's thread */
+} ModbusSerialServerConfig;
+
+/*==============================
+    Server structure
+==============================*/
+typedef struct ModbusSerialServer ModbusSerialServer;
+
+/* Cache line aligned, so workers never write to a line another worker uses */
+typedef struct {
+    _Alignas(64) ModbusSerialServer *owner;
+    pthread_t thread;
+    int epoll_fd;
+    unsigned ports; /* Ports served by this loop */
+} ModbusSerialWorker;
+
+struct ModbusSerialServer {
+    ModbusSerialWorker loops[MODBUS_SERIAL_SERVER_MAX_WORKERS];
+    unsigned loop_count;
+    ModbusSerialPort *ports[MODBUS_SERIAL_SERVER_MAX_PORTS];
+    unsigned port_count;
+    bool threaded;    /* Loops run in worker threads */
+    unsigned started; /* Worker threads running */
+    atomic_bool running;
+    atomic_uint lost; /* Ports dropped after a tty error */
+};
+
+/*==============================
+    Public API
+==============================*/
+int modbus_serial_server_init(ModbusSerialServer *server, const ModbusSerialServerConfig *cfg);
+int modbus_serial_server_add(ModbusSerialServer *server, ModbusSerialPort *port);
+int modbus_serial_server_poll(ModbusSerialServer *server, int timeout_ms);
+int modbus_serial_server_start(ModbusSerialServer *server);
+void modbus_serial_server_close(ModbusSerialServer *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_SERIAL_SERVER_H */
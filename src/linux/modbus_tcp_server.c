@@ -0,0 +1,582 @@
+#define _GNU_SOURCE
+
+#include "modbus_tcp_server.h"
+#include "modbus_rtu.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+
+/* Readiness events handled per epoll_wait() call */
+#define MODBUS_TCP_SERVER_EVENTS 256
+
+#define MODBUS_TCP_SERVER_RX_MASK (MODBUS_TCP_SERVER_RX_SIZE - 1)
+
+#define TCP_CONNECTION_OF_TIMER(t) \
+    ((ModbusTcpConnection *)((char *)(t) - offsetof(ModbusTcpConnection, timer)))
+
+// =============================================================================
+// Connections
+// =============================================================================
+
+/**
+ * Change the epoll events watched on a connection
+ * @return 0 on success, -1 on error
+ */
+static int tcp_connection_watch(ModbusTcpServer *server, ModbusTcpConnection *conn, uint32_t events) {
+    if (conn->events == events) return 0;
+
+    struct epoll_event ev = { .events = events, .data.ptr = conn };
+    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev) != 0) return -1;
+
+    conn->events = events;
+    return 0;
+}
+
+/**
+ * Close a connection and release it
+ */
+static void tcp_connection_close(ModbusTcpServer *server, ModbusTcpConnection *conn) {
+    close(conn->fd); // Also removes it from the epoll set
+    modbus_timer_wheel_cancel(&server->timers, &conn->timer);
+
+    if (conn->prev) conn->prev->next = conn->next;
+    else server->connections = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+
+    server->connection_count--;
+    modbus_pool_free(&server->sessions, conn);
+}
+
+/**
+ * Restart the timeout of a connection after activity
+ *
+ * A connection in the middle of a request or response gets the request
+ * timeout, an idle one the idle timeout. Usually only the deadline moves;
+ * the timer is moved when the deadline gets earlier, and a later deadline
+ * is picked up when the timer fires.
+ */
+static void tcp_connection_arm(ModbusTcpServer *server, ModbusTcpConnection *conn) {
+    bool busy = conn->tx_len != 0 || conn->rx_head != conn->rx_tail;
+    uint32_t ticks = busy && server->request_ticks ? server->request_ticks : server->idle_ticks;
+
+    if (ticks == 0) {
+        modbus_timer_wheel_cancel(&server->timers, &conn->timer);
+        return;
+    }
+
+    conn->deadline = server->tick + ticks;
+    if (!modbus_timer_pending(&conn->timer) || conn->timer.expires > conn->deadline) {
+        modbus_timer_wheel_add(&server->timers, &conn->timer, conn->deadline);
+    }
+}
+
+/**
+ * Send the queued responses
+ *
+ * Responses the socket cannot take at once stay queued and the connection
+ * waits for EPOLLOUT instead of EPOLLIN, so a client that stops reading
+ * stops being served rather than growing a backlog.
+ * @return 0 on success, -1 if the connection failed
+ */
+static int tcp_connection_flush(ModbusTcpServer *server, ModbusTcpConnection *conn) {
+    while (conn->tx_sent < conn->tx_len) {
+        ssize_t n = send(conn->fd, &conn->tx[conn->tx_sent], conn->tx_len - conn->tx_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return tcp_connection_watch(server, conn, EPOLLOUT);
+            return -1;
+        }
+        conn->tx_sent += (uint16_t)n;
+        server->stats.sends++;
+    }
+
+    conn->tx_len = 0;
+    conn->tx_sent = 0;
+    return tcp_connection_watch(server, conn, EPOLLIN);
+}
+
+/**
+ * Get length contiguous bytes at the head of the receive ring
+ *
+ * Only data that wraps around the end of the ring is copied, to scratch.
+ */
+static const uint8_t *tcp_connection_peek(const ModbusTcpConnection *conn, uint16_t length, uint8_t *scratch) {
+    uint16_t head = conn->rx_head & MODBUS_TCP_SERVER_RX_MASK;
+    if (head + length <= MODBUS_TCP_SERVER_RX_SIZE) return &conn->rx[head];
+
+    uint16_t first = MODBUS_TCP_SERVER_RX_SIZE - head;
+    memcpy(scratch, &conn->rx[head], first);
+    memcpy(&scratch[first], conn->rx, length - first);
+    return scratch;
+}
+
+/**
+ * Delimit the request at the head of the receive ring
+ *
+ * With RTU framing, bytes that do not start a frame with a valid CRC are
+ * skipped, so a stream resynchronizes on the next intact request.
+ * @return Request length, 0 if it is incomplete, -1 if the connection must
+ *         be closed
+ */
+static int32_t tcp_connection_frame(ModbusTcpServer *server, ModbusTcpConnection *conn, uint8_t *scratch) {
+    for (;;) {
+        uint16_t available = (uint16_t)(conn->rx_tail - conn->rx_head);
+
+        if (server->framing == MODBUS_TCP_FRAMING_MBAP) {
+            if (available < MODBUS_MBAP_HEADER_LENGTH) return 0;
+
+            const uint8_t *header = tcp_connection_peek(conn, MODBUS_MBAP_HEADER_LENGTH, scratch);
+            int32_t adu_len = modbus_tcp_adu_length(header, MODBUS_MBAP_HEADER_LENGTH);
+            if (adu_len < 0) { // Framing lost, nothing after this point can be trusted
+                server->stats.dropped++;
+                return -1;
+            }
+            return adu_len > available ? 0 : adu_len;
+        }
+
+        uint16_t length = available < MODBUS_MAX_FRAME_LENGTH ? available : MODBUS_MAX_FRAME_LENGTH;
+        int32_t frame_len = modbus_rtu_request_length(tcp_connection_peek(conn, length, scratch), length);
+        if (frame_len >= 0) return frame_len;
+
+        conn->rx_head++;
+        server->stats.skipped++;
+    }
+}
+
+/**
+ * Answer every complete request in the receive ring
+ *
+ * The responses are collected in the transmit buffer and leave together in
+ * one send. Only when the buffer cannot take another maximum size response
+ * is it sent early, and processing pauses while a send is incomplete.
+ * @return 0 on success, -1 if the connection must be closed
+ */
+static int tcp_connection_process(ModbusTcpServer *server, ModbusTcpConnection *conn) {
+    uint8_t scratch[MODBUS_TCP_MAX_ADU_LENGTH];
+
+    for (;;) {
+        bool full = false;
+
+        for (;;) {
+            if (MODBUS_TCP_SERVER_TX_SIZE - conn->tx_len < MODBUS_TCP_MAX_ADU_LENGTH) {
+                full = true;
+                break;
+            }
+
+            int32_t adu_len = tcp_connection_frame(server, conn, scratch);
+            if (adu_len < 0) return -1;
+            if (adu_len == 0) break;
+
+            const uint8_t *adu = tcp_connection_peek(conn, (uint16_t)adu_len, scratch);
+            uint16_t response_len = 0;
+            if (server->framing == MODBUS_TCP_FRAMING_RTU) {
+                modbus_rtu_process_adu(server->slave, adu, (uint16_t)adu_len, &conn->tx[conn->tx_len], &response_len);
+            } else {
+                modbus_tcp_process_adu(server->slave, adu, (uint16_t)adu_len, &conn->tx[conn->tx_len], &response_len);
+            }
+            conn->tx_len += response_len;
+            conn->rx_head += (uint16_t)adu_len;
+            server->stats.requests++;
+        }
+
+        // Restart an empty ring at its beginning, so the next requests rarely wrap
+        if (conn->rx_head == conn->rx_tail) conn->rx_head = conn->rx_tail = 0;
+
+        if (conn->tx_len == 0) return 0;
+        if (tcp_connection_flush(server, conn) != 0) return -1;
+        if (conn->tx_len != 0 || !full) return 0;
+    }
+}
+
+/**
+ * Receive into the free space of the ring with one system call
+ * @return Bytes received, 0 if closed by the client, -1 on error
+ */
+static ssize_t tcp_connection_recv(ModbusTcpConnection *conn) {
+    uint16_t free_space = MODBUS_TCP_SERVER_RX_SIZE - (uint16_t)(conn->rx_tail - conn->rx_head);
+    uint16_t tail = conn->rx_tail & MODBUS_TCP_SERVER_RX_MASK;
+    uint16_t first = MODBUS_TCP_SERVER_RX_SIZE - tail;
+    if (first > free_space) first = free_space;
+
+    struct iovec iov[2] = {
+        { .iov_base = &conn->rx[tail], .iov_len = first },
+        { .iov_base = conn->rx, .iov_len = free_space - first },
+    };
+
+    ssize_t n;
+    do {
+        n = readv(conn->fd, iov, iov[1].iov_len ? 2 : 1);
+    } while (n < 0 && errno == EINTR);
+
+    if (n > 0) conn->rx_tail += (uint16_t)n;
+    return n;
+}
+
+/**
+ * Handle readiness of a connection
+ * @return 0 on success, -1 if the connection must be closed
+ */
+static int tcp_connection_event(ModbusTcpServer *server, ModbusTcpConnection *conn, uint32_t events) {
+    if (events & (EPOLLERR | EPOLLHUP)) return -1;
+
+    if (events & EPOLLOUT) {
+        if (tcp_connection_flush(server, conn) != 0) return -1;
+        if (conn->tx_len == 0 && tcp_connection_process(server, conn) != 0) return -1;
+    }
+
+    // A full ring always holds a complete request, processed before receiving more
+    if ((events & EPOLLIN) && conn->tx_len == 0 &&
+        (uint16_t)(conn->rx_tail - conn->rx_head) < MODBUS_TCP_SERVER_RX_SIZE) {
+        ssize_t n = tcp_connection_recv(conn);
+        if (n == 0) return -1; // Closed by the client
+        if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+
+        return tcp_connection_process(server, conn);
+    }
+
+    return 0;
+}
+
+// =============================================================================
+// Listener
+// =============================================================================
+
+/**
+ * Register an accepted socket as a new connection
+ */
+static void tcp_server_add_connection(ModbusTcpServer *server, int fd) {
+    ModbusTcpConnection *conn = modbus_pool_alloc(&server->sessions);
+    if (!conn) { // Limit reached
+        server->stats.refused++;
+        close(fd);
+        return;
+    }
+
+    modbus_tcp_client_options(fd, server->keepalive_s);
+
+    conn->fd = fd;
+    conn->events = EPOLLIN;
+    conn->rx_head = 0;
+    conn->rx_tail = 0;
+    conn->tx_len = 0;
+    conn->tx_sent = 0;
+    modbus_timer_init(&conn->timer);
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        server->stats.refused++;
+        close(fd);
+        modbus_pool_free(&server->sessions, conn);
+        return;
+    }
+
+    conn->prev = NULL;
+    conn->next = server->connections;
+    if (conn->next) conn->next->prev = conn;
+    server->connections = conn;
+    server->connection_count++;
+    server->stats.accepted++;
+    tcp_connection_arm(server, conn);
+}
+
+/**
+ * Close the connections whose timeout passed
+ */
+static void tcp_server_expire(ModbusTcpServer *server) {
+    ModbusTimer *timer;
+
+    while ((timer = modbus_timer_wheel_expire(&server->timers, server->tick)) != NULL) {
+        ModbusTcpConnection *conn = TCP_CONNECTION_OF_TIMER(timer);
+
+        if (conn->deadline > server->tick) { // Active since the timer was set
+            modbus_timer_wheel_add(&server->timers, timer, conn->deadline);
+            continue;
+        }
+
+        server->stats.timeouts++;
+        tcp_connection_close(server, conn);
+    }
+}
+
+/**
+ * Accept every pending client
+ *
+ * When the process runs out of descriptors the spare descriptor is released
+ * to accept and immediately close one client, otherwise the pending
+ * connection would keep the listener readable and the loop spinning.
+ */
+static void tcp_server_accept(ModbusTcpServer *server) {
+    for (;;) {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd >= 0) {
+            tcp_server_add_connection(server, fd);
+            continue;
+        }
+
+        if (errno == EINTR || errno == ECONNABORTED) continue;
+        if ((errno == EMFILE || errno == ENFILE) && server->spare_fd >= 0) {
+            close(server->spare_fd);
+            fd = accept(server->listen_fd, NULL, NULL);
+            if (fd >= 0) {
+                close(fd);
+                server->stats.refused++;
+            }
+            server->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+            continue;
+        }
+        return; // EAGAIN: backlog drained
+    }
+}
+
+// =============================================================================
+// Sockets
+// =============================================================================
+
+/**
+ * Open a non-blocking listening socket for a server configuration
+ *
+ * Shared by the server backends.
+ * @param cfg Listening address and port
+ * @return Socket descriptor, -1 on error (errno is set)
+ */
+int modbus_tcp_listen(const ModbusTcpServerConfig *cfg) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(cfg->port) };
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (cfg->address && inet_pton(AF_INET, cfg->address, &addr.sin_addr) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (cfg->reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * Get the local port of a socket, useful after binding port 0
+ * @return Port in host byte order, 0 on error
+ */
+uint16_t modbus_tcp_local_port(int fd) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    if (getsockname(fd, (struct sockaddr *)&addr, &len) != 0) return 0;
+    return ntohs(addr.sin_port);
+}
+
+/**
+ * Set the options of an accepted client socket
+ *
+ * Shared by the server backends. Keepalive probes let the kernel detect and
+ * reset clients that vanished without closing, even with no idle timeout.
+ * @param fd          Client socket
+ * @param keepalive_s Silence before the first probe, and between probes;
+ *                    0 leaves keepalive off
+ */
+void modbus_tcp_client_options(int fd, uint16_t keepalive_s) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Responses are small, send them now
+
+    if (keepalive_s) {
+        int seconds = keepalive_s;
+        int probes = 3;
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &seconds, sizeof(seconds));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &seconds, sizeof(seconds));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+    }
+}
+
+// =============================================================================
+// Timeouts
+// =============================================================================
+
+/**
+ * Read the monotonic clock
+ * @return Milliseconds since an arbitrary point
+ */
+uint64_t modbus_tcp_clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/**
+ * Convert a timeout to ticks, rounded up so that it never fires early
+ * @return Ticks, 0 if the timeout is disabled
+ */
+uint32_t modbus_tcp_timeout_ticks(uint32_t timeout_ms) {
+    if (timeout_ms == 0) return 0;
+    return (timeout_ms + MODBUS_TCP_SERVER_TICK_MS - 1) / MODBUS_TCP_SERVER_TICK_MS + 1;
+}
+
+/**
+ * Bound the wait of an event loop by the next connection timeout
+ * @param timers     Timer wheel of the server, in MODBUS_TCP_SERVER_TICK_MS ticks
+ * @param timeout_ms Wait requested by the caller, -1 for none
+ * @return Wait in milliseconds, -1 for none
+ */
+int modbus_tcp_timer_wait(const ModbusTimerWheel *timers, int timeout_ms) {
+    uint64_t next = modbus_timer_wheel_next(timers);
+    if (next == UINT64_MAX || timeout_ms == 0) return timeout_ms;
+
+    uint64_t now = modbus_tcp_clock_ms() / MODBUS_TCP_SERVER_TICK_MS;
+    uint64_t wait = next > now ? (next - now) * MODBUS_TCP_SERVER_TICK_MS : 0;
+    if (timeout_ms >= 0 && wait > (uint64_t)timeout_ms) return timeout_ms;
+    return (int)wait;
+}
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+/**
+ * Open the listening socket and the event loop of a Modbus TCP server
+ *
+ * All sockets are non-blocking and multiplexed by one epoll instance, so a
+ * single thread calling modbus_tcp_server_poll() serves every client.
+ * Requests are processed by slave with modbus_process_pdu(); the write
+ * callback of its configuration is not used.
+ * @param server Server instance
+ * @param slave  Initialized slave answering the requests
+ * @param cfg    Listening address, port, connection limit
+ *               (MODBUS_TCP_SERVER_DEFAULT_CONNECTIONS if 0), timeouts,
+ *               keepalive and framing
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int modbus_tcp_server_init(ModbusTcpServer *server, ModbusSlave *slave, const ModbusTcpServerConfig *cfg) {
+    if (!server || !slave || !cfg) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->slave = slave;
+    server->framing = cfg->framing;
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->spare_fd = -1;
+    server->tick = modbus_tcp_clock_ms() / MODBUS_TCP_SERVER_TICK_MS;
+    server->idle_ticks = modbus_tcp_timeout_ticks(cfg->idle_timeout_ms);
+    server->request_ticks = modbus_tcp_timeout_ticks(cfg->request_timeout_ms);
+    server->keepalive_s = cfg->keepalive_s;
+    modbus_timer_wheel_init(&server->timers, server->tick);
+
+    // Mapped once and only backed by memory as sessions are first used, so a
+    // large limit costs nothing up front and churn never reaches the heap
+    uint32_t capacity = cfg->max_connections ? cfg->max_connections : MODBUS_TCP_SERVER_DEFAULT_CONNECTIONS;
+    size_t size = modbus_pool_storage_size(sizeof(ModbusTcpConnection), capacity);
+    void *storage = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED) return -1;
+    modbus_pool_init(&server->sessions, storage, sizeof(ModbusTcpConnection), capacity);
+
+    server->listen_fd = modbus_tcp_listen(cfg);
+    if (server->listen_fd < 0) goto fail;
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (server->epoll_fd < 0) goto fail;
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &ev) != 0) goto fail;
+
+    server->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return 0;
+
+fail:
+    {
+        int saved = errno;
+        modbus_tcp_server_close(server);
+        errno = saved;
+    }
+    return -1;
+}
+
+/**
+ * Get the port the server listens on, useful after binding port 0
+ * @return Port in host byte order, 0 on error
+ */
+uint16_t modbus_tcp_server_port(const ModbusTcpServer *server) {
+    return modbus_tcp_local_port(server->listen_fd);
+}
+
+/**
+ * Wait for socket readiness and serve it - call in a loop
+ *
+ * The wait ends early to close connections whose timeout passed.
+ * @param server     Server instance
+ * @param timeout_ms Longest wait in milliseconds, -1 to wait indefinitely
+ * @return Number of readiness events handled, -1 on error
+ */
+int modbus_tcp_server_poll(ModbusTcpServer *server, int timeout_ms) {
+    struct epoll_event events[MODBUS_TCP_SERVER_EVENTS];
+
+    int count = epoll_wait(server->epoll_fd, events, MODBUS_TCP_SERVER_EVENTS,
+                           modbus_tcp_timer_wait(&server->timers, timeout_ms));
+    if (count < 0) return errno == EINTR ? 0 : -1;
+
+    server->tick = modbus_tcp_clock_ms() / MODBUS_TCP_SERVER_TICK_MS;
+    for (int i = 0; i < count; ++i) {
+        ModbusTcpConnection *conn = events[i].data.ptr;
+
+        if (!conn) {
+            tcp_server_accept(server);
+        } else if (tcp_connection_event(server, conn, events[i].events) != 0) {
+            tcp_connection_close(server, conn);
+        } else {
+            tcp_connection_arm(server, conn);
+        }
+    }
+
+    tcp_server_expire(server);
+    return count;
+}
+
+/**
+ * Close every connection and the listening socket
+ */
+void modbus_tcp_server_close(ModbusTcpServer *server) {
+    while (server->connections) {
+        tcp_connection_close(server, server->connections);
+    }
+
+    if (server->listen_fd >= 0) close(server->listen_fd);
+    if (server->epoll_fd >= 0) close(server->epoll_fd);
+    if (server->spare_fd >= 0) close(server->spare_fd);
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->spare_fd = -1;
+
+    if (server->sessions.storage) {
+        munmap(server->sessions.storage,
+               modbus_pool_storage_size(server->sessions.object_size, server->sessions.capacity));
+        server->sessions.storage = NULL;
+    }
+}
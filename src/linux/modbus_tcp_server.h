@@ -0,0 +1,130 @@
+#ifndef MODBUS_TCP_SERVER_H
+#define MODBUS_TCP_SERVER_H
+
+#include "modbus_pool.h"
+#include "modbus_tcp.h"
+#include "modbus_timer_wheel.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Receive ring per connection, a power of two that holds a maximum size ADU */
+#ifndef MODBUS_TCP_SERVER_RX_SIZE
+#define MODBUS_TCP_SERVER_RX_SIZE 1024
+#endif
+
+/* Responses collected per connection before they are sent */
+#ifndef MODBUS_TCP_SERVER_TX_SIZE
+#define MODBUS_TCP_SERVER_TX_SIZE 2048
+#endif
+
+#if (MODBUS_TCP_SERVER_RX_SIZE & (MODBUS_TCP_SERVER_RX_SIZE - 1)) != 0 || \
+    MODBUS_TCP_SERVER_RX_SIZE < MODBUS_TCP_MAX_ADU_LENGTH || MODBUS_TCP_SERVER_RX_SIZE > 32768
+#error "MODBUS_TCP_SERVER_RX_SIZE must be a power of two between 512 and 32768"
+#endif
+
+#if MODBUS_TCP_SERVER_TX_SIZE < MODBUS_TCP_MAX_ADU_LENGTH || MODBUS_TCP_SERVER_TX_SIZE > 65535
+#error "MODBUS_TCP_SERVER_TX_SIZE must hold a maximum size ADU and fit 16 bits"
+#endif
+
+/* Sessions allocated at init when the configuration sets no limit */
+#ifndef MODBUS_TCP_SERVER_DEFAULT_CONNECTIONS
+#define MODBUS_TCP_SERVER_DEFAULT_CONNECTIONS 1024
+#endif
+
+/* Resolution of the connection timeouts */
+#ifndef MODBUS_TCP_SERVER_TICK_MS
+#define MODBUS_TCP_SERVER_TICK_MS 10
+#endif
+
+/*==============================
+    Configuration
+==============================*/
+typedef enum {
+    MODBUS_TCP_FRAMING_MBAP = 0, /* Modbus TCP, requests behind an MBAP header */
+    MODBUS_TCP_FRAMING_RTU,      /* RTU over TCP, RTU frames with CRC carried as is */
+} ModbusTcpFraming;
+
+typedef struct {
+    const char *address;         /* IPv4 address to listen on, NULL for any */
+    uint16_t port;               /* Usually MODBUS_TCP_PORT, 0 for an ephemeral port */
+    uint32_t max_connections;    /* Clients beyond this are refused, 0 for the backend default */
+    bool reuse_port;             /* SO_REUSEPORT: servers sharing the port split the clients */
+    uint32_t idle_timeout_ms;    /* Close clients silent this long, 0 for never */
+    uint32_t request_timeout_ms; /* Close clients stalled mid request or response this long, 0 for never */
+    uint16_t keepalive_s;        /* TCP keepalive probes after this much silence, 0 for none */
+    ModbusTcpFraming framing;    /* Framing of the streams, epoll server only */
+} ModbusTcpServerConfig;
+
+/*==============================
+    Connections
+==============================*/
+typedef struct ModbusTcpConnection {
+    struct ModbusTcpConnection *prev;
+    struct ModbusTcpConnection *next;
+    int fd;
+    uint32_t events;  /* epoll events currently watched */
+    uint16_t rx_head; /* Ring index of the first unprocessed byte, free running */
+    uint16_t rx_tail; /* Ring index one past the last received byte, free running */
+    uint16_t tx_len;  /* Response bytes queued, 0 if none */
+    uint16_t tx_sent; /* Queued bytes already sent */
+    ModbusTimer timer;
+    uint64_t deadline; /* Tick the connection times out at, the timer may be earlier */
+    uint8_t rx[MODBUS_TCP_SERVER_RX_SIZE];
+    uint8_t tx[MODBUS_TCP_SERVER_TX_SIZE];
+} ModbusTcpConnection;
+
+typedef struct {
+    uint64_t requests; /* ADUs processed */
+    uint64_t sends;    /* Sends issued, each carrying one or more responses */
+    uint32_t accepted; /* Connections accepted */
+    uint32_t refused;  /* Connections closed on accept, limit reached */
+    uint32_t dropped;  /* Connections closed for a malformed MBAP header */
+    uint32_t timeouts; /* Connections closed by the idle or request timeout */
+    uint32_t skipped;  /* RTU over TCP: bytes skipped to find the next frame */
+} ModbusTcpServerStats;
+
+/*==============================
+    Server structure
+==============================*/
+typedef struct {
+    ModbusSlave *slave;
+    ModbusTcpFraming framing;
+    int listen_fd;
+    int epoll_fd;
+    int spare_fd;                     /* Released to shed clients when out of descriptors */
+    uint32_t connection_count;
+    ModbusTcpConnection *connections; /* Open connections */
+    ModbusPool sessions;              /* Storage of max_connections connections, mapped at init */
+    ModbusTimerWheel timers;          /* Connection timeouts */
+    uint64_t tick;                    /* Current tick, updated by every poll */
+    uint32_t idle_ticks;
+    uint32_t request_ticks;
+    uint16_t keepalive_s;
+    ModbusTcpServerStats stats;
+} ModbusTcpServer;
+
+/*==============================
+    Public API
+==============================*/
+int modbus_tcp_listen(const ModbusTcpServerConfig *cfg);
+uint16_t modbus_tcp_local_port(int fd);
+void modbus_tcp_client_options(int fd, uint16_t keepalive_s);
+uint64_t modbus_tcp_clock_ms(void);
+uint32_t modbus_tcp_timeout_ticks(uint32_t timeout_ms);
+int modbus_tcp_timer_wait(const ModbusTimerWheel *timers, int timeout_ms);
+
+int modbus_tcp_server_init(ModbusTcpServer *server, ModbusSlave *slave, const ModbusTcpServerConfig *cfg);
+uint16_t modbus_tcp_server_port(const ModbusTcpServer *server);
+int modbus_tcp_server_poll(ModbusTcpServer *server, int timeout_ms);
+void modbus_tcp_server_close(ModbusTcpServer *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_TCP_SERVER_H */
@@ -0,0 +1,250 @@
+#define _GNU_SOURCE
+
+#include "modbus_tcp_shard.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/* Longest time a shard takes to notice modbus_tcp_sharded_server_stop() */
+#define MODBUS_TCP_SHARD_POLL_MS 100
+
+// =============================================================================
+// Shards
+// =============================================================================
+
+/**
+ * Copy the statistics of a shard's server where other threads may read them
+ */
+static void shard_publish_stats(ModbusTcpShard *shard) {
+    const ModbusTcpServerStats *stats = &shard->server.stats;
+
+    atomic_store_explicit(&shard->requests, stats->requests, memory_order_relaxed);
+    atomic_store_explicit(&shard->sends, stats->sends, memory_order_relaxed);
+    atomic_store_explicit(&shard->accepted, stats->accepted, memory_order_relaxed);
+    atomic_store_explicit(&shard->refused, stats->refused, memory_order_relaxed);
+    atomic_store_explicit(&shard->dropped, stats->dropped, memory_order_relaxed);
+    atomic_store_explicit(&shard->timeouts, stats->timeouts, memory_order_relaxed);
+    atomic_store_explicit(&shard->skipped, stats->skipped, memory_order_relaxed);
+}
+
+/**
+ * Shard thread: pin, set up the slave and server on the shard's own core,
+ * then serve until stopped
+ */
+static void *shard_main(void *arg) {
+    ModbusTcpShard *shard = arg;
+    ModbusTcpShardedServer *server = shard->owner;
+
+    if (shard->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(shard->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    // Initialized here so that the memory is first touched on the shard's core
+    ModbusTcpServerConfig cfg = server->config.server;
+    cfg.port = server->port;
+    cfg.reuse_port = true;
+    errno = 0;
+    int result = modbus_slave_init(&shard->slave, server->config.slave);
+#if MODBUS_MAX_UNITS > 1
+    for (unsigned i = 0; result == 0 && i < server->config.unit_count; ++i) {
+        result = modbus_slave_add_unit(&shard->slave, server->config.units[i]);
+    }
+#endif
+    if (result == 0) result = modbus_tcp_server_init(&shard->server, &shard->slave, &cfg);
+    shard->result = result == 0 ? 0 : errno ? errno : EINVAL; // The slave sets no errno
+
+    pthread_mutex_lock(&server->lock);
+    server->reported++;
+    pthread_cond_broadcast(&server->cond);
+    while (!server->decided) pthread_cond_wait(&server->cond, &server->lock);
+    pthread_mutex_unlock(&server->lock);
+
+    if (shard->result != 0) return NULL;
+
+    // Not running if another shard failed to start
+    while (atomic_load_explicit(&server->running, memory_order_relaxed)) {
+        if (modbus_tcp_server_poll(&shard->server, MODBUS_TCP_SHARD_POLL_MS) < 0) break;
+        shard_publish_stats(shard);
+    }
+
+    shard_publish_stats(shard);
+    modbus_tcp_server_close(&shard->server);
+    return NULL;
+}
+
+/**
+ * Bind, without listening, a socket that holds the port until every shard
+ * has bound it too; picks the port when the configuration asks for port 0
+ * @return Socket descriptor, -1 on error
+ */
+static int shard_reserve_port(const ModbusTcpServerConfig *cfg, uint16_t *port) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(cfg->port) };
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (cfg->address && inet_pton(AF_INET, cfg->address, &addr.sin_addr) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0 ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    *port = modbus_tcp_local_port(fd);
+    return fd;
+}
+
+/**
+ * Free what modbus_tcp_sharded_server_start() allocated, once no shard runs
+ */
+static void modbus_tcp_sharded_server_release(ModbusTcpShardedServer *server) {
+    pthread_cond_destroy(&server->cond);
+    pthread_mutex_destroy(&server->lock);
+    free(server->shards);
+    server->shards = NULL;
+    server->shard_count = 0;
+}
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+/**
+ * Start a sharded Modbus TCP server
+ *
+ * Returns once every shard is serving, or once all of them have been shut
+ * down again because one could not start.
+ * @param server Server instance
+ * @param cfg    Listening address, port and per-shard connection limit,
+ *               slave and unit configurations, shard count and CPU pinning
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int modbus_tcp_sharded_server_start(ModbusTcpShardedServer *server, const ModbusTcpShardedConfig *cfg) {
+    if (!server || !cfg || !cfg->slave || (cfg->unit_count && !cfg->units) || cfg->unit_count >= MODBUS_MAX_UNITS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    cpu_set_t allowed;
+    int cpus[CPU_SETSIZE];
+    unsigned cpu_count = 0;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return -1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed)) cpus[cpu_count++] = cpu;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->config = *cfg;
+    server->shard_count = cfg->shards ? cfg->shards : cpu_count;
+
+    int reserved = shard_reserve_port(&cfg->server, &server->port);
+    if (reserved < 0) return -1;
+
+    server->shards = aligned_alloc(_Alignof(ModbusTcpShard), server->shard_count * sizeof(ModbusTcpShard));
+    if (!server->shards) {
+        close(reserved);
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(server->shards, 0, server->shard_count * sizeof(ModbusTcpShard));
+
+    pthread_mutex_init(&server->lock, NULL);
+    pthread_cond_init(&server->cond, NULL);
+    atomic_init(&server->running, false);
+
+    int saved = 0;
+    unsigned started = 0;
+    for (; started < server->shard_count; ++started) {
+        ModbusTcpShard *shard = &server->shards[started];
+        shard->owner = server;
+        shard->cpu = cfg->pin && cpu_count ? cpus[started % cpu_count] : -1;
+        int err = pthread_create(&shard->thread, NULL, shard_main, shard); // Returns the error, errno is not set
+        if (err != 0) {
+            saved = err;
+            break;
+        }
+    }
+
+    bool ok = started == server->shard_count;
+
+    pthread_mutex_lock(&server->lock);
+    while (server->reported < started) pthread_cond_wait(&server->cond, &server->lock);
+    for (unsigned i = 0; i < started; ++i) {
+        if (server->shards[i].result == 0) continue;
+        ok = false;
+        if (!saved) saved = server->shards[i].result;
+    }
+    atomic_store(&server->running, ok);
+    server->decided = true;
+    pthread_cond_broadcast(&server->cond);
+    pthread_mutex_unlock(&server->lock);
+
+    close(reserved); // Every shard holds the port now
+
+    if (!ok) {
+        for (unsigned i = 0; i < started; ++i) {
+            pthread_join(server->shards[i].thread, NULL);
+        }
+        modbus_tcp_sharded_server_release(server);
+        errno = saved ? saved : EAGAIN;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Get the port the shards listen on, useful after configuring port 0
+ */
+uint16_t modbus_tcp_sharded_server_port(const ModbusTcpShardedServer *server) {
+    return server->port;
+}
+
+/**
+ * Sum the statistics of all shards, as of their last poll
+ */
+void modbus_tcp_sharded_server_stats(const ModbusTcpShardedServer *server, ModbusTcpServerStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    for (unsigned i = 0; i < server->shard_count; ++i) {
+        ModbusTcpShard *shard = &server->shards[i];
+        stats->requests += atomic_load_explicit(&shard->requests, memory_order_relaxed);
+        stats->sends += atomic_load_explicit(&shard->sends, memory_order_relaxed);
+        stats->accepted += atomic_load_explicit(&shard->accepted, memory_order_relaxed);
+        stats->refused += atomic_load_explicit(&shard->refused, memory_order_relaxed);
+        stats->dropped += atomic_load_explicit(&shard->dropped, memory_order_relaxed);
+        stats->timeouts += atomic_load_explicit(&shard->timeouts, memory_order_relaxed);
+        stats->skipped += atomic_load_explicit(&shard->skipped, memory_order_relaxed);
+    }
+}
+
+/**
+ * Stop every shard, close its connections and release the server
+ */
+void modbus_tcp_sharded_server_stop(ModbusTcpShardedServer *server) {
+    if (!server->shards) return;
+
+    atomic_store(&server->running, false);
+    for (unsigned i = 0; i < server->shard_count; ++i) {
+        pthread_join(server->shards[i].thread, NULL);
+    }
+
+    modbus_tcp_sharded_server_release(server);
+}
@@ -0,0 +1,96 @@
+#ifndef MODBUS_TCP_SHARD_H
+#define MODBUS_TCP_SHARD_H
+
+#include "modbus_tcp_server.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Shared-nothing Modbus TCP server for multi-core gateways.
+ *
+ * Every shard is a thread with its own ModbusSlave, epoll server and
+ * listening socket. The sockets share the port through SO_REUSEPORT, so the
+ * kernel spreads new clients over the shards and a connection stays on the
+ * shard that accepted it: no request crosses cores and nothing in the stack
+ * is locked. The only shared state is the application data behind the
+ * callbacks, which therefore must be thread-safe - a ModbusRegisterBank is.
+ *
+ * Per-slave state stays per shard: counters, dirty bitmaps and response
+ * cache entries. A write on one shard does not invalidate the response cache
+ * of the others, so use MODBUS_RESPONSE_CACHE_ENTRIES 0 with writable data.
+ *
+ * The shards create their slaves themselves, so modbus_slave_add_unit()
+ * cannot reach them; list the additional units in the configuration and
+ * every shard adds them to its slave.
+ */
+
+/*==============================
+    Configuration
+==============================*/
+typedef struct {
+    ModbusTcpServerConfig server;   /* Per shard; reuse_port is implied */
+    const ModbusSlaveConfig *slave; /* Configuration of every shard's slave */
+    const ModbusSlaveConfig *const *units; /* Further units added to every shard's slave, kept by reference */
+    unsigned unit_count;            /* Entries in units, below MODBUS_MAX_UNITS */
+    unsigned shards;                /* Number of shards, 0 for one per usable CPU */
+    bool pin;                       /* Pin shard i to the i-th usable CPU */
+} ModbusTcpShardedConfig;
+
+/*==============================
+    Shards
+==============================*/
+typedef struct ModbusTcpShardedServer ModbusTcpShardedServer;
+
+/* Cache line aligned, so shards never write to a line another shard uses */
+typedef struct {
+    _Alignas(64) ModbusTcpShardedServer *owner;
+    pthread_t thread;
+    int cpu;    /* CPU the shard is pinned to, -1 if not pinned */
+    int result; /* 0 if the shard started, the errno of its failure otherwise */
+    ModbusSlave slave;
+    ModbusTcpServer server;
+
+    /* Copy of server.stats, published after every poll for other threads */
+    _Atomic uint64_t requests;
+    _Atomic uint64_t sends;
+    atomic_uint accepted;
+    atomic_uint refused;
+    atomic_uint dropped;
+    atomic_uint timeouts;
+    atomic_uint skipped;
+} ModbusTcpShard;
+
+struct ModbusTcpShardedServer {
+    ModbusTcpShard *shards;
+    unsigned shard_count;
+    uint16_t port;
+    atomic_bool running;
+    ModbusTcpShardedConfig config;
+
+    /* Start-up handshake: shards report, then wait for the decision to run */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned reported;
+    bool decided;
+};
+
+/*==============================
+    Public API
+==============================*/
+int modbus_tcp_sharded_server_start(ModbusTcpShardedServer *server, const ModbusTcpShardedConfig *cfg);
+uint16_t modbus_tcp_sharded_server_port(const ModbusTcpShardedServer *server);
+void modbus_tcp_sharded_server_stats(const ModbusTcpShardedServer *server, ModbusTcpServerStats *stats);
+void modbus_tcp_sharded_server_stop(ModbusTcpShardedServer *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_TCP_SHARD_H */
@@ -0,0 +1,872 @@
+#define _GNU_SOURCE
+
+#include "modbus_tcp_uring.h"
+
+#if MODBUS_ENABLE_TCP_URING
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+/*
+ * Completion tags, stored in the low bits of user_data next to the
+ * connection pointer
+ */
+#define URING_TAG_ACCEPT 0u
+#define URING_TAG_RECV   1u
+#define URING_TAG_SEND   2u
+#define URING_TAG_CANCEL 3u
+#define URING_TAG_MASK   3u
+
+#define URING_RX_GROUP   0 /* Provided buffer group of the receive buffers */
+#define URING_NO_BUFFER  0xFFFFu /* End of the held buffers of a connection */
+
+#define MODBUS_TCP_URING_RX_MASK (MODBUS_TCP_URING_RX_SIZE - 1)
+
+#define URING_CONNECTION_OF_TIMER(t) \
+    ((ModbusTcpUringConnection *)((char *)(t) - offsetof(ModbusTcpUringConnection, timer)))
+
+// =============================================================================
+// Ring access
+// =============================================================================
+
+static int uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_register(int fd, unsigned opcode, void *arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+/**
+ * Submit the prepared entries and optionally wait for completions
+ *
+ * Submission and waiting share one io_uring_enter() call, so every entry
+ * prepared while handling a batch of completions costs no extra system call.
+ * @param wait_nr    Completions to wait for, 0 to only submit
+ * @param timeout_ms Longest wait, -1 for none
+ * @return 0 on success or timeout, -1 on error
+ */
+static int uring_enter(ModbusTcpUringServer *server, unsigned wait_nr, int timeout_ms) {
+    __atomic_store_n(server->sq_tail, server->sq_local_tail, __ATOMIC_RELEASE);
+
+    unsigned to_submit = server->sq_local_tail - __atomic_load_n(server->sq_head, __ATOMIC_ACQUIRE);
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    void *argp = NULL;
+    size_t argsz = 0;
+
+    if (wait_nr && timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argsz = sizeof(arg);
+    }
+
+    if (syscall(__NR_io_uring_enter, server->ring_fd, to_submit, wait_nr, flags, argp, argsz) < 0) {
+        if (errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY) return 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Get a cleared submission queue entry, submitting early if the queue is full
+ * @return Entry, NULL if the queue stayed full
+ */
+static struct io_uring_sqe *uring_get_sqe(ModbusTcpUringServer *server) {
+    if (server->sq_local_tail - __atomic_load_n(server->sq_head, __ATOMIC_ACQUIRE) >= server->sq_entries) {
+        uring_enter(server, 0, -1);
+        if (server->sq_local_tail - __atomic_load_n(server->sq_head, __ATOMIC_ACQUIRE) >= server->sq_entries) {
+            return NULL;
+        }
+    }
+
+    struct io_uring_sqe *sqe = &server->sqes[server->sq_local_tail & server->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    server->sq_local_tail++;
+    return sqe;
+}
+
+// =============================================================================
+// Operations
+// =============================================================================
+
+static uint64_t uring_user_data(ModbusTcpUringConnection *conn, unsigned tag) {
+    return (uint64_t)(uintptr_t)conn | tag;
+}
+
+/**
+ * Queue a multishot accept on the listening socket
+ */
+static void uring_queue_accept(ModbusTcpUringServer *server) {
+    struct io_uring_sqe *sqe = uring_get_sqe(server);
+    if (!sqe) return; // Retried by the next poll
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server->listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = uring_user_data(NULL, URING_TAG_ACCEPT);
+    server->accepting = true;
+}
+
+/**
+ * Queue a multishot receive into the provided buffers
+ * @return 0 on success, -1 if the submission queue is full
+ */
+static int uring_queue_recv(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    struct io_uring_sqe *sqe = uring_get_sqe(server);
+    if (!sqe) return -1;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_RX_GROUP;
+    sqe->user_data = uring_user_data(conn, URING_TAG_RECV);
+    conn->pending++;
+    conn->receiving = true;
+    return 0;
+}
+
+/**
+ * Park a connection whose receive ended for lack of buffers
+ *
+ * Re-arming it at once would fail again as long as other connections hold
+ * every buffer, spinning on the completions; it is re-armed when a buffer
+ * returns instead, in the order the connections starved.
+ */
+static void uring_connection_starve(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    uint32_t slot = (uint32_t)(conn - server->connections);
+
+    conn->starved = true;
+    conn->starved_next = server->max_connections;
+    conn->starved_prev = server->starved_tail;
+    if (server->starved_tail == server->max_connections) server->starved_head = slot;
+    else server->connections[server->starved_tail].starved_next = slot;
+    server->starved_tail = slot;
+}
+
+/**
+ * Take a connection off the list of starved connections
+ */
+static void uring_connection_unstarve(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    if (!conn->starved) return;
+
+    if (conn->starved_prev == server->max_connections) server->starved_head = conn->starved_next;
+    else server->connections[conn->starved_prev].starved_next = conn->starved_next;
+    if (conn->starved_next == server->max_connections) server->starved_tail = conn->starved_prev;
+    else server->connections[conn->starved_next].starved_prev = conn->starved_prev;
+    conn->starved = false;
+}
+
+/**
+ * Re-arm the receive of the connection starved the longest
+ */
+static void uring_server_feed(ModbusTcpUringServer *server) {
+    if (server->starved_head == server->max_connections) return;
+
+    ModbusTcpUringConnection *conn = &server->connections[server->starved_head];
+    if (uring_queue_recv(server, conn) != 0) { // Retried by the next poll
+        server->feed_retry = true;
+        return;
+    }
+    uring_connection_unstarve(server, conn);
+}
+
+/**
+ * Hand a receive buffer back to the kernel, with a connection to use it if
+ * one starved
+ */
+static void uring_recycle_buffer(ModbusTcpUringServer *server, uint16_t bid) {
+    struct io_uring_buf *buf = &server->rx_ring->bufs[server->rx_ring_tail & (MODBUS_TCP_URING_RX_BUFFERS - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)&server->rx_buffers[(size_t)bid * MODBUS_TCP_URING_RX_BUFFER_SIZE];
+    buf->len = MODBUS_TCP_URING_RX_BUFFER_SIZE;
+    buf->bid = bid;
+    server->rx_ring_tail++;
+    server->rx_free++;
+    __atomic_store_n(&server->rx_ring->tail, server->rx_ring_tail, __ATOMIC_RELEASE);
+    uring_server_feed(server);
+}
+
+/**
+ * Queue the cancel of the multishot receive of a connection
+ * @return 0 on success, -1 if the submission queue is full
+ */
+static int uring_queue_cancel(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    struct io_uring_sqe *sqe = uring_get_sqe(server);
+    if (!sqe) return -1;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = uring_user_data(conn, URING_TAG_RECV);
+    sqe->user_data = uring_user_data(conn, URING_TAG_CANCEL);
+    conn->pending++;
+    conn->canceling = true;
+    return 0;
+}
+
+/**
+ * Transmit half of a connection, the other one is being filled
+ */
+static uint8_t *uring_tx_buffer(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn, unsigned half) {
+    size_t slot = (size_t)(conn - server->connections);
+    return &server->tx_arena[(slot * 2 + half) * MODBUS_TCP_URING_TX_SIZE];
+}
+
+/**
+ * Queue the send of the in-flight transmit half
+ * @return 0 on success, -1 if the submission queue is full
+ */
+static int uring_queue_send(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    struct io_uring_sqe *sqe = uring_get_sqe(server);
+    if (!sqe) return -1;
+
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&uring_tx_buffer(server, conn, conn->tx_active ^ 1u)[conn->tx_sent];
+    sqe->len = (uint32_t)(conn->tx_len - conn->tx_sent);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = uring_user_data(conn, URING_TAG_SEND);
+    conn->pending++;
+    server->stats.sends++;
+    return 0;
+}
+
+// =============================================================================
+// Connections
+// =============================================================================
+
+/**
+ * Release a closing connection once no operation refers to it anymore
+ */
+static void uring_connection_release(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    if (!conn->closing || conn->pending || conn->fd < 0) return;
+
+    while (conn->held_first != URING_NO_BUFFER) {
+        uint16_t bid = conn->held_first;
+        conn->held_first = server->rx_held_next[bid];
+        uring_recycle_buffer(server, bid);
+    }
+
+    close(conn->fd);
+    conn->fd = -1;
+    modbus_timer_wheel_cancel(&server->timers, &conn->timer);
+    conn->next_free = server->free_head;
+    server->free_head = (uint32_t)(conn - server->connections);
+    server->connection_count--;
+}
+
+/**
+ * Start closing a connection
+ *
+ * Shutting the socket down completes the multishot receive and any send in
+ * flight; the slot is released once their completions are in.
+ */
+static void uring_connection_close(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    if (conn->closing) return;
+
+    conn->closing = true;
+    uring_connection_unstarve(server, conn);
+    shutdown(conn->fd, SHUT_RDWR);
+    uring_connection_release(server, conn); // At once if nothing is in flight
+}
+
+/**
+ * Restart the timeout of a connection after activity, as the epoll server does
+ */
+static void uring_connection_arm(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    if (conn->closing) return;
+
+    bool busy = conn->rx_head != conn->rx_tail || conn->held_first != URING_NO_BUFFER ||
+                conn->tx_len != 0 || conn->tx_fill != 0;
+    uint32_t ticks = busy && server->request_ticks ? server->request_ticks : server->idle_ticks;
+
+    if (ticks == 0) {
+        modbus_timer_wheel_cancel(&server->timers, &conn->timer);
+        return;
+    }
+
+    conn->deadline = server->tick + ticks;
+    if (!modbus_timer_pending(&conn->timer) || conn->timer.expires > conn->deadline) {
+        modbus_timer_wheel_add(&server->timers, &conn->timer, conn->deadline);
+    }
+}
+
+/**
+ * Shut down the connections whose timeout passed
+ */
+static void uring_server_expire(ModbusTcpUringServer *server) {
+    ModbusTimer *timer;
+
+    while ((timer = modbus_timer_wheel_expire(&server->timers, server->tick)) != NULL) {
+        ModbusTcpUringConnection *conn = URING_CONNECTION_OF_TIMER(timer);
+
+        if (conn->closing) continue; // Released once its operations complete
+        if (conn->deadline > server->tick) { // Active since the timer was set
+            modbus_timer_wheel_add(&server->timers, timer, conn->deadline);
+            continue;
+        }
+
+        server->stats.timeouts++;
+        uring_connection_close(server, conn);
+    }
+}
+
+/**
+ * Send the collected responses unless a send is already in flight
+ */
+static void uring_connection_flush(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    if (conn->closing || conn->tx_len || conn->tx_fill == 0) return;
+
+    conn->tx_len = conn->tx_fill;
+    conn->tx_sent = 0;
+    conn->tx_fill = 0;
+    conn->tx_active ^= 1u; // Keep collecting into the other half
+
+    if (uring_queue_send(server, conn) != 0) uring_connection_close(server, conn);
+}
+
+/**
+ * Answer one request into the active transmit half
+ */
+static void uring_connection_answer(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn,
+                                    const uint8_t *adu, uint16_t adu_len) {
+    uint16_t response_len;
+
+    modbus_tcp_process_adu(server->slave, adu, adu_len,
+                           &uring_tx_buffer(server, conn, conn->tx_active)[conn->tx_fill], &response_len);
+    conn->tx_fill += response_len;
+    server->stats.requests++;
+}
+
+static bool uring_connection_tx_room(const ModbusTcpUringConnection *conn) {
+    return MODBUS_TCP_URING_TX_SIZE - conn->tx_fill >= MODBUS_TCP_MAX_ADU_LENGTH;
+}
+
+/**
+ * Answer the complete requests at the start of a kernel filled buffer
+ *
+ * Responses are collected in the active transmit half; processing stops
+ * when it could not take another response.
+ * @return Bytes consumed, -1 if the MBAP framing is broken
+ */
+static int32_t uring_connection_consume(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn,
+                                        const uint8_t *data, uint32_t length) {
+    uint32_t offset = 0;
+
+    while (uring_connection_tx_room(conn)) {
+        int32_t adu_len = modbus_tcp_adu_length(&data[offset], length - offset);
+        if (adu_len < 0) return -1;
+        if (adu_len == 0 || (uint32_t)adu_len > length - offset) break;
+
+        uring_connection_answer(server, conn, &data[offset], (uint16_t)adu_len);
+        offset += (uint32_t)adu_len;
+    }
+
+    return (int32_t)offset;
+}
+
+/**
+ * Get length contiguous bytes at the head of the receive ring
+ *
+ * Only data that wraps around the end of the ring is copied, to scratch.
+ */
+static const uint8_t *uring_connection_peek(const ModbusTcpUringConnection *conn, uint16_t length, uint8_t *scratch) {
+    uint16_t head = conn->rx_head & MODBUS_TCP_URING_RX_MASK;
+    if (head + length <= MODBUS_TCP_URING_RX_SIZE) return &conn->rx[head];
+
+    uint16_t first = MODBUS_TCP_URING_RX_SIZE - head;
+    memcpy(scratch, &conn->rx[head], first);
+    memcpy(&scratch[first], conn->rx, length - first);
+    return scratch;
+}
+
+/**
+ * Answer the complete requests in the receive ring
+ * @return 0 on success, -1 if the MBAP framing is broken
+ */
+static int uring_connection_process(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    uint8_t scratch[MODBUS_TCP_MAX_ADU_LENGTH];
+
+    while (uring_connection_tx_room(conn)) {
+        uint16_t available = (uint16_t)(conn->rx_tail - conn->rx_head);
+        if (available < MODBUS_MBAP_HEADER_LENGTH) break;
+
+        const uint8_t *header = uring_connection_peek(conn, MODBUS_MBAP_HEADER_LENGTH, scratch);
+        int32_t adu_len = modbus_tcp_adu_length(header, MODBUS_MBAP_HEADER_LENGTH);
+        if (adu_len < 0) return -1;
+        if (adu_len > available) break;
+
+        uring_connection_answer(server, conn, uring_connection_peek(conn, (uint16_t)adu_len, scratch), (uint16_t)adu_len);
+        conn->rx_head += (uint16_t)adu_len;
+    }
+
+    // Restart an empty ring at its beginning, so the next requests rarely wrap
+    if (conn->rx_head == conn->rx_tail) conn->rx_head = conn->rx_tail = 0;
+    return 0;
+}
+
+/**
+ * Copy the held buffers into the free space of the receive ring, handing
+ * every buffer taken completely back to the kernel
+ */
+static void uring_connection_take(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    while (conn->held_first != URING_NO_BUFFER) {
+        uint16_t bid = conn->held_first;
+        const uint8_t *data = &server->rx_buffers[(size_t)bid * MODBUS_TCP_URING_RX_BUFFER_SIZE + conn->held_offset];
+        uint16_t length = server->rx_held_length[bid] - conn->held_offset;
+        uint16_t free_space = MODBUS_TCP_URING_RX_SIZE - (uint16_t)(conn->rx_tail - conn->rx_head);
+        if (length > free_space) length = free_space;
+        if (length == 0) return;
+
+        uint16_t tail = conn->rx_tail & MODBUS_TCP_URING_RX_MASK;
+        uint16_t first = MODBUS_TCP_URING_RX_SIZE - tail;
+        if (first > length) first = length;
+        memcpy(&conn->rx[tail], data, first);
+        memcpy(conn->rx, &data[first], length - first);
+        conn->rx_tail += length;
+        conn->held_offset += length;
+
+        if (conn->held_offset < server->rx_held_length[bid]) return; // Ring full
+        conn->held_first = server->rx_held_next[bid];
+        conn->held_offset = 0;
+        uring_recycle_buffer(server, bid);
+    }
+}
+
+/**
+ * Move received data through a connection as far as its transmit buffer allows
+ *
+ * Held buffers are copied into the receive ring as it frees up and the
+ * requests there are answered, sending every transmit half that fills up.
+ * While buffers stay held the multishot receive is cancelled, so a client
+ * that sends faster than it reads is slowed down by TCP flow control rather
+ * than taking receive buffers from the other connections, as the epoll
+ * server stops reading. It is armed again once nothing is held.
+ */
+static void uring_connection_pump(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    for (;;) {
+        uint16_t tail;
+
+        do {
+            if (uring_connection_process(server, conn) != 0) { // Framing lost, nothing after this point can be trusted
+                server->stats.dropped++;
+                uring_connection_close(server, conn);
+                return;
+            }
+            tail = conn->rx_tail;
+            uring_connection_take(server, conn);
+        } while (conn->rx_tail != tail);
+
+        bool full = !uring_connection_tx_room(conn);
+        uring_connection_flush(server, conn);
+        if (conn->closing) return;
+        if (!full || conn->tx_fill != 0) break; // Done, or both halves wait for the send in flight
+    }
+
+    if (conn->held_first != URING_NO_BUFFER) {
+        if (conn->receiving && !conn->canceling && uring_queue_cancel(server, conn) != 0) {
+            uring_connection_close(server, conn);
+        }
+    } else if (!conn->receiving && !conn->starved && uring_queue_recv(server, conn) != 0) {
+        uring_connection_close(server, conn);
+    }
+}
+
+/**
+ * Handle a buffer filled by the multishot receive
+ *
+ * Requests are processed straight from the buffer when nothing received
+ * earlier is waiting; the rest of it is held until the receive ring takes it.
+ */
+static void uring_connection_receive(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn,
+                                     uint16_t bid, uint32_t length) {
+    int32_t consumed = 0;
+
+    if (conn->rx_head == conn->rx_tail && conn->held_first == URING_NO_BUFFER) {
+        consumed = uring_connection_consume(server, conn,
+                                            &server->rx_buffers[(size_t)bid * MODBUS_TCP_URING_RX_BUFFER_SIZE], length);
+        if (consumed < 0) {
+            uring_recycle_buffer(server, bid);
+            server->stats.dropped++;
+            uring_connection_close(server, conn);
+            return;
+        }
+    }
+
+    if ((uint32_t)consumed == length) {
+        uring_recycle_buffer(server, bid);
+    } else {
+        server->rx_held_next[bid] = URING_NO_BUFFER;
+        server->rx_held_length[bid] = (uint16_t)length;
+        if (conn->held_first == URING_NO_BUFFER) {
+            conn->held_first = bid;
+            conn->held_offset = (uint16_t)consumed;
+        } else {
+            server->rx_held_next[conn->held_last] = bid;
+        }
+        conn->held_last = bid;
+    }
+
+    uring_connection_pump(server, conn);
+}
+
+/**
+ * Register an accepted socket as a new connection
+ */
+static void uring_connection_open(ModbusTcpUringServer *server, int fd) {
+    if (server->free_head == server->max_connections) {
+        server->stats.refused++;
+        close(fd);
+        return;
+    }
+
+    ModbusTcpUringConnection *conn = &server->connections[server->free_head];
+
+    modbus_tcp_client_options(fd, server->keepalive_s);
+
+    conn->fd = fd;
+    conn->pending = 0;
+    conn->closing = false;
+    conn->tx_active = 0;
+    conn->tx_fill = 0;
+    conn->tx_len = 0;
+    conn->tx_sent = 0;
+    conn->receiving = false;
+    conn->canceling = false;
+    conn->starved = false;
+    conn->rx_head = 0;
+    conn->rx_tail = 0;
+    conn->held_first = URING_NO_BUFFER;
+    conn->held_offset = 0;
+    modbus_timer_init(&conn->timer);
+
+    if (uring_queue_recv(server, conn) != 0) {
+        conn->fd = -1;
+        server->stats.refused++;
+        close(fd);
+        return;
+    }
+
+    server->free_head = conn->next_free;
+    server->connection_count++;
+    server->stats.accepted++;
+    uring_connection_arm(server, conn);
+}
+
+// =============================================================================
+// Completions
+// =============================================================================
+
+static void uring_complete_recv(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn,
+                                int32_t res, uint32_t flags) {
+    if (!(flags & IORING_CQE_F_MORE)) {
+        conn->pending--;
+        conn->receiving = false;
+    }
+
+    if (flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+        server->rx_free--;
+        if (res > 0 && !conn->closing) {
+            uring_connection_receive(server, conn, bid, (uint32_t)res);
+        } else {
+            uring_recycle_buffer(server, bid);
+        }
+    }
+
+    if (res == 0 || (res < 0 && res != -ENOBUFS && res != -ECANCELED)) { // Closed by the client or failed
+        uring_connection_close(server, conn);
+    } else if (!conn->receiving && !conn->closing) {
+        // A buffer handed back after the kernel ran out is used at once
+        if (res == -ENOBUFS && conn->held_first == URING_NO_BUFFER && server->rx_free == 0) {
+            uring_connection_starve(server, conn); // Re-armed once a buffer returns
+        } else {
+            uring_connection_pump(server, conn); // Re-arms a receive ended by the kernel unless paused
+        }
+    }
+
+    uring_connection_arm(server, conn);
+    uring_connection_release(server, conn);
+}
+
+static void uring_complete_send(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn, int32_t res) {
+    conn->pending--;
+
+    if (res <= 0) {
+        uring_connection_close(server, conn);
+    } else if (!conn->closing) {
+        conn->tx_sent += (uint16_t)res;
+        if (conn->tx_sent < conn->tx_len) { // Short send, queue the rest
+            if (uring_queue_send(server, conn) != 0) uring_connection_close(server, conn);
+            return;
+        }
+
+        conn->tx_len = 0;
+        uring_connection_pump(server, conn); // Requests held back by a full transmit buffer
+    }
+
+    uring_connection_arm(server, conn);
+    uring_connection_release(server, conn);
+}
+
+static void uring_complete_cancel(ModbusTcpUringServer *server, ModbusTcpUringConnection *conn) {
+    conn->pending--;
+    conn->canceling = false;
+    uring_connection_release(server, conn);
+}
+
+static void uring_complete_accept(ModbusTcpUringServer *server, int32_t res, uint32_t flags) {
+    if (res >= 0) uring_connection_open(server, res);
+
+    if (!(flags & IORING_CQE_F_MORE)) server->accepting = false; // Re-armed by the poll
+}
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+/**
+ * Set up the io_uring instance, buffers and listening socket of a server
+ *
+ * One multishot accept and one multishot receive per connection stay armed
+ * and receives land in a ring of buffers registered with the kernel, so a
+ * request costs no system call of its own. Responses are collected per
+ * connection and sent with one operation. Completions are handled in
+ * batches and the operations they trigger are submitted together with the
+ * next wait. Requests are processed by slave as with modbus_tcp_server_init().
+ * @param server Server instance
+ * @param slave  Initialized slave answering the requests
+ * @param cfg    Listening address, port, connection limit
+ *               (MODBUS_TCP_URING_DEFAULT_CONNECTIONS if 0), timeouts and
+ *               keepalive; only MBAP framing is supported
+ * @return 0 on success, -1 on error (errno is set, ENOSYS/EINVAL if the
+ *         kernel lacks io_uring or the features used)
+ */
+int modbus_tcp_uring_server_init(ModbusTcpUringServer *server, ModbusSlave *slave, const ModbusTcpServerConfig *cfg) {
+    if (!server || !slave || !cfg || cfg->framing != MODBUS_TCP_FRAMING_MBAP) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->slave = slave;
+    server->listen_fd = -1;
+    server->ring_fd = -1;
+    server->max_connections = cfg->max_connections ? cfg->max_connections : MODBUS_TCP_URING_DEFAULT_CONNECTIONS;
+    server->starved_head = server->max_connections;
+    server->starved_tail = server->max_connections;
+    server->tick = modbus_tcp_clock_ms() / MODBUS_TCP_SERVER_TICK_MS;
+    server->idle_ticks = modbus_tcp_timeout_ticks(cfg->idle_timeout_ms);
+    server->request_ticks = modbus_tcp_timeout_ticks(cfg->request_timeout_ms);
+    server->keepalive_s = cfg->keepalive_s;
+    modbus_timer_wheel_init(&server->timers, server->tick);
+
+    server->connections = calloc(server->max_connections, sizeof(*server->connections));
+    if (!server->connections) goto fail;
+    for (uint32_t i = 0; i < server->max_connections; ++i) {
+        server->connections[i].fd = -1;
+        server->connections[i].next_free = i + 1;
+    }
+
+    // Ring, created disabled so that the first polling thread becomes its only submitter
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_R_DISABLED | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    server->ring_fd = uring_setup(MODBUS_TCP_URING_ENTRIES, &params);
+    if (server->ring_fd < 0 && errno == EINVAL) { // Kernel before 6.1
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_R_DISABLED;
+        server->ring_fd = uring_setup(MODBUS_TCP_URING_ENTRIES, &params);
+    }
+    if (server->ring_fd < 0) goto fail;
+
+    server->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    server->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (server->cq_ring_size > server->sq_ring_size) server->sq_ring_size = server->cq_ring_size;
+        server->cq_ring_size = 0;
+    }
+
+    server->sq_ring = mmap(NULL, server->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           server->ring_fd, IORING_OFF_SQ_RING);
+    if (server->sq_ring == MAP_FAILED) goto fail;
+    server->cq_ring = server->sq_ring;
+    if (server->cq_ring_size) {
+        server->cq_ring = mmap(NULL, server->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                               server->ring_fd, IORING_OFF_CQ_RING);
+        if (server->cq_ring == MAP_FAILED) goto fail;
+    }
+
+    server->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    server->sqes = mmap(NULL, server->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        server->ring_fd, IORING_OFF_SQES);
+    if (server->sqes == MAP_FAILED) goto fail;
+
+    uint8_t *sq = server->sq_ring;
+    uint8_t *cq = server->cq_ring;
+    server->sq_head = (unsigned *)(sq + params.sq_off.head);
+    server->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    server->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    server->sq_entries = params.sq_entries;
+    server->sq_local_tail = *server->sq_tail;
+    server->cq_head = (unsigned *)(cq + params.cq_off.head);
+    server->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    server->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    server->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    unsigned *sq_array = (unsigned *)(sq + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; ++i) {
+        sq_array[i] = i;
+    }
+
+    // Provided receive buffers
+    server->rx_ring = mmap(NULL, MODBUS_TCP_URING_RX_BUFFERS * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (server->rx_ring == MAP_FAILED) goto fail;
+    server->rx_buffers = malloc((size_t)MODBUS_TCP_URING_RX_BUFFERS * MODBUS_TCP_URING_RX_BUFFER_SIZE);
+    if (!server->rx_buffers) goto fail;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)server->rx_ring;
+    reg.ring_entries = MODBUS_TCP_URING_RX_BUFFERS;
+    reg.bgid = URING_RX_GROUP;
+    if (uring_register(server->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) goto fail;
+    for (uint16_t bid = 0; bid < MODBUS_TCP_URING_RX_BUFFERS; ++bid) {
+        uring_recycle_buffer(server, bid);
+    }
+
+    // Transmit arena, two halves per connection
+    server->tx_arena_size = (size_t)server->max_connections * 2 * MODBUS_TCP_URING_TX_SIZE;
+    server->tx_arena = mmap(NULL, server->tx_arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (server->tx_arena == MAP_FAILED) goto fail;
+
+    server->listen_fd = modbus_tcp_listen(cfg);
+    if (server->listen_fd < 0) goto fail;
+
+    uring_queue_accept(server); // Submitted by the first poll
+    return 0;
+
+fail:
+    {
+        int saved = errno;
+        modbus_tcp_uring_server_close(server);
+        errno = saved;
+    }
+    return -1;
+}
+
+/**
+ * Get the port the server listens on, useful after binding port 0
+ * @return Port in host byte order, 0 on error
+ */
+uint16_t modbus_tcp_uring_server_port(const ModbusTcpUringServer *server) {
+    return modbus_tcp_local_port(server->listen_fd);
+}
+
+/**
+ * Submit queued operations, wait for completions and handle them - call in a loop
+ *
+ * The thread calling it first becomes the only thread allowed to poll.
+ * @param server     Server instance
+ * @param timeout_ms Longest wait in milliseconds, -1 to wait indefinitely
+ * @return Number of completions handled, -1 on error
+ */
+int modbus_tcp_uring_server_poll(ModbusTcpUringServer *server, int timeout_ms) {
+    if (!server->enabled) {
+        if (uring_register(server->ring_fd, IORING_REGISTER_ENABLE_RINGS, NULL, 0) != 0) return -1;
+        server->enabled = true;
+    }
+
+    timeout_ms = modbus_tcp_timer_wait(&server->timers, timeout_ms);
+    if (uring_enter(server, timeout_ms == 0 ? 0 : 1, timeout_ms) != 0) return -1;
+    server->tick = modbus_tcp_clock_ms() / MODBUS_TCP_SERVER_TICK_MS;
+
+    unsigned head = *server->cq_head;
+    unsigned tail = __atomic_load_n(server->cq_tail, __ATOMIC_ACQUIRE);
+    int count = 0;
+
+    while (head != tail) {
+        const struct io_uring_cqe *cqe = &server->cqes[head & server->cq_mask];
+        uint64_t user_data = cqe->user_data;
+        int32_t res = cqe->res;
+        uint32_t flags = cqe->flags;
+
+        head++;
+        count++;
+
+        ModbusTcpUringConnection *conn = (ModbusTcpUringConnection *)(uintptr_t)(user_data & ~(uint64_t)URING_TAG_MASK);
+        switch ((unsigned)(user_data & URING_TAG_MASK)) {
+        case URING_TAG_ACCEPT:
+            uring_complete_accept(server, res, flags);
+            break;
+        case URING_TAG_RECV:
+            uring_complete_recv(server, conn, res, flags);
+            break;
+        case URING_TAG_SEND:
+            uring_complete_send(server, conn, res);
+            break;
+        case URING_TAG_CANCEL:
+            uring_complete_cancel(server, conn);
+            break;
+        }
+
+        if (head == tail) tail = __atomic_load_n(server->cq_tail, __ATOMIC_ACQUIRE);
+    }
+
+    __atomic_store_n(server->cq_head, head, __ATOMIC_RELEASE);
+
+    uring_server_expire(server);
+    if (!server->accepting) uring_queue_accept(server);
+    if (server->feed_retry) {
+        server->feed_retry = false;
+        uring_server_feed(server);
+    }
+    return count;
+}
+
+/**
+ * Close every connection, the listening socket and the ring
+ */
+void modbus_tcp_uring_server_close(ModbusTcpUringServer *server) {
+    if (server->ring_fd >= 0) close(server->ring_fd); // Cancels everything in flight
+    if (server->listen_fd >= 0) close(server->listen_fd);
+
+    if (server->connections) {
+        for (uint32_t i = 0; i < server->max_connections; ++i) {
+            if (server->connections[i].fd >= 0) close(server->connections[i].fd);
+        }
+    }
+
+    if (server->sqes && server->sqes != MAP_FAILED) munmap(server->sqes, server->sqes_size);
+    if (server->cq_ring && server->cq_ring != MAP_FAILED && server->cq_ring != server->sq_ring) {
+        munmap(server->cq_ring, server->cq_ring_size);
+    }
+    if (server->sq_ring && server->sq_ring != MAP_FAILED) munmap(server->sq_ring, server->sq_ring_size);
+    if (server->rx_ring && server->rx_ring != MAP_FAILED) {
+        munmap(server->rx_ring, MODBUS_TCP_URING_RX_BUFFERS * sizeof(struct io_uring_buf));
+    }
+    if (server->tx_arena && server->tx_arena != MAP_FAILED) munmap(server->tx_arena, server->tx_arena_size);
+    free(server->rx_buffers);
+    free(server->connections);
+
+    memset(server, 0, sizeof(*server));
+    server->listen_fd = -1;
+    server->ring_fd = -1;
+}
+
+#endif /* MODBUS_ENABLE_TCP_URING */
@@ -0,0 +1,169 @@
+#ifndef MODBUS_TCP_URING_H
+#define MODBUS_TCP_URING_H
+
+#include "modbus_tcp_server.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Build the io_uring backend when the kernel headers know multishot receive
+ * and provided buffer rings (Linux 6.0). Whether the running kernel supports
+ * them is only known at modbus_tcp_uring_server_init().
+ */
+#ifndef MODBUS_ENABLE_TCP_URING
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT)
+#define MODBUS_ENABLE_TCP_URING 1
+#else
+#define MODBUS_ENABLE_TCP_URING 0
+#endif
+#endif
+
+#if MODBUS_ENABLE_TCP_URING
+
+/* Submission queue entries, the completion queue is twice as large */
+#ifndef MODBUS_TCP_URING_ENTRIES
+#define MODBUS_TCP_URING_ENTRIES 1024
+#endif
+
+/* Receive buffers provided to the kernel, a power of two */
+#ifndef MODBUS_TCP_URING_RX_BUFFERS
+#define MODBUS_TCP_URING_RX_BUFFERS 1024
+#endif
+
+#ifndef MODBUS_TCP_URING_RX_BUFFER_SIZE
+#define MODBUS_TCP_URING_RX_BUFFER_SIZE 2048
+#endif
+
+/* Receive ring per connection for requests split across buffers, a power of two that holds a maximum size ADU */
+#ifndef MODBUS_TCP_URING_RX_SIZE
+#define MODBUS_TCP_URING_RX_SIZE 1024
+#endif
+
+/* Responses collected per send, per connection and per half of its double buffer */
+#ifndef MODBUS_TCP_URING_TX_SIZE
+#define MODBUS_TCP_URING_TX_SIZE 2048
+#endif
+
+#if (MODBUS_TCP_URING_RX_BUFFERS & (MODBUS_TCP_URING_RX_BUFFERS - 1)) != 0 || MODBUS_TCP_URING_RX_BUFFERS > 32768
+#error "MODBUS_TCP_URING_RX_BUFFERS must be a power of two up to 32768"
+#endif
+
+#if (MODBUS_TCP_URING_RX_SIZE & (MODBUS_TCP_URING_RX_SIZE - 1)) != 0 || \
+    MODBUS_TCP_URING_RX_SIZE < MODBUS_TCP_MAX_ADU_LENGTH || MODBUS_TCP_URING_RX_SIZE > 32768
+#error "MODBUS_TCP_URING_RX_SIZE must be a power of two between 512 and 32768"
+#endif
+
+/* Connection limit used when the configuration sets none */
+#define MODBUS_TCP_URING_DEFAULT_CONNECTIONS MODBUS_TCP_SERVER_DEFAULT_CONNECTIONS
+
+/*==============================
+    Connections
+==============================*/
+typedef struct {
+    int fd;             /* -1 if the slot is free */
+    uint32_t next_free; /* Next free slot while on the free list */
+    uint8_t pending;    /* Operations in flight for this connection */
+    bool closing;       /* Shut down, released once nothing is pending */
+    uint8_t tx_active;  /* Half of the transmit buffer being filled */
+    uint16_t tx_fill;   /* Bytes queued in the active half */
+    uint16_t tx_len;    /* Bytes of the send in flight, 0 if none */
+    uint16_t tx_sent;   /* Bytes of the send in flight already sent */
+    bool receiving;     /* Multishot receive armed */
+    bool canceling;     /* Cancel of the multishot receive in flight */
+    bool starved;       /* Receive ended for lack of buffers, parked until one returns */
+    uint32_t starved_next; /* Neighbours on the list of starved connections */
+    uint32_t starved_prev;
+    uint16_t rx_head;   /* Ring index of the first unprocessed byte, free running */
+    uint16_t rx_tail;   /* Ring index one past the last received byte, free running */
+    uint16_t held_first;  /* First receive buffer waiting for room in the ring, 0xFFFF if none */
+    uint16_t held_last;   /* Last receive buffer waiting for room in the ring */
+    uint16_t held_offset; /* Bytes of the first held buffer already taken */
+    ModbusTimer timer;
+    uint64_t deadline;  /* Tick the connection times out at, the timer may be earlier */
+    uint8_t rx[MODBUS_TCP_URING_RX_SIZE];
+} ModbusTcpUringConnection;
+
+/*==============================
+    Server structure
+==============================*/
+typedef struct {
+    ModbusSlave *slave;
+    int listen_fd;
+    int ring_fd;
+
+    /* Submission queue */
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_local_tail; /* Entries prepared, published on submit */
+    struct io_uring_sqe *sqes;
+
+    /* Completion queue */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    /* Receive buffers registered as a provided buffer ring */
+    struct io_uring_buf_ring *rx_ring;
+    uint8_t *rx_buffers;
+    uint16_t rx_ring_tail;
+    uint16_t rx_free;     /* Buffers the kernel has, as far as the completions handled tell */
+    uint16_t rx_held_next[MODBUS_TCP_URING_RX_BUFFERS];   /* Next buffer held by the same connection */
+    uint16_t rx_held_length[MODBUS_TCP_URING_RX_BUFFERS]; /* Bytes received into a held buffer */
+    uint32_t starved_head; /* Connections waiting for a receive buffer, oldest first, max_connections if none */
+    uint32_t starved_tail;
+    bool feed_retry;       /* A buffer returned but no starved connection could be re-armed */
+
+    /* Transmit buffers, two halves per connection */
+    uint8_t *tx_arena;
+    size_t tx_arena_size;
+
+    bool enabled;   /* Ring enabled by the first poll */
+    bool accepting; /* Multishot accept armed */
+    ModbusTcpUringConnection *connections;
+    uint32_t max_connections;
+    uint32_t connection_count;
+    uint32_t free_head;
+    ModbusTimerWheel timers; /* Connection timeouts */
+    uint64_t tick;           /* Current tick, updated by every poll */
+    uint32_t idle_ticks;
+    uint32_t request_ticks;
+    uint16_t keepalive_s;
+    ModbusTcpServerStats stats;
+} ModbusTcpUringServer;
+
+/*==============================
+    Public API
+==============================*/
+int modbus_tcp_uring_server_init(ModbusTcpUringServer *server, ModbusSlave *slave, const ModbusTcpServerConfig *cfg);
+uint16_t modbus_tcp_uring_server_port(const ModbusTcpUringServer *server);
+int modbus_tcp_uring_server_poll(ModbusTcpUringServer *server, int timeout_ms);
+void modbus_tcp_uring_server_close(ModbusTcpUringServer *server);
+
+#endif /* MODBUS_ENABLE_TCP_URING */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_TCP_URING_H */
@@ -0,0 +1,197 @@
+#define _GNU_SOURCE
+
+#include "modbus_udp_server.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// =============================================================================
+// Batches
+// =============================================================================
+
+/**
+ * Receive a batch of datagrams without blocking
+ * @param msgs Message headers, set up by modbus_udp_server_poll()
+ * @return Datagrams received, 0 if none is waiting, -1 on error
+ */
+static int udp_server_recv_batch(ModbusUdpServer *server, struct mmsghdr *msgs) {
+    int count = recvmmsg(server->fd, msgs, MODBUS_UDP_SERVER_BATCH, MSG_DONTWAIT, NULL);
+    if (count >= 0) return count;
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+}
+
+/**
+ * Send the responses of a batch, each to the peer of its request
+ *
+ * A response the socket refuses is counted and skipped; once the socket
+ * buffer is full the rest of the batch is counted as unsent, as the peer
+ * retries a lost datagram anyway.
+ */
+static void udp_server_send_batch(ModbusUdpServer *server, struct mmsghdr *msgs, unsigned count) {
+    unsigned sent = 0;
+
+    while (sent < count) {
+        int n = sendmmsg(server->fd, &msgs[sent], count - sent, MSG_DONTWAIT);
+        server->stats.sends++;
+
+        if (n > 0) {
+            sent += (unsigned)n;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+            server->stats.unsent += count - sent;
+            return;
+        } else {
+            server->stats.unsent++; // Undeliverable peer, the others may still be
+            sent++;
+        }
+    }
+}
+
+/**
+ * Answer every valid request of a received batch
+ * @return Number of responses prepared in msgs
+ */
+static unsigned udp_server_process_batch(ModbusUdpServer *server, const struct mmsghdr *requests, unsigned count,
+                                         struct mmsghdr *msgs, struct iovec *iov) {
+    unsigned responses = 0;
+
+    for (unsigned i = 0; i < count; ++i) {
+        uint16_t length;
+
+        if ((requests[i].msg_hdr.msg_flags & MSG_TRUNC) ||
+            modbus_tcp_process_adu(server->slave, server->rx[i], (uint16_t)requests[i].msg_len,
+                                   server->tx[i], &length) != 0) {
+            server->stats.dropped++;
+            continue;
+        }
+
+        iov[responses].iov_base = server->tx[i];
+        iov[responses].iov_len = length;
+        memset(&msgs[responses].msg_hdr, 0, sizeof(msgs[responses].msg_hdr));
+        msgs[responses].msg_hdr.msg_name = &server->peers[i];
+        msgs[responses].msg_hdr.msg_namelen = requests[i].msg_hdr.msg_namelen;
+        msgs[responses].msg_hdr.msg_iov = &iov[responses];
+        msgs[responses].msg_hdr.msg_iovlen = 1;
+        responses++;
+    }
+
+    server->stats.requests += responses;
+    return responses;
+}
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+/**
+ * Initialize a Modbus UDP server and bind its socket
+ *
+ * The server does not spawn threads: the single thread calling
+ * modbus_udp_server_poll() serves every client. Requests are processed by
+ * slave with modbus_process_pdu(); the write callback of its configuration
+ * is not used.
+ * @param server Server instance
+ * @param slave  Initialized slave answering the requests
+ * @param cfg    Listening address, port and receive buffer size
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int modbus_udp_server_init(ModbusUdpServer *server, ModbusSlave *slave, const ModbusUdpServerConfig *cfg) {
+    if (!server || !slave || !cfg) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->slave = slave;
+    server->fd = -1;
+
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(cfg->port) };
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (cfg->address && inet_pton(AF_INET, cfg->address, &addr.sin_addr) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    server->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server->fd < 0) return -1;
+
+    int one = 1;
+    int rcvbuf = (int)cfg->rcvbuf;
+    if ((cfg->reuse_port && setsockopt(server->fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) ||
+        (rcvbuf && setsockopt(server->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) != 0) ||
+        bind(server->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int saved = errno;
+        modbus_udp_server_close(server);
+        errno = saved;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Get the port the server listens on, useful after binding port 0
+ * @return Port in host byte order, 0 on error
+ */
+uint16_t modbus_udp_server_port(const ModbusUdpServer *server) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    if (getsockname(server->fd, (struct sockaddr *)&addr, &len) != 0) return 0;
+    return ntohs(addr.sin_port);
+}
+
+/**
+ * Receive one batch of requests and answer it - call in a loop
+ *
+ * Waits only if no datagram is queued already, so a loaded server spends
+ * one receive and one send call per batch.
+ * @param server     Server instance
+ * @param timeout_ms Longest wait in milliseconds, -1 to wait indefinitely
+ * @return Number of datagrams received, -1 on error
+ */
+int modbus_udp_server_poll(ModbusUdpServer *server, int timeout_ms) {
+    struct mmsghdr requests[MODBUS_UDP_SERVER_BATCH];
+    struct mmsghdr responses[MODBUS_UDP_SERVER_BATCH];
+    struct iovec iov[MODBUS_UDP_SERVER_BATCH];
+
+    for (unsigned i = 0; i < MODBUS_UDP_SERVER_BATCH; ++i) {
+        iov[i].iov_base = server->rx[i];
+        iov[i].iov_len = sizeof(server->rx[i]);
+        memset(&requests[i].msg_hdr, 0, sizeof(requests[i].msg_hdr));
+        requests[i].msg_hdr.msg_name = &server->peers[i];
+        requests[i].msg_hdr.msg_namelen = sizeof(server->peers[i]);
+        requests[i].msg_hdr.msg_iov = &iov[i];
+        requests[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int count = udp_server_recv_batch(server, requests);
+    if (count == 0 && timeout_ms != 0) {
+        struct pollfd pfd = { .fd = server->fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready < 0) return errno == EINTR ? 0 : -1;
+        if (ready > 0) count = udp_server_recv_batch(server, requests);
+    }
+    if (count <= 0) return count;
+
+    server->stats.receives++;
+
+    // The request iovecs are no longer needed and are reused for the responses
+    unsigned prepared = udp_server_process_batch(server, requests, (unsigned)count, responses, iov);
+    if (prepared) udp_server_send_batch(server, responses, prepared);
+    return count;
+}
+
+/**
+ * Close the server socket
+ */
+void modbus_udp_server_close(ModbusUdpServer *server) {
+    if (server->fd >= 0) close(server->fd);
+    server->fd = -1;
+}
@@ -0,0 +1,74 @@
+#ifndef MODBUS_UDP_SERVER_H
+#define MODBUS_UDP_SERVER_H
+
+#include "modbus_tcp.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Modbus UDP server: every datagram carries one MBAP framed request and is
+ * answered by one datagram, as in Modbus TCP but without a connection.
+ *
+ * Datagrams are received and answered in batches of up to
+ * MODBUS_UDP_SERVER_BATCH with one recvmmsg() and one sendmmsg() call, so a
+ * busy server spends two system calls on a whole batch of requests.
+ */
+
+/* Datagrams received and answered per system call */
+#ifndef MODBUS_UDP_SERVER_BATCH
+#define MODBUS_UDP_SERVER_BATCH 64
+#endif
+
+#if MODBUS_UDP_SERVER_BATCH < 1 || MODBUS_UDP_SERVER_BATCH > 1024
+#error "MODBUS_UDP_SERVER_BATCH must be between 1 and 1024"
+#endif
+
+/*==============================
+    Configuration
+==============================*/
+typedef struct {
+    const char *address; /* IPv4 address to listen on, NULL for any */
+    uint16_t port;       /* Usually MODBUS_TCP_PORT, 0 for an ephemeral port */
+    bool reuse_port;     /* SO_REUSEPORT: servers sharing the port split the datagrams */
+    uint32_t rcvbuf;     /* Socket receive buffer in bytes, 0 for the system default */
+} ModbusUdpServerConfig;
+
+typedef struct {
+    uint64_t requests; /* Datagrams answered */
+    uint64_t receives; /* Receive calls that returned datagrams */
+    uint64_t sends;    /* Send calls issued, each carrying one or more responses */
+    uint32_t dropped;  /* Datagrams ignored, not exactly one valid ADU */
+    uint32_t unsent;   /* Responses the socket would not take */
+} ModbusUdpServerStats;
+
+/*==============================
+    Server structure
+==============================*/
+typedef struct {
+    ModbusSlave *slave;
+    int fd;
+    struct sockaddr_in peers[MODBUS_UDP_SERVER_BATCH];
+    uint8_t rx[MODBUS_UDP_SERVER_BATCH][MODBUS_TCP_MAX_ADU_LENGTH];
+    uint8_t tx[MODBUS_UDP_SERVER_BATCH][MODBUS_TCP_MAX_ADU_LENGTH];
+    ModbusUdpServerStats stats;
+} ModbusUdpServer;
+
+/*==============================
+    Public API
+==============================*/
+int modbus_udp_server_init(ModbusUdpServer *server, ModbusSlave *slave, const ModbusUdpServerConfig *cfg);
+uint16_t modbus_udp_server_port(const ModbusUdpServer *server);
+int modbus_udp_server_poll(ModbusUdpServer *server, int timeout_ms);
+void modbus_udp_server_close(ModbusUdpServer *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_UDP_SERVER_H */
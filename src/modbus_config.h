@@ -0,0 +1,317 @@
+#ifndef MODBUS_CONFIG_H
+#define MODBUS_CONFIG_H
+
+/*
+ * Compile-time configuration of the OpenModbus stack.
+ *
+ * Every option below has a default and may be overridden either on the
+ * compiler command line (e.g. -DMODBUS_ENABLE_FC_01=0) or from a project
+ * specific header named by MODBUS_CONFIG_FILE, e.g.
+ *
+ *     -DMODBUS_CONFIG_FILE=\"my_modbus_config.h\"
+ *
+ * Disabling a function code removes its handler, its dispatch case and its
+ * callback field from ModbusSlaveConfig, so unused protocol support costs
+ * neither flash nor RAM. Requests for a disabled function code are answered
+ * with an ILLEGAL FUNCTION exception.
+ */
+
+#ifdef MODBUS_CONFIG_FILE
+#include MODBUS_CONFIG_FILE
+#endif
+
+/*==============================
+    Function code selection
+==============================*/
+#ifndef MODBUS_ENABLE_FC_01
+#define MODBUS_ENABLE_FC_01 1 /* Read Coils */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_02
+#define MODBUS_ENABLE_FC_02 1 /* Read Discrete Inputs */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_03
+#define MODBUS_ENABLE_FC_03 1 /* Read Holding Registers */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_04
+#define MODBUS_ENABLE_FC_04 1 /* Read Input Registers */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_05
+#define MODBUS_ENABLE_FC_05 1 /* Write Single Coil */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_06
+#define MODBUS_ENABLE_FC_06 1 /* Write Single Register */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_07
+#define MODBUS_ENABLE_FC_07 0 /* Read Exception Status */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_08
+#define MODBUS_ENABLE_FC_08 0 /* Diagnostics */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_0F
+#define MODBUS_ENABLE_FC_0F 1 /* Write Multiple Coils */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_10
+#define MODBUS_ENABLE_FC_10 1 /* Write Multiple Registers */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_16
+#define MODBUS_ENABLE_FC_16 1 /* Mask Write Register */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_17
+#define MODBUS_ENABLE_FC_17 1 /* Read/Write Multiple Registers */
+#endif
+
+#ifndef MODBUS_ENABLE_FC_2B
+#define MODBUS_ENABLE_FC_2B 0 /* Encapsulated Interface Transport (Read Device Identification) */
+#endif
+
+/*==============================
+    Virtual units
+==============================*/
+
+/*
+ * Number of unit addresses one ModbusSlave can serve. With more than one,
+ * modbus_slave_add_unit() registers further configurations (callback sets)
+ * under their own addresses, and a 256-entry table maps each request to its
+ * unit in constant time. All units share the receiver, the frame buffer and
+ * the CRC check, so a gateway emulating many devices behind one serial port
+ * needs a single instance.
+ */
+#ifndef MODBUS_MAX_UNITS
+#define MODBUS_MAX_UNITS 1
+#endif
+
+#if MODBUS_MAX_UNITS < 1 || MODBUS_MAX_UNITS > 247
+#error "MODBUS_MAX_UNITS must be between 1 and 247"
+#endif
+
+/*==============================
+    Device identification
+==============================*/
+
+/*
+ * Bytes reserved in each ModbusSlave for precomputed Read Device
+ * Identification responses. modbus_slave_init() builds the complete frames
+ * (address and CRC included) of the basic, regular and extended stream
+ * requests starting at object 0, so a discovery scan is answered by handing
+ * the cached frame to write(). Frames that do not fit are built on demand.
+ * 0 disables the cache.
+ */
+#ifndef MODBUS_DEVICE_ID_CACHE_SIZE
+#define MODBUS_DEVICE_ID_CACHE_SIZE 0
+#endif
+
+/*==============================
+    Response cache
+==============================*/
+
+/*
+ * Number of read responses (0x01-0x04) cached per slave. A repeated request
+ * with the same address and PDU is answered with the stored frame, CRC
+ * included, without calling the application. Entries are invalidated by
+ * modbus_slave_bump_generation() and by every successful write request.
+ * 0 disables the cache.
+ */
+#ifndef MODBUS_RESPONSE_CACHE_ENTRIES
+#define MODBUS_RESPONSE_CACHE_ENTRIES 0
+#endif
+
+/*
+ * Largest response frame a cache entry can hold. Longer responses are not
+ * cached. The default fits any read response.
+ */
+#ifndef MODBUS_RESPONSE_CACHE_FRAME_SIZE
+#define MODBUS_RESPONSE_CACHE_FRAME_SIZE 256
+#endif
+
+/*==============================
+    Staged writes
+==============================*/
+
+/*
+ * Build support for staged register writes. A slave configured with
+ * staged_writes validates every register of a 0x10 or 0x17 request with the
+ * optional validate_register callback, keeps the values staged while the
+ * rest of the request is processed and hands them to
+ * write_multiple_registers in a single call once the request succeeded.
+ * A rejected request applies nothing. Staging 0x17 reads through
+ * read_holding_registers and therefore needs MODBUS_ENABLE_FC_03; without it
+ * 0x17 keeps using read_write_multiple_registers.
+ */
+#ifndef MODBUS_STAGED_WRITES
+#define MODBUS_STAGED_WRITES 0
+#endif
+
+#if MODBUS_STAGED_WRITES && !MODBUS_ENABLE_FC_10
+#error "MODBUS_STAGED_WRITES requires MODBUS_ENABLE_FC_10"
+#endif
+
+/*==============================
+    Change tracking
+==============================*/
+
+/*
+ * Number of coils (0x05, 0x0F) and holding registers (0x06, 0x10, 0x16,
+ * 0x17), counted from address 0, whose writes are recorded in per-unit
+ * dirty bitmaps. The application fetches the changed addresses with
+ * modbus_slave_next_dirty() instead of rescanning its tables. Each tracked
+ * address costs one bit of RAM per unit; 0 disables tracking for that table.
+ */
+#ifndef MODBUS_DIRTY_COIL_COUNT
+#define MODBUS_DIRTY_COIL_COUNT 0
+#endif
+
+#ifndef MODBUS_DIRTY_REGISTER_COUNT
+#define MODBUS_DIRTY_REGISTER_COUNT 0
+#endif
+
+#define MODBUS_ENABLE_DIRTY_TRACKING (MODBUS_DIRTY_COIL_COUNT || MODBUS_DIRTY_REGISTER_COUNT)
+
+/*==============================
+    Register bank
+==============================*/
+
+/*
+ * Build the seqlock protected register bank (modbus_register_bank.h). It
+ * relies on C11 atomics and is enabled by default whenever they are
+ * available.
+ */
+#ifndef MODBUS_ENABLE_REGISTER_BANK
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+#define MODBUS_ENABLE_REGISTER_BANK 1
+#else
+#define MODBUS_ENABLE_REGISTER_BANK 0
+#endif
+#endif
+
+/*
+ * How a register bank reader or writer waits while another writer is
+ * publishing. With threads (POSIX systems by default) it pauses the CPU for
+ * MODBUS_REGISTER_BANK_SPINS attempts, then yields the processor between
+ * attempts and gives up with SLAVE DEVICE BUSY only once no publication
+ * made progress for MODBUS_REGISTER_BANK_TIMEOUT_US: long enough for a
+ * writer on another core, or a preempted one, to finish.
+ */
+#ifndef MODBUS_REGISTER_BANK_THREADS
+#if defined(__unix__) || defined(__APPLE__)
+#define MODBUS_REGISTER_BANK_THREADS 1
+#else
+#define MODBUS_REGISTER_BANK_THREADS 0
+#endif
+#endif
+
+#ifndef MODBUS_REGISTER_BANK_SPINS
+#define MODBUS_REGISTER_BANK_SPINS 64
+#endif
+
+#ifndef MODBUS_REGISTER_BANK_TIMEOUT_US
+#define MODBUS_REGISTER_BANK_TIMEOUT_US 100000
+#endif
+
+/*
+ * Without threads, how many times a register bank reader or writer retries
+ * before giving up. Bounds the wait when a context interrupts a writer on a
+ * single core system, where the writer cannot finish until it returns.
+ */
+#ifndef MODBUS_REGISTER_BANK_MAX_RETRIES
+#define MODBUS_REGISTER_BANK_MAX_RETRIES 100
+#endif
+
+/*==============================
+    Diagnostics
+==============================*/
+
+/*
+ * Maintain the serial line counters (bus messages, CRC errors, exceptions,
+ * overruns, ...) in ModbusSlave. Required by Diagnostics (0x08).
+ */
+#ifndef MODBUS_ENABLE_COUNTERS
+#define MODBUS_ENABLE_COUNTERS MODBUS_ENABLE_FC_08
+#endif
+
+#if MODBUS_ENABLE_FC_08 && !MODBUS_ENABLE_COUNTERS
+#error "MODBUS_ENABLE_FC_08 requires MODBUS_ENABLE_COUNTERS"
+#endif
+
+/*==============================
+    Half-duplex transmit
+==============================*/
+
+/*
+ * Add the RS-485 transmit hooks to ModbusSlaveConfig. Every response is
+ * preceded by the optional turnaround delay (through delay_us) and framed by
+ * tx_begin and tx_end around write(), so the driver enable pin of the
+ * transceiver is only raised for the response and dropped as soon as write()
+ * returns.
+ */
+#ifndef MODBUS_ENABLE_TX_HOOKS
+#define MODBUS_ENABLE_TX_HOOKS 0
+#endif
+
+/*==============================
+    Response deadline
+==============================*/
+
+/*
+ * Add a response deadline to ModbusSlaveConfig. modbus_slave_3_5t_elapsed()
+ * timestamps every complete frame with the now_ms clock, and a request still
+ * waiting for modbus_slave_poll() when its deadline has passed is dropped
+ * unanswered: its master has given up on it, and answering late only takes
+ * bus time from the retry and may collide with it. Broadcasts have no master
+ * waiting for them and are always executed.
+ */
+#ifndef MODBUS_ENABLE_DEADLINE
+#define MODBUS_ENABLE_DEADLINE 0
+#endif
+
+/*==============================
+    Memory footprint
+==============================*/
+
+/*
+ * When set, ModbusSlave keeps a pointer to the ModbusSlaveConfig passed to
+ * modbus_slave_init() instead of a private copy. The configuration can then
+ * be a const object placed in flash and shared by any number of instances;
+ * it must outlive every slave that references it. The slave address is kept
+ * per instance (see modbus_slave_set_address()).
+ */
+#ifndef MODBUS_SHARED_CONFIG
+#define MODBUS_SHARED_CONFIG 0
+#endif
+
+/*
+ * When set, the receiver state and its flags are packed into bit-fields of
+ * a single byte. The byte is updated from both the ISR and the main loop,
+ * so only enable this when modbus_slave_poll() cannot be preempted by the
+ * receive/timer ISRs of the same instance (e.g. polling from the ISR itself
+ * or masking those interrupts around the poll).
+ */
+#ifndef MODBUS_PACKED_FLAGS
+#define MODBUS_PACKED_FLAGS 0
+#endif
+
+/*
+ * Size of the receive buffer embedded in each ModbusSlave. Requests longer
+ * than this are dropped. Set to 0 to embed no buffer at all and attach a
+ * buffer of any size to each instance with modbus_slave_set_frame_buffer().
+ */
+#ifndef MODBUS_FRAME_BUFFER_SIZE
+#define MODBUS_FRAME_BUFFER_SIZE 256
+#endif
+
+#if MODBUS_FRAME_BUFFER_SIZE != 0 && \
+    (MODBUS_FRAME_BUFFER_SIZE < 4 || MODBUS_FRAME_BUFFER_SIZE > 256)
+#error "MODBUS_FRAME_BUFFER_SIZE must be 0 or between 4 and 256"
+#endif
+
+#endif /* MODBUS_CONFIG_H */
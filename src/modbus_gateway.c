@@ -0,0 +1,694 @@
+#include "modbus_gateway.h"
+#include "modbus_crc16.h"
+#include "modbus_rtu.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define GATEWAY_REQUEST_OF_LINK(link) \
+    ((ModbusGatewayRequest *)((char *)(link) - offsetof(ModbusGatewayRequest, next)))
+
+#define GATEWAY_KEY_LENGTH 6 // Unit, function code, start address, quantity
+
+// =============================================================================
+// Responses
+// =============================================================================
+
+/**
+ * Deliver a response PDU to a source with the MBAP header of its request
+ * @param header MBAP header of the request
+ */
+static void gateway_respond_pdu(ModbusGateway *gateway, ModbusGatewaySource *source, const uint8_t *header,
+                                const uint8_t *pdu, uint16_t pdu_len) {
+    uint8_t adu[MODBUS_TCP_MAX_ADU_LENGTH];
+
+    memcpy(adu, header, MODBUS_MBAP_HEADER_LENGTH);
+    modbus_be16_set(&adu[4], (uint16_t)(pdu_len + 1));
+    memcpy(&adu[MODBUS_MBAP_HEADER_LENGTH], pdu, pdu_len);
+    gateway->respond(source, adu, (uint16_t)(MODBUS_MBAP_HEADER_LENGTH + pdu_len));
+}
+
+/**
+ * Answer a request with a gateway exception
+ * @param header MBAP header of the request
+ */
+static void gateway_respond_exception(ModbusGateway *gateway, ModbusGatewaySource *source,
+                                      const uint8_t *header, uint8_t function_code, ModbusExceptionCode code) {
+    const uint8_t pdu[2] = { (uint8_t)(function_code | MODBUS_FC_EXCEPTION_MASK), (uint8_t)code };
+
+    gateway_respond_pdu(gateway, source, header, pdu, sizeof(pdu));
+}
+
+/**
+ * Deliver a response PDU to the source of a request and to the sources of
+ * the reads that joined it
+ * @return Number of sources answered
+ */
+static uint32_t bus_answer(ModbusGatewayBus *bus, const ModbusGatewayRequest *request,
+                           const uint8_t *pdu, uint16_t pdu_len) {
+    uint32_t answered = 0;
+
+    for (; request; request = request->joined) {
+        if (!request->source) continue; // Cancelled
+        gateway_respond_pdu(bus->gateway, request->source, request->header, pdu, pdu_len);
+        answered++;
+    }
+    return answered;
+}
+
+// =============================================================================
+// Shared reads
+// =============================================================================
+
+/**
+ * Check whether a request frame is a plain read, which may be shared
+ * @param frame     Unit identifier followed by the PDU
+ * @param frame_len Frame length, CRC included
+ */
+static bool gateway_is_read(const uint8_t *frame, uint16_t frame_len) {
+    if (frame_len != GATEWAY_KEY_LENGTH + 2 || frame[0] == 0x00) return false;
+
+    switch (frame[1]) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Get the data a write request modifies
+ * @param frame     Request frame, CRC included
+ * @param frame_len Frame length
+ * @param table     Set to the function code reading the table written
+ * @param first     Set to the first address written
+ * @param count     Set to the number of addresses written, the whole
+ *                  table if the request is too short to tell
+ * @return true if the request is a write
+ */
+static bool gateway_write_range(const uint8_t *frame, uint16_t frame_len,
+                                uint8_t *table, uint32_t *first, uint32_t *count) {
+    const uint8_t *pdu = &frame[1];
+    uint16_t pdu_len = (uint16_t)(frame_len - 3);
+    uint16_t range_offset = 1;
+    uint16_t quantity_offset = 0; // Single address writes carry no quantity
+
+    switch (pdu[0]) {
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+            *table = MODBUS_FC_READ_COILS;
+            break;
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+            *table = MODBUS_FC_READ_COILS;
+            quantity_offset = 3;
+            break;
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+        case MODBUS_FC_MASK_WRITE_REGISTER:
+            *table = MODBUS_FC_READ_HOLDING_REGISTERS;
+            break;
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            *table = MODBUS_FC_READ_HOLDING_REGISTERS;
+            quantity_offset = 3;
+            break;
+        case MODBUS_FC_READ_WRITE_MULTIPLE_REGS:
+            *table = MODBUS_FC_READ_HOLDING_REGISTERS;
+            range_offset = 5;
+            quantity_offset = 7;
+            break;
+        default:
+            return false;
+    }
+
+    uint16_t needed = (uint16_t)((quantity_offset ? quantity_offset : range_offset) + 2);
+    if (pdu_len < needed) {
+        *first = 0;
+        *count = 0x10000;
+    } else {
+        *first = modbus_be16_get(&pdu[range_offset]);
+        *count = quantity_offset ? modbus_be16_get(&pdu[quantity_offset]) : 1;
+    }
+    return true;
+}
+
+/**
+ * Check whether a read covers data of a write
+ * @param read Read key: unit, function code, start address, quantity
+ * @param unit Unit written, 0 for a broadcast reaching every unit
+ */
+static bool gateway_read_overlaps(const uint8_t *read, uint8_t unit, uint8_t table, uint32_t first, uint32_t count) {
+    if ((unit != 0x00 && read[0] != unit) || read[1] != table) return false;
+
+    uint32_t address = modbus_be16_get(&read[2]);
+    uint32_t quantity = modbus_be16_get(&read[4]);
+    return address < first + count && first < address + quantity;
+}
+
+/**
+ * Find a shared read identical to a request, queued or on the line
+ * @return Request to join, NULL if none
+ */
+static ModbusGatewayRequest *bus_find_shared(ModbusGatewayBus *bus, const ModbusGatewayRequest *request) {
+    if (bus->active && bus->active->shared && memcmp(bus->active->frame, request->frame, GATEWAY_KEY_LENGTH) == 0) {
+        return bus->active;
+    }
+    for (ModbusGatewayRequest *waiting = bus->head; waiting; waiting = waiting->next) {
+        if (waiting->shared && memcmp(waiting->frame, request->frame, GATEWAY_KEY_LENGTH) == 0) return waiting;
+    }
+    return NULL;
+}
+
+#if MODBUS_GATEWAY_CACHE_ENTRIES
+/**
+ * Find a cached response to a read that is still within the TTL
+ * @param key Read key: unit, function code, start address, quantity
+ * @return Cache entry, NULL on miss
+ */
+static const ModbusGatewayCacheEntry *bus_cache_lookup(const ModbusGatewayBus *bus, const uint8_t *key,
+                                                       uint32_t now_ms) {
+    if (!bus->config.cache_ttl_ms) return NULL;
+
+    for (uint8_t i = 0; i < MODBUS_GATEWAY_CACHE_ENTRIES; ++i) {
+        const ModbusGatewayCacheEntry *entry = &bus->cache[i];
+        if (entry->pdu_len == 0 || now_ms - entry->stored_ms >= bus->config.cache_ttl_ms) continue;
+        if (memcmp(entry->request, key, GATEWAY_KEY_LENGTH) == 0) return entry;
+    }
+    return NULL;
+}
+
+/**
+ * Store the response to a read, over the expired entry of the same read
+ * or else in round-robin order
+ */
+static void bus_cache_store(ModbusGatewayBus *bus, const uint8_t *key, const uint8_t *pdu, uint16_t pdu_len,
+                            uint32_t now_ms) {
+    if (!bus->config.cache_ttl_ms) return;
+
+    ModbusGatewayCacheEntry *entry = NULL;
+    for (uint8_t i = 0; i < MODBUS_GATEWAY_CACHE_ENTRIES && !entry; ++i) {
+        if (bus->cache[i].pdu_len && memcmp(bus->cache[i].request, key, GATEWAY_KEY_LENGTH) == 0) {
+            entry = &bus->cache[i];
+        }
+    }
+    if (!entry) {
+        entry = &bus->cache[bus->cache_next];
+        bus->cache_next = (uint8_t)((bus->cache_next + 1) % MODBUS_GATEWAY_CACHE_ENTRIES);
+    }
+
+    entry->stored_ms = now_ms;
+    entry->pdu_len = pdu_len;
+    memcpy(entry->request, key, GATEWAY_KEY_LENGTH);
+    memcpy(entry->pdu, pdu, pdu_len);
+}
+#endif
+
+/**
+ * Drop the reads a write request makes stale
+ *
+ * Cached responses covering the written data are dropped both when the
+ * write is queued and when it goes on the line, as reads of other masters
+ * may be sent in between. Reads already queued stop being shared when the
+ * write is queued, so that a read issued after the write never gets data
+ * read before it.
+ * @param request Request, nothing is done unless it is a write
+ * @param queued  true when the write is queued, false when it is sent
+ */
+static void bus_invalidate(ModbusGatewayBus *bus, const ModbusGatewayRequest *request, bool queued) {
+    uint8_t unit = request->frame[0];
+    uint8_t table;
+    uint32_t first;
+    uint32_t count;
+
+    if (!request->write) return;
+    gateway_write_range(request->frame, request->frame_len, &table, &first, &count);
+
+#if MODBUS_GATEWAY_CACHE_ENTRIES
+    for (uint8_t i = 0; i < MODBUS_GATEWAY_CACHE_ENTRIES; ++i) {
+        ModbusGatewayCacheEntry *entry = &bus->cache[i];
+        if (entry->pdu_len && gateway_read_overlaps(entry->request, unit, table, first, count)) entry->pdu_len = 0;
+    }
+#endif
+    if (!queued) return;
+
+    if (bus->active && gateway_read_overlaps(bus->active->frame, unit, table, first, count)) {
+        bus->active->shared = false;
+    }
+    for (ModbusGatewayRequest *waiting = bus->head; waiting; waiting = waiting->next) {
+        if (gateway_read_overlaps(waiting->frame, unit, table, first, count)) waiting->shared = false;
+    }
+}
+
+// =============================================================================
+// Scheduling
+// =============================================================================
+
+/**
+ * Check whether a waiting request goes on the line before another one
+ *
+ * The source served least recently goes first, so every master gets its
+ * turn however many requests the others queue; a source's own requests
+ * keep their order.
+ */
+static bool bus_goes_before(const ModbusGatewayBus *bus, const ModbusGatewayRequest *a,
+                            const ModbusGatewayRequest *b) {
+    if (bus->config.policy == MODBUS_GATEWAY_PRIORITY && a->source->priority != b->source->priority) {
+        return a->source->priority > b->source->priority;
+    }
+    if (a->source == b->source) return false;
+    return (int32_t)(a->source->served - b->source->served) < 0;
+}
+
+/**
+ * Take the next request to send from the waiting list - O(depth)
+ * @return Request, NULL if none is waiting
+ */
+static ModbusGatewayRequest *bus_dequeue(ModbusGatewayBus *bus) {
+    ModbusGatewayRequest **best = NULL;
+
+    for (ModbusGatewayRequest **link = &bus->head; *link; link = &(*link)->next) {
+        if (!best || bus_goes_before(bus, *link, *best)) best = link;
+    }
+    if (!best) return NULL;
+
+    ModbusGatewayRequest *request = *best;
+    *best = request->next;
+    if (bus->tail == request) bus->tail = best == &bus->head ? NULL : GATEWAY_REQUEST_OF_LINK(best);
+    request->next = NULL;
+    return request;
+}
+
+/**
+ * Detach a request from its source
+ */
+static void bus_disown(ModbusGatewayRequest *request) {
+    request->source->queued--;
+    if (request->write) request->source->writes--;
+    request->source = NULL;
+}
+
+/**
+ * Release a request that left the line, with the reads that joined it
+ */
+static void bus_release(ModbusGatewayBus *bus, ModbusGatewayRequest *request) {
+    while (request) {
+        ModbusGatewayRequest *joined = request->joined;
+        if (request->source) bus_disown(request);
+        modbus_pool_free(&bus->requests, request);
+        request = joined;
+    }
+    bus->stats.depth = bus->requests.in_use;
+}
+
+/**
+ * End the transaction on the line and account for the time it took
+ * @param quiet_ms Silence to keep before the next request
+ */
+static void bus_finish(ModbusGatewayBus *bus, uint32_t now_ms, uint32_t quiet_ms) {
+    if (bus->active) bus_release(bus, bus->active);
+    bus->active = NULL;
+    bus->rx_len = 0;
+    bus->stats.busy_ms += now_ms - bus->busy_since_ms;
+    bus->state = MODBUS_GATEWAY_BUS_QUIET;
+    bus->deadline_ms = now_ms + quiet_ms;
+}
+
+/**
+ * Put the next waiting request on the line once it is idle and silent
+ */
+static void bus_start(ModbusGatewayBus *bus, uint32_t now_ms) {
+    if (bus->state == MODBUS_GATEWAY_BUS_QUIET && (int32_t)(now_ms - bus->deadline_ms) >= 0) {
+        bus->state = MODBUS_GATEWAY_BUS_IDLE;
+    }
+    if (bus->state != MODBUS_GATEWAY_BUS_IDLE) return;
+
+    ModbusGatewayRequest *request = bus_dequeue(bus);
+    if (!request) return;
+
+    request->source->served = ++bus->gateway->ticket;
+    bus->stats.requests++;
+    bus->stats.wait_ms += now_ms - request->queued_ms;
+    bus->busy_since_ms = now_ms;
+    bus->rx_len = 0;
+    bus_invalidate(bus, request, false);
+    bus->config.write(bus->config.ctx, request->frame, request->frame_len);
+
+    if (request->frame[0] == 0x00) { // Broadcast, no response to wait for
+        bus->state = MODBUS_GATEWAY_BUS_TURNAROUND;
+        bus->deadline_ms = now_ms + bus->config.turnaround_ms;
+        bus_release(bus, request);
+    } else {
+        bus->state = MODBUS_GATEWAY_BUS_WAITING;
+        bus->deadline_ms = now_ms + bus->config.response_timeout_ms;
+        bus->active = request;
+    }
+}
+
+/**
+ * Drop the reads of a source that joined a request
+ */
+static void bus_cancel_joined(ModbusGatewayBus *bus, ModbusGatewayRequest *request, ModbusGatewaySource *source) {
+    ModbusGatewayRequest **link = &request->joined;
+
+    while (*link) {
+        ModbusGatewayRequest *joined = *link;
+        if (joined->source == source) {
+            *link = joined->joined;
+            joined->joined = NULL;
+            bus_release(bus, joined);
+        } else {
+            link = &joined->joined;
+        }
+    }
+}
+
+/**
+ * Withdraw the requests of a source from one bus
+ */
+static void bus_cancel(ModbusGatewayBus *bus, ModbusGatewaySource *source) {
+    ModbusGatewayRequest **link = &bus->head;
+
+    bus->tail = NULL;
+    while (*link) {
+        ModbusGatewayRequest *request = *link;
+
+        bus_cancel_joined(bus, request, source);
+        if (request->source != source) {
+            bus->tail = request;
+            link = &request->next;
+            continue;
+        }
+
+        ModbusGatewayRequest *heir = request->joined;
+        if (heir) { // Other masters await the same read, the first takes its place in the queue
+            heir->next = request->next;
+            heir->shared = request->shared;
+            *link = heir;
+            request->joined = NULL;
+        } else {
+            *link = request->next;
+        }
+        bus_release(bus, request);
+    }
+
+    if (bus->active) {
+        bus_cancel_joined(bus, bus->active, source);
+        if (bus->active->source == source) bus_disown(bus->active);
+    }
+}
+
+/**
+ * Get the silence that ends an RTU frame on a line, in milliseconds
+ *
+ * 3.5 character times of 11 bits, fixed at 1750 us above 19200 bit/s as
+ * the RTU specification recommends, rounded up and with a millisecond more
+ * as a free running millisecond clock may tick just after a frame ends.
+ */
+static uint32_t bus_frame_gap_ms(uint32_t baudrate) {
+    uint32_t gap_us = baudrate > 19200 ? 1750 : (38500000 + baudrate - 1) / baudrate;
+
+    return (gap_us + 999) / 1000 + 1;
+}
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+/**
+ * Initialize a gateway without buses
+ * @param gateway Gateway instance
+ * @param respond Called with the response ADU of every request, from
+ *                modbus_gateway_submit(), modbus_gateway_bus_rx() or
+ *                modbus_gateway_bus_poll()
+ */
+void modbus_gateway_init(ModbusGateway *gateway,
+                         void (*respond)(ModbusGatewaySource *source, const uint8_t *adu, uint16_t length)) {
+    memset(gateway, 0, sizeof(*gateway));
+    gateway->respond = respond;
+}
+
+/**
+ * Initialize a serial bus
+ * @param bus Bus instance
+ * @param cfg Write callback, scheduling policy, timeouts, line timing and
+ *            cache TTL
+ * @return 0 on success, -1 on invalid configuration
+ */
+int modbus_gateway_bus_init(ModbusGatewayBus *bus, const ModbusGatewayBusConfig *cfg) {
+    if (!bus || !cfg || !cfg->write) return -1;
+
+    memset(bus, 0, sizeof(*bus));
+    bus->config = *cfg;
+    if (!bus->config.response_timeout_ms) bus->config.response_timeout_ms = MODBUS_GATEWAY_RESPONSE_TIMEOUT_MS;
+    if (!bus->config.turnaround_ms) bus->config.turnaround_ms = MODBUS_GATEWAY_TURNAROUND_MS;
+    if (!bus->config.baudrate) bus->config.baudrate = MODBUS_GATEWAY_BAUDRATE;
+    uint32_t gap_ms = bus_frame_gap_ms(bus->config.baudrate);
+    if (bus->config.frame_gap_ms < gap_ms) bus->config.frame_gap_ms = gap_ms;
+    if (!bus->config.timeout_quiet_ms) bus->config.timeout_quiet_ms = MODBUS_GATEWAY_TIMEOUT_QUIET_MS;
+    if (bus->config.timeout_quiet_ms < bus->config.frame_gap_ms) {
+        bus->config.timeout_quiet_ms = bus->config.frame_gap_ms;
+    }
+
+    return modbus_pool_init(&bus->requests, bus->storage, sizeof(ModbusGatewayRequest),
+                            MODBUS_GATEWAY_QUEUE_DEPTH);
+}
+
+/**
+ * Attach a bus and route a range of unit identifiers to it
+ *
+ * Routing unit 0 makes TCP requests to it broadcasts on the bus, which get
+ * no response. A bus may be added again to route more ranges.
+ * @return 0 on success, -1 if the gateway has no room for another bus
+ */
+int modbus_gateway_add_bus(ModbusGateway *gateway, ModbusGatewayBus *bus, uint8_t first_unit, uint8_t last_unit) {
+    uint8_t index = 0;
+
+    while (index < gateway->bus_count && gateway->buses[index] != bus) index++;
+    if (index == gateway->bus_count) {
+        if (gateway->bus_count == MODBUS_GATEWAY_MAX_BUSES) return -1;
+        gateway->buses[gateway->bus_count++] = bus;
+    }
+    bus->gateway = gateway;
+
+    for (uint16_t unit = first_unit; unit <= last_unit; ++unit) {
+        gateway->route[unit] = (uint8_t)(index + 1);
+    }
+    return 0;
+}
+
+/**
+ * Initialize a source of requests
+ * @param source   Source instance
+ * @param ctx      Application data, e.g. the connection to respond on
+ * @param priority Higher is served first on MODBUS_GATEWAY_PRIORITY buses
+ */
+void modbus_gateway_source_init(ModbusGatewaySource *source, void *ctx, uint8_t priority) {
+    memset(source, 0, sizeof(*source));
+    source->ctx = ctx;
+    source->priority = priority;
+}
+
+/**
+ * Queue a Modbus TCP request on the bus its unit is routed to
+ *
+ * Requests for units without a route are answered at once with GATEWAY
+ * PATH UNAVAILABLE, and requests finding their bus queue full with SLAVE
+ * DEVICE BUSY. Reads (0x01-0x04) are answered from the cache while the bus
+ * holds a fresh response, or else join an identical read queued or on the
+ * line. An idle bus sends the request before this returns.
+ * @param gateway Gateway instance
+ * @param source  Source the response is delivered to
+ * @param adu     Complete request ADU, as sized by modbus_tcp_adu_length()
+ * @param length  ADU length
+ * @param now_ms  Current time
+ * @return 0 if queued or answered, -1 if the ADU is malformed
+ */
+int modbus_gateway_submit(ModbusGateway *gateway, ModbusGatewaySource *source,
+                          const uint8_t *adu, uint16_t length, uint32_t now_ms) {
+    if (modbus_tcp_adu_length(adu, length) != (int32_t)length) return -1;
+
+    const uint8_t *pdu = &adu[MODBUS_MBAP_HEADER_LENGTH];
+    uint16_t pdu_len = (uint16_t)(length - MODBUS_MBAP_HEADER_LENGTH);
+    uint8_t unit = adu[6];
+
+    if (!gateway->route[unit]) {
+        gateway_respond_exception(gateway, source, adu, pdu[0], MODBUS_EX_GATEWAY_PATH_UNAVAILABLE);
+        return 0;
+    }
+
+    ModbusGatewayBus *bus = gateway->buses[gateway->route[unit] - 1];
+    bool read = gateway_is_read(&adu[6], (uint16_t)(pdu_len + 3)); // Unit and PDU, the frame without its CRC
+    bool shareable = read && !source->writes; // Must not get data read before a write of its own
+
+#if MODBUS_GATEWAY_CACHE_ENTRIES
+    const ModbusGatewayCacheEntry *cached = shareable ? bus_cache_lookup(bus, &adu[6], now_ms) : NULL;
+    if (cached) {
+        bus->stats.cache_hits++;
+        gateway_respond_pdu(gateway, source, adu, cached->pdu, cached->pdu_len);
+        return 0;
+    }
+#endif
+
+    ModbusGatewayRequest *request = modbus_pool_alloc(&bus->requests);
+    if (!request) {
+        bus->stats.rejected++;
+        gateway_respond_exception(gateway, source, adu, pdu[0], MODBUS_EX_SLAVE_DEVICE_BUSY);
+        return 0;
+    }
+
+    request->next = NULL;
+    request->joined = NULL;
+    request->source = source;
+    request->queued_ms = now_ms;
+    request->shared = read;
+    memcpy(request->header, adu, MODBUS_MBAP_HEADER_LENGTH);
+
+    // Unit identifier becomes the address, the PDU is carried as is
+    request->frame[0] = unit;
+    memcpy(&request->frame[1], pdu, pdu_len);
+    modbus_le16_set(&request->frame[1 + pdu_len], modbus_crc16(request->frame, (uint16_t)(1 + pdu_len)));
+    request->frame_len = (uint16_t)(pdu_len + 3);
+
+    uint8_t table;
+    uint32_t first;
+    uint32_t count;
+    request->write = gateway_write_range(request->frame, request->frame_len, &table, &first, &count);
+
+    source->queued++;
+    if (request->write) source->writes++;
+    bus->stats.depth = bus->requests.in_use;
+    if (bus->stats.depth > bus->stats.peak_depth) bus->stats.peak_depth = bus->stats.depth;
+
+    ModbusGatewayRequest *leader = shareable ? bus_find_shared(bus, request) : NULL;
+    if (leader) {
+        request->joined = leader->joined;
+        leader->joined = request;
+        bus->stats.coalesced++;
+        return 0;
+    }
+
+    bus_invalidate(bus, request, true);
+    if (bus->tail) bus->tail->next = request;
+    else bus->head = request;
+    bus->tail = request;
+
+    bus_start(bus, now_ms);
+    return 0;
+}
+
+/**
+ * Withdraw every request of a source, e.g. when its connection closes
+ *
+ * Waiting requests are dropped, though a read other masters joined stays
+ * queued for them. A request already on the line completes, as the unit
+ * answers it anyway, but its response is discarded.
+ */
+void modbus_gateway_cancel(ModbusGateway *gateway, ModbusGatewaySource *source) {
+    for (uint8_t i = 0; i < gateway->bus_count && source->queued; ++i) {
+        bus_cancel(gateway->buses[i], source);
+    }
+}
+
+/**
+ * Pass bytes read from the serial line of a bus
+ *
+ * The response is delimited by length rules and CRC (modbus_rtu.h), so the
+ * line needs no inter-character timing. It is forwarded once complete if it
+ * comes from the addressed unit for the function requested, and the next
+ * request goes on the line after the frame gap. Other frames are dropped,
+ * as are bytes received while no response is awaited: a late response to a
+ * request that timed out, or noise, restarts the frame gap so the next
+ * request waits for the line to fall silent.
+ * @param bus    Bus instance
+ * @param data   Received bytes
+ * @param length Number of bytes
+ * @param now_ms Current time
+ */
+void modbus_gateway_bus_rx(ModbusGatewayBus *bus, const uint8_t *data, uint16_t length, uint32_t now_ms) {
+    if (bus->state != MODBUS_GATEWAY_BUS_WAITING) {
+        bus->stats.stray += length;
+        if (bus->state == MODBUS_GATEWAY_BUS_TURNAROUND) return;
+
+        uint32_t silent_ms = now_ms + bus->config.frame_gap_ms;
+        if (bus->state == MODBUS_GATEWAY_BUS_IDLE || (int32_t)(silent_ms - bus->deadline_ms) > 0) {
+            bus->deadline_ms = silent_ms;
+        }
+        bus->state = MODBUS_GATEWAY_BUS_QUIET;
+        return;
+    }
+
+    while (length) {
+        uint16_t take = (uint16_t)(sizeof(bus->rx) - bus->rx_len);
+        if (take > length) take = length;
+        memcpy(&bus->rx[bus->rx_len], data, take);
+        bus->rx_len += take;
+        data += take;
+        length -= take;
+
+        for (;;) {
+            int32_t frame_len = modbus_rtu_response_length(bus->rx, bus->rx_len);
+            if (frame_len == 0) break;
+
+            const ModbusGatewayRequest *request = bus->active;
+            if (frame_len > 0 && bus->rx[0] == request->frame[0] &&
+                (bus->rx[1] & ~MODBUS_FC_EXCEPTION_MASK) == request->frame[1]) {
+                uint16_t pdu_len = (uint16_t)(frame_len - 3); // Address and CRC stripped
+
+#if MODBUS_GATEWAY_CACHE_ENTRIES
+                if (request->shared && !(bus->rx[1] & MODBUS_FC_EXCEPTION_MASK)) {
+                    bus_cache_store(bus, request->frame, &bus->rx[1], pdu_len, now_ms);
+                }
+#endif
+                bus->stats.responses += bus_answer(bus, request, &bus->rx[1], pdu_len);
+                bus_finish(bus, now_ms, bus->config.frame_gap_ms);
+                return;
+            }
+
+            // Not the awaited response, resynchronize on the next byte
+            if (frame_len > 0) bus->stats.garbled++;
+            uint16_t drop = frame_len > 0 ? (uint16_t)frame_len : 1;
+            bus->rx_len -= drop;
+            memmove(bus->rx, &bus->rx[drop], bus->rx_len);
+        }
+    }
+}
+
+/**
+ * Run the timers of a bus - call at least by modbus_gateway_bus_next()
+ *
+ * A unit that misses the response timeout is reported to the masters with
+ * GATEWAY TARGET FAILED and the line is kept quiet for timeout_quiet_ms, so
+ * a late response neither collides with the next request nor is taken for
+ * its response. A finished turnaround is followed by the frame gap, and the
+ * next request goes on the line once the silence is over.
+ */
+void modbus_gateway_bus_poll(ModbusGatewayBus *bus, uint32_t now_ms) {
+    if (bus->state == MODBUS_GATEWAY_BUS_IDLE || bus->state == MODBUS_GATEWAY_BUS_QUIET) {
+        bus_start(bus, now_ms);
+        return;
+    }
+    if ((int32_t)(now_ms - bus->deadline_ms) < 0) return;
+
+    if (bus->state == MODBUS_GATEWAY_BUS_WAITING) {
+        const uint8_t pdu[2] = { (uint8_t)(bus->active->frame[1] | MODBUS_FC_EXCEPTION_MASK),
+                                 MODBUS_EX_GATEWAY_TARGET_FAILED };
+        bus->stats.timeouts++;
+        bus_answer(bus, bus->active, pdu, sizeof(pdu));
+        bus_finish(bus, now_ms, bus->config.timeout_quiet_ms);
+    } else {
+        bus_finish(bus, now_ms, bus->config.frame_gap_ms);
+    }
+}
+
+/**
+ * Get the time until a bus needs modbus_gateway_bus_poll(), to bound the
+ * wait of an event loop
+ * @return Milliseconds, 0 if it is due, UINT32_MAX if no timer runs
+ */
+uint32_t modbus_gateway_bus_next(const ModbusGatewayBus *bus, uint32_t now_ms) {
+    if (bus->state == MODBUS_GATEWAY_BUS_IDLE) return bus->head ? 0 : UINT32_MAX;
+    if (bus->state == MODBUS_GATEWAY_BUS_QUIET && !bus->head) return UINT32_MAX; // Checked by the next submit
+
+    int32_t left = (int32_t)(bus->deadline_ms - now_ms);
+    return left > 0 ? (uint32_t)left : 0;
+}
@@ -0,0 +1,197 @@
+#ifndef MODBUS_GATEWAY_H
+#define MODBUS_GATEWAY_H
+
+#include "modbus_pool.h"
+#include "modbus_tcp.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Modbus TCP to RTU gateway.
+ *
+ * Requests of TCP masters are routed by unit identifier to a serial bus,
+ * queued there and sent one at a time, as a half-duplex line allows. Each
+ * bus picks its next request by policy, enforces the response timeout, the
+ * turnaround delay after broadcasts and the silence between frames, and
+ * answers the master with the response or a gateway exception.
+ *
+ * Reads are shared between masters polling the same data: a read identical
+ * to one already queued or on the line joins it and gets a copy of its
+ * response, and with a cache TTL set, repeats within the TTL are answered
+ * from the cache without using the line. Writes invalidate the cached and
+ * queued reads they overlap.
+ *
+ * I/O stays with the caller, as with ModbusSlave: request frames leave
+ * through the write callback of their bus, bytes read from the line are
+ * passed to modbus_gateway_bus_rx(), and modbus_gateway_bus_poll() runs the
+ * timers. Time is a free running millisecond clock of the caller's choice.
+ */
+
+/* Requests queued per bus, the one on the line included */
+#ifndef MODBUS_GATEWAY_QUEUE_DEPTH
+#define MODBUS_GATEWAY_QUEUE_DEPTH 32
+#endif
+
+#ifndef MODBUS_GATEWAY_MAX_BUSES
+#define MODBUS_GATEWAY_MAX_BUSES 8
+#endif
+
+/* Used when the bus configuration sets 0 */
+#ifndef MODBUS_GATEWAY_RESPONSE_TIMEOUT_MS
+#define MODBUS_GATEWAY_RESPONSE_TIMEOUT_MS 1000
+#endif
+
+#ifndef MODBUS_GATEWAY_TURNAROUND_MS
+#define MODBUS_GATEWAY_TURNAROUND_MS 100
+#endif
+
+/* Used when the bus configuration sets no baud rate */
+#ifndef MODBUS_GATEWAY_BAUDRATE
+#define MODBUS_GATEWAY_BAUDRATE 19200
+#endif
+
+/* Silence after a response timeout, for late responses to end before the
+   next request; used when the bus configuration sets 0 */
+#ifndef MODBUS_GATEWAY_TIMEOUT_QUIET_MS
+#define MODBUS_GATEWAY_TIMEOUT_QUIET_MS 100
+#endif
+
+/* Read responses cached per bus, 0 removes the cache */
+#ifndef MODBUS_GATEWAY_CACHE_ENTRIES
+#define MODBUS_GATEWAY_CACHE_ENTRIES 16
+#endif
+
+#if MODBUS_GATEWAY_CACHE_ENTRIES > 255
+#error "MODBUS_GATEWAY_CACHE_ENTRIES must not exceed 255"
+#endif
+
+/*==============================
+    Sources
+==============================*/
+typedef enum {
+    MODBUS_GATEWAY_FAIR = 0, /* Round robin over the sources with queued requests */
+    MODBUS_GATEWAY_PRIORITY, /* Highest source priority first, round robin among equals */
+} ModbusGatewayPolicy;
+
+/* A master submitting requests, typically one TCP connection */
+typedef struct {
+    void *ctx;        /* Application data, e.g. the connection */
+    uint8_t priority; /* Higher is served first by MODBUS_GATEWAY_PRIORITY buses */
+    uint16_t queued;  /* Requests queued or on the line */
+    uint16_t writes;  /* Writes among them, reads wait for them instead of being shared */
+    uint32_t served;  /* Ticket of the last request sent, for the round robin */
+} ModbusGatewaySource;
+
+typedef struct ModbusGatewayRequest {
+    struct ModbusGatewayRequest *next;
+    struct ModbusGatewayRequest *joined;          /* Identical reads answered with this one */
+    ModbusGatewaySource *source;                  /* NULL once cancelled */
+    uint32_t queued_ms;
+    uint16_t frame_len;
+    bool shared;                                  /* Read that others may join and whose response is cached */
+    bool write;
+    uint8_t header[MODBUS_MBAP_HEADER_LENGTH];    /* MBAP header of the request, echoed */
+    uint8_t frame[MODBUS_MAX_FRAME_LENGTH];       /* RTU request frame, CRC included */
+} ModbusGatewayRequest;
+
+/*==============================
+    Buses
+==============================*/
+typedef struct {
+    void (*write)(void *ctx, const uint8_t *frame, uint16_t length); /* Send a frame on the line */
+    void *ctx;
+    ModbusGatewayPolicy policy;
+    uint32_t response_timeout_ms; /* 0 for MODBUS_GATEWAY_RESPONSE_TIMEOUT_MS */
+    uint32_t turnaround_ms;       /* Silence after a broadcast, 0 for MODBUS_GATEWAY_TURNAROUND_MS */
+    uint32_t baudrate;            /* Line rate, 0 for MODBUS_GATEWAY_BAUDRATE */
+    uint32_t frame_gap_ms;        /* Silence before every request, raised to 3.5 characters at the baud rate */
+    uint32_t timeout_quiet_ms;    /* Silence after a timeout, 0 for MODBUS_GATEWAY_TIMEOUT_QUIET_MS */
+    uint32_t cache_ttl_ms;        /* Read responses reused for this long, 0 disables the cache */
+} ModbusGatewayBusConfig;
+
+typedef struct {
+    uint32_t depth;      /* Requests queued now, the one on the line included */
+    uint32_t peak_depth; /* Highest depth reached */
+    uint32_t requests;   /* Frames sent on the line */
+    uint32_t responses;  /* Responses forwarded to a master */
+    uint32_t timeouts;   /* Requests answered with GATEWAY TARGET FAILED */
+    uint32_t rejected;   /* Requests answered with SLAVE DEVICE BUSY, queue full */
+    uint32_t garbled;    /* Received frames dropped, bad CRC or not the expected response */
+    uint32_t stray;      /* Bytes dropped as no response was awaited, late responses included */
+    uint32_t coalesced;  /* Reads that joined an identical one instead of using the line */
+    uint32_t cache_hits; /* Reads answered from the cache */
+    uint64_t busy_ms;    /* Time the line was sending, awaiting a response or turning around */
+    uint64_t wait_ms;    /* Time requests were queued before being sent */
+} ModbusGatewayBusStats;
+
+typedef struct {
+    uint32_t stored_ms;
+    uint16_t pdu_len;   /* Response PDU length, 0 if the entry is empty */
+    uint8_t request[6]; /* Unit, function code, start address, quantity */
+    uint8_t pdu[MODBUS_MAX_PDU_LENGTH];
+} ModbusGatewayCacheEntry;
+
+typedef enum {
+    MODBUS_GATEWAY_BUS_IDLE = 0,
+    MODBUS_GATEWAY_BUS_WAITING,    /* Request sent, awaiting the response */
+    MODBUS_GATEWAY_BUS_TURNAROUND, /* Broadcast sent, letting the units execute it */
+    MODBUS_GATEWAY_BUS_QUIET,      /* Keeping the line silent before the next request */
+} ModbusGatewayBusState;
+
+typedef struct ModbusGatewayBus {
+    ModbusGatewayBusConfig config;
+    struct ModbusGateway *gateway;
+    ModbusGatewayBusState state;
+    ModbusGatewayRequest *active; /* Request on the line */
+    ModbusGatewayRequest *head;   /* Waiting requests, in arrival order */
+    ModbusGatewayRequest *tail;
+    uint32_t busy_since_ms;
+    uint32_t deadline_ms;         /* End of the response timeout, turnaround or silence */
+    uint16_t rx_len;
+    uint8_t rx[MODBUS_MAX_FRAME_LENGTH];
+    ModbusPool requests;
+    uint64_t storage[MODBUS_POOL_STORAGE_WORDS(sizeof(ModbusGatewayRequest), MODBUS_GATEWAY_QUEUE_DEPTH)];
+#if MODBUS_GATEWAY_CACHE_ENTRIES
+    uint8_t cache_next; /* Entry replaced on the next store */
+    ModbusGatewayCacheEntry cache[MODBUS_GATEWAY_CACHE_ENTRIES];
+#endif
+    ModbusGatewayBusStats stats;
+} ModbusGatewayBus;
+
+/*==============================
+    Gateway structure
+==============================*/
+typedef struct ModbusGateway {
+    /* Deliver a response ADU to the source of a request */
+    void (*respond)(ModbusGatewaySource *source, const uint8_t *adu, uint16_t length);
+    ModbusGatewayBus *buses[MODBUS_GATEWAY_MAX_BUSES];
+    uint8_t bus_count;
+    uint8_t route[256]; /* Unit identifier -> bus index + 1, 0 if not routed */
+    uint32_t ticket;    /* Requests sent so far on any bus */
+} ModbusGateway;
+
+/*==============================
+    Public API
+==============================*/
+void modbus_gateway_init(ModbusGateway *gateway,
+                         void (*respond)(ModbusGatewaySource *source, const uint8_t *adu, uint16_t length));
+int modbus_gateway_bus_init(ModbusGatewayBus *bus, const ModbusGatewayBusConfig *cfg);
+int modbus_gateway_add_bus(ModbusGateway *gateway, ModbusGatewayBus *bus, uint8_t first_unit, uint8_t last_unit);
+void modbus_gateway_source_init(ModbusGatewaySource *source, void *ctx, uint8_t priority);
+int modbus_gateway_submit(ModbusGateway *gateway, ModbusGatewaySource *source,
+                          const uint8_t *adu, uint16_t length, uint32_t now_ms);
+void modbus_gateway_cancel(ModbusGateway *gateway, ModbusGatewaySource *source);
+void modbus_gateway_bus_rx(ModbusGatewayBus *bus, const uint8_t *data, uint16_t length, uint32_t now_ms);
+void modbus_gateway_bus_poll(ModbusGatewayBus *bus, uint32_t now_ms);
+uint32_t modbus_gateway_bus_next(const ModbusGatewayBus *bus, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_GATEWAY_H */
@@ -0,0 +1,97 @@
+#include "modbus_pool.h"
+
+#include <string.h>
+
+/**
+ * Round an object size up to the pool alignment
+ */
+static size_t pool_object_size(size_t object_size) {
+    return (object_size + MODBUS_POOL_ALIGN - 1u) & ~(size_t)(MODBUS_POOL_ALIGN - 1u);
+}
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+/**
+ * Get the storage a pool needs
+ * @param object_size Size of one object
+ * @param capacity    Number of objects
+ * @return Bytes of storage, aligned to at least MODBUS_POOL_ALIGN
+ */
+size_t modbus_pool_storage_size(size_t object_size, uint32_t capacity) {
+    return (pool_object_size(object_size) + sizeof(uint32_t)) * capacity;
+}
+
+/**
+ * Initialize an empty pool over caller provided storage
+ *
+ * The storage is not touched here.
+ * @param pool        Pool instance
+ * @param storage     At least modbus_pool_storage_size() bytes, aligned to
+ *                    MODBUS_POOL_ALIGN
+ * @param object_size Size of one object
+ * @param capacity    Number of objects
+ * @return 0 on success, -1 on invalid arguments
+ */
+int modbus_pool_init(ModbusPool *pool, void *storage, size_t object_size, uint32_t capacity) {
+    if (!pool || !storage || object_size == 0 || capacity == 0 ||
+        ((uintptr_t)storage & (MODBUS_POOL_ALIGN - 1u)) != 0) {
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pool->storage = storage;
+    pool->object_size = pool_object_size(object_size);
+    pool->links = (uint32_t *)&pool->storage[pool->object_size * capacity];
+    pool->capacity = capacity;
+    pool->free_head = capacity;
+    return 0;
+}
+
+/**
+ * Take an object from the pool - O(1)
+ * @return Object with undefined contents, NULL if the pool is exhausted
+ */
+void *modbus_pool_alloc(ModbusPool *pool) {
+    uint8_t *object;
+
+    if (pool->free_head != pool->capacity) {
+        object = modbus_pool_object(pool, pool->free_head);
+        pool->free_head = pool->links[pool->free_head];
+    } else if (pool->used < pool->capacity) {
+        object = modbus_pool_object(pool, pool->used++);
+    } else {
+        pool->exhausted++;
+        return NULL;
+    }
+
+    if (++pool->in_use > pool->peak) pool->peak = pool->in_use;
+    return object;
+}
+
+/**
+ * Return an object to the pool - O(1)
+ */
+void modbus_pool_free(ModbusPool *pool, void *object) {
+    if (!object) return;
+
+    uint32_t index = modbus_pool_index(pool, object);
+    pool->links[index] = pool->free_head;
+    pool->free_head = index;
+    pool->in_use--;
+}
+
+/**
+ * Get the position of an object in the storage, e.g. to index side tables
+ */
+uint32_t modbus_pool_index(const ModbusPool *pool, const void *object) {
+    return (uint32_t)(((const uint8_t *)object - pool->storage) / pool->object_size);
+}
+
+/**
+ * Get the object at a position in the storage
+ */
+void *modbus_pool_object(const ModbusPool *pool, uint32_t index) {
+    return &pool->storage[(size_t)index * pool->object_size];
+}
@@ -0,0 +1,63 @@
+#ifndef MODBUS_POOL_H
+#define MODBUS_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed capacity pool of equally sized objects, such as the sessions of a
+ * TCP server with their receive and transmit buffers.
+ *
+ * The storage is provided once by the caller and never grows, so allocating
+ * and freeing are O(1) and cost no heap traffic however often objects come
+ * and go. Freed objects are reused first, most recently freed first; objects
+ * never used yet are handed out in storage order, so memory the operating
+ * system maps lazily is only touched once the pool actually grows into it.
+ * The free list is kept next to the objects, a freed object keeps its
+ * contents.
+ */
+
+/* Objects are placed at multiples of this alignment */
+#define MODBUS_POOL_ALIGN 8u
+
+/* Storage of a pool in uint64_t words, to reserve it statically */
+#define MODBUS_POOL_STORAGE_WORDS(object_size, capacity) \
+    (((((object_size) + MODBUS_POOL_ALIGN - 1u) & ~(size_t)(MODBUS_POOL_ALIGN - 1u)) + sizeof(uint32_t)) * \
+     (capacity) / sizeof(uint64_t) + 1u)
+
+/*==============================
+    Pool structure
+==============================*/
+typedef struct {
+    uint8_t *storage;
+    uint32_t *links;    /* Free list, one entry per object after the objects */
+    size_t object_size; /* Rounded up to MODBUS_POOL_ALIGN */
+    uint32_t capacity;
+    uint32_t used;      /* Objects handed out at least once, in storage order */
+    uint32_t free_head; /* Index of the first freed object, capacity if none */
+
+    /* Counters */
+    uint32_t in_use;    /* Objects currently allocated */
+    uint32_t peak;      /* Highest in_use reached */
+    uint32_t exhausted; /* Allocations refused because the pool was full */
+} ModbusPool;
+
+/*==============================
+    Public API
+==============================*/
+size_t modbus_pool_storage_size(size_t object_size, uint32_t capacity);
+int modbus_pool_init(ModbusPool *pool, void *storage, size_t object_size, uint32_t capacity);
+void *modbus_pool_alloc(ModbusPool *pool);
+void modbus_pool_free(ModbusPool *pool, void *object);
+uint32_t modbus_pool_index(const ModbusPool *pool, const void *object);
+void *modbus_pool_object(const ModbusPool *pool, uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_POOL_H */
@@ -0,0 +1,299 @@
+#if defined(__unix__) && !defined(_GNU_SOURCE) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // clock_gettime() and sched_yield() under strict ISO C
+#endif
+
+#include "modbus_register_bank.h"
+
+#if MODBUS_ENABLE_REGISTER_BANK
+
+#include <stddef.h>
+
+#if MODBUS_REGISTER_BANK_THREADS
+#include <sched.h>
+#include <time.h>
+#endif
+
+/* Progress of a reader or writer waiting for a publication to finish */
+typedef struct {
+    unsigned sequence; /* Sequence seen when the wait started or last moved */
+    unsigned attempts; /* Attempts since then */
+#if MODBUS_REGISTER_BANK_THREADS
+    uint64_t deadline_us;
+#endif
+} BankWait;
+
+/**
+ * Tell the CPU that this is a spin-wait loop
+ */
+static inline void bank_cpu_relax(void) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(__arm__))
+    __asm__ volatile("yield");
+#endif
+}
+
+#if MODBUS_REGISTER_BANK_THREADS
+static uint64_t bank_clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+#endif
+
+/**
+ * Pause before retrying an access that found a publication in progress
+ *
+ * Any change of the sequence means a writer made progress and restarts the
+ * wait, so only a publication that stays open gives up.
+ * @param wait     Wait state, sequence set and attempts zeroed at the start
+ * @param sequence Sequence just observed
+ * @return 0 to retry, -1 to give up
+ */
+static int bank_wait(BankWait *wait, unsigned sequence) {
+    if (sequence != wait->sequence) {
+        wait->sequence = sequence;
+        wait->attempts = 0;
+    }
+    wait->attempts++;
+
+#if MODBUS_REGISTER_BANK_THREADS
+    if (wait->attempts <= MODBUS_REGISTER_BANK_SPINS) {
+        bank_cpu_relax();
+        return 0;
+    }
+
+    uint64_t now = bank_clock_us();
+    if (wait->attempts == MODBUS_REGISTER_BANK_SPINS + 1) {
+        wait->deadline_us = now + MODBUS_REGISTER_BANK_TIMEOUT_US;
+    } else if (now >= wait->deadline_us) {
+        return -1;
+    }
+    sched_yield();
+    return 0;
+#else
+    bank_cpu_relax();
+    return wait->attempts > MODBUS_REGISTER_BANK_MAX_RETRIES ? -1 : 0;
+#endif
+}
+
+/**
+ * Check that [addr, addr + count) lies inside the bank
+ */
+static int bank_contains(const ModbusRegisterBank *bank, uint16_t addr, uint16_t count) {
+    return addr >= bank->start &&
+           (uint32_t)(addr - bank->start) + count <= bank->count;
+}
+
+/**
+ * Get the atomic word backing a register
+ */
+static _Atomic uint16_t *bank_register(ModbusRegisterBank *bank, uint16_t addr) {
+    return &bank->registers[addr - bank->start];
+}
+
+/**
+ * Copy registers without tearing a concurrent publication
+ *
+ * A single register is one atomic load. Longer copies are accepted only if
+ * the sequence was even before them and unchanged after them. Exactly one of
+ * values (host order) and bytes (big-endian) is used.
+ * @return MODBUS_EX_NONE, or MODBUS_EX_SLAVE_DEVICE_BUSY if a publication
+ *         stayed open for the whole wait (see bank_wait())
+ */
+static ModbusExceptionCode bank_read_stable(ModbusRegisterBank *bank, uint16_t addr, uint16_t count,
+                                            uint16_t *values, uint8_t *bytes) {
+    _Atomic uint16_t *regs = bank_register(bank, addr);
+
+    if (count == 1) {
+        uint16_t value = atomic_load_explicit(regs, memory_order_acquire);
+        if (values) {
+            values[0] = value;
+        } else {
+            modbus_be16_set(bytes, value);
+        }
+        return MODBUS_EX_NONE;
+    }
+
+    BankWait wait = { .sequence = atomic_load_explicit(&bank->sequence, memory_order_relaxed) };
+
+    for (;;) {
+        unsigned seq = atomic_load_explicit(&bank->sequence, memory_order_acquire);
+
+        if ((seq & 1u) == 0) {
+            for (uint16_t i = 0; i < count; i++) {
+                uint16_t value = atomic_load_explicit(&regs[i], memory_order_relaxed);
+                if (values) {
+                    values[i] = value;
+                } else {
+                    modbus_be16_set(&bytes[i * 2], value);
+                }
+            }
+
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&bank->sequence, memory_order_relaxed) == seq) return MODBUS_EX_NONE;
+        }
+
+        if (bank_wait(&wait, seq) != 0) return MODBUS_EX_SLAVE_DEVICE_BUSY;
+    }
+}
+
+/**
+ * Initialize a register bank over application provided storage
+ * @param bank Bank to initialize
+ * @param storage Array of count registers, host byte order
+ * @param start Modbus address of storage[0]
+ * @param count Number of registers
+ * @return 0 on success, -1 on invalid arguments
+ */
+int modbus_register_bank_init(ModbusRegisterBank *bank, _Atomic uint16_t *storage, uint16_t start, uint16_t count) {
+    if (!bank || !storage || (uint32_t)start + count > 0x10000u) return -1;
+
+    atomic_init(&bank->sequence, 0u);
+    bank->start = start;
+    bank->count = count;
+    bank->registers = storage;
+    return 0;
+}
+
+/**
+ * Start publishing a block of registers
+ *
+ * Marks the bank as being written; the caller may then update
+ * bank->registers with relaxed atomic stores and must call
+ * modbus_register_bank_write_end(). Waits for other writers as readers do,
+ * never giving up while they make progress.
+ * @return 0 on success, -1 if another publication stayed open for the
+ *         whole wait
+ */
+int modbus_register_bank_write_begin(ModbusRegisterBank *bank) {
+    unsigned seq = atomic_load_explicit(&bank->sequence, memory_order_relaxed);
+    BankWait wait = { .sequence = seq };
+
+    for (;;) {
+        if ((seq & 1u) == 0 &&
+            atomic_compare_exchange_weak_explicit(&bank->sequence, &seq, seq + 1u,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            // Keep the register stores after the odd sequence
+            atomic_thread_fence(memory_order_release);
+            return 0;
+        }
+        if (bank_wait(&wait, seq) != 0) return -1;
+        seq = atomic_load_explicit(&bank->sequence, memory_order_relaxed);
+    }
+}
+
+/**
+ * Finish a publication started with modbus_register_bank_write_begin()
+ */
+void modbus_register_bank_write_end(ModbusRegisterBank *bank) {
+    atomic_fetch_add_explicit(&bank->sequence, 1u, memory_order_release);
+}
+
+/**
+ * Publish consecutive registers as one block
+ * @param values Register values in host byte order
+ * @return 0 on success, -1 if out of range or the bank stayed busy
+ */
+int modbus_register_bank_write(ModbusRegisterBank *bank, uint16_t addr, const uint16_t *values, uint16_t count) {
+    if (!bank_contains(bank, addr, count)) return -1;
+    if (count == 1) {
+        atomic_store_explicit(bank_register(bank, addr), values[0], memory_order_release);
+        return 0;
+    }
+    if (modbus_register_bank_write_begin(bank) != 0) return -1;
+
+    _Atomic uint16_t *regs = bank_register(bank, addr);
+    for (uint16_t i = 0; i < count; i++) {
+        atomic_store_explicit(&regs[i], values[i], memory_order_relaxed);
+    }
+
+    modbus_register_bank_write_end(bank);
+    return 0;
+}
+
+/**
+ * Copy a consistent snapshot of consecutive registers
+ * @param values Destination in host byte order
+ * @return 0 on success, -1 if out of range or the bank stayed busy
+ */
+int modbus_register_bank_snapshot(ModbusRegisterBank *bank, uint16_t addr, uint16_t count, uint16_t *values) {
+    if (!bank_contains(bank, addr, count)) return -1;
+
+    return bank_read_stable(bank, addr, count, values, NULL) == MODBUS_EX_NONE ? 0 : -1;
+}
+
+/**
+ * Write a single register with one atomic store (0x06)
+ * @return MODBUS_EX_ILLEGAL_DATA_ADDRESS if out of range
+ */
+ModbusExceptionCode modbus_register_bank_write_single(ModbusRegisterBank *bank, uint16_t addr, uint16_t value) {
+    if (!bank_contains(bank, addr, 1)) return MODBUS_EX_ILLEGAL_DATA_ADDRESS;
+
+    atomic_store_explicit(bank_register(bank, addr), value, memory_order_release);
+    return MODBUS_EX_NONE;
+}
+
+/**
+ * Apply (value & and_mask) | (or_mask & ~and_mask) atomically (0x16)
+ *
+ * The read-modify-write is a compare-and-swap loop, so concurrent updates of
+ * other bits in the same register are never lost.
+ * @return MODBUS_EX_ILLEGAL_DATA_ADDRESS if out of range
+ */
+ModbusExceptionCode modbus_register_bank_mask_write(ModbusRegisterBank *bank, uint16_t addr, uint16_t and_mask, uint16_t or_mask) {
+    if (!bank_contains(bank, addr, 1)) return MODBUS_EX_ILLEGAL_DATA_ADDRESS;
+
+    _Atomic uint16_t *reg = bank_register(bank, addr);
+    uint16_t current = atomic_load_explicit(reg, memory_order_relaxed);
+    uint16_t updated;
+
+    do {
+        updated = (uint16_t)((current & and_mask) | (or_mask & (uint16_t)~and_mask));
+    } while (!atomic_compare_exchange_weak_explicit(reg, &current, updated,
+                                                    memory_order_acq_rel, memory_order_relaxed));
+
+    return MODBUS_EX_NONE;
+}
+
+/**
+ * Read registers for a Modbus response (0x03, 0x04, 0x17)
+ *
+ * Intended to be called from the read callbacks:
+ *     return modbus_register_bank_read(&bank, addr, count, dest);
+ * @param dest Destination for count big-endian registers
+ * @return MODBUS_EX_ILLEGAL_DATA_ADDRESS if out of range,
+ *         MODBUS_EX_SLAVE_DEVICE_BUSY if the bank stayed busy
+ */
+ModbusExceptionCode modbus_register_bank_read(ModbusRegisterBank *bank, uint16_t addr, uint16_t count, uint8_t *dest) {
+    if (!bank_contains(bank, addr, count)) return MODBUS_EX_ILLEGAL_DATA_ADDRESS;
+
+    return bank_read_stable(bank, addr, count, NULL, dest);
+}
+
+/**
+ * Store registers received in a Modbus request (0x10, 0x17)
+ *
+ * A single register is one atomic store, longer blocks are published under
+ * the sequence counter.
+ * @param src count big-endian registers
+ * @return MODBUS_EX_ILLEGAL_DATA_ADDRESS if out of range,
+ *         MODBUS_EX_SLAVE_DEVICE_BUSY if the bank stayed busy
+ */
+ModbusExceptionCode modbus_register_bank_store(ModbusRegisterBank *bank, uint16_t addr, uint16_t count, const uint8_t *src) {
+    if (!bank_contains(bank, addr, count)) return MODBUS_EX_ILLEGAL_DATA_ADDRESS;
+    if (count == 1) {
+        return modbus_register_bank_write_single(bank, addr, modbus_be16_get(src));
+    }
+    if (modbus_register_bank_write_begin(bank) != 0) return MODBUS_EX_SLAVE_DEVICE_BUSY;
+
+    _Atomic uint16_t *regs = bank_register(bank, addr);
+    for (uint16_t i = 0; i < count; i++) {
+        atomic_store_explicit(&regs[i], modbus_be16_get(&src[i * 2]), memory_order_relaxed);
+    }
+
+    modbus_register_bank_write_end(bank);
+    return MODBUS_EX_NONE;
+}
+
+#endif /* MODBUS_ENABLE_REGISTER_BANK */
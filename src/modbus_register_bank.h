@@ -0,0 +1,65 @@
+#ifndef MODBUS_REGISTER_BANK_H
+#define MODBUS_REGISTER_BANK_H
+
+#include "modbus_slave.h"
+
+#include <stdint.h>
+
+#if MODBUS_ENABLE_REGISTER_BANK
+
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Block of 16-bit registers shared between the Modbus stack and application
+ * tasks or threads, so callbacks need no mutex around them.
+ *
+ * Every register is an atomic word. Single register writes are one atomic
+ * store and mask writes one compare-and-swap loop. Blocks of registers are
+ * published under a sequence counter (seqlock): the counter is odd while a
+ * block is being written, and readers of more than one register retry until
+ * they copied the registers without a publication in between. Multi register
+ * values such as 32-bit floats are therefore never torn. Single register
+ * updates bypass the counter; they are atomic on their own.
+ *
+ * Block writers are serialized through the same counter. Readers and
+ * writers wait for a concurrent publication as modbus_config.h configures
+ * it: with threads they back off and yield, and give up only once no
+ * publication made progress for MODBUS_REGISTER_BANK_TIMEOUT_US; without
+ * them after MODBUS_REGISTER_BANK_MAX_RETRIES attempts, so a context that
+ * interrupts a writer on a single core system fails instead of spinning
+ * forever.
+ */
+typedef struct {
+    atomic_uint sequence;        /* Odd while a block is being published */
+    uint16_t start;              /* Modbus address of the first register */
+    uint16_t count;              /* Number of registers */
+    _Atomic uint16_t *registers; /* Storage owned by the application */
+} ModbusRegisterBank;
+
+int modbus_register_bank_init(ModbusRegisterBank *bank, _Atomic uint16_t *storage, uint16_t start, uint16_t count);
+
+/* Application side, host byte order */
+int modbus_register_bank_write_begin(ModbusRegisterBank *bank);
+void modbus_register_bank_write_end(ModbusRegisterBank *bank);
+int modbus_register_bank_write(ModbusRegisterBank *bank, uint16_t addr, const uint16_t *values, uint16_t count);
+int modbus_register_bank_snapshot(ModbusRegisterBank *bank, uint16_t addr, uint16_t count, uint16_t *values);
+
+/* Single register updates, also usable as 0x06 and 0x16 callbacks */
+ModbusExceptionCode modbus_register_bank_write_single(ModbusRegisterBank *bank, uint16_t addr, uint16_t value);
+ModbusExceptionCode modbus_register_bank_mask_write(ModbusRegisterBank *bank, uint16_t addr, uint16_t and_mask, uint16_t or_mask);
+
+/* Modbus side, big-endian register data as used by the callbacks */
+ModbusExceptionCode modbus_register_bank_read(ModbusRegisterBank *bank, uint16_t addr, uint16_t count, uint8_t *dest);
+ModbusExceptionCode modbus_register_bank_store(ModbusRegisterBank *bank, uint16_t addr, uint16_t count, const uint8_t *src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_ENABLE_REGISTER_BANK */
+
+#endif /* MODBUS_REGISTER_BANK_H */
@@ -0,0 +1,187 @@
+#include "modbus_rtu.h"
+#include "modbus_crc16.h"
+
+// =============================================================================
+// Stream framing
+// =============================================================================
+
+/**
+ * Length of a request frame by the rules of its function code
+ * @param data   Received bytes, frame boundary first, at least 2
+ * @param length Number of received bytes
+ * @return Frame length including the CRC, 0 if more bytes are needed to
+ *         tell, -1 if the function code has no length rule
+ */
+static int32_t rtu_request_rule(const uint8_t *data, size_t length) {
+    switch (data[1]) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+        case MODBUS_FC_DIAGNOSTICS:
+            return 8; // Address, function code, two words, CRC
+        case MODBUS_FC_READ_EXCEPTION_STATUS:
+        case 0x0B: // Get Comm Event Counter
+        case 0x0C: // Get Comm Event Log
+        case 0x11: // Report Server ID
+            return 4;
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            return length < 7 ? 0 : 9 + (int32_t)data[6];
+        case MODBUS_FC_MASK_WRITE_REGISTER:
+            return 10;
+        case MODBUS_FC_READ_WRITE_MULTIPLE_REGS:
+            return length < 11 ? 0 : 13 + (int32_t)data[10];
+        case MODBUS_FC_ENCAPSULATED_INTERFACE:
+            if (length < 3) return 0;
+            return data[2] == MODBUS_MEI_READ_DEVICE_ID ? 7 : -1;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Length of a response frame by the rules of its function code
+ * @param data   Received bytes, frame boundary first, at least 2
+ * @param length Number of received bytes
+ * @return Frame length including the CRC, 0 if more bytes are needed to
+ *         tell, -1 if the function code has no length rule
+ */
+static int32_t rtu_response_rule(const uint8_t *data, size_t length) {
+    if (data[1] & MODBUS_FC_EXCEPTION_MASK) return 5; // Address, function code, exception code, CRC
+
+    switch (data[1]) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+        case MODBUS_FC_READ_WRITE_MULTIPLE_REGS:
+        case 0x0C: // Get Comm Event Log
+        case 0x11: // Report Server ID
+            return length < 3 ? 0 : 5 + (int32_t)data[2];
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+        case MODBUS_FC_DIAGNOSTICS:
+        case 0x0B: // Get Comm Event Counter
+            return 8;
+        case MODBUS_FC_READ_EXCEPTION_STATUS:
+            return 5;
+        case MODBUS_FC_MASK_WRITE_REGISTER:
+            return 10;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Check the CRC at the end of a frame
+ */
+static bool rtu_crc_ok(const uint8_t *frame, uint16_t length) {
+    return modbus_crc16(frame, (uint16_t)(length - 2)) == modbus_le16_get(&frame[length - 2]);
+}
+
+/**
+ * Find the shortest frame at the start of a buffer whose CRC matches
+ * @return Frame length, 0 if none
+ */
+static int32_t rtu_crc_scan(const uint8_t *data, size_t length) {
+    uint16_t crc = 0xFFFF; // CRC of data[0..end)
+
+    if (length > MODBUS_MAX_FRAME_LENGTH) length = MODBUS_MAX_FRAME_LENGTH;
+    for (size_t end = 0; end + 2 <= length; ++end) {
+        if (end >= 2 && crc == modbus_le16_get(&data[end])) return (int32_t)end + 2;
+        crc = (uint16_t)((crc >> 8) ^ modbus_crc16_table[(uint8_t)(data[end] ^ crc)]);
+    }
+    return 0;
+}
+
+/**
+ * Delimit a frame by a length rule, or by its CRC without one
+ */
+static int32_t rtu_frame_length(const uint8_t *data, size_t length,
+                                int32_t (*rule)(const uint8_t *data, size_t length)) {
+    if (length < MODBUS_MIN_FRAME_LENGTH) return 0;
+
+    int32_t frame_len = rule(data, length);
+    if (frame_len == 0) return 0;
+
+    if (frame_len > 0) {
+        if (frame_len > MODBUS_MAX_FRAME_LENGTH) return -1;
+        if ((size_t)frame_len > length) return 0;
+        return rtu_crc_ok(data, (uint16_t)frame_len) ? frame_len : -1;
+    }
+
+    frame_len = rtu_crc_scan(data, length);
+    if (frame_len > 0) return frame_len;
+    return length >= MODBUS_MAX_FRAME_LENGTH ? -1 : 0;
+}
+
+/**
+ * Delimit the request frame at the start of a stream buffer
+ *
+ * The length follows from the function code and, for the multiple write
+ * requests, the byte count. Requests with other function codes are
+ * delimited by the first matching CRC. A frame is only returned once its
+ * CRC checks out, so a stream that lost its framing is resynchronized by
+ * discarding one byte per -1 returned.
+ * @param data   Received bytes, frame boundary first
+ * @param length Number of received bytes
+ * @return Frame length including the CRC, 0 if more bytes are needed,
+ *         -1 if no frame starts at the first byte
+ */
+int32_t modbus_rtu_request_length(const uint8_t *data, size_t length) {
+    return rtu_frame_length(data, length, rtu_request_rule);
+}
+
+/**
+ * Delimit the response frame at the start of a buffer
+ *
+ * Same as modbus_rtu_request_length() with the length rules of responses,
+ * for masters and gateways reading a serial line.
+ * @param data   Received bytes, frame boundary first
+ * @param length Number of received bytes
+ * @return Frame length including the CRC, 0 if more bytes are needed,
+ *         -1 if no frame starts at the first byte
+ */
+int32_t modbus_rtu_response_length(const uint8_t *data, size_t length) {
+    return rtu_frame_length(data, length, rtu_response_rule);
+}
+
+// =============================================================================
+// Request processing
+// =============================================================================
+
+/**
+ * Process one complete RTU request frame received from a stream
+ *
+ * Broadcasts are executed without a response, as on a serial line, and
+ * frames for units the slave does not serve are ignored.
+ * @param slave        Slave instance
+ * @param request      Request frame, as delimited by modbus_rtu_request_length()
+ * @param request_len  Request frame length, CRC included
+ * @param response     Response frame buffer, at least MODBUS_MAX_FRAME_LENGTH bytes
+ * @param response_len Set to the response frame length, 0 if nothing must be sent
+ * @return 0 on success, -1 if the request is not a valid frame
+ */
+int modbus_rtu_process_adu(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                           uint8_t *response, uint16_t *response_len) {
+    *response_len = 0;
+
+    if (request_len < MODBUS_MIN_FRAME_LENGTH || request_len > MODBUS_MAX_FRAME_LENGTH) return -1;
+
+    uint16_t len;
+    if (modbus_process_pdu(slave, request[0], &request[1], (uint16_t)(request_len - 3),
+                           &response[1], &len) != 0 || len == 0) {
+        return 0;
+    }
+
+    response[0] = request[0];
+    len += 1;
+    modbus_le16_set(&response[len], modbus_crc16(response, len));
+    *response_len = (uint16_t)(len + 2);
+    return 0;
+}
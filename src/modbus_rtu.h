@@ -0,0 +1,32 @@
+#ifndef MODBUS_RTU_H
+#define MODBUS_RTU_H
+
+#include "modbus_slave.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * RTU frames carried by a byte stream without inter-character timing, such
+ * as RTU over TCP from cellular modems and serial device servers. Frames
+ * are delimited by the length rules of their function code and confirmed
+ * by their CRC instead of by the 3.5 character gap.
+ */
+
+/*==============================
+    Public API
+==============================*/
+int32_t modbus_rtu_request_length(const uint8_t *data, size_t length);
+int32_t modbus_rtu_response_length(const uint8_t *data, size_t length);
+int modbus_rtu_process_adu(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                           uint8_t *response, uint16_t *response_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_RTU_H */
@@ -5,6 +5,362 @@
 
 #include <string.h>
 
+#if MODBUS_ENABLE_COUNTERS
+#define MODBUS_COUNT(slave, counter) ((slave)->counters.counter++)
+#else
+#define MODBUS_COUNT(slave, counter) ((void)0)
+#endif
+
+#if MODBUS_ENABLE_DIRTY_TRACKING
+#define MODBUS_DIRTY_TRACK(slave, index, request) modbus_dirty_track(slave, index, request)
+#else
+#define MODBUS_DIRTY_TRACK(slave, index, request) ((void)0)
+#endif
+
+/**
+ * Check whether a request address is served by this instance
+ * @param slave   Slave instance
+ * @param address Address byte of a frame
+ * @return true for broadcast and for every unit address of the slave
+ */
+static inline bool modbus_is_own_address(const ModbusSlave *slave, uint8_t address) {
+#if MODBUS_MAX_UNITS > 1
+    return address == 0x00 || slave->unit_index[address] != 0;
+#else
+    return address == 0x00 || address == MODBUS_SLAVE_ADDRESS(slave);
+#endif
+}
+
+// =============================================================================
+// Device identification cache
+// =============================================================================
+
+#if MODBUS_ENABLE_FC_2B && MODBUS_DEVICE_ID_CACHE_SIZE
+/**
+ * Precompute the complete response frames of the basic, regular and
+ * extended stream requests starting at object 0
+ * @param slave Slave instance
+ */
+static void modbus_device_id_cache_build(ModbusSlave *slave) {
+    uint16_t offset = 0;
+
+    for (uint8_t code = MODBUS_DEVICE_ID_BASIC; code <= MODBUS_DEVICE_ID_EXTENDED; ++code) {
+        uint8_t frame[MODBUS_MAX_FRAME_LENGTH];
+        uint16_t frame_len = 1;
+
+        slave->device_id_len[code - 1] = 0;
+
+        ModbusExceptionCode ex = modbus_device_id_build(&MODBUS_SLAVE_CFG(slave), code, 0x00, &frame[1], &frame_len);
+        if (ex != MODBUS_EX_NONE) continue;
+        if (offset + frame_len + 2 > MODBUS_DEVICE_ID_CACHE_SIZE) continue; // Built on demand instead
+
+        frame[0] = MODBUS_SLAVE_ADDRESS(slave);
+        modbus_le16_set(&frame[frame_len], modbus_crc16(frame, frame_len));
+        frame_len += 2;
+
+        memcpy(&slave->device_id_cache[offset], frame, frame_len);
+        slave->device_id_len[code - 1] = frame_len;
+        offset += frame_len;
+    }
+}
+
+/**
+ * Find the cached response for a discovery request
+ * @param slave  Slave instance holding a validated request
+ * @param length Set to the cached frame length
+ * @return Cached response frame, NULL if the request is not cached
+ */
+static const uint8_t *modbus_device_id_cache_lookup(const ModbusSlave *slave, uint16_t *length) {
+    const uint8_t *request = slave->frame;
+
+    if (slave->frame_len != 7 || request[0] != MODBUS_SLAVE_ADDRESS(slave)) return NULL;
+    if (request[1] != MODBUS_FC_ENCAPSULATED_INTERFACE || request[2] != MODBUS_MEI_READ_DEVICE_ID) return NULL;
+    if (request[4] != 0x00) return NULL;
+
+    uint8_t code = request[3];
+    if (code < MODBUS_DEVICE_ID_BASIC || code > MODBUS_DEVICE_ID_EXTENDED) return NULL;
+    if (slave->device_id_len[code - 1] == 0) return NULL;
+
+    uint16_t offset = 0;
+    for (uint8_t i = 0; i < code - 1; ++i) offset += slave->device_id_len[i];
+
+    *length = slave->device_id_len[code - 1];
+    return &slave->device_id_cache[offset];
+}
+#endif
+
+// =============================================================================
+// Response cache
+// =============================================================================
+
+#if MODBUS_RESPONSE_CACHE_ENTRIES
+#define MODBUS_CACHE_KEY_LENGTH 6
+
+/**
+ * Check whether a request may be answered from the response cache
+ * Only plain reads addressed to this slave are cached.
+ * @param slave Slave instance holding a validated request
+ * @return true if the request is cacheable
+ */
+static bool modbus_response_cache_eligible(const ModbusSlave *slave) {
+    if (slave->frame_len != MODBUS_CACHE_KEY_LENGTH + 2 || slave->frame[0] == 0x00) return false;
+
+    switch (slave->frame[1]) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Check whether a function code modifies application data
+ * @param function_code Function code
+ * @return true for write functions
+ */
+static bool modbus_is_write_function(uint8_t function_code) {
+    switch (function_code) {
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+        case MODBUS_FC_MASK_WRITE_REGISTER:
+        case MODBUS_FC_READ_WRITE_MULTIPLE_REGS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Find a response built for the same request and data generation
+ * @param slave Slave instance holding a validated request
+ * @return Cache entry, NULL on miss
+ */
+static const ModbusResponseCacheEntry *modbus_response_cache_lookup(const ModbusSlave *slave) {
+    uint32_t generation = slave->generation;
+
+    for (uint8_t i = 0; i < MODBUS_RESPONSE_CACHE_ENTRIES; ++i) {
+        const ModbusResponseCacheEntry *entry = &slave->cache[i];
+        if (entry->response_len == 0 || entry->generation != generation) continue;
+        if (memcmp(entry->request, slave->frame, MODBUS_CACHE_KEY_LENGTH) != 0) continue;
+        return entry;
+    }
+
+    return NULL;
+}
+
+/**
+ * Store a response frame, replacing entries in round-robin order
+ * @param slave        Slave instance holding the request
+ * @param generation   Data generation sampled before the response was built
+ * @param response     Complete response frame, CRC included
+ * @param response_len Response frame length
+ */
+static void modbus_response_cache_store(ModbusSlave *slave, uint32_t generation,
+                                        const uint8_t *response, uint16_t response_len) {
+    if (response_len > MODBUS_RESPONSE_CACHE_FRAME_SIZE) return;
+
+    ModbusResponseCacheEntry *entry = &slave->cache[slave->cache_next];
+    slave->cache_next = (slave->cache_next + 1) % MODBUS_RESPONSE_CACHE_ENTRIES;
+
+    entry->generation = generation;
+    entry->response_len = response_len;
+    memcpy(entry->request, slave->frame, MODBUS_CACHE_KEY_LENGTH);
+    memcpy(entry->response, response, response_len);
+}
+
+/**
+ * Fold a pending modbus_slave_bump_generation() into the data generation
+ *
+ * The flag is cleared before the generation moves on, so a bump that lands
+ * in between is folded again by the next request instead of being lost.
+ * @param slave Slave instance
+ * @return Current data generation
+ */
+static uint32_t modbus_response_cache_generation(ModbusSlave *slave) {
+    if (slave->data_changed) {
+        slave->data_changed = 0;
+        slave->generation++;
+    }
+    return slave->generation;
+}
+
+/**
+ * Signal that application data changed - invalidates all cached responses
+ *
+ * Only sets a byte flag that the next processed request folds into the
+ * generation, so it may be called from an interrupt handler on any target,
+ * 8 and 16-bit ones included. On a multi-core host, call it after the data
+ * change is visible to the thread calling modbus_slave_poll() (e.g. after
+ * releasing the lock protecting the data).
+ * @param slave Slave instance
+ */
+void modbus_slave_bump_generation(ModbusSlave *slave) {
+    slave->data_changed = 1;
+}
+#endif
+
+// =============================================================================
+// Change tracking
+// =============================================================================
+
+#if MODBUS_ENABLE_DIRTY_TRACKING
+/**
+ * Count trailing zero bits
+ * @param value Non-zero value
+ * @return Index of the lowest set bit
+ */
+static inline uint8_t modbus_ctz32(uint32_t value) {
+#if defined(__GNUC__)
+    return (uint8_t)__builtin_ctz(value);
+#else
+    uint8_t n = 0;
+    while ((value & 1u) == 0) {
+        value >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * Select the bitmap of a table of one unit
+ * @param slave Slave instance
+ * @param index Index of the unit, 0 for the configuration passed to init
+ * @param table Table to select
+ * @param limit Set to the number of tracked addresses, 0 if not tracked
+ * @return Bitmap words, NULL if the table is not tracked
+ */
+static uint32_t *modbus_dirty_bitmap(ModbusSlave *slave, uint8_t index, ModbusDirtyTable table, uint16_t *limit) {
+    switch (table) {
+#if MODBUS_DIRTY_COIL_COUNT
+        case MODBUS_DIRTY_COILS:
+            *limit = MODBUS_DIRTY_COIL_COUNT;
+            return slave->dirty_coils[index];
+#endif
+#if MODBUS_DIRTY_REGISTER_COUNT
+        case MODBUS_DIRTY_HOLDING_REGISTERS:
+            *limit = MODBUS_DIRTY_REGISTER_COUNT;
+            return slave->dirty_registers[index];
+#endif
+        default:
+            *limit = 0;
+            return NULL;
+    }
+}
+
+/**
+ * Mark a range of addresses as written, one bitmap word at a time
+ * Addresses beyond the tracked range are ignored.
+ * @param slave Slave instance
+ * @param index Index of the written unit
+ * @param table Written table
+ * @param addr  First written address
+ * @param count Number of written addresses
+ */
+static void modbus_dirty_mark(ModbusSlave *slave, uint8_t index, ModbusDirtyTable table, uint16_t addr, uint16_t count) {
+    uint16_t limit;
+    uint32_t *words = modbus_dirty_bitmap(slave, index, table, &limit);
+    if (!words) return;
+
+    uint32_t first = addr;
+    uint32_t end = (uint32_t)addr + count;
+    if (end > limit) end = limit;
+
+    while (first < end) {
+        uint32_t bit = first & 31u;
+        uint32_t span = end - first;
+        if (span > 32u - bit) span = 32u - bit;
+
+        uint32_t mask = (span == 32u) ? 0xFFFFFFFFu : ((1u << span) - 1u) << bit;
+        words[first >> 5] |= mask;
+        first += span;
+    }
+}
+
+/**
+ * Record the addresses changed by a successfully executed write request
+ * @param slave   Slave instance
+ * @param index   Index of the unit that executed it
+ * @param request Request PDU
+ */
+static void modbus_dirty_track(ModbusSlave *slave, uint8_t index, const uint8_t *request) {
+    uint16_t addr = modbus_be16_get(&request[1]);
+
+    switch (request[0]) {
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+            modbus_dirty_mark(slave, index, MODBUS_DIRTY_COILS, addr, 1);
+            break;
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+            modbus_dirty_mark(slave, index, MODBUS_DIRTY_COILS, addr, modbus_be16_get(&request[3]));
+            break;
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+        case MODBUS_FC_MASK_WRITE_REGISTER:
+            modbus_dirty_mark(slave, index, MODBUS_DIRTY_HOLDING_REGISTERS, addr, 1);
+            break;
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            modbus_dirty_mark(slave, index, MODBUS_DIRTY_HOLDING_REGISTERS, addr, modbus_be16_get(&request[3]));
+            break;
+        case MODBUS_FC_READ_WRITE_MULTIPLE_REGS:
+            modbus_dirty_mark(slave, index, MODBUS_DIRTY_HOLDING_REGISTERS,
+                              modbus_be16_get(&request[5]), modbus_be16_get(&request[7]));
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Fetch and clear the next written address of a table of one unit
+ *
+ * Each unit has its own bitmaps, a broadcast write marks those of every
+ * unit that executed it. Each bitmap word is cleared when the cursor reaches
+ * it, so every write is reported once. Call from the same context as
+ * modbus_slave_poll().
+ *
+ *     ModbusDirtyCursor cursor = {0};
+ *     int32_t addr;
+ *     while ((addr = modbus_slave_next_dirty(&slave, 0x01, MODBUS_DIRTY_HOLDING_REGISTERS, &cursor)) >= 0) {
+ *         apply_register((uint16_t)addr);
+ *     }
+ *
+ * @param slave  Slave instance
+ * @param unit   Address of the unit
+ * @param table  Table to scan
+ * @param cursor Iteration state, zero-initialized before the first call
+ * @return Next written address, -1 when there are no more or the unit is not served
+ */
+int32_t modbus_slave_next_dirty(ModbusSlave *slave, uint8_t unit, ModbusDirtyTable table, ModbusDirtyCursor *cursor) {
+#if MODBUS_MAX_UNITS > 1
+    if (unit == 0x00 || slave->unit_index[unit] == 0) return -1;
+    uint8_t index = (uint8_t)(slave->unit_index[unit] - 1);
+#else
+    if (unit != MODBUS_SLAVE_ADDRESS(slave)) return -1;
+    uint8_t index = 0;
+#endif
+
+    uint16_t limit;
+    uint32_t *words = modbus_dirty_bitmap(slave, index, table, &limit);
+    if (!words) return -1;
+
+    while (cursor->bits == 0) {
+        if (cursor->word >= MODBUS_DIRTY_WORDS(limit)) return -1;
+        cursor->bits = words[cursor->word];
+        words[cursor->word] = 0;
+        cursor->word++;
+    }
+
+    uint8_t bit = modbus_ctz32(cursor->bits);
+    cursor->bits &= cursor->bits - 1u; // Clear the lowest set bit
+
+    return (int32_t)(cursor->word - 1u) * 32 + bit;
+}
+#endif
+
 // =============================================================================
 // Initialization
 // =============================================================================
@@ -20,15 +376,140 @@ int modbus_slave_init(ModbusSlave *slave, const ModbusSlaveConfig *cfg) {
 
     if (cfg->address == 0x00) return -1; // Address 0 is reserved for broadcast
 
+#if MODBUS_ENABLE_TX_HOOKS
+    if (cfg->turnaround_us && !cfg->delay_us) return -1;
+#endif
+
+#if MODBUS_ENABLE_DEADLINE
+    if (cfg->response_deadline_ms && !cfg->now_ms) return -1;
+#endif
+
+#if MODBUS_ENABLE_FC_2B
+    if (modbus_device_id_validate(cfg) != 0) return -1;
+#endif
+
+#if MODBUS_SHARED_CONFIG
+    slave->config = cfg;
+    slave->address = cfg->address;
+#else
     slave->config = *cfg;
+#endif
     slave->state = IDLE;
     slave->frame_len = 0;
     slave->frame_ok = true;
     slave->frame_available = false;
     slave->processing_frame = false;
+#if MODBUS_ENABLE_COUNTERS
+    memset(&slave->counters, 0, sizeof(slave->counters));
+#endif
+#if MODBUS_ENABLE_DEADLINE
+    slave->frame_time_ms = 0;
+    slave->stale_frames = 0;
+#endif
+#if MODBUS_FRAME_BUFFER_SIZE == 0
+    slave->frame = NULL;
+    slave->frame_size = 0;
+#endif
+#if MODBUS_RESPONSE_CACHE_ENTRIES
+    slave->generation = 0;
+    slave->data_changed = 0;
+    slave->cache_next = 0;
+    memset(slave->cache, 0, sizeof(slave->cache));
+#endif
+#if MODBUS_STAGED_WRITES
+    slave->staged.count = 0;
+#endif
+#if MODBUS_MAX_UNITS > 1
+    memset(slave->unit_index, 0, sizeof(slave->unit_index));
+    slave->units[0] = &MODBUS_SLAVE_CFG(slave);
+    slave->unit_count = 1;
+    slave->unit_index[cfg->address] = 1;
+    slave->unit = slave->units[0];
+#endif
+#if MODBUS_DIRTY_COIL_COUNT
+    memset(slave->dirty_coils, 0, sizeof(slave->dirty_coils));
+#endif
+#if MODBUS_DIRTY_REGISTER_COUNT
+    memset(slave->dirty_registers, 0, sizeof(slave->dirty_registers));
+#endif
+#if MODBUS_ENABLE_FC_2B && MODBUS_DEVICE_ID_CACHE_SIZE
+    modbus_device_id_cache_build(slave);
+#endif
+
+    return 0;
+}
+
+/**
+ * Change the address the slave responds to
+ * @param slave   Initialized slave instance
+ * @param address New slave address (1-247)
+ * @return 0 on success, -1 on error
+ */
+int modbus_slave_set_address(ModbusSlave *slave, uint8_t address) {
+    if (!slave || address == 0x00) return -1;
+
+#if MODBUS_MAX_UNITS > 1
+    uint8_t current = MODBUS_SLAVE_ADDRESS(slave);
+    if (address != current && slave->unit_index[address] != 0) return -1; // Taken by another unit
+
+    slave->unit_index[current] = 0;
+    slave->unit_index[address] = 1;
+#endif
+
+    MODBUS_SLAVE_ADDRESS(slave) = address;
+
+#if MODBUS_ENABLE_FC_2B && MODBUS_DEVICE_ID_CACHE_SIZE
+    modbus_device_id_cache_build(slave); // Cached frames carry the address
+#endif
+
+    return 0;
+}
+
+#if MODBUS_MAX_UNITS > 1
+/**
+ * Serve another unit address from the same instance
+ * The unit shares the receiver, frame buffer and write function of the slave;
+ * only its address and callbacks are used.
+ * @param slave Initialized slave instance
+ * @param unit  Unit configuration, kept by reference and must outlive the slave
+ * @return 0 on success, -1 on error (invalid or taken address, table full)
+ */
+int modbus_slave_add_unit(ModbusSlave *slave, const ModbusSlaveConfig *unit) {
+    if (!slave || !unit || unit->address == 0x00) return -1;
+    if (slave->unit_index[unit->address] != 0) return -1;
+    if (slave->unit_count >= MODBUS_MAX_UNITS) return -1;
+
+#if MODBUS_ENABLE_FC_2B
+    if (modbus_device_id_validate(unit) != 0) return -1;
+#endif
+
+    slave->units[slave->unit_count] = unit;
+    slave->unit_count++;
+    slave->unit_index[unit->address] = slave->unit_count;
+
+    return 0;
+}
+#endif
+
+#if MODBUS_FRAME_BUFFER_SIZE == 0
+/**
+ * Attach a receive buffer to a slave built without an embedded one
+ * @param slave  Initialized slave instance
+ * @param buffer Buffer for incoming frames, owned by the caller
+ * @param size   Buffer size in bytes (MODBUS_MIN_FRAME_LENGTH..MODBUS_MAX_FRAME_LENGTH)
+ * @return 0 on success, -1 on error
+ */
+int modbus_slave_set_frame_buffer(ModbusSlave *slave, uint8_t *buffer, uint16_t size) {
+    if (!slave || !buffer) return -1;
+    if (size < MODBUS_MIN_FRAME_LENGTH || size > MODBUS_MAX_FRAME_LENGTH) return -1;
+
+    slave->frame = buffer;
+    slave->frame_size = size;
+    slave->frame_len = 0;
 
     return 0;
 }
+#endif
 
 // =============================================================================
 // Receive byte (ISR-safe)
@@ -49,9 +530,13 @@ void modbus_slave_rx_byte(ModbusSlave *slave, uint8_t byte) {
     }
 
     if (slave->state == RECEPTION) {
-        if (slave->frame_len < MODBUS_MAX_FRAME_LENGTH) {
+        if (slave->frame_len < MODBUS_SLAVE_FRAME_SIZE(slave)) {
             slave->frame[slave->frame_len++] = byte;
         } else { // Drop data if frame exceeds size limit
+#if MODBUS_ENABLE_COUNTERS
+            uint8_t address = slave->frame[0];
+            if (modbus_is_own_address(slave, address)) MODBUS_COUNT(slave, bus_char_overrun);
+#endif
             slave->frame_ok = false;
             slave->state = CONTROL_AND_WAITING;
         }
@@ -78,7 +563,13 @@ void modbus_slave_3_5t_elapsed(ModbusSlave *slave) {
     if (slave->state != CONTROL_AND_WAITING) return;
 
     // Only process the frame if there were no reception errors
-    if (slave->frame_ok) slave->frame_available = true;
+    if (slave->frame_ok) {
+#if MODBUS_ENABLE_DEADLINE
+        // Stamped before the frame is published to modbus_slave_poll()
+        if (MODBUS_SLAVE_CFG(slave).response_deadline_ms) slave->frame_time_ms = MODBUS_SLAVE_CFG(slave).now_ms();
+#endif
+        slave->frame_available = true;
+    }
 
     slave->state = IDLE;
 }
@@ -93,91 +584,308 @@ void modbus_slave_3_5t_elapsed(ModbusSlave *slave) {
  * @return 0 if valid, -1 if invalid
  */
 static int modbus_validate_frame(ModbusSlave *slave) {
-	if (slave->frame_len < MODBUS_MIN_FRAME_LENGTH) return -1;
+	if (slave->frame_len < MODBUS_MIN_FRAME_LENGTH) {
+		MODBUS_COUNT(slave, bus_comm_error);
+		return -1;
+	}
 
 	uint8_t address = slave->frame[0];
-	if (address != 0x00 && address != slave->config.address) return -1;
+
+#if !MODBUS_ENABLE_COUNTERS
+	// Without counters there is no need to check CRC of frames for other slaves
+	if (!modbus_is_own_address(slave, address)) return -1;
+#endif
 
 	uint16_t received_crc = modbus_le16_get(&slave->frame[slave->frame_len - 2]);
 	uint16_t expected_crc = modbus_crc16(slave->frame, slave->frame_len - 2);
-	if (received_crc != expected_crc) return -1;
+	if (received_crc != expected_crc) {
+		MODBUS_COUNT(slave, bus_comm_error);
+		return -1;
+	}
+
+	MODBUS_COUNT(slave, bus_message);
+
+#if MODBUS_ENABLE_COUNTERS
+	if (!modbus_is_own_address(slave, address)) return -1;
+#endif
+
+	MODBUS_COUNT(slave, slave_message);
 
 	return 0;
 }
 
 // =============================================================================
-// Frame processor
+// PDU processing
 // =============================================================================
 
 /**
- * Process valid Modbus frame and generate response
- * @param slave Slave instance
+ * Run the handler of the request function code for the current unit
+ * @param slave        Slave instance
+ * @param request      Request PDU
+ * @param request_len  Request PDU length
+ * @param response     Response PDU buffer
+ * @param response_len Response PDU length, updated by the handler
+ * @return Exception code, MODBUS_EX_NONE on success
  */
-static void modbus_process_frame(ModbusSlave *slave) {
-    if (modbus_validate_frame(slave) != 0) return; // Drop invalid frames
-
-    uint8_t *request = slave->frame;
-
-    uint8_t response[MODBUS_MAX_FRAME_LENGTH];
-    uint8_t *response_pdu = response + 1;
-    uint16_t response_len = 0;
+static ModbusExceptionCode modbus_dispatch(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                           uint8_t *response, uint16_t *response_len) {
+    ModbusExceptionCode ex;
 
-    ModbusExceptionCode ex_code = MODBUS_EX_NONE;
-
-    switch(request[1]) {
+    switch (request[0]) {
+#if MODBUS_ENABLE_FC_01
         case MODBUS_FC_READ_COILS:
-            ex_code = handle_read_coils(slave, response_pdu, &response_len);
+            ex = handle_read_coils(slave, request, request_len, response, response_len);
             break;
+#endif
+#if MODBUS_ENABLE_FC_02
         case MODBUS_FC_READ_DISCRETE_INPUTS:
-            ex_code = handle_read_discrete_inputs(slave, response_pdu, &response_len);
+            ex = handle_read_discrete_inputs(slave, request, request_len, response, response_len);
             break;
+#endif
+#if MODBUS_ENABLE_FC_03
         case MODBUS_FC_READ_HOLDING_REGISTERS:
-            ex_code = handle_read_holding_registers(slave, response_pdu, &response_len);
+            ex = handle_read_holding_registers(slave, request, request_len, response, response_len);
             break;
+#endif
+#if MODBUS_ENABLE_FC_04
         case MODBUS_FC_READ_INPUT_REGISTERS:
-            ex_code = handle_read_input_registers(slave, response_pdu, &response_len);
+            ex = handle_read_input_registers(slave, request, request_len, response, response_len);
             break;
+#endif
+#if MODBUS_ENABLE_FC_05
         case MODBUS_FC_WRITE_SINGLE_COIL:
-            ex_code = handle_write_single_coil(slave, response_pdu, &response_len);
+            ex = handle_write_single_coil(slave, request, request_len, response, response_len);
             break;
+#endif
+#if MODBUS_ENABLE_FC_06
         case MODBUS_FC_WRITE_SINGLE_REGISTER:
-            ex_code = handle_write_single_register(slave, response_pdu, &response_len);
+            ex = handle_write_single_register(slave, request, request_len, response, response_len);
+            break;
+#endif
+#if MODBUS_ENABLE_FC_07
+        case MODBUS_FC_READ_EXCEPTION_STATUS:
+            ex = handle_read_exception_status(slave, request, request_len, response, response_len);
             break;
+#endif
+#if MODBUS_ENABLE_FC_08
+        case MODBUS_FC_DIAGNOSTICS:
+            ex = handle_diagnostics(slave, request, request_len, response, response_len);
+            break;
+#endif
+#if MODBUS_ENABLE_FC_0F
         case MODBUS_FC_WRITE_MULTIPLE_COILS:
-            ex_code = handle_write_multiple_coils(slave, response_pdu, &response_len);
+            ex = handle_write_multiple_coils(slave, request, request_len, response, response_len);
             break;
+#endif
+#if MODBUS_ENABLE_FC_10
         case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
-            ex_code = handle_write_multiple_registers(slave, response_pdu, &response_len);
+            ex = handle_write_multiple_registers(slave, request, request_len, response, response_len);
             break;
+#endif
+#if MODBUS_ENABLE_FC_16
         case MODBUS_FC_MASK_WRITE_REGISTER:
-            ex_code = handle_mask_write_register(slave, response_pdu, &response_len);
+            ex = handle_mask_write_register(slave, request, request_len, response, response_len);
             break;
+#endif
+#if MODBUS_ENABLE_FC_17
         case MODBUS_FC_READ_WRITE_MULTIPLE_REGS:
-            ex_code = handle_read_write_multiple_registers(slave, response_pdu, &response_len);
+            ex = handle_read_write_multiple_registers(slave, request, request_len, response, response_len);
+            break;
+#endif
+#if MODBUS_ENABLE_FC_2B
+        case MODBUS_FC_ENCAPSULATED_INTERFACE:
+            ex = handle_read_device_identification(slave, request, request_len, response, response_len);
             break;
+#endif
         default:
-            ex_code = MODBUS_EX_ILLEGAL_FUNCTION;
+            ex = MODBUS_EX_ILLEGAL_FUNCTION;
             break;
     }
 
-    if (request[0] == 0x00) return; // Broadcast frame, no response
+#if MODBUS_STAGED_WRITES
+    if (slave->staged.count) { // Apply staged registers only once the whole request succeeded
+        if (ex == MODBUS_EX_NONE) {
+            ex = MODBUS_UNIT_CFG(slave).write_multiple_registers(slave->staged.addr, slave->staged.count,
+                                                                 slave->staged.data);
+        }
+        slave->staged.count = 0;
+    }
+#endif
 
-    response[0] = request[0]; // Reassign the address
-    response_len += 1;
+    return ex;
+}
+
+/**
+ * Process a request PDU addressed to a unit
+ *
+ * Transport independent entry point: the RTU receiver calls it once address
+ * and CRC are checked, other transports (e.g. Modbus TCP) call it directly
+ * with the unit identifier of their header and need no CRC at all.
+ * @param slave        Slave instance
+ * @param unit         Unit address, 0x00 for broadcast
+ * @param request      Request PDU, function code first
+ * @param request_len  Request PDU length
+ * @param response     Response PDU buffer, at least MODBUS_MAX_PDU_LENGTH bytes
+ * @param response_len Set to the response PDU length, 0 if nothing must be sent
+ * @return 0 if processed, -1 if the unit is not served or the PDU is invalid
+ */
+int modbus_process_pdu(ModbusSlave *slave, uint8_t unit, const uint8_t *request, uint16_t request_len,
+                       uint8_t *response, uint16_t *response_len) {
+    *response_len = 0;
+
+    if (request_len == 0 || request_len > MODBUS_MAX_PDU_LENGTH) return -1;
+    if (!modbus_is_own_address(slave, unit)) return -1;
+
+    ModbusExceptionCode ex_code;
+    uint16_t len = 0;
+
+#if MODBUS_MAX_UNITS > 1
+    if (unit == 0x00) { // Broadcast, executed by every unit
+        ex_code = MODBUS_EX_ILLEGAL_FUNCTION;
+        for (uint8_t i = 0; i < slave->unit_count; ++i) {
+            slave->unit = slave->units[i];
+            len = 0;
+            if (modbus_dispatch(slave, request, request_len, response, &len) == MODBUS_EX_NONE) {
+                ex_code = MODBUS_EX_NONE;
+                MODBUS_DIRTY_TRACK(slave, i, request);
+            }
+        }
+    } else {
+        uint8_t index = (uint8_t)(slave->unit_index[unit] - 1);
+        slave->unit = slave->units[index];
+        ex_code = modbus_dispatch(slave, request, request_len, response, &len);
+        if (ex_code == MODBUS_EX_NONE) MODBUS_DIRTY_TRACK(slave, index, request);
+    }
+#else
+    ex_code = modbus_dispatch(slave, request, request_len, response, &len);
+    if (ex_code == MODBUS_EX_NONE) MODBUS_DIRTY_TRACK(slave, 0, request);
+#endif
+
+#if MODBUS_RESPONSE_CACHE_ENTRIES
+    // A successful write changes the data behind cached responses
+    if (ex_code == MODBUS_EX_NONE && modbus_is_write_function(request[0])) slave->generation++;
+#endif
+
+    if (unit == 0x00) return 0; // Broadcast request, no response
+
+    if (ex_code != MODBUS_EX_NONE) { // Replace the response with the exception
+        response[0] = request[0] | MODBUS_FC_EXCEPTION_MASK;
+        response[1] = (uint8_t)ex_code;
+        len = 2;
+    }
+
+    *response_len = len;
+    return 0;
+}
+
+// =============================================================================
+// Frame processor
+// =============================================================================
+
+#if MODBUS_ENABLE_DEADLINE
+/**
+ * Check whether a validated request waited past its response deadline
+ * @param slave Slave instance holding a validated request
+ * @return true if the request must be dropped unanswered
+ */
+static bool modbus_frame_is_stale(const ModbusSlave *slave) {
+    const ModbusSlaveConfig *cfg = &MODBUS_SLAVE_CFG(slave);
+
+    if (!cfg->response_deadline_ms || slave->frame[0] == 0x00) return false; // Broadcasts have no deadline
+
+    uint32_t age = cfg->now_ms() - slave->frame_time_ms; // Wraps with the clock
+    return age > cfg->response_deadline_ms;
+}
+#endif
 
-    if (ex_code != MODBUS_EX_NONE) { // Set an exception if there was one
-        response[1] = request[1] | MODBUS_FC_EXCEPTION_MASK;
-        response[2] = (uint8_t)ex_code;
-        response_len = 3;
+/**
+ * Send a response frame, framed by the transmit hooks of the configuration
+ * @param slave  Slave instance
+ * @param frame  Response frame, CRC included
+ * @param length Frame length
+ */
+static void modbus_send_response(const ModbusSlave *slave, const uint8_t *frame, uint16_t length) {
+#if MODBUS_ENABLE_TX_HOOKS
+    const ModbusSlaveConfig *cfg = &MODBUS_SLAVE_CFG(slave);
+
+    if (cfg->turnaround_us) cfg->delay_us(cfg->turnaround_us); // Bus still released, the master may be switching over
+    if (cfg->tx_begin) cfg->tx_begin();
+    cfg->write(frame, length);
+    if (cfg->tx_end) cfg->tx_end();
+#else
+    MODBUS_SLAVE_CFG(slave).write(frame, length);
+#endif
+}
+
+/**
+ * Process valid Modbus frame and generate response
+ * @param slave Slave instance
+ */
+static void modbus_process_frame(ModbusSlave *slave) {
+    if (modbus_validate_frame(slave) != 0) return; // Drop invalid frames
+
+#if MODBUS_ENABLE_DEADLINE
+    if (modbus_frame_is_stale(slave)) { // The master already gave up on it
+        slave->stale_frames++;
+        MODBUS_COUNT(slave, slave_no_response);
+        return;
+    }
+#endif
+
+#if MODBUS_ENABLE_FC_2B && MODBUS_DEVICE_ID_CACHE_SIZE
+    uint16_t cached_len;
+    const uint8_t *cached = modbus_device_id_cache_lookup(slave, &cached_len);
+    if (cached) { // Precomputed discovery response, CRC included
+        modbus_send_response(slave, cached, cached_len);
+        return;
+    }
+#endif
+
+#if MODBUS_RESPONSE_CACHE_ENTRIES
+    bool cacheable = modbus_response_cache_eligible(slave);
+    uint32_t generation = modbus_response_cache_generation(slave); // Sampled before the application is asked for data
+
+    if (cacheable) {
+        const ModbusResponseCacheEntry *entry = modbus_response_cache_lookup(slave);
+        if (entry) { // Same request, data unchanged since the response was built
+            modbus_send_response(slave, entry->response, entry->response_len);
+            return;
+        }
+    }
+#endif
+
+    uint8_t *request = slave->frame;
+
+    uint8_t response[MODBUS_MAX_FRAME_LENGTH];
+    uint16_t response_len;
+
+    // Strip address and CRC, the PDU is processed in place
+    if (modbus_process_pdu(slave, request[0], &request[1], slave->frame_len - 3,
+                           &response[1], &response_len) != 0) return;
+
+    // Serial line counters, only kept for requests received on the line
+    if (response_len == 0) { // Broadcast, no response
+        MODBUS_COUNT(slave, slave_no_response);
+        return;
     }
+    if (response[1] & MODBUS_FC_EXCEPTION_MASK) MODBUS_COUNT(slave, bus_exception);
+
+    response[0] = request[0]; // Reassign the address
+    response_len += 1;
 
     // Calculate and set CRC16
     uint16_t crc = modbus_crc16(response, response_len);
     modbus_le16_set(&response[response_len], crc);
     response_len += 2;
 
+#if MODBUS_RESPONSE_CACHE_ENTRIES
+    if (cacheable && !(response[1] & MODBUS_FC_EXCEPTION_MASK)) {
+        modbus_response_cache_store(slave, generation, response, response_len);
+    }
+#endif
+
     // Send the response
-    slave->config.write(response, response_len);
+    modbus_send_response(slave, response, response_len);
 }
 
 // =============================================================================
@@ -1,6 +1,7 @@
 #ifndef MODBUS_SLAVE_H
 #define MODBUS_SLAVE_H
 
+#include "modbus_config.h"
 #include "modbus_bytes.h"
 
 #include <stdint.h>
@@ -44,17 +45,54 @@ typedef enum {
     MODBUS_FC_DIAGNOSTICS               = 0x08,
     MODBUS_FC_READ_WRITE_MULTIPLE_REGS  = 0x17,
     MODBUS_FC_MASK_WRITE_REGISTER       = 0x16,
+    MODBUS_FC_ENCAPSULATED_INTERFACE    = 0x2B,
 } ModbusFunctionCode;
 
+/*==============================
+    Device identification
+==============================*/
+#define MODBUS_MEI_READ_DEVICE_ID 0x0E
+
+typedef enum {
+    MODBUS_DEVICE_ID_BASIC      = 0x01, /* Stream access, objects 0x00-0x02 */
+    MODBUS_DEVICE_ID_REGULAR    = 0x02, /* Stream access, objects 0x00-0x7F */
+    MODBUS_DEVICE_ID_EXTENDED   = 0x03, /* Stream access, objects 0x00-0xFF */
+    MODBUS_DEVICE_ID_INDIVIDUAL = 0x04, /* One specific object */
+} ModbusDeviceIdCode;
+
+typedef struct {
+    uint8_t id;         /* Object id, e.g. 0x00 VendorName, 0x01 ProductCode */
+    uint8_t length;     /* Value length in bytes */
+    const char *value;  /* Value, not necessarily NUL-terminated */
+} ModbusDeviceIdObject;
+
+/*==============================
+    Diagnostics sub-functions
+==============================*/
+typedef enum {
+    MODBUS_DIAG_RETURN_QUERY_DATA       = 0x00,
+    MODBUS_DIAG_CLEAR_COUNTERS          = 0x0A,
+    MODBUS_DIAG_BUS_MESSAGE_COUNT       = 0x0B,
+    MODBUS_DIAG_BUS_COMM_ERROR_COUNT    = 0x0C,
+    MODBUS_DIAG_BUS_EXCEPTION_COUNT     = 0x0D,
+    MODBUS_DIAG_SLAVE_MESSAGE_COUNT     = 0x0E,
+    MODBUS_DIAG_SLAVE_NO_RESPONSE_COUNT = 0x0F,
+    MODBUS_DIAG_BUS_CHAR_OVERRUN_COUNT  = 0x12,
+    MODBUS_DIAG_CLEAR_OVERRUN_COUNTER   = 0x14,
+} ModbusDiagnosticsSubFunction;
+
 /*==============================
     Exception codes
 ==============================*/
 typedef enum {
-    MODBUS_EX_NONE                 = 0x00, /* No exception */
-    MODBUS_EX_ILLEGAL_FUNCTION     = 0x01, /* Function not supported */
-    MODBUS_EX_ILLEGAL_DATA_ADDRESS = 0x02, /* Invalid register/coil address */
-    MODBUS_EX_ILLEGAL_DATA_VALUE   = 0x03, /* Invalid value */
-    MODBUS_EX_SLAVE_DEVICE_FAILURE = 0x04, /* Device failure */
+    MODBUS_EX_NONE                     = 0x00, /* No exception */
+    MODBUS_EX_ILLEGAL_FUNCTION         = 0x01, /* Function not supported */
+    MODBUS_EX_ILLEGAL_DATA_ADDRESS     = 0x02, /* Invalid register/coil address */
+    MODBUS_EX_ILLEGAL_DATA_VALUE       = 0x03, /* Invalid value */
+    MODBUS_EX_SLAVE_DEVICE_FAILURE     = 0x04, /* Device failure */
+    MODBUS_EX_SLAVE_DEVICE_BUSY        = 0x06, /* Device busy, retry later */
+    MODBUS_EX_GATEWAY_PATH_UNAVAILABLE = 0x0A, /* No path to the addressed unit */
+    MODBUS_EX_GATEWAY_TARGET_FAILED    = 0x0B, /* Unit behind a gateway did not respond */
 } ModbusExceptionCode;
 
 /*==============================
@@ -70,6 +108,10 @@ typedef ModbusExceptionCode (*ModbusWriteSingleRegisterCb)(uint16_t addr, uint16
 typedef ModbusExceptionCode (*ModbusWriteMultipleCoilsCb)(uint16_t addr, uint16_t count, const uint8_t *src);
 typedef ModbusExceptionCode (*ModbusWriteMultipleRegistersCb)(uint16_t addr, uint16_t count, const uint8_t *src);
 
+typedef ModbusExceptionCode (*ModbusReadExceptionStatusCb)(uint8_t *status);
+
+typedef ModbusExceptionCode (*ModbusValidateRegisterCb)(uint16_t addr, uint16_t value);
+
 typedef ModbusExceptionCode (*ModbusMaskWriteRegisterCb)(uint16_t addr, uint16_t and_mask, uint16_t or_mask);
 typedef ModbusExceptionCode (*ModbusReadWriteMultipleRegistersCb)(
     uint16_t read_addr, uint16_t read_count,
@@ -84,42 +126,236 @@ typedef struct {
     uint8_t address;
     
     void (*write)(const uint8_t *data, uint16_t length);
+
+#if MODBUS_ENABLE_TX_HOOKS
+    /* Optional, called before write(): enable the RS-485 driver */
+    void (*tx_begin)(void);
+    /* Optional, called once write() returned: disable the driver. write() must
+       then only return after the last stop bit left the UART */
+    void (*tx_end)(void);
+    /* Busy-wait for the given microseconds, required with turnaround_us */
+    void (*delay_us)(uint16_t us);
+    /* Silence kept after the request before driving the bus, for masters slow to release it */
+    uint16_t turnaround_us;
+#endif
+
+#if MODBUS_ENABLE_DEADLINE
+    /* Free-running millisecond clock, required with response_deadline_ms.
+       Called from modbus_slave_3_5t_elapsed(), so it must be ISR-safe */
+    uint32_t (*now_ms)(void);
+    /* Requests older than this when processed are dropped unanswered, 0 for no deadline */
+    uint16_t response_deadline_ms;
+#endif
     
+#if MODBUS_ENABLE_FC_01
     ModbusReadCoilsCb                   read_coils;
+#endif
+#if MODBUS_ENABLE_FC_02
     ModbusReadDiscreteInputsCb          read_discrete_inputs;
+#endif
+#if MODBUS_ENABLE_FC_03
     ModbusReadHoldingRegistersCb        read_holding_registers;
+#endif
+#if MODBUS_ENABLE_FC_04
     ModbusReadInputRegistersCb          read_input_registers;
+#endif
 
+#if MODBUS_ENABLE_FC_05
     ModbusWriteSingleCoilCb             write_single_coil;
+#endif
+#if MODBUS_ENABLE_FC_06
     ModbusWriteSingleRegisterCb         write_single_register;
+#endif
+#if MODBUS_ENABLE_FC_0F
     ModbusWriteMultipleCoilsCb          write_multiple_coils;
+#endif
+#if MODBUS_ENABLE_FC_10
     ModbusWriteMultipleRegistersCb      write_multiple_registers;
+#endif
+
+#if MODBUS_ENABLE_FC_07
+    ModbusReadExceptionStatusCb         read_exception_status;
+#endif
+
+#if MODBUS_ENABLE_FC_2B
+    /* Sorted by id, objects 0x00-0x02 are mandatory */
+    const ModbusDeviceIdObject          *device_id_objects;
+    uint8_t                             device_id_object_count;
+#endif
 
+#if MODBUS_ENABLE_FC_16
     ModbusMaskWriteRegisterCb           mask_write_register;
+#endif
+#if MODBUS_ENABLE_FC_17
     ModbusReadWriteMultipleRegistersCb  read_write_multiple_registers;
+#endif
+
+#if MODBUS_STAGED_WRITES
+    /* Commit 0x10/0x17 writes through write_multiple_registers once the request succeeded */
+    bool                                staged_writes;
+    ModbusValidateRegisterCb            validate_register; /* Optional, called per staged register */
+#endif
 } ModbusSlaveConfig;
 
+/*==============================
+    Serial line counters
+==============================*/
+typedef struct {
+    uint16_t bus_message;       /* Frames with a valid CRC seen on the bus */
+    uint16_t bus_comm_error;    /* Frames dropped for a bad CRC or length */
+    uint16_t bus_exception;     /* Exception responses returned */
+    uint16_t slave_message;     /* Frames addressed to this slave or broadcast */
+    uint16_t slave_no_response; /* Addressed frames left without a response */
+    uint16_t bus_char_overrun;  /* Addressed frames lost to a buffer overrun */
+} ModbusCounters;
+
+/*==============================
+    Response cache
+==============================*/
+typedef struct {
+    uint32_t generation;   /* Data generation the response was built for */
+    uint16_t response_len; /* Frame length, 0 if the entry is empty */
+    uint8_t request[6];    /* Address, function code, start address, quantity */
+    uint8_t response[MODBUS_RESPONSE_CACHE_FRAME_SIZE];
+} ModbusResponseCacheEntry;
+
+/*==============================
+    Staged writes
+==============================*/
+typedef struct {
+    const uint8_t *data; /* Big-endian values, inside the request PDU */
+    uint16_t addr;       /* First staged register */
+    uint16_t count;      /* Staged registers, 0 if nothing is staged */
+} ModbusStagedWrite;
+
+/*==============================
+    Change tracking
+==============================*/
+typedef enum {
+    MODBUS_DIRTY_COILS,             /* Written by 0x05, 0x0F */
+    MODBUS_DIRTY_HOLDING_REGISTERS  /* Written by 0x06, 0x10, 0x16, 0x17 */
+} ModbusDirtyTable;
+
+/* Iteration state of modbus_slave_next_dirty(), zero-initialize before use */
+typedef struct {
+    uint32_t bits; /* Fetched bits not returned yet */
+    uint16_t word; /* Next bitmap word to fetch */
+} ModbusDirtyCursor;
+
+#define MODBUS_DIRTY_WORDS(count) (((count) + 31u) / 32u)
+
 /*==============================
     Slave structure
 ==============================*/
 typedef struct {
+#if MODBUS_SHARED_CONFIG
+    const ModbusSlaveConfig *config;
+    uint8_t address;
+#else
     ModbusSlaveConfig config;
+#endif
+#if MODBUS_PACKED_FLAGS
+    volatile uint8_t state            : 2;
+    volatile uint8_t frame_ok         : 1;
+    volatile uint8_t frame_available  : 1;
+    volatile uint8_t processing_frame : 1;
+#else
     volatile ModbusState state;
-    uint8_t frame[MODBUS_MAX_FRAME_LENGTH];
-    volatile uint16_t frame_len;
     volatile bool frame_ok;
     volatile bool frame_available;
     volatile bool processing_frame;
+#endif
+    volatile uint16_t frame_len;
+#if MODBUS_ENABLE_COUNTERS
+    ModbusCounters counters;
+#endif
+#if MODBUS_ENABLE_DEADLINE
+    volatile uint32_t frame_time_ms; /* Clock reading when the pending frame ended */
+    uint32_t stale_frames;           /* Requests dropped past their response deadline */
+#endif
+#if MODBUS_RESPONSE_CACHE_ENTRIES
+    uint32_t generation;            /* Only changed by the processing path */
+    volatile uint8_t data_changed;  /* Set by modbus_slave_bump_generation(), a byte store from any context */
+    uint8_t cache_next; /* Entry replaced on the next miss */
+    ModbusResponseCacheEntry cache[MODBUS_RESPONSE_CACHE_ENTRIES];
+#endif
+#if MODBUS_STAGED_WRITES
+    ModbusStagedWrite staged;
+#endif
+#if MODBUS_DIRTY_COIL_COUNT
+    uint32_t dirty_coils[MODBUS_MAX_UNITS][MODBUS_DIRTY_WORDS(MODBUS_DIRTY_COIL_COUNT)]; /* Per unit */
+#endif
+#if MODBUS_DIRTY_REGISTER_COUNT
+    uint32_t dirty_registers[MODBUS_MAX_UNITS][MODBUS_DIRTY_WORDS(MODBUS_DIRTY_REGISTER_COUNT)]; /* Per unit */
+#endif
+#if MODBUS_ENABLE_FC_2B && MODBUS_DEVICE_ID_CACHE_SIZE
+    uint16_t device_id_len[3]; /* Cached frame length per stream code, 0 if not cached */
+    uint8_t device_id_cache[MODBUS_DEVICE_ID_CACHE_SIZE];
+#endif
+#if MODBUS_MAX_UNITS > 1
+    const ModbusSlaveConfig *unit;                    /* Unit addressed by the frame being processed */
+    const ModbusSlaveConfig *units[MODBUS_MAX_UNITS]; /* units[0] is the configuration passed to init */
+    uint8_t unit_count;
+    uint8_t unit_index[256];                          /* Address -> index in units + 1, 0 if not served */
+#endif
+#if MODBUS_FRAME_BUFFER_SIZE
+    uint8_t frame[MODBUS_FRAME_BUFFER_SIZE];
+#else
+    uint16_t frame_size;
+    uint8_t *frame;
+#endif
 } ModbusSlave;
 
+/*
+ * Access the active configuration and address of a slave independently of
+ * MODBUS_SHARED_CONFIG
+ */
+#if MODBUS_SHARED_CONFIG
+#define MODBUS_SLAVE_CFG(slave)     (*(slave)->config)
+#define MODBUS_SLAVE_ADDRESS(slave) ((slave)->address)
+#else
+#define MODBUS_SLAVE_CFG(slave)     ((slave)->config)
+#define MODBUS_SLAVE_ADDRESS(slave) ((slave)->config.address)
+#endif
+
+/*
+ * Access the callbacks of the unit addressed by the request being processed
+ */
+#if MODBUS_MAX_UNITS > 1
+#define MODBUS_UNIT_CFG(slave) (*(slave)->unit)
+#else
+#define MODBUS_UNIT_CFG(slave) MODBUS_SLAVE_CFG(slave)
+#endif
+
+#if MODBUS_FRAME_BUFFER_SIZE
+#define MODBUS_SLAVE_FRAME_SIZE(slave) MODBUS_FRAME_BUFFER_SIZE
+#else
+#define MODBUS_SLAVE_FRAME_SIZE(slave) ((slave)->frame_size)
+#endif
+
 /*==============================
     Public API
 ==============================*/
 int modbus_slave_init(ModbusSlave *slave, const ModbusSlaveConfig *cfg);
+int modbus_slave_set_address(ModbusSlave *slave, uint8_t address);
+#if MODBUS_MAX_UNITS > 1
+int modbus_slave_add_unit(ModbusSlave *slave, const ModbusSlaveConfig *unit);
+#endif
+#if MODBUS_FRAME_BUFFER_SIZE == 0
+int modbus_slave_set_frame_buffer(ModbusSlave *slave, uint8_t *buffer, uint16_t size);
+#endif
 void modbus_slave_rx_byte(ModbusSlave *slave, uint8_t byte);
 void modbus_slave_1_5t_elapsed(ModbusSlave *slave);
 void modbus_slave_3_5t_elapsed(ModbusSlave *slave);
 void modbus_slave_poll(ModbusSlave *slave);
+int modbus_process_pdu(ModbusSlave *slave, uint8_t unit, const uint8_t *request, uint16_t request_len,
+                       uint8_t *response, uint16_t *response_len);
+#if MODBUS_RESPONSE_CACHE_ENTRIES
+void modbus_slave_bump_generation(ModbusSlave *slave);
+#endif
+#if MODBUS_ENABLE_DIRTY_TRACKING
+int32_t modbus_slave_next_dirty(ModbusSlave *slave, uint8_t unit, ModbusDirtyTable table, ModbusDirtyCursor *cursor);
+#endif
 
 #ifdef __cplusplus
 }
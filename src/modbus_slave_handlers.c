@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#if MODBUS_ENABLE_FC_01
+
 // =============================================================================
 // READ COILS (Function Code 0x01)
 // =============================================================================
@@ -10,27 +12,33 @@
 /**
  * Handle Read Coils request
  * Reads multiple coil (discrete output) values
- * Request: [Address][0x01][Start Address Hi][Lo][Quantity Hi][Lo]
- * Response: [Address][0x01][Byte Count][Coil Data...]
+ * Request: [0x01][Start Address Hi][Lo][Quantity Hi][Lo]
+ * Response: [0x01][Byte Count][Coil Data...]
  */
-ModbusExceptionCode handle_read_coils(ModbusSlave *slave, uint8_t *response, uint16_t *response_len) {
-    if (!slave->config.read_coils) return MODBUS_EX_ILLEGAL_FUNCTION;
+ModbusExceptionCode handle_read_coils(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                      uint8_t *response, uint16_t *response_len) {
+    if (!MODBUS_UNIT_CFG(slave).read_coils) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len != 5) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    uint16_t addr = modbus_be16_get(&slave->frame[2]);
-    uint16_t count = modbus_be16_get(&slave->frame[4]);
+    uint16_t addr = modbus_be16_get(&request[1]);
+    uint16_t count = modbus_be16_get(&request[3]);
 
     if (count < 0x0001 || count > 0x07D0) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    ModbusExceptionCode ex = slave->config.read_coils(addr, count, &response[2]);
+    ModbusExceptionCode ex = MODBUS_UNIT_CFG(slave).read_coils(addr, count, &response[2]);
     if (ex != MODBUS_EX_NONE) return ex;
 
-    response[0] = slave->frame[1];
+    response[0] = request[0];
     response[1] = (count + 7) / 8;
     *response_len += 2 + response[1];
 
     return MODBUS_EX_NONE;
 }
 
+#endif /* MODBUS_ENABLE_FC_01 */
+
+#if MODBUS_ENABLE_FC_02
+
 // =============================================================================
 // READ DISCRETE INPUTS (Function Code 0x02)
 // =============================================================================
@@ -38,27 +46,33 @@ ModbusExceptionCode handle_read_coils(ModbusSlave *slave, uint8_t *response, uin
 /**
  * Handle Read Discrete Inputs request
  * Reads multiple discrete input values
- * Request: [Address][0x02][Start Address Hi][Lo][Quantity Hi][Lo]
- * Response: [Address][0x02][Byte Count][Input Data...]
+ * Request: [0x02][Start Address Hi][Lo][Quantity Hi][Lo]
+ * Response: [0x02][Byte Count][Input Data...]
  */
-ModbusExceptionCode handle_read_discrete_inputs(ModbusSlave *slave, uint8_t *response, uint16_t *response_len) {
-    if (!slave->config.read_discrete_inputs) return MODBUS_EX_ILLEGAL_FUNCTION;
+ModbusExceptionCode handle_read_discrete_inputs(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                uint8_t *response, uint16_t *response_len) {
+    if (!MODBUS_UNIT_CFG(slave).read_discrete_inputs) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len != 5) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    uint16_t addr = modbus_be16_get(&slave->frame[2]);
-    uint16_t count = modbus_be16_get(&slave->frame[4]);
+    uint16_t addr = modbus_be16_get(&request[1]);
+    uint16_t count = modbus_be16_get(&request[3]);
 
     if (count < 0x0001 || count > 0x07D0) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    ModbusExceptionCode ex = slave->config.read_discrete_inputs(addr, count, &response[2]);
+    ModbusExceptionCode ex = MODBUS_UNIT_CFG(slave).read_discrete_inputs(addr, count, &response[2]);
     if (ex != MODBUS_EX_NONE) return ex;
 
-    response[0] = slave->frame[1];
+    response[0] = request[0];
     response[1] = (count + 7) / 8;
     *response_len += 2 + response[1];
 
     return MODBUS_EX_NONE;
 }
 
+#endif /* MODBUS_ENABLE_FC_02 */
+
+#if MODBUS_ENABLE_FC_03
+
 // =============================================================================
 // READ HOLDING REGISTERS (Function Code 0x03)
 // =============================================================================
@@ -66,27 +80,33 @@ ModbusExceptionCode handle_read_discrete_inputs(ModbusSlave *slave, uint8_t *res
 /**
  * Handle Read Holding Registers request
  * Reads multiple 16-bit holding register values
- * Request: [Address][0x03][Start Address Hi][Lo][Quantity Hi][Lo]
- * Response: [Address][0x03][Byte Count][Register Data Hi/Lo...]
+ * Request: [0x03][Start Address Hi][Lo][Quantity Hi][Lo]
+ * Response: [0x03][Byte Count][Register Data Hi/Lo...]
  */
-ModbusExceptionCode handle_read_holding_registers(ModbusSlave *slave, uint8_t *response, uint16_t *response_len) {
-    if (!slave->config.read_holding_registers) return MODBUS_EX_ILLEGAL_FUNCTION;
+ModbusExceptionCode handle_read_holding_registers(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                  uint8_t *response, uint16_t *response_len) {
+    if (!MODBUS_UNIT_CFG(slave).read_holding_registers) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len != 5) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    uint16_t addr = modbus_be16_get(&slave->frame[2]);
-    uint16_t count = modbus_be16_get(&slave->frame[4]);
+    uint16_t addr = modbus_be16_get(&request[1]);
+    uint16_t count = modbus_be16_get(&request[3]);
 
     if (count < 0x0001 || count > 0x007D) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    ModbusExceptionCode ex = slave->config.read_holding_registers(addr, count, &response[2]);
+    ModbusExceptionCode ex = MODBUS_UNIT_CFG(slave).read_holding_registers(addr, count, &response[2]);
     if (ex != MODBUS_EX_NONE) return ex;
 
-    response[0] = slave->frame[1];
+    response[0] = request[0];
     response[1] = count * 2;
     *response_len += 2 + response[1];
 
     return MODBUS_EX_NONE;
 }
 
+#endif /* MODBUS_ENABLE_FC_03 */
+
+#if MODBUS_ENABLE_FC_04
+
 // =============================================================================
 // READ INPUT REGISTERS (Function Code 0x04)
 // =============================================================================
@@ -94,27 +114,33 @@ ModbusExceptionCode handle_read_holding_registers(ModbusSlave *slave, uint8_t *r
 /**
  * Handle Read Input Registers request
  * Reads multiple 16-bit input register values
- * Request: [Address][0x04][Start Address Hi][Lo][Quantity Hi][Lo]
- * Response: [Address][0x04][Byte Count][Register Data Hi/Lo...]
+ * Request: [0x04][Start Address Hi][Lo][Quantity Hi][Lo]
+ * Response: [0x04][Byte Count][Register Data Hi/Lo...]
  */
-ModbusExceptionCode handle_read_input_registers(ModbusSlave *slave, uint8_t *response, uint16_t *response_len) {
-    if (!slave->config.read_input_registers) return MODBUS_EX_ILLEGAL_FUNCTION;
+ModbusExceptionCode handle_read_input_registers(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                uint8_t *response, uint16_t *response_len) {
+    if (!MODBUS_UNIT_CFG(slave).read_input_registers) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len != 5) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    uint16_t addr = modbus_be16_get(&slave->frame[2]);
-    uint16_t count = modbus_be16_get(&slave->frame[4]);
+    uint16_t addr = modbus_be16_get(&request[1]);
+    uint16_t count = modbus_be16_get(&request[3]);
 
     if (count < 0x0001 || count > 0x007D) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    ModbusExceptionCode ex = slave->config.read_input_registers(addr, count, &response[2]);
+    ModbusExceptionCode ex = MODBUS_UNIT_CFG(slave).read_input_registers(addr, count, &response[2]);
     if (ex != MODBUS_EX_NONE) return ex;
 
-    response[0] = slave->frame[1];
+    response[0] = request[0];
     response[1] = count * 2;
     *response_len += 2 + response[1];
 
     return MODBUS_EX_NONE;
 }
 
+#endif /* MODBUS_ENABLE_FC_04 */
+
+#if MODBUS_ENABLE_FC_05
+
 // =============================================================================
 // WRITE SINGLE COIL (Function Code 0x05)
 // =============================================================================
@@ -122,27 +148,33 @@ ModbusExceptionCode handle_read_input_registers(ModbusSlave *slave, uint8_t *res
 /**
  * Handle Write Single Coil request
  * Writes one coil (discrete output) value
- * Request: [Address][0x05][Coil Address Hi][Lo][Value Hi][Lo]
+ * Request: [0x05][Coil Address Hi][Lo][Value Hi][Lo]
  * Response: Echo of request
  */
-ModbusExceptionCode handle_write_single_coil(ModbusSlave *slave, uint8_t *response, uint16_t *response_len) {
-    if (!slave->config.write_single_coil) return MODBUS_EX_ILLEGAL_FUNCTION;
+ModbusExceptionCode handle_write_single_coil(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                             uint8_t *response, uint16_t *response_len) {
+    if (!MODBUS_UNIT_CFG(slave).write_single_coil) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len != 5) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    uint16_t addr = modbus_be16_get(&slave->frame[2]);
-    uint16_t value = modbus_be16_get(&slave->frame[4]);
+    uint16_t addr = modbus_be16_get(&request[1]);
+    uint16_t value = modbus_be16_get(&request[3]);
 
     // Validate coil value (should be 0x0000 or 0xFF00 per Modbus spec)
     if (value != 0x0000 && value != 0xFF00) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    ModbusExceptionCode ex = slave->config.write_single_coil(addr, (value == 0xFF00) ? 1 : 0);
+    ModbusExceptionCode ex = MODBUS_UNIT_CFG(slave).write_single_coil(addr, (value == 0xFF00) ? 1 : 0);
     if (ex != MODBUS_EX_NONE) return ex;
 
-    memcpy(response, slave->frame + 1, 5);
+    memcpy(response, request, 5);
     *response_len += 5;
 
     return MODBUS_EX_NONE;
 }
 
+#endif /* MODBUS_ENABLE_FC_05 */
+
+#if MODBUS_ENABLE_FC_06
+
 // =============================================================================
 // WRITE SINGLE REGISTER (Function Code 0x06)
 // =============================================================================
@@ -150,24 +182,30 @@ ModbusExceptionCode handle_write_single_coil(ModbusSlave *slave, uint8_t *respon
 /**
  * Handle Write Single Register request
  * Writes one 16-bit holding register
- * Request: [Address][0x06][Register Address Hi][Lo][Value Hi][Lo]
+ * Request: [0x06][Register Address Hi][Lo][Value Hi][Lo]
  * Response: Echo of request
  */
-ModbusExceptionCode handle_write_single_register(ModbusSlave *slave, uint8_t *response, uint16_t *response_len) {
-    if (!slave->config.write_single_register) return MODBUS_EX_ILLEGAL_FUNCTION;
+ModbusExceptionCode handle_write_single_register(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                 uint8_t *response, uint16_t *response_len) {
+    if (!MODBUS_UNIT_CFG(slave).write_single_register) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len != 5) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    uint16_t addr = modbus_be16_get(&slave->frame[2]);
-    uint16_t value = modbus_be16_get(&slave->frame[4]);
+    uint16_t addr = modbus_be16_get(&request[1]);
+    uint16_t value = modbus_be16_get(&request[3]);
 
-    ModbusExceptionCode ex = slave->config.write_single_register(addr, value);
+    ModbusExceptionCode ex = MODBUS_UNIT_CFG(slave).write_single_register(addr, value);
     if (ex != MODBUS_EX_NONE) return ex;
 
-    for (int i = 0; i < 4; ++i) response[i] = slave->frame[1 + i];
+    for (int i = 0; i < 4; ++i) response[i] = request[i];
     *response_len += 4;
 
     return MODBUS_EX_NONE;
 }
 
+#endif /* MODBUS_ENABLE_FC_06 */
+
+#if MODBUS_ENABLE_FC_0F
+
 // =============================================================================
 // WRITE MULTIPLE COILS (Function Code 0x0F)
 // =============================================================================
@@ -175,28 +213,70 @@ ModbusExceptionCode handle_write_single_register(ModbusSlave *slave, uint8_t *re
 /**
  * Handle Write Multiple Coils request
  * Writes multiple coil (discrete output) values
- * Request: [Address][0x0F][Start Address Hi][Lo][Quantity Hi][Lo][Byte Count][Coil Data...]
- * Response: [Address][0x0F][Start Address Hi][Lo][Quantity Hi][Lo]
+ * Request: [0x0F][Start Address Hi][Lo][Quantity Hi][Lo][Byte Count][Coil Data...]
+ * Response: [0x0F][Start Address Hi][Lo][Quantity Hi][Lo]
  */
-ModbusExceptionCode handle_write_multiple_coils(ModbusSlave *slave, uint8_t *response, uint16_t *response_len) {
-    if (!slave->config.write_multiple_coils) return MODBUS_EX_ILLEGAL_FUNCTION;
+ModbusExceptionCode handle_write_multiple_coils(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                uint8_t *response, uint16_t *response_len) {
+    if (!MODBUS_UNIT_CFG(slave).write_multiple_coils) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len < 6 || request[5] != request_len - 6) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    uint16_t addr = modbus_be16_get(&slave->frame[2]);
-    uint16_t count = modbus_be16_get(&slave->frame[4]);
-    uint8_t byte_count = slave->frame[6];
+    uint16_t addr = modbus_be16_get(&request[1]);
+    uint16_t count = modbus_be16_get(&request[3]);
+    uint8_t byte_count = request[5];
 
     if (count < 0x0001 || count > 0x07B0) return MODBUS_EX_ILLEGAL_DATA_VALUE;
     if (byte_count != (count + 7) / 8) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    ModbusExceptionCode ex = slave->config.write_multiple_coils(addr, count, &slave->frame[7]);
+    ModbusExceptionCode ex = MODBUS_UNIT_CFG(slave).write_multiple_coils(addr, count, &request[6]);
     if (ex != MODBUS_EX_NONE) return ex;
 
-    memcpy(response, slave->frame + 1, 5);
+    memcpy(response, request, 5);
 	*response_len += 5;
 
     return MODBUS_EX_NONE;
 }
 
+#endif /* MODBUS_ENABLE_FC_0F */
+
+#if MODBUS_STAGED_WRITES
+
+// =============================================================================
+// STAGED WRITES
+// =============================================================================
+
+/**
+ * Validate the registers of a write request and stage them for commit
+ * The values are applied by modbus_slave.c after the whole request succeeded.
+ * @param slave Slave instance
+ * @param addr  First register
+ * @param count Number of registers
+ * @param src   Big-endian values inside the request PDU
+ * @return MODBUS_EX_NONE if staged, the validation exception otherwise
+ */
+static ModbusExceptionCode modbus_stage_registers(ModbusSlave *slave, uint16_t addr, uint16_t count, const uint8_t *src) {
+    if (!MODBUS_UNIT_CFG(slave).write_multiple_registers) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if ((uint32_t)addr + count > 0x10000u) return MODBUS_EX_ILLEGAL_DATA_ADDRESS;
+
+    ModbusValidateRegisterCb validate = MODBUS_UNIT_CFG(slave).validate_register;
+    if (validate) {
+        for (uint16_t i = 0; i < count; ++i) {
+            ModbusExceptionCode ex = validate(addr + i, modbus_be16_get(&src[i * 2]));
+            if (ex != MODBUS_EX_NONE) return ex;
+        }
+    }
+
+    slave->staged.addr = addr;
+    slave->staged.count = count;
+    slave->staged.data = src;
+
+    return MODBUS_EX_NONE;
+}
+
+#endif /* MODBUS_STAGED_WRITES */
+
+#if MODBUS_ENABLE_FC_10
+
 // =============================================================================
 // WRITE MULTIPLE REGISTERS (Function Code 0x10)
 // =============================================================================
@@ -204,28 +284,141 @@ ModbusExceptionCode handle_write_multiple_coils(ModbusSlave *slave, uint8_t *res
 /**
  * Handle Write Multiple Registers request
  * Writes multiple 16-bit holding registers
- * Request: [Address][0x10][Start Address Hi][Lo][Quantity Hi][Lo][Byte Count][Data...]
- * Response: [Address][0x10][Start Address Hi][Lo][Quantity Hi][Lo]
+ * Request: [0x10][Start Address Hi][Lo][Quantity Hi][Lo][Byte Count][Data...]
+ * Response: [0x10][Start Address Hi][Lo][Quantity Hi][Lo]
  */
-ModbusExceptionCode handle_write_multiple_registers(ModbusSlave *slave, uint8_t *response, uint16_t *response_len) {
-    if (!slave->config.write_multiple_registers) return MODBUS_EX_ILLEGAL_FUNCTION;
+ModbusExceptionCode handle_write_multiple_registers(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                    uint8_t *response, uint16_t *response_len) {
+    if (!MODBUS_UNIT_CFG(slave).write_multiple_registers) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len < 6 || request[5] != request_len - 6) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    uint16_t addr = modbus_be16_get(&slave->frame[2]);
-    uint16_t count = modbus_be16_get(&slave->frame[4]);
-    uint8_t byte_count = slave->frame[6];
+    uint16_t addr = modbus_be16_get(&request[1]);
+    uint16_t count = modbus_be16_get(&request[3]);
+    uint8_t byte_count = request[5];
 
     if (count < 0x0001 || count > 0x007B) return MODBUS_EX_ILLEGAL_DATA_VALUE;
     if (byte_count != count * 2) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    ModbusExceptionCode ex = slave->config.write_multiple_registers(addr, count, &slave->frame[7]);
+    ModbusExceptionCode ex;
+#if MODBUS_STAGED_WRITES
+    if (MODBUS_UNIT_CFG(slave).staged_writes) {
+        ex = modbus_stage_registers(slave, addr, count, &request[6]);
+    } else
+#endif
+    {
+        ex = MODBUS_UNIT_CFG(slave).write_multiple_registers(addr, count, &request[6]);
+    }
     if (ex != MODBUS_EX_NONE) return ex;
 
-    for (int i = 0; i < 4; ++i) response[i] = slave->frame[1 + i];
+    for (int i = 0; i < 4; ++i) response[i] = request[i];
     *response_len += 4;
 
     return MODBUS_EX_NONE;
 }
 
+#endif /* MODBUS_ENABLE_FC_10 */
+
+#if MODBUS_ENABLE_FC_07
+
+// =============================================================================
+// READ EXCEPTION STATUS (Function Code 0x07)
+// =============================================================================
+
+/**
+ * Handle Read Exception Status request
+ * Reads the eight exception status outputs of the device
+ * Request: [0x07]
+ * Response: [0x07][Output Data]
+ */
+ModbusExceptionCode handle_read_exception_status(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                 uint8_t *response, uint16_t *response_len) {
+    if (!MODBUS_UNIT_CFG(slave).read_exception_status) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len != 1) return MODBUS_EX_ILLEGAL_DATA_VALUE;
+
+    uint8_t status = 0;
+
+    ModbusExceptionCode ex = MODBUS_UNIT_CFG(slave).read_exception_status(&status);
+    if (ex != MODBUS_EX_NONE) return ex;
+
+    response[0] = request[0];
+    response[1] = status;
+    *response_len += 2;
+
+    return MODBUS_EX_NONE;
+}
+
+#endif /* MODBUS_ENABLE_FC_07 */
+
+#if MODBUS_ENABLE_FC_08
+
+// =============================================================================
+// DIAGNOSTICS (Function Code 0x08)
+// =============================================================================
+
+/**
+ * Handle Diagnostics request
+ * Echoes query data or reports/clears the serial line counters
+ * Request: [0x08][Sub-function Hi][Lo][Data...]
+ * Response: [0x08][Sub-function Hi][Lo][Data...]
+ */
+ModbusExceptionCode handle_diagnostics(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                       uint8_t *response, uint16_t *response_len) {
+    if (request_len < 5) return MODBUS_EX_ILLEGAL_DATA_VALUE;
+
+    uint16_t sub_function = modbus_be16_get(&request[1]);
+    uint16_t data = modbus_be16_get(&request[3]);
+    ModbusCounters *counters = &slave->counters;
+    uint16_t value = 0;
+
+    // Loopback of the whole request, data field included
+    if (sub_function == MODBUS_DIAG_RETURN_QUERY_DATA) {
+        memcpy(response, request, request_len);
+        *response_len += request_len;
+        return MODBUS_EX_NONE;
+    }
+
+    if (data != 0x0000) return MODBUS_EX_ILLEGAL_DATA_VALUE;
+
+    switch (sub_function) {
+        case MODBUS_DIAG_CLEAR_COUNTERS:
+            memset(counters, 0, sizeof(*counters));
+            break;
+        case MODBUS_DIAG_BUS_MESSAGE_COUNT:
+            value = counters->bus_message;
+            break;
+        case MODBUS_DIAG_BUS_COMM_ERROR_COUNT:
+            value = counters->bus_comm_error;
+            break;
+        case MODBUS_DIAG_BUS_EXCEPTION_COUNT:
+            value = counters->bus_exception;
+            break;
+        case MODBUS_DIAG_SLAVE_MESSAGE_COUNT:
+            value = counters->slave_message;
+            break;
+        case MODBUS_DIAG_SLAVE_NO_RESPONSE_COUNT:
+            value = counters->slave_no_response;
+            break;
+        case MODBUS_DIAG_BUS_CHAR_OVERRUN_COUNT:
+            value = counters->bus_char_overrun;
+            break;
+        case MODBUS_DIAG_CLEAR_OVERRUN_COUNTER:
+            counters->bus_char_overrun = 0;
+            break;
+        default:
+            return MODBUS_EX_ILLEGAL_FUNCTION;
+    }
+
+    memcpy(response, request, 3);
+    modbus_be16_set(&response[3], value);
+    *response_len += 5;
+
+    return MODBUS_EX_NONE;
+}
+
+#endif /* MODBUS_ENABLE_FC_08 */
+
+#if MODBUS_ENABLE_FC_16
+
 // =============================================================================
 // MASK WRITE REGISTER (Function Code 0x16)
 // =============================================================================
@@ -233,58 +426,237 @@ ModbusExceptionCode handle_write_multiple_registers(ModbusSlave *slave, uint8_t
 /**
  * Handle Mask Write Register request
  * Modifies specific bits in a holding register using AND/OR masks
- * Request: [Address][0x16][Register Address Hi][Lo][AND Mask Hi][Lo][OR Mask Hi][Lo]
+ * Request: [0x16][Register Address Hi][Lo][AND Mask Hi][Lo][OR Mask Hi][Lo]
  * Response: Echo of request
  */
-ModbusExceptionCode handle_mask_write_register(ModbusSlave *slave, uint8_t *response, uint16_t *response_len) {
-    if (!slave->config.mask_write_register) return MODBUS_EX_ILLEGAL_FUNCTION;
+ModbusExceptionCode handle_mask_write_register(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                               uint8_t *response, uint16_t *response_len) {
+    if (!MODBUS_UNIT_CFG(slave).mask_write_register) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len != 7) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    uint16_t addr = modbus_be16_get(&slave->frame[2]);
-    uint16_t and_mask = modbus_be16_get(&slave->frame[4]);
-    uint16_t or_mask = modbus_be16_get(&slave->frame[6]);
+    uint16_t addr = modbus_be16_get(&request[1]);
+    uint16_t and_mask = modbus_be16_get(&request[3]);
+    uint16_t or_mask = modbus_be16_get(&request[5]);
 
-    ModbusExceptionCode ex = slave->config.mask_write_register(addr, and_mask, or_mask);
+    ModbusExceptionCode ex = MODBUS_UNIT_CFG(slave).mask_write_register(addr, and_mask, or_mask);
     if (ex != MODBUS_EX_NONE) return ex;
 
-    for (int i = 0; i < 6; ++i) response[i] = slave->frame[1 + i];
+    for (int i = 0; i < 6; ++i) response[i] = request[i];
     *response_len += 6;
 
     return MODBUS_EX_NONE;
 }
 
+#endif /* MODBUS_ENABLE_FC_16 */
+
+#if MODBUS_ENABLE_FC_17
+
 // =============================================================================
 // READ/WRITE MULTIPLE REGISTERS (Function Code 0x17)
 // =============================================================================
 
+#if MODBUS_STAGED_WRITES && MODBUS_ENABLE_FC_03
+/**
+ * Staged variant of Read/Write Multiple Registers
+ * The write is validated and staged, the read goes through
+ * read_holding_registers with the staged values overlaid, so the response
+ * reflects the write as if it had been performed first.
+ */
+static ModbusExceptionCode modbus_read_write_staged(ModbusSlave *slave, uint16_t read_addr, uint16_t read_count,
+                                                    uint16_t write_addr, uint16_t write_count,
+                                                    const uint8_t *write_data, uint8_t *read_data) {
+    if (!MODBUS_UNIT_CFG(slave).read_holding_registers) return MODBUS_EX_ILLEGAL_FUNCTION;
+
+    ModbusExceptionCode ex = modbus_stage_registers(slave, write_addr, write_count, write_data);
+    if (ex != MODBUS_EX_NONE) return ex;
+
+    ex = MODBUS_UNIT_CFG(slave).read_holding_registers(read_addr, read_count, read_data);
+    if (ex != MODBUS_EX_NONE) return ex;
+
+    uint32_t first = read_addr > write_addr ? read_addr : write_addr;
+    uint32_t read_end = (uint32_t)read_addr + read_count;
+    uint32_t write_end = (uint32_t)write_addr + write_count;
+    uint32_t end = read_end < write_end ? read_end : write_end;
+
+    if (first < end) {
+        memcpy(&read_data[(first - read_addr) * 2], &slave->staged.data[(first - write_addr) * 2], (end - first) * 2);
+    }
+
+    return MODBUS_EX_NONE;
+}
+#endif
+
 /**
  * Handle Read/Write Multiple Registers request
  * Performs a write operation followed by a read operation in a single request
- * Request: [Address][0x17][Read Address Hi][Lo][Read Quantity Hi][Lo]
+ * Request: [0x17][Read Address Hi][Lo][Read Quantity Hi][Lo]
  *          [Write Address Hi][Lo][Write Quantity Hi][Lo][Write Byte Count][Write Data...]
- * Response: [Address][0x17][Byte Count][Read Register Data Hi/Lo...]
+ * Response: [0x17][Byte Count][Read Register Data Hi/Lo...]
  */
-ModbusExceptionCode handle_read_write_multiple_registers(ModbusSlave *slave, uint8_t *response, uint16_t *response_len) {
-    if (!slave->config.read_write_multiple_registers) return MODBUS_EX_ILLEGAL_FUNCTION;
-
-    uint16_t read_addr = modbus_be16_get(&slave->frame[2]);
-    uint16_t read_count = modbus_be16_get(&slave->frame[4]);
-    uint16_t write_addr = modbus_be16_get(&slave->frame[6]);
-    uint16_t write_count = modbus_be16_get(&slave->frame[8]);
-    uint8_t write_byte_count = slave->frame[10];
+ModbusExceptionCode handle_read_write_multiple_registers(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                         uint8_t *response, uint16_t *response_len) {
+#if MODBUS_STAGED_WRITES && MODBUS_ENABLE_FC_03
+    bool staged = MODBUS_UNIT_CFG(slave).staged_writes;
+#else
+    bool staged = false;
+#endif
+    if (!staged && !MODBUS_UNIT_CFG(slave).read_write_multiple_registers) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len < 10 || request[9] != request_len - 10) return MODBUS_EX_ILLEGAL_DATA_VALUE;
+
+    uint16_t read_addr = modbus_be16_get(&request[1]);
+    uint16_t read_count = modbus_be16_get(&request[3]);
+    uint16_t write_addr = modbus_be16_get(&request[5]);
+    uint16_t write_count = modbus_be16_get(&request[7]);
+    uint8_t write_byte_count = request[9];
 
     if (read_count < 0x0001 || read_count > 0x007D) return MODBUS_EX_ILLEGAL_DATA_VALUE;
     if (write_count < 0x0001 || write_count > 0x0079) return MODBUS_EX_ILLEGAL_DATA_VALUE;
     if (write_byte_count != write_count * 2) return MODBUS_EX_ILLEGAL_DATA_VALUE;
 
-    ModbusExceptionCode ex = slave->config.read_write_multiple_registers(
-        read_addr, read_count, write_addr, write_count, 
-        &slave->frame[11], &response[2]
-    );
+    ModbusExceptionCode ex;
+#if MODBUS_STAGED_WRITES && MODBUS_ENABLE_FC_03
+    if (staged) {
+        ex = modbus_read_write_staged(slave, read_addr, read_count, write_addr, write_count,
+                                      &request[10], &response[2]);
+    } else
+#endif
+    {
+        ex = MODBUS_UNIT_CFG(slave).read_write_multiple_registers(
+            read_addr, read_count, write_addr, write_count, 
+            &request[10], &response[2]
+        );
+    }
     if (ex != MODBUS_EX_NONE) return ex;
 
-    response[0] = slave->frame[1];
+    response[0] = request[0];
     response[1] = read_count * 2;
     *response_len += 2 + response[1];
 
     return MODBUS_EX_NONE;
 }
+
+#endif /* MODBUS_ENABLE_FC_17 */
+
+#if MODBUS_ENABLE_FC_2B
+
+// =============================================================================
+// READ DEVICE IDENTIFICATION (Function Code 0x2B / MEI Type 0x0E)
+// =============================================================================
+
+#define MODBUS_DEVICE_ID_HEADER_LENGTH 7
+#define MODBUS_DEVICE_ID_MAX_OBJECT_LENGTH (MODBUS_MAX_PDU_LENGTH - MODBUS_DEVICE_ID_HEADER_LENGTH - 2)
+
+/**
+ * Check the device identification objects of a configuration
+ * Objects must be sorted by id, contain the mandatory basic objects
+ * 0x00-0x02 and fit into a single response each. No objects at all
+ * is valid and disables the function.
+ * @param cfg Configuration to check
+ * @return 0 if valid, -1 if invalid
+ */
+int modbus_device_id_validate(const ModbusSlaveConfig *cfg) {
+    const ModbusDeviceIdObject *objects = cfg->device_id_objects;
+    uint8_t count = cfg->device_id_object_count;
+
+    if (count == 0) return 0;
+    if (!objects || count < 3) return -1;
+
+    for (uint8_t i = 0; i < count; ++i) {
+        if (i < 3 && objects[i].id != i) return -1; // Mandatory basic objects
+        if (i > 0 && objects[i].id <= objects[i - 1].id) return -1;
+        if (objects[i].length > MODBUS_DEVICE_ID_MAX_OBJECT_LENGTH) return -1;
+        if (objects[i].length && !objects[i].value) return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Build a Read Device Identification response PDU
+ * Streams as many objects of the requested category as fit into one PDU,
+ * starting at object_id (or at object 0 if it is unknown), or returns the
+ * single object asked for by individual access.
+ * @param cfg          Configuration holding the objects
+ * @param code         Read device id code (ModbusDeviceIdCode)
+ * @param object_id    First object to return
+ * @param response     Response PDU buffer (MODBUS_MAX_PDU_LENGTH bytes)
+ * @param response_len Incremented by the PDU length
+ * @return Exception code
+ */
+ModbusExceptionCode modbus_device_id_build(const ModbusSlaveConfig *cfg, uint8_t code, uint8_t object_id,
+                                           uint8_t *response, uint16_t *response_len) {
+    const ModbusDeviceIdObject *objects = cfg->device_id_objects;
+    uint8_t count = cfg->device_id_object_count;
+
+    if (count == 0) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (code < MODBUS_DEVICE_ID_BASIC || code > MODBUS_DEVICE_ID_INDIVIDUAL) return MODBUS_EX_ILLEGAL_DATA_VALUE;
+
+    // Conformity level follows the highest category present, individual access is always supported
+    uint8_t last_id = objects[count - 1].id;
+    uint8_t conformity = 0x80 | (last_id >= 0x80 ? MODBUS_DEVICE_ID_EXTENDED
+                               : last_id >= 0x03 ? MODBUS_DEVICE_ID_REGULAR
+                               : MODBUS_DEVICE_ID_BASIC);
+
+    uint8_t first = 0;
+    while (first < count && objects[first].id != object_id) ++first;
+
+    uint8_t last = count;
+    if (code == MODBUS_DEVICE_ID_INDIVIDUAL) {
+        if (first == count) return MODBUS_EX_ILLEGAL_DATA_ADDRESS;
+        last = first + 1;
+    } else {
+        uint8_t max_id = code == MODBUS_DEVICE_ID_BASIC ? 0x02
+                       : code == MODBUS_DEVICE_ID_REGULAR ? 0x7F
+                       : 0xFF;
+        if (first == count || object_id > max_id) first = 0; // Restart the stream at object 0
+        while (last > first && objects[last - 1].id > max_id) --last;
+    }
+
+    uint16_t length = MODBUS_DEVICE_ID_HEADER_LENGTH;
+    uint8_t more_follows = 0x00;
+    uint8_t next_object_id = 0x00;
+    uint8_t object_count = 0;
+
+    for (uint8_t i = first; i < last; ++i) {
+        if (length + 2 + objects[i].length > MODBUS_MAX_PDU_LENGTH) {
+            more_follows = 0xFF;
+            next_object_id = objects[i].id;
+            break;
+        }
+
+        response[length] = objects[i].id;
+        response[length + 1] = objects[i].length;
+        memcpy(&response[length + 2], objects[i].value, objects[i].length);
+        length += 2 + objects[i].length;
+        ++object_count;
+    }
+
+    response[0] = MODBUS_FC_ENCAPSULATED_INTERFACE;
+    response[1] = MODBUS_MEI_READ_DEVICE_ID;
+    response[2] = code;
+    response[3] = conformity;
+    response[4] = more_follows;
+    response[5] = next_object_id;
+    response[6] = object_count;
+    *response_len += length;
+
+    return MODBUS_EX_NONE;
+}
+
+/**
+ * Handle Read Device Identification request
+ * Reads the identification objects declared in the configuration
+ * Request: [0x2B][0x0E][Read Device ID Code][Object Id]
+ * Response: [0x2B][0x0E][Read Device ID Code][Conformity Level][More Follows]
+ *           [Next Object Id][Number Of Objects][Object Id][Object Length][Object Value]...
+ */
+ModbusExceptionCode handle_read_device_identification(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                      uint8_t *response, uint16_t *response_len) {
+    if (request_len < 2 || request[1] != MODBUS_MEI_READ_DEVICE_ID) return MODBUS_EX_ILLEGAL_FUNCTION;
+    if (request_len != 4) return MODBUS_EX_ILLEGAL_DATA_VALUE;
+
+    return modbus_device_id_build(&MODBUS_UNIT_CFG(slave), request[2], request[3],
+                                  response, response_len);
+}
+
+#endif /* MODBUS_ENABLE_FC_2B */
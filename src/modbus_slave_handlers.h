@@ -5,18 +5,70 @@
 
 #include <stdint.h>
 
-ModbusExceptionCode handle_read_coils(ModbusSlave *slave, uint8_t *response, uint16_t *response_len);
-ModbusExceptionCode handle_read_discrete_inputs(ModbusSlave *slave, uint8_t *response, uint16_t *response_len);
-ModbusExceptionCode handle_read_holding_registers(ModbusSlave *slave, uint8_t *response, uint16_t *response_len);
-ModbusExceptionCode handle_read_input_registers(ModbusSlave *slave, uint8_t *response, uint16_t *response_len);
+/*
+ * Function code handlers. Each one takes the request PDU (function code
+ * first, no address or CRC), appends its response PDU to response and
+ * returns MODBUS_EX_NONE, or returns the exception to report.
+ */
 
-ModbusExceptionCode handle_write_single_coil(ModbusSlave *slave, uint8_t *response, uint16_t *response_len);
-ModbusExceptionCode handle_write_single_register(ModbusSlave *slave, uint8_t *response, uint16_t *response_len);
-ModbusExceptionCode handle_write_multiple_coils(ModbusSlave *slave, uint8_t *response, uint16_t *response_len);
-ModbusExceptionCode handle_write_multiple_registers(ModbusSlave *slave, uint8_t *response, uint16_t *response_len);
+#if MODBUS_ENABLE_FC_01
+ModbusExceptionCode handle_read_coils(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                      uint8_t *response, uint16_t *response_len);
+#endif
+#if MODBUS_ENABLE_FC_02
+ModbusExceptionCode handle_read_discrete_inputs(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                uint8_t *response, uint16_t *response_len);
+#endif
+#if MODBUS_ENABLE_FC_03
+ModbusExceptionCode handle_read_holding_registers(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                  uint8_t *response, uint16_t *response_len);
+#endif
+#if MODBUS_ENABLE_FC_04
+ModbusExceptionCode handle_read_input_registers(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                uint8_t *response, uint16_t *response_len);
+#endif
 
-ModbusExceptionCode handle_mask_write_register(ModbusSlave *slave, uint8_t *response, uint16_t *response_len);
-ModbusExceptionCode handle_read_write_multiple_registers(ModbusSlave *slave, uint8_t *response, uint16_t *response_len);
+#if MODBUS_ENABLE_FC_05
+ModbusExceptionCode handle_write_single_coil(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                             uint8_t *response, uint16_t *response_len);
+#endif
+#if MODBUS_ENABLE_FC_06
+ModbusExceptionCode handle_write_single_register(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                 uint8_t *response, uint16_t *response_len);
+#endif
+#if MODBUS_ENABLE_FC_0F
+ModbusExceptionCode handle_write_multiple_coils(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                uint8_t *response, uint16_t *response_len);
+#endif
+#if MODBUS_ENABLE_FC_10
+ModbusExceptionCode handle_write_multiple_registers(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                    uint8_t *response, uint16_t *response_len);
+#endif
 
+#if MODBUS_ENABLE_FC_07
+ModbusExceptionCode handle_read_exception_status(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                 uint8_t *response, uint16_t *response_len);
+#endif
+#if MODBUS_ENABLE_FC_08
+ModbusExceptionCode handle_diagnostics(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                       uint8_t *response, uint16_t *response_len);
+#endif
+
+#if MODBUS_ENABLE_FC_16
+ModbusExceptionCode handle_mask_write_register(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                               uint8_t *response, uint16_t *response_len);
+#endif
+#if MODBUS_ENABLE_FC_17
+ModbusExceptionCode handle_read_write_multiple_registers(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                         uint8_t *response, uint16_t *response_len);
+#endif
+
+#if MODBUS_ENABLE_FC_2B
+ModbusExceptionCode handle_read_device_identification(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                                                      uint8_t *response, uint16_t *response_len);
+ModbusExceptionCode modbus_device_id_build(const ModbusSlaveConfig *cfg, uint8_t code, uint8_t object_id,
+                                           uint8_t *response, uint16_t *response_len);
+int modbus_device_id_validate(const ModbusSlaveConfig *cfg);
+#endif
 
 #endif /* MODBUS_SLAVE_HANDLERS_H */
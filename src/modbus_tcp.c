@@ -0,0 +1,75 @@
+#include "modbus_tcp.h"
+
+// =============================================================================
+// MBAP framing
+// =============================================================================
+
+/**
+ * Determine the length of the ADU at the start of a stream buffer
+ *
+ * The MBAP length field counts the unit identifier and the PDU, so a
+ * complete ADU is 6 + length bytes long.
+ * @param data   Received bytes, ADU boundary first
+ * @param length Number of received bytes
+ * @return Total ADU length, 0 if more bytes are needed to tell,
+ *         -1 if the header is malformed and the stream must be dropped
+ */
+int32_t modbus_tcp_adu_length(const uint8_t *data, size_t length) {
+    if (length < MODBUS_MBAP_HEADER_LENGTH) return 0;
+
+    if (modbus_be16_get(&data[2]) != 0) return -1; // Protocol identifier, 0 = Modbus
+
+    uint16_t mbap_length = modbus_be16_get(&data[4]);
+    if (mbap_length < 2 || mbap_length > MODBUS_MAX_PDU_LENGTH + 1) return -1; // Unit id + PDU
+
+    return (int32_t)mbap_length + 6;
+}
+
+// =============================================================================
+// Request processing
+// =============================================================================
+
+/**
+ * Process one complete Modbus TCP request ADU
+ *
+ * The unit identifier selects the unit of the slave. 0xFF and 0x00 address
+ * the server itself and are mapped to the slave's own address: Modbus TCP
+ * has no broadcast and the client always waits for an answer. A unit the
+ * slave does not serve is answered with GATEWAY PATH UNAVAILABLE.
+ * @param slave        Slave instance
+ * @param request      Request ADU, as sized by modbus_tcp_adu_length()
+ * @param request_len  Request ADU length
+ * @param response     Response ADU buffer, at least MODBUS_TCP_MAX_ADU_LENGTH bytes
+ * @param response_len Set to the response ADU length
+ * @return 0 on success, -1 if the request is not a valid ADU
+ */
+int modbus_tcp_process_adu(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                           uint8_t *response, uint16_t *response_len) {
+    *response_len = 0;
+
+    if (modbus_tcp_adu_length(request, request_len) != (int32_t)request_len) return -1;
+
+    const uint8_t *pdu = &request[MODBUS_MBAP_HEADER_LENGTH];
+    uint16_t pdu_len = (uint16_t)(request_len - MODBUS_MBAP_HEADER_LENGTH);
+    uint8_t unit = request[6];
+    uint16_t len;
+
+    if (unit == MODBUS_TCP_UNIT_ID_SERVER || unit == 0x00) unit = MODBUS_SLAVE_ADDRESS(slave);
+
+    if (modbus_process_pdu(slave, unit, pdu, pdu_len, &response[MODBUS_MBAP_HEADER_LENGTH], &len) != 0) {
+        response[MODBUS_MBAP_HEADER_LENGTH] = pdu[0] | MODBUS_FC_EXCEPTION_MASK;
+        response[MODBUS_MBAP_HEADER_LENGTH + 1] = (uint8_t)MODBUS_EX_GATEWAY_PATH_UNAVAILABLE;
+        len = 2;
+    }
+
+    // Echo transaction id, protocol id and unit id
+    response[0] = request[0];
+    response[1] = request[1];
+    response[2] = 0x00;
+    response[3] = 0x00;
+    modbus_be16_set(&response[4], (uint16_t)(len + 1));
+    response[6] = request[6];
+
+    *response_len = (uint16_t)(len + MODBUS_MBAP_HEADER_LENGTH);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef MODBUS_TCP_H
+#define MODBUS_TCP_H
+
+#include "modbus_slave.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==============================
+    MBAP header
+==============================*/
+#define MODBUS_TCP_PORT              502
+#define MODBUS_MBAP_HEADER_LENGTH    7   /* Transaction id, protocol id, length, unit id */
+#define MODBUS_TCP_MAX_ADU_LENGTH    (MODBUS_MBAP_HEADER_LENGTH + MODBUS_MAX_PDU_LENGTH)
+
+/*
+ * Unit identifier of a Modbus TCP request addressed to the server itself
+ * rather than to a device behind it
+ */
+#define MODBUS_TCP_UNIT_ID_SERVER    0xFF
+
+/*==============================
+    Public API
+==============================*/
+int32_t modbus_tcp_adu_length(const uint8_t *data, size_t length);
+int modbus_tcp_process_adu(ModbusSlave *slave, const uint8_t *request, uint16_t request_len,
+                           uint8_t *response, uint16_t *response_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_TCP_H */
@@ -0,0 +1,190 @@
+#include "modbus_timer_wheel.h"
+
+#include <string.h>
+
+#define WHEEL_MASK      (MODBUS_TIMER_WHEEL_SLOTS - 1u)
+#define WHEEL_SPAN(lvl) ((uint64_t)1 << ((lvl) * MODBUS_TIMER_WHEEL_BITS))
+
+/* Furthest expiry a timer is placed by, relative to the current tick */
+#define WHEEL_RANGE     (WHEEL_SPAN(MODBUS_TIMER_WHEEL_LEVELS) - 1u)
+
+// =============================================================================
+// Slots
+// =============================================================================
+
+/**
+ * Link a timer into the slot its expiry falls into, as seen from the
+ * current tick
+ *
+ * A timer that is already due goes to the slot of the current tick.
+ */
+static void wheel_place(ModbusTimerWheel *wheel, ModbusTimer *timer) {
+    uint64_t expires = timer->expires;
+    uint64_t delta = expires > wheel->now ? expires - wheel->now : 0;
+    unsigned level = 0;
+
+    if (delta == 0) expires = wheel->now;
+    if (delta > WHEEL_RANGE) expires = wheel->now + WHEEL_RANGE;
+    while (level < MODBUS_TIMER_WHEEL_LEVELS - 1 && delta >= WHEEL_SPAN(level + 1)) {
+        level++;
+    }
+
+    unsigned slot = (unsigned)(expires >> (level * MODBUS_TIMER_WHEEL_BITS)) & WHEEL_MASK;
+    ModbusTimer **head = &wheel->slots[level][slot];
+
+    timer->level = (uint8_t)level;
+    timer->slot = (uint8_t)slot;
+    timer->next = *head;
+    timer->pprev = head;
+    if (*head) (*head)->pprev = &timer->next;
+    *head = timer;
+    wheel->occupied[level] |= (uint64_t)1 << slot;
+}
+
+/**
+ * Unlink a pending timer
+ */
+static void wheel_unlink(ModbusTimerWheel *wheel, ModbusTimer *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+
+    if (!wheel->slots[timer->level][timer->slot]) {
+        wheel->occupied[timer->level] &= ~((uint64_t)1 << timer->slot);
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/**
+ * Move the timers of the higher level slots that the current tick enters
+ * one or more levels down
+ */
+static void wheel_cascade(ModbusTimerWheel *wheel) {
+    for (unsigned level = MODBUS_TIMER_WHEEL_LEVELS - 1; level > 0; --level) {
+        if (wheel->now & (WHEEL_SPAN(level) - 1u)) continue;
+
+        unsigned slot = (unsigned)(wheel->now >> (level * MODBUS_TIMER_WHEEL_BITS)) & WHEEL_MASK;
+        ModbusTimer *timer = wheel->slots[level][slot];
+
+        wheel->slots[level][slot] = NULL;
+        wheel->occupied[level] &= ~((uint64_t)1 << slot);
+        while (timer) {
+            ModbusTimer *next = timer->next;
+            wheel_place(wheel, timer);
+            timer = next;
+        }
+    }
+}
+
+/**
+ * Index of the lowest set bit of a non-zero word
+ */
+static unsigned wheel_lowest_bit(uint64_t bits) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(bits);
+#else
+    unsigned index = 0;
+    while (!(bits & 1u)) {
+        bits >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+/**
+ * Get the first tick after the current one that can expire a timer or
+ * cascade one, UINT64_MAX if no timer is pending
+ */
+static uint64_t wheel_next_tick(const ModbusTimerWheel *wheel) {
+    if (wheel->count == 0) return UINT64_MAX;
+
+    unsigned index = (unsigned)wheel->now & WHEEL_MASK;
+    uint64_t later = index == WHEEL_MASK ? 0 : wheel->occupied[0] & (~(uint64_t)0 << (index + 1));
+    if (later) return wheel->now - index + wheel_lowest_bit(later);
+
+    return (wheel->now | WHEEL_MASK) + 1; // Level 0 wraps, the levels above may cascade
+}
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+/**
+ * Initialize an empty wheel
+ * @param wheel Wheel instance
+ * @param now   Current tick
+ */
+void modbus_timer_wheel_init(ModbusTimerWheel *wheel, uint64_t now) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+/**
+ * Start a timer, or move it if it is already pending - O(1)
+ * @param wheel   Wheel instance
+ * @param timer   Timer, initialized with modbus_timer_init() before first use
+ * @param expires Tick the timer expires at; a tick already passed expires
+ *                it at the next modbus_timer_wheel_expire()
+ */
+void modbus_timer_wheel_add(ModbusTimerWheel *wheel, ModbusTimer *timer, uint64_t expires) {
+    if (modbus_timer_pending(timer)) {
+        wheel_unlink(wheel, timer);
+    } else {
+        wheel->count++;
+    }
+
+    timer->expires = expires;
+    wheel_place(wheel, timer);
+}
+
+/**
+ * Stop a timer if it is pending - O(1)
+ */
+void modbus_timer_wheel_cancel(ModbusTimerWheel *wheel, ModbusTimer *timer) {
+    if (!modbus_timer_pending(timer)) return;
+
+    wheel_unlink(wheel, timer);
+    wheel->count--;
+}
+
+/**
+ * Advance the wheel and take one expired timer from it - call until it
+ * returns NULL
+ *
+ * Ticks without a timer to expire or cascade are skipped at no cost.
+ * @param wheel Wheel instance
+ * @param now   Current tick, never less than at the previous call
+ * @return Expired timer, no longer pending, or NULL if none is left
+ */
+ModbusTimer *modbus_timer_wheel_expire(ModbusTimerWheel *wheel, uint64_t now) {
+    for (;;) {
+        ModbusTimer *timer = wheel->slots[0][wheel->now & WHEEL_MASK];
+        if (timer) {
+            wheel_unlink(wheel, timer);
+            wheel->count--;
+            return timer;
+        }
+
+        uint64_t next = wheel_next_tick(wheel);
+        if (next > now) {
+            if (now > wheel->now) wheel->now = now;
+            return NULL;
+        }
+
+        wheel->now = next;
+        wheel_cascade(wheel);
+    }
+}
+
+/**
+ * Get the earliest tick at which modbus_timer_wheel_expire() may return a
+ * timer, to bound the wait of an event loop
+ *
+ * The tick can be early when timers wait in the higher levels, never late.
+ * @return Tick, UINT64_MAX if no timer is pending
+ */
+uint64_t modbus_timer_wheel_next(const ModbusTimerWheel *wheel) {
+    if (wheel->slots[0][wheel->now & WHEEL_MASK]) return wheel->now;
+    return wheel_next_tick(wheel);
+}
@@ -0,0 +1,79 @@
+#ifndef MODBUS_TIMER_WHEEL_H
+#define MODBUS_TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Hierarchical timer wheel for large numbers of coarse timeouts, such as the
+ * idle and request timeouts of every connection of a TCP server.
+ *
+ * Time is counted in ticks of any length chosen by the caller. Each level
+ * has 64 slots; a slot of level 0 covers one tick and a slot of level n
+ * covers 64^n ticks. A timer is linked into the slot its expiry falls into
+ * and is moved one level down whenever time enters that slot, so adding and
+ * cancelling are O(1) and advancing the wheel costs at most one cascade per
+ * 64 ticks plus the timers that expire. Expiries further away than 64^4
+ * ticks are re-examined every 64^3 ticks until they are in range.
+ *
+ * Timers are embedded in the caller's objects and nothing is allocated.
+ */
+#define MODBUS_TIMER_WHEEL_LEVELS 4
+#define MODBUS_TIMER_WHEEL_BITS   6
+#define MODBUS_TIMER_WHEEL_SLOTS  (1u << MODBUS_TIMER_WHEEL_BITS)
+
+/*==============================
+    Timers
+==============================*/
+typedef struct ModbusTimer {
+    struct ModbusTimer *next;
+    struct ModbusTimer **pprev; /* Link pointing to this timer, NULL while not pending */
+    uint64_t expires;           /* Tick the timer expires at */
+    uint8_t level;
+    uint8_t slot;
+} ModbusTimer;
+
+/*==============================
+    Wheel structure
+==============================*/
+typedef struct {
+    uint64_t now;                                  /* Tick processed last */
+    uint32_t count;                                /* Pending timers */
+    uint64_t occupied[MODBUS_TIMER_WHEEL_LEVELS];  /* Bit per non-empty slot */
+    ModbusTimer *slots[MODBUS_TIMER_WHEEL_LEVELS][MODBUS_TIMER_WHEEL_SLOTS];
+} ModbusTimerWheel;
+
+/*==============================
+    Public API
+==============================*/
+void modbus_timer_wheel_init(ModbusTimerWheel *wheel, uint64_t now);
+void modbus_timer_wheel_add(ModbusTimerWheel *wheel, ModbusTimer *timer, uint64_t expires);
+void modbus_timer_wheel_cancel(ModbusTimerWheel *wheel, ModbusTimer *timer);
+ModbusTimer *modbus_timer_wheel_expire(ModbusTimerWheel *wheel, uint64_t now);
+uint64_t modbus_timer_wheel_next(const ModbusTimerWheel *wheel);
+
+/**
+ * Prepare a timer that is not pending
+ */
+static inline void modbus_timer_init(ModbusTimer *timer) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/**
+ * Check whether a timer waits in a wheel
+ */
+static inline bool modbus_timer_pending(const ModbusTimer *timer) {
+    return timer->pprev != NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_TIMER_WHEEL_H */
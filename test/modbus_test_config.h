@@ -0,0 +1,64 @@
+#ifndef MODBUS_TEST_CONFIG_H
+#define MODBUS_TEST_CONFIG_H
+
+/*
+ * Configuration used by the unit tests, included through MODBUS_CONFIG_FILE.
+ * Optional features that are off by default are enabled here so their code
+ * paths are covered as well.
+ */
+
+#ifndef MODBUS_ENABLE_FC_07
+#define MODBUS_ENABLE_FC_07 1
+#endif
+
+#ifndef MODBUS_ENABLE_FC_08
+#define MODBUS_ENABLE_FC_08 1
+#endif
+
+#ifndef MODBUS_ENABLE_FC_2B
+#define MODBUS_ENABLE_FC_2B 1
+#endif
+
+#ifndef MODBUS_MAX_UNITS
+#define MODBUS_MAX_UNITS 3
+#endif
+
+#ifndef MODBUS_DEVICE_ID_CACHE_SIZE
+#define MODBUS_DEVICE_ID_CACHE_SIZE 256
+#endif
+
+#ifndef MODBUS_RESPONSE_CACHE_ENTRIES
+#define MODBUS_RESPONSE_CACHE_ENTRIES 2
+#endif
+
+#ifndef MODBUS_STAGED_WRITES
+#define MODBUS_STAGED_WRITES 1
+#endif
+
+#ifndef MODBUS_DIRTY_COIL_COUNT
+#define MODBUS_DIRTY_COIL_COUNT 40
+#endif
+
+#ifndef MODBUS_DIRTY_REGISTER_COUNT
+#define MODBUS_DIRTY_REGISTER_COUNT 100
+#endif
+
+#ifndef MODBUS_ENABLE_TX_HOOKS
+#define MODBUS_ENABLE_TX_HOOKS 1
+#endif
+
+#ifndef MODBUS_ENABLE_DEADLINE
+#define MODBUS_ENABLE_DEADLINE 1
+#endif
+
+/* Keeps the tests that hold a publication open short */
+#ifndef MODBUS_REGISTER_BANK_TIMEOUT_US
+#define MODBUS_REGISTER_BANK_TIMEOUT_US 20000
+#endif
+
+/* Few enough for paused clients to hold every receive buffer of the io_uring server */
+#ifndef MODBUS_TCP_URING_RX_BUFFERS
+#define MODBUS_TCP_URING_RX_BUFFERS 4
+#endif
+
+#endif /* MODBUS_TEST_CONFIG_H */
@@ -0,0 +1,511 @@
+#include "unity_fixture.h"
+#include "modbus_gateway.h"
+#include "modbus_crc16.h"
+
+#include <string.h>
+
+TEST_GROUP(modbus_gateway);
+
+#define MAX_CAPTURED 8
+#define FRAME_GAP_MS 5
+
+typedef struct {
+    ModbusGatewaySource *source;
+    uint8_t adu[MODBUS_TCP_MAX_ADU_LENGTH];
+    uint16_t length;
+} Captured;
+
+static ModbusGateway gateway;
+static ModbusGatewayBus bus;
+static ModbusGatewaySource master_a;
+static ModbusGatewaySource master_b;
+
+static uint8_t line[MAX_CAPTURED][MODBUS_MAX_FRAME_LENGTH]; // Frames written to the bus
+static uint16_t line_len[MAX_CAPTURED];
+static int line_count;
+
+static Captured responses[MAX_CAPTURED];
+static int response_count;
+
+static void mock_bus_write(void *ctx, const uint8_t *frame, uint16_t length) {
+    (void)ctx;
+
+    if (line_count < MAX_CAPTURED) {
+        memcpy(line[line_count], frame, length);
+        line_len[line_count] = length;
+    }
+    line_count++;
+}
+
+static void mock_respond(ModbusGatewaySource *source, const uint8_t *adu, uint16_t length) {
+    if (response_count < MAX_CAPTURED) {
+        responses[response_count].source = source;
+        memcpy(responses[response_count].adu, adu, length);
+        responses[response_count].length = length;
+    }
+    response_count++;
+}
+
+/**
+ * Build a Read Holding Registers request ADU
+ * @return ADU length
+ */
+static uint16_t read_request(uint8_t *adu, uint16_t transaction_id, uint8_t unit, uint16_t address) {
+    const uint8_t request[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x06, unit, 0x03, 0x00, 0x00, 0x00, 0x01};
+
+    memcpy(adu, request, sizeof(request));
+    modbus_be16_set(&adu[0], transaction_id);
+    modbus_be16_set(&adu[8], address);
+    return sizeof(request);
+}
+
+static void submit_read(ModbusGatewaySource *source, uint16_t transaction_id, uint8_t unit, uint16_t address,
+                        uint32_t now_ms) {
+    uint8_t adu[MODBUS_TCP_MAX_ADU_LENGTH];
+    uint16_t length = read_request(adu, transaction_id, unit, address);
+
+    TEST_ASSERT_EQUAL(0, modbus_gateway_submit(&gateway, source, adu, length, now_ms));
+}
+
+/**
+ * Respond to the last frame on the line with one register holding value
+ */
+static void respond_read(uint16_t value, uint32_t now_ms) {
+    uint8_t frame[16] = {line[line_count - 1][0], 0x03, 0x02};
+
+    modbus_be16_set(&frame[3], value);
+    modbus_le16_set(&frame[5], modbus_crc16(frame, 5));
+    modbus_gateway_bus_rx(&bus, frame, 7, now_ms);
+}
+
+/**
+ * Answer the last frame on the line with one register holding value, and
+ * let the frame gap pass so the next request goes on the line
+ */
+static void answer_read(uint16_t value, uint32_t now_ms) {
+    respond_read(value, now_ms);
+    modbus_gateway_bus_poll(&bus, now_ms + FRAME_GAP_MS);
+}
+
+/**
+ * Submit a Write Single Register request
+ */
+static void submit_write(ModbusGatewaySource *source, uint16_t transaction_id, uint8_t unit, uint16_t address,
+                         uint32_t now_ms) {
+    const uint8_t adu[] = {0x00, (uint8_t)transaction_id, 0x00, 0x00, 0x00, 0x06, unit, 0x06,
+                           (uint8_t)(address >> 8), (uint8_t)address, 0x00, 0x2A};
+
+    TEST_ASSERT_EQUAL(0, modbus_gateway_submit(&gateway, source, adu, sizeof(adu), now_ms));
+}
+
+/**
+ * Answer the write on the line with its echo, and let the frame gap pass
+ */
+static void answer_write(uint32_t now_ms) {
+    uint8_t frame[16];
+
+    memcpy(frame, line[line_count - 1], 8);
+    modbus_gateway_bus_rx(&bus, frame, 8, now_ms);
+    modbus_gateway_bus_poll(&bus, now_ms + FRAME_GAP_MS);
+}
+
+static void setup_bus(ModbusGatewayPolicy policy, uint32_t cache_ttl_ms) {
+    ModbusGatewayBusConfig config = {
+        .write = mock_bus_write,
+        .policy = policy,
+        .response_timeout_ms = 200,
+        .turnaround_ms = 50,
+        .baudrate = 115200,
+        .frame_gap_ms = FRAME_GAP_MS,
+        .cache_ttl_ms = cache_ttl_ms,
+    };
+
+    TEST_ASSERT_EQUAL(0, modbus_gateway_bus_init(&bus, &config));
+    TEST_ASSERT_EQUAL(0, modbus_gateway_add_bus(&gateway, &bus, 0, 31));
+}
+
+TEST_SETUP(modbus_gateway) {
+    line_count = 0;
+    response_count = 0;
+
+    modbus_gateway_init(&gateway, mock_respond);
+    modbus_gateway_source_init(&master_a, NULL, 0);
+    modbus_gateway_source_init(&master_b, NULL, 1);
+    setup_bus(MODBUS_GATEWAY_FAIR, 0);
+}
+
+TEST_TEAR_DOWN(modbus_gateway) {}
+
+/**
+ * Test that a request is sent as an RTU frame and its response returned
+ * with the MBAP header of the request, even when received byte by byte
+ */
+TEST(modbus_gateway, test_gateway_round_trip) {
+    const uint8_t expected_frame[] = {0x05, 0x03, 0x00, 0x10, 0x00, 0x01, 0x84, 0x4B};
+    const uint8_t expected_adu[] = {0x12, 0x34, 0x00, 0x00, 0x00, 0x05, 0x05, 0x03, 0x02, 0xBE, 0xEF};
+    uint8_t frame[16] = {0x05, 0x03, 0x02, 0xBE, 0xEF};
+
+    submit_read(&master_a, 0x1234, 0x05, 0x0010, 0);
+    TEST_ASSERT_EQUAL(1, line_count);
+    TEST_ASSERT_EQUAL(sizeof(expected_frame), line_len[0]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_frame, line[0], sizeof(expected_frame));
+    TEST_ASSERT_EQUAL(MODBUS_GATEWAY_BUS_WAITING, bus.state);
+
+    modbus_le16_set(&frame[5], modbus_crc16(frame, 5));
+    for (int i = 0; i < 7; i++) {
+        modbus_gateway_bus_rx(&bus, &frame[i], 1, 30);
+    }
+
+    TEST_ASSERT_EQUAL(1, response_count);
+    TEST_ASSERT_EQUAL_PTR(&master_a, responses[0].source);
+    TEST_ASSERT_EQUAL(sizeof(expected_adu), responses[0].length);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_adu, responses[0].adu, sizeof(expected_adu));
+    TEST_ASSERT_EQUAL(MODBUS_GATEWAY_BUS_QUIET, bus.state);
+    TEST_ASSERT_EQUAL(1, bus.stats.responses);
+    TEST_ASSERT_EQUAL(30, bus.stats.busy_ms);
+    TEST_ASSERT_EQUAL(0, bus.stats.depth);
+    TEST_ASSERT_EQUAL(0, master_a.queued);
+}
+
+/**
+ * Test that a silent unit is reported with GATEWAY TARGET FAILED and that
+ * the next request goes on the line after the quiet period, and that a
+ * response from another unit is not taken for the awaited one
+ */
+TEST(modbus_gateway, test_gateway_timeout) {
+    const uint8_t expected_adu[] = {0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x07, 0x83, 0x0B};
+
+    submit_read(&master_a, 1, 0x07, 0, 0);
+    submit_read(&master_a, 2, 0x08, 0, 0);
+    TEST_ASSERT_EQUAL(1, line_count);
+    TEST_ASSERT_EQUAL(200, modbus_gateway_bus_next(&bus, 0));
+
+    line[0][0] = 0x09; // Some other unit answers
+    answer_read(0x1111, 10);
+    TEST_ASSERT_EQUAL(0, response_count);
+    TEST_ASSERT_EQUAL(1, bus.stats.garbled);
+
+    modbus_gateway_bus_poll(&bus, 199);
+    TEST_ASSERT_EQUAL(0, response_count);
+
+    modbus_gateway_bus_poll(&bus, 200);
+    TEST_ASSERT_EQUAL(1, response_count);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_adu, responses[0].adu, sizeof(expected_adu));
+    TEST_ASSERT_EQUAL(1, bus.stats.timeouts);
+    TEST_ASSERT_EQUAL(1, line_count);
+    TEST_ASSERT_EQUAL(100, modbus_gateway_bus_next(&bus, 200));
+
+    modbus_gateway_bus_poll(&bus, 299);
+    TEST_ASSERT_EQUAL(1, line_count);
+
+    modbus_gateway_bus_poll(&bus, 300);
+    TEST_ASSERT_EQUAL(2, line_count);
+    TEST_ASSERT_EQUAL_HEX8(0x08, line[1][0]);
+    TEST_ASSERT_EQUAL(300, bus.stats.wait_ms);
+}
+
+/**
+ * Test that the fair policy alternates between masters however many
+ * requests one of them queues, and keeps each master's order
+ */
+TEST(modbus_gateway, test_gateway_fair_round_robin) {
+    submit_read(&master_a, 1, 0x01, 1, 0); // On the line at once
+    submit_read(&master_a, 2, 0x01, 2, 0);
+    submit_read(&master_a, 3, 0x01, 3, 0);
+    submit_read(&master_b, 4, 0x01, 4, 0);
+    TEST_ASSERT_EQUAL(4, bus.stats.peak_depth);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        answer_read(0, 10 * (i + 1));
+    }
+
+    TEST_ASSERT_EQUAL(4, response_count);
+    TEST_ASSERT_EQUAL(1, modbus_be16_get(&line[0][2]));
+    TEST_ASSERT_EQUAL(4, modbus_be16_get(&line[1][2]));
+    TEST_ASSERT_EQUAL(2, modbus_be16_get(&line[2][2]));
+    TEST_ASSERT_EQUAL(3, modbus_be16_get(&line[3][2]));
+    TEST_ASSERT_EQUAL_PTR(&master_b, responses[1].source);
+}
+
+/**
+ * Test that the priority policy serves the higher priority master first
+ */
+TEST(modbus_gateway, test_gateway_priority) {
+    modbus_gateway_init(&gateway, mock_respond);
+    setup_bus(MODBUS_GATEWAY_PRIORITY, 0);
+
+    submit_read(&master_a, 1, 0x01, 1, 0);
+    submit_read(&master_a, 2, 0x01, 2, 0);
+    submit_read(&master_b, 3, 0x01, 3, 0);
+    submit_read(&master_b, 4, 0x01, 4, 0);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        answer_read(0, 10 * (i + 1));
+    }
+
+    TEST_ASSERT_EQUAL(1, modbus_be16_get(&line[0][2]));
+    TEST_ASSERT_EQUAL(3, modbus_be16_get(&line[1][2]));
+    TEST_ASSERT_EQUAL(4, modbus_be16_get(&line[2][2]));
+    TEST_ASSERT_EQUAL(2, modbus_be16_get(&line[3][2]));
+}
+
+/**
+ * Test that requests beyond the queue depth are answered with SLAVE DEVICE
+ * BUSY, and unrouted units with GATEWAY PATH UNAVAILABLE
+ */
+TEST(modbus_gateway, test_gateway_rejections) {
+    uint8_t adu[MODBUS_TCP_MAX_ADU_LENGTH];
+
+    for (int i = 0; i < MODBUS_GATEWAY_QUEUE_DEPTH; i++) {
+        submit_read(&master_a, (uint16_t)i, 0x01, (uint16_t)i, 0); // Distinct, so none is shared
+    }
+    TEST_ASSERT_EQUAL(0, response_count);
+
+    submit_read(&master_a, 0xAAAA, 0x01, 0, 0);
+    TEST_ASSERT_EQUAL(1, response_count);
+    TEST_ASSERT_EQUAL_HEX8(0x83, responses[0].adu[7]);
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_EX_SLAVE_DEVICE_BUSY, responses[0].adu[8]);
+    TEST_ASSERT_EQUAL(0xAAAA, modbus_be16_get(responses[0].adu));
+    TEST_ASSERT_EQUAL(1, bus.stats.rejected);
+
+    submit_read(&master_a, 0xBBBB, 0x40, 0, 0);
+    TEST_ASSERT_EQUAL(2, response_count);
+    TEST_ASSERT_EQUAL_HEX8(0x40, responses[1].adu[6]);
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_EX_GATEWAY_PATH_UNAVAILABLE, responses[1].adu[8]);
+
+    uint16_t length = read_request(adu, 1, 0x01, 0);
+    TEST_ASSERT_EQUAL(-1, modbus_gateway_submit(&gateway, &master_a, adu, (uint16_t)(length - 1), 0));
+}
+
+/**
+ * Test that a broadcast gets no response and holds the line for the
+ * turnaround delay and the frame gap
+ */
+TEST(modbus_gateway, test_gateway_broadcast_turnaround) {
+    submit_read(&master_a, 1, 0x00, 0, 0);
+    submit_read(&master_a, 2, 0x01, 0, 0);
+
+    TEST_ASSERT_EQUAL(1, line_count);
+    TEST_ASSERT_EQUAL(MODBUS_GATEWAY_BUS_TURNAROUND, bus.state);
+    TEST_ASSERT_EQUAL(50, modbus_gateway_bus_next(&bus, 0));
+
+    modbus_gateway_bus_poll(&bus, 49);
+    TEST_ASSERT_EQUAL(1, line_count);
+
+    modbus_gateway_bus_poll(&bus, 50);
+    TEST_ASSERT_EQUAL(1, line_count);
+
+    modbus_gateway_bus_poll(&bus, 50 + FRAME_GAP_MS);
+    TEST_ASSERT_EQUAL(2, line_count);
+    TEST_ASSERT_EQUAL(0, response_count);
+    TEST_ASSERT_EQUAL(1, master_a.queued);
+}
+
+/**
+ * Test that cancelling a master drops its waiting requests and discards
+ * the response to the one on the line
+ */
+TEST(modbus_gateway, test_gateway_cancel) {
+    submit_read(&master_a, 1, 0x01, 1, 0);
+    submit_read(&master_a, 2, 0x01, 2, 0);
+    submit_read(&master_b, 3, 0x01, 3, 0);
+
+    modbus_gateway_cancel(&gateway, &master_a);
+    TEST_ASSERT_EQUAL(0, master_a.queued);
+    TEST_ASSERT_EQUAL(2, bus.stats.depth);
+
+    answer_read(0, 10);
+    TEST_ASSERT_EQUAL(0, response_count);
+    TEST_ASSERT_EQUAL(2, line_count);
+    TEST_ASSERT_EQUAL(3, modbus_be16_get(&line[1][2]));
+
+    answer_read(0, 20);
+    TEST_ASSERT_EQUAL(1, response_count);
+    TEST_ASSERT_EQUAL_PTR(&master_b, responses[0].source);
+    TEST_ASSERT_EQUAL(0, bus.stats.depth);
+    TEST_ASSERT_EQUAL(UINT32_MAX, modbus_gateway_bus_next(&bus, 25));
+}
+
+/**
+ * Test that identical reads of several masters share one transaction, each
+ * answered with its own transaction id, timeouts included
+ */
+TEST(modbus_gateway, test_gateway_coalescing) {
+    ModbusGatewaySource master_c;
+    modbus_gateway_source_init(&master_c, NULL, 0);
+
+    submit_read(&master_a, 1, 0x01, 7, 0); // On the line
+    submit_read(&master_b, 2, 0x01, 7, 0); // Joins it
+    submit_read(&master_b, 3, 0x01, 8, 0); // Queued
+    submit_read(&master_c, 4, 0x01, 8, 0); // Joins the queued one
+    TEST_ASSERT_EQUAL(1, line_count);
+    TEST_ASSERT_EQUAL(2, bus.stats.coalesced);
+    TEST_ASSERT_EQUAL(4, bus.stats.depth);
+
+    answer_read(0x1234, 10);
+    TEST_ASSERT_EQUAL(2, response_count);
+    TEST_ASSERT_EQUAL(2, line_count);
+    TEST_ASSERT_EQUAL(2, bus.stats.responses);
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL(0x1234, modbus_be16_get(&responses[i].adu[9]));
+    }
+    TEST_ASSERT_TRUE(modbus_be16_get(responses[0].adu) != modbus_be16_get(responses[1].adu));
+
+    modbus_gateway_bus_poll(&bus, 215);
+    TEST_ASSERT_EQUAL(4, response_count);
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_EX_GATEWAY_TARGET_FAILED, responses[2].adu[8]);
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_EX_GATEWAY_TARGET_FAILED, responses[3].adu[8]);
+    TEST_ASSERT_EQUAL(2, bus.stats.requests);
+    TEST_ASSERT_EQUAL(0, bus.stats.depth);
+    TEST_ASSERT_EQUAL(0, master_b.queued);
+    TEST_ASSERT_EQUAL(0, master_c.queued);
+}
+
+#if MODBUS_GATEWAY_CACHE_ENTRIES
+/**
+ * Test that repeated reads are answered from the cache within the TTL, and
+ * that a write drops the cached reads it overlaps
+ */
+TEST(modbus_gateway, test_gateway_cache) {
+    setup_bus(MODBUS_GATEWAY_FAIR, 100);
+
+    submit_read(&master_a, 1, 0x01, 7, 0);
+    answer_read(0x1111, 10);
+    submit_read(&master_a, 2, 0x01, 8, 15);
+    answer_read(0x2222, 20);
+
+    submit_read(&master_b, 3, 0x01, 7, 50);
+    TEST_ASSERT_EQUAL(3, response_count);
+    TEST_ASSERT_EQUAL(2, line_count);
+    TEST_ASSERT_EQUAL(1, bus.stats.cache_hits);
+    TEST_ASSERT_EQUAL(3, modbus_be16_get(responses[2].adu));
+    TEST_ASSERT_EQUAL(0x1111, modbus_be16_get(&responses[2].adu[9]));
+
+    submit_read(&master_b, 4, 0x01, 7, 110); // Expired
+    TEST_ASSERT_EQUAL(3, line_count);
+    answer_read(0x3333, 115);
+
+    submit_write(&master_a, 5, 0x01, 8, 120); // Register 7 is left cached
+    answer_write(125);
+    submit_read(&master_b, 6, 0x01, 7, 130);
+    submit_read(&master_b, 7, 0x01, 8, 130);
+    TEST_ASSERT_EQUAL(2, bus.stats.cache_hits);
+    TEST_ASSERT_EQUAL(5, line_count);
+    TEST_ASSERT_EQUAL(8, modbus_be16_get(&line[4][2]));
+}
+
+/**
+ * Test that a master never gets data read before its own write, whether
+ * from the cache or by joining a read of another master
+ */
+TEST(modbus_gateway, test_gateway_read_after_write) {
+    setup_bus(MODBUS_GATEWAY_FAIR, 1000);
+
+    submit_read(&master_b, 1, 0x01, 7, 0);
+    answer_read(0x1111, 10);                // Cached
+
+    submit_read(&master_a, 2, 0x01, 9, 20); // On the line
+    submit_write(&master_a, 3, 0x01, 7, 20);
+    submit_read(&master_b, 4, 0x01, 7, 20); // Sent before the write, b was served less recently
+    submit_read(&master_a, 5, 0x01, 7, 20); // Must neither hit the cache nor join b's read
+    TEST_ASSERT_EQUAL(0, bus.stats.cache_hits);
+    TEST_ASSERT_EQUAL(0, bus.stats.coalesced);
+
+    answer_read(0, 30);
+    answer_read(0x1111, 40);
+    TEST_ASSERT_EQUAL(7, modbus_be16_get(&line[2][2]));
+    answer_write(50);
+    TEST_ASSERT_EQUAL(5, line_count);
+    answer_read(0x2A, 60);
+
+    TEST_ASSERT_EQUAL(5, response_count);
+    TEST_ASSERT_EQUAL(5, modbus_be16_get(responses[4].adu));
+    TEST_ASSERT_EQUAL(0x2A, modbus_be16_get(&responses[4].adu[9]));
+}
+
+#endif /* MODBUS_GATEWAY_CACHE_ENTRIES */
+
+/**
+ * Test that a cancelled read other masters joined stays queued for them
+ */
+TEST(modbus_gateway, test_gateway_cancel_shared) {
+    submit_read(&master_a, 1, 0x01, 1, 0);
+    submit_read(&master_a, 2, 0x01, 2, 0);
+    submit_read(&master_b, 3, 0x01, 2, 0); // Joins a's queued read
+
+    modbus_gateway_cancel(&gateway, &master_a);
+    TEST_ASSERT_EQUAL(0, master_a.queued);
+    TEST_ASSERT_EQUAL(1, master_b.queued);
+
+    answer_read(0, 10);
+    TEST_ASSERT_EQUAL(2, line_count);
+    answer_read(0x5555, 20);
+
+    TEST_ASSERT_EQUAL(1, response_count);
+    TEST_ASSERT_EQUAL_PTR(&master_b, responses[0].source);
+    TEST_ASSERT_EQUAL(3, modbus_be16_get(responses[0].adu));
+    TEST_ASSERT_EQUAL(0, bus.stats.depth);
+}
+
+/**
+ * Test that the next request waits for the frame gap after a response, and
+ * that the gap is at least 3.5 character times at the line rate
+ */
+TEST(modbus_gateway, test_gateway_frame_gap) {
+    static ModbusGatewayBus slow_bus;
+    ModbusGatewayBusConfig config = { .write = mock_bus_write, .baudrate = 1200, .frame_gap_ms = 1 };
+
+    submit_read(&master_a, 1, 0x01, 1, 0);
+    submit_read(&master_a, 2, 0x01, 2, 0);
+
+    respond_read(0, 10);
+    TEST_ASSERT_EQUAL(1, response_count);
+    TEST_ASSERT_EQUAL(MODBUS_GATEWAY_BUS_QUIET, bus.state);
+    TEST_ASSERT_EQUAL(FRAME_GAP_MS, modbus_gateway_bus_next(&bus, 10));
+
+    modbus_gateway_bus_poll(&bus, 10 + FRAME_GAP_MS - 1);
+    TEST_ASSERT_EQUAL(1, line_count);
+
+    modbus_gateway_bus_poll(&bus, 10 + FRAME_GAP_MS);
+    TEST_ASSERT_EQUAL(2, line_count);
+
+    TEST_ASSERT_EQUAL(0, modbus_gateway_bus_init(&slow_bus, &config));
+    TEST_ASSERT_EQUAL(34, slow_bus.config.frame_gap_ms); // 32.1 ms rounded up, and the clock resolution
+    TEST_ASSERT_EQUAL(MODBUS_GATEWAY_TIMEOUT_QUIET_MS, slow_bus.config.timeout_quiet_ms);
+
+    config.baudrate = 0;
+    TEST_ASSERT_EQUAL(0, modbus_gateway_bus_init(&slow_bus, &config));
+    TEST_ASSERT_EQUAL(4, slow_bus.config.frame_gap_ms); // 2.0 ms at 19200 bit/s
+}
+
+/**
+ * Test that a response arriving after its request timed out is dropped and
+ * delays the next request to the same unit and function, instead of
+ * colliding with it or being taken for its response
+ */
+TEST(modbus_gateway, test_gateway_late_response) {
+    submit_read(&master_a, 1, 0x07, 1, 0);
+    submit_read(&master_a, 2, 0x07, 2, 0);
+
+    modbus_gateway_bus_poll(&bus, 200);
+    TEST_ASSERT_EQUAL(1, response_count);
+    TEST_ASSERT_EQUAL(1, line_count);
+
+    respond_read(0x1111, 298); // Late, the quiet period is extended past it
+    TEST_ASSERT_EQUAL(1, response_count);
+    TEST_ASSERT_EQUAL(7, bus.stats.stray);
+    TEST_ASSERT_EQUAL(0, bus.stats.garbled);
+    TEST_ASSERT_EQUAL(FRAME_GAP_MS, modbus_gateway_bus_next(&bus, 298));
+
+    modbus_gateway_bus_poll(&bus, 300);
+    TEST_ASSERT_EQUAL(1, line_count);
+
+    modbus_gateway_bus_poll(&bus, 298 + FRAME_GAP_MS);
+    TEST_ASSERT_EQUAL(2, line_count);
+    TEST_ASSERT_EQUAL(2, modbus_be16_get(&line[1][2]));
+
+    respond_read(0x2222, 310);
+    TEST_ASSERT_EQUAL(2, response_count);
+    TEST_ASSERT_EQUAL(2, modbus_be16_get(responses[1].adu));
+    TEST_ASSERT_EQUAL(0x2222, modbus_be16_get(&responses[1].adu[9]));
+}
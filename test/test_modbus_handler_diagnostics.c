@@ -0,0 +1,156 @@
+#include "unity_fixture.h"
+#include "modbus_slave.h"
+#include "modbus_slave_handlers.h"
+
+#include <string.h>
+
+#if MODBUS_ENABLE_FC_08
+
+TEST_GROUP(modbus_handler_diagnostics);
+
+static ModbusSlave slave;
+static ModbusSlaveConfig config;
+
+/**
+ * Mock transmit function
+ */
+static void mock_write(const uint8_t *data, uint16_t length) {
+    // Do nothing for tests
+    (void)(data);
+    (void)(length);
+}
+
+TEST_SETUP(modbus_handler_diagnostics) {
+    memset(&slave, 0, sizeof(slave));
+    memset(&config, 0, sizeof(config));
+    config.address = 0x01;
+    config.write = mock_write;
+    
+    modbus_slave_init(&slave, &config);
+    
+    slave.counters.bus_message = 10;
+    slave.counters.bus_comm_error = 2;
+    slave.counters.bus_exception = 3;
+    slave.counters.slave_message = 7;
+    slave.counters.slave_no_response = 1;
+    slave.counters.bus_char_overrun = 4;
+}
+
+TEST_TEAR_DOWN(modbus_handler_diagnostics) {}
+
+/**
+ * Test return query data echoes the whole request
+ */
+TEST(modbus_handler_diagnostics, test_handle_diagnostics_return_query_data) {
+    uint8_t request[] = {0x01, 0x08, 0x00, 0x00, 0xA5, 0x37, 0x12};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_diagnostics(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&request[1], response, 6);
+    TEST_ASSERT_EQUAL(6, response_len);
+}
+
+/**
+ * Test every counter sub-function reports its counter
+ */
+TEST(modbus_handler_diagnostics, test_handle_diagnostics_counters) {
+    const uint8_t sub_functions[] = {
+        MODBUS_DIAG_BUS_MESSAGE_COUNT, MODBUS_DIAG_BUS_COMM_ERROR_COUNT,
+        MODBUS_DIAG_BUS_EXCEPTION_COUNT, MODBUS_DIAG_SLAVE_MESSAGE_COUNT,
+        MODBUS_DIAG_SLAVE_NO_RESPONSE_COUNT, MODBUS_DIAG_BUS_CHAR_OVERRUN_COUNT,
+    };
+    const uint16_t expected[] = {10, 2, 3, 7, 1, 4};
+    
+    for (unsigned i = 0; i < sizeof(sub_functions); i++) {
+        uint8_t request[] = {0x01, 0x08, 0x00, sub_functions[i], 0x00, 0x00};
+        
+        uint8_t response[256];
+        uint16_t response_len = 0;
+        ModbusExceptionCode result = handle_diagnostics(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+        
+        TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+        TEST_ASSERT_EQUAL(5, response_len);
+        TEST_ASSERT_EQUAL(0x08, response[0]);
+        TEST_ASSERT_EQUAL_HEX16(sub_functions[i], modbus_be16_get(&response[1]));
+        TEST_ASSERT_EQUAL(expected[i], modbus_be16_get(&response[3]));
+    }
+}
+
+/**
+ * Test clear counters resets all counters and echoes the request
+ */
+TEST(modbus_handler_diagnostics, test_handle_diagnostics_clear_counters) {
+    uint8_t request[] = {0x01, 0x08, 0x00, 0x0A, 0x00, 0x00};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_diagnostics(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&request[1], response, 5);
+    TEST_ASSERT_EQUAL(0, slave.counters.bus_message);
+    TEST_ASSERT_EQUAL(0, slave.counters.bus_comm_error);
+    TEST_ASSERT_EQUAL(0, slave.counters.bus_exception);
+    TEST_ASSERT_EQUAL(0, slave.counters.slave_message);
+    TEST_ASSERT_EQUAL(0, slave.counters.slave_no_response);
+    TEST_ASSERT_EQUAL(0, slave.counters.bus_char_overrun);
+}
+
+/**
+ * Test clear overrun counter leaves the other counters untouched
+ */
+TEST(modbus_handler_diagnostics, test_handle_diagnostics_clear_overrun) {
+    uint8_t request[] = {0x01, 0x08, 0x00, 0x14, 0x00, 0x00};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_diagnostics(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+    TEST_ASSERT_EQUAL(0, slave.counters.bus_char_overrun);
+    TEST_ASSERT_EQUAL(10, slave.counters.bus_message);
+}
+
+/**
+ * Test unsupported sub-function
+ */
+TEST(modbus_handler_diagnostics, test_handle_diagnostics_unsupported_sub_function) {
+    uint8_t request[] = {0x01, 0x08, 0x00, 0x01, 0x00, 0x00}; // Restart communications
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_diagnostics(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
+}
+
+/**
+ * Test counter sub-function with non-zero data field
+ */
+TEST(modbus_handler_diagnostics, test_handle_diagnostics_invalid_data) {
+    uint8_t request[] = {0x01, 0x08, 0x00, 0x0B, 0x00, 0x01};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_diagnostics(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
+}
+
+/**
+ * Test request too short to carry a data field
+ */
+TEST(modbus_handler_diagnostics, test_handle_diagnostics_short_request) {
+    uint8_t request[] = {0x01, 0x08, 0x00, 0x0B};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_diagnostics(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
+}
+
+#endif /* MODBUS_ENABLE_FC_08 */
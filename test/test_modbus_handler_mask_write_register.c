@@ -4,6 +4,8 @@
 
 #include <string.h>
 
+#if MODBUS_ENABLE_FC_16
+
 TEST_GROUP(modbus_handler_mask_write_register);
 
 static ModbusSlave slave;
@@ -51,12 +53,10 @@ TEST_TEAR_DOWN(modbus_handler_mask_write_register) {}
 TEST(modbus_handler_mask_write_register, test_handle_mask_write_register_valid) {
     // Build mask write register request: addr 0x0100 (256), AND mask 0x00FF, OR mask 0x1234
     uint8_t request[] = {0x01, 0x16, 0x01, 0x00, 0x00, 0xFF, 0x12, 0x34};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_mask_write_register(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_mask_write_register(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0100, last_mask_addr);
@@ -73,12 +73,10 @@ TEST(modbus_handler_mask_write_register, test_handle_mask_write_register_unsuppo
     slave.config.mask_write_register = NULL;
     
     uint8_t request[] = {0x01, 0x16, 0x05, 0x00, 0x00, 0xFF, 0x12, 0x34};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_mask_write_register(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_mask_write_register(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
 }
@@ -89,12 +87,10 @@ TEST(modbus_handler_mask_write_register, test_handle_mask_write_register_unsuppo
 TEST(modbus_handler_mask_write_register, test_handle_mask_write_register_address_error) {
     // Mock will return address error for addr > 1000
     uint8_t request[] = {0x01, 0x16, 0x03, 0xE9, 0x00, 0xFF, 0x12, 0x34}; // Addr = 1001
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_mask_write_register(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_mask_write_register(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
 }
@@ -104,16 +100,16 @@ TEST(modbus_handler_mask_write_register, test_handle_mask_write_register_address
  */
 TEST(modbus_handler_mask_write_register, test_handle_mask_write_register_zero_masks) {
     uint8_t request[] = {0x01, 0x16, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00}; // AND=0, OR=0
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_mask_write_register(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_mask_write_register(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0100, last_mask_addr);
     TEST_ASSERT_EQUAL(0x0000, last_and_mask);
     TEST_ASSERT_EQUAL(0x0000, last_or_mask);
     TEST_ASSERT_EQUAL_HEX8_ARRAY(&request[1], response, 6);
-}
\ No newline at end of file
+}
+
+#endif /* MODBUS_ENABLE_FC_16 */
@@ -4,6 +4,8 @@
 
 #include <string.h>
 
+#if MODBUS_ENABLE_FC_01
+
 TEST_GROUP(modbus_handler_read_coils);
 
 static ModbusSlave slave;
@@ -56,12 +58,10 @@ TEST_TEAR_DOWN(modbus_handler_read_coils) {}
 TEST(modbus_handler_read_coils, test_handle_read_coils_valid) {
     // Build read coils request: addr 0x0100, count 0x0010
     uint8_t request[] = {0x01, 0x01, 0x01, 0x00, 0x00, 0x10};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0100, last_coil_addr);
@@ -80,12 +80,10 @@ TEST(modbus_handler_read_coils, test_handle_read_coils_unsupported) {
     slave.config.read_coils = NULL;
     
     uint8_t request[] = {0x01, 0x01, 0x00, 0x00, 0x00, 0x10};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
 }
@@ -95,12 +93,10 @@ TEST(modbus_handler_read_coils, test_handle_read_coils_unsupported) {
  */
 TEST(modbus_handler_read_coils, test_handle_read_coils_invalid_count_low) {
     uint8_t request[] = {0x01, 0x01, 0x00, 0x00, 0x00, 0x00}; // Count = 0
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -110,12 +106,10 @@ TEST(modbus_handler_read_coils, test_handle_read_coils_invalid_count_low) {
  */
 TEST(modbus_handler_read_coils, test_handle_read_coils_invalid_count_high) {
     uint8_t request[] = {0x01, 0x01, 0x00, 0x00, 0x07, 0xD1}; // Count = 2001
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -126,19 +120,18 @@ TEST(modbus_handler_read_coils, test_handle_read_coils_invalid_count_high) {
 TEST(modbus_handler_read_coils, test_handle_read_coils_address_error) {
     // Mock will return address error for addr > 1000
     uint8_t request[] = {0x01, 0x01, 0x03, 0xE8, 0x00, 0x01}; // Addr = 1000
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     
     // Now test with addr > 1000
     request[2] = 0x03; request[3] = 0xE9; // Addr = 1001
-    memcpy(slave.frame, request, sizeof(request));
     
-    result = handle_read_coils(&slave, response, &response_len);
+    result = handle_read_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
-}
\ No newline at end of file
+}
+
+#endif /* MODBUS_ENABLE_FC_01 */
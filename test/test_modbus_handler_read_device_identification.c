@@ -0,0 +1,210 @@
+#include "unity_fixture.h"
+#include "modbus_slave.h"
+#include "modbus_slave_handlers.h"
+
+#include <string.h>
+
+#if MODBUS_ENABLE_FC_2B
+
+TEST_GROUP(modbus_handler_read_device_identification);
+
+static ModbusSlave slave;
+static ModbusSlaveConfig config;
+
+static char long_value[230];
+
+static const ModbusDeviceIdObject objects[] = {
+    {0x00, 4, "ACME"},
+    {0x01, 5, "PX-10"},
+    {0x02, 4, "V1.2"},
+    {0x04, 6, "Pump-X"},
+    {0x80, 3, "LOT"},
+    {0x81, sizeof(long_value), long_value},
+};
+
+/**
+ * Mock transmit function
+ */
+static void mock_write(const uint8_t *data, uint16_t length) {
+    // Do nothing for tests
+    (void)(data);
+    (void)(length);
+}
+
+TEST_SETUP(modbus_handler_read_device_identification) {
+    memset(&slave, 0, sizeof(slave));
+    memset(&config, 0, sizeof(config));
+    memset(long_value, 'x', sizeof(long_value));
+    config.address = 0x01;
+    config.write = mock_write;
+    config.device_id_objects = objects;
+    config.device_id_object_count = sizeof(objects) / sizeof(objects[0]);
+    
+    modbus_slave_init(&slave, &config);
+}
+
+TEST_TEAR_DOWN(modbus_handler_read_device_identification) {}
+
+/**
+ * Test basic stream returns the three mandatory objects
+ */
+TEST(modbus_handler_read_device_identification, test_handle_read_device_identification_basic) {
+    uint8_t request[] = {0x01, 0x2B, 0x0E, 0x01, 0x00};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_device_identification(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    const uint8_t expected[] = {
+        0x2B, 0x0E, 0x01, 0x83, 0x00, 0x00, 0x03,
+        0x00, 4, 'A', 'C', 'M', 'E',
+        0x01, 5, 'P', 'X', '-', '1', '0',
+        0x02, 4, 'V', '1', '.', '2',
+    };
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+    TEST_ASSERT_EQUAL(sizeof(expected), response_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+}
+
+/**
+ * Test regular stream stops before the extended objects
+ */
+TEST(modbus_handler_read_device_identification, test_handle_read_device_identification_regular) {
+    uint8_t request[] = {0x01, 0x2B, 0x0E, 0x02, 0x00};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_device_identification(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+    TEST_ASSERT_EQUAL(0x00, response[4]); // No more follows
+    TEST_ASSERT_EQUAL(4, response[6]); // Number of objects
+    TEST_ASSERT_EQUAL(7 + 6 + 7 + 6 + 8, response_len);
+}
+
+/**
+ * Test extended stream splits across responses when objects do not fit
+ */
+TEST(modbus_handler_read_device_identification, test_handle_read_device_identification_extended_more_follows) {
+    uint8_t request[] = {0x01, 0x2B, 0x0E, 0x03, 0x00};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_device_identification(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+    TEST_ASSERT_EQUAL(0xFF, response[4]); // More follows
+    TEST_ASSERT_EQUAL(0x81, response[5]); // Next object id
+    TEST_ASSERT_EQUAL(5, response[6]);
+    
+    // Continue the stream at the next object
+    request[4] = 0x81;
+    response_len = 0;
+    result = handle_read_device_identification(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+    TEST_ASSERT_EQUAL(0x00, response[4]);
+    TEST_ASSERT_EQUAL(1, response[6]);
+    TEST_ASSERT_EQUAL(0x81, response[7]);
+    TEST_ASSERT_EQUAL(sizeof(long_value), response[8]);
+    TEST_ASSERT_EQUAL(7 + 2 + sizeof(long_value), response_len);
+}
+
+/**
+ * Test stream request for an unknown object restarts at object 0
+ */
+TEST(modbus_handler_read_device_identification, test_handle_read_device_identification_unknown_object_restarts) {
+    uint8_t request[] = {0x01, 0x2B, 0x0E, 0x01, 0x05};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_device_identification(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+    TEST_ASSERT_EQUAL(3, response[6]);
+    TEST_ASSERT_EQUAL(0x00, response[7]);
+}
+
+/**
+ * Test individual access returns a single object
+ */
+TEST(modbus_handler_read_device_identification, test_handle_read_device_identification_individual) {
+    uint8_t request[] = {0x01, 0x2B, 0x0E, 0x04, 0x80};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_device_identification(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    const uint8_t expected[] = {0x2B, 0x0E, 0x04, 0x83, 0x00, 0x00, 0x01, 0x80, 3, 'L', 'O', 'T'};
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+    TEST_ASSERT_EQUAL(sizeof(expected), response_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+}
+
+/**
+ * Test individual access to an unknown object
+ */
+TEST(modbus_handler_read_device_identification, test_handle_read_device_identification_individual_unknown) {
+    uint8_t request[] = {0x01, 0x2B, 0x0E, 0x04, 0x05};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_device_identification(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
+}
+
+/**
+ * Test invalid read device id code
+ */
+TEST(modbus_handler_read_device_identification, test_handle_read_device_identification_invalid_code) {
+    uint8_t request[] = {0x01, 0x2B, 0x0E, 0x05, 0x00};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_device_identification(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
+}
+
+/**
+ * Test unsupported MEI type and slave without objects
+ */
+TEST(modbus_handler_read_device_identification, test_handle_read_device_identification_unsupported) {
+    uint8_t request[] = {0x01, 0x2B, 0x0D, 0x01, 0x00}; // CANopen general reference
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_device_identification(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
+    
+    slave.config.device_id_object_count = 0;
+    request[2] = 0x0E;
+    result = handle_read_device_identification(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
+}
+
+/**
+ * Test initialization rejects invalid object tables
+ */
+TEST(modbus_handler_read_device_identification, test_device_id_validate) {
+    static const ModbusDeviceIdObject missing_basic[] = {
+        {0x00, 4, "ACME"}, {0x02, 4, "V1.2"}, {0x03, 3, "URL"},
+    };
+    static const ModbusDeviceIdObject unsorted[] = {
+        {0x00, 4, "ACME"}, {0x01, 5, "PX-10"}, {0x02, 4, "V1.2"}, {0x85, 1, "a"}, {0x80, 1, "b"},
+    };
+    
+    config.device_id_objects = missing_basic;
+    config.device_id_object_count = 3;
+    TEST_ASSERT_EQUAL(-1, modbus_slave_init(&slave, &config));
+    
+    config.device_id_objects = unsorted;
+    config.device_id_object_count = 5;
+    TEST_ASSERT_EQUAL(-1, modbus_slave_init(&slave, &config));
+    
+    config.device_id_object_count = 3;
+    TEST_ASSERT_EQUAL(0, modbus_slave_init(&slave, &config));
+}
+
+#endif /* MODBUS_ENABLE_FC_2B */
@@ -0,0 +1,95 @@
+#include "unity_fixture.h"
+#include "modbus_slave.h"
+#include "modbus_slave_handlers.h"
+
+#include <string.h>
+
+#if MODBUS_ENABLE_FC_07
+
+TEST_GROUP(modbus_handler_read_exception_status);
+
+static ModbusSlave slave;
+static ModbusSlaveConfig config;
+
+// Mock callbacks
+static uint8_t mock_status;
+static ModbusExceptionCode mock_result;
+
+/**
+ * Mock transmit function
+ */
+static void mock_write(const uint8_t *data, uint16_t length) {
+    // Do nothing for tests
+    (void)(data);
+    (void)(length);
+}
+
+static ModbusExceptionCode mock_read_exception_status(uint8_t *status) {
+    *status = mock_status;
+    return mock_result;
+}
+
+TEST_SETUP(modbus_handler_read_exception_status) {
+    memset(&slave, 0, sizeof(slave));
+    memset(&config, 0, sizeof(config));
+    config.address = 0x01;
+    config.read_exception_status = mock_read_exception_status;
+    config.write = mock_write;
+    
+    modbus_slave_init(&slave, &config);
+    
+    // Reset test variables
+    mock_status = 0;
+    mock_result = MODBUS_EX_NONE;
+}
+
+TEST_TEAR_DOWN(modbus_handler_read_exception_status) {}
+
+/**
+ * Test read exception status handler with valid request
+ */
+TEST(modbus_handler_read_exception_status, test_handle_read_exception_status_valid) {
+    uint8_t request[] = {0x01, 0x07};
+    mock_status = 0x6D;
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_exception_status(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
+    TEST_ASSERT_EQUAL(0x07, response[0]); // Function code
+    TEST_ASSERT_EQUAL_HEX8(0x6D, response[1]); // Status outputs
+    TEST_ASSERT_EQUAL(2, response_len);
+}
+
+/**
+ * Test read exception status handler with unsupported function
+ */
+TEST(modbus_handler_read_exception_status, test_handle_read_exception_status_unsupported) {
+    slave.config.read_exception_status = NULL;
+    
+    uint8_t request[] = {0x01, 0x07};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_exception_status(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
+}
+
+/**
+ * Test read exception status handler with callback returning device failure
+ */
+TEST(modbus_handler_read_exception_status, test_handle_read_exception_status_device_failure) {
+    uint8_t request[] = {0x01, 0x07};
+    mock_result = MODBUS_EX_SLAVE_DEVICE_FAILURE;
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_exception_status(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_SLAVE_DEVICE_FAILURE, result);
+    TEST_ASSERT_EQUAL(0, response_len);
+}
+
+#endif /* MODBUS_ENABLE_FC_07 */
@@ -4,6 +4,8 @@
 
 #include <string.h>
 
+#if MODBUS_ENABLE_FC_03
+
 TEST_GROUP(modbus_handler_read_holding_registers);
 
 static ModbusSlave slave;
@@ -55,12 +57,10 @@ TEST_TEAR_DOWN(modbus_handler_read_holding_registers) {}
 TEST(modbus_handler_read_holding_registers, test_handle_read_holding_registers_valid) {
     // Build read holding registers request: addr 0x0200, count 0x0002
     uint8_t request[] = {0x01, 0x03, 0x02, 0x00, 0x00, 0x02};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_holding_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_holding_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0200, last_holding_addr);
@@ -80,12 +80,10 @@ TEST(modbus_handler_read_holding_registers, test_handle_read_holding_registers_u
     slave.config.read_holding_registers = NULL;
     
     uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x02};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_holding_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_holding_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
 }
@@ -95,12 +93,10 @@ TEST(modbus_handler_read_holding_registers, test_handle_read_holding_registers_u
  */
 TEST(modbus_handler_read_holding_registers, test_handle_read_holding_registers_invalid_count_low) {
     uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x00}; // Count = 0
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_holding_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_holding_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -110,28 +106,42 @@ TEST(modbus_handler_read_holding_registers, test_handle_read_holding_registers_i
  */
 TEST(modbus_handler_read_holding_registers, test_handle_read_holding_registers_invalid_count_high) {
     uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x7E}; // Count = 126
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_holding_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_holding_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
 
+/**
+ * Test read holding registers handler with a PDU of the wrong length
+ */
+TEST(modbus_handler_read_holding_registers, test_handle_read_holding_registers_invalid_length) {
+    uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00};
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_read_holding_registers(&slave, &request[1], 4, response, &response_len);
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
+    
+    result = handle_read_holding_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
+    TEST_ASSERT_EQUAL(0, response_len);
+}
+
 /**
  * Test read holding registers handler with callback returning address error
  */
 TEST(modbus_handler_read_holding_registers, test_handle_read_holding_registers_address_error) {
     // Mock will return address error for addr > 1000
     uint8_t request[] = {0x01, 0x03, 0x03, 0xE9, 0x00, 0x01}; // Addr = 1001
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_holding_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_holding_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
-}
\ No newline at end of file
+}
+
+#endif /* MODBUS_ENABLE_FC_03 */
@@ -4,6 +4,8 @@
 
 #include <string.h>
 
+#if MODBUS_ENABLE_FC_04
+
 TEST_GROUP(modbus_handler_read_input_registers);
 
 static ModbusSlave slave;
@@ -56,12 +58,10 @@ TEST_TEAR_DOWN(modbus_handler_read_input_registers) {}
 TEST(modbus_handler_read_input_registers, test_handle_read_input_registers_valid) {
     // Build read input registers request: addr 0x0200, count 0x0002
     uint8_t request[] = {0x01, 0x04, 0x02, 0x00, 0x00, 0x02};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_input_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_input_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0200, last_input_reg_addr);
@@ -80,12 +80,10 @@ TEST(modbus_handler_read_input_registers, test_handle_read_input_registers_unsup
     slave.config.read_input_registers = NULL;
     
     uint8_t request[] = {0x01, 0x04, 0x00, 0x00, 0x00, 0x02};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_input_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_input_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
 }
@@ -95,12 +93,10 @@ TEST(modbus_handler_read_input_registers, test_handle_read_input_registers_unsup
  */
 TEST(modbus_handler_read_input_registers, test_handle_read_input_registers_invalid_count_low) {
     uint8_t request[] = {0x01, 0x04, 0x00, 0x00, 0x00, 0x00}; // Count = 0
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_input_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_input_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -110,12 +106,10 @@ TEST(modbus_handler_read_input_registers, test_handle_read_input_registers_inval
  */
 TEST(modbus_handler_read_input_registers, test_handle_read_input_registers_invalid_count_high) {
     uint8_t request[] = {0x01, 0x04, 0x00, 0x00, 0x00, 0x7E}; // Count = 126
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_input_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_input_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -126,12 +120,12 @@ TEST(modbus_handler_read_input_registers, test_handle_read_input_registers_inval
 TEST(modbus_handler_read_input_registers, test_handle_read_input_registers_address_error) {
     // Mock will return address error for addr > 1000
     uint8_t request[] = {0x01, 0x04, 0x03, 0xE9, 0x00, 0x01}; // Addr = 1001
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_input_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_input_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
-}
\ No newline at end of file
+}
+
+#endif /* MODBUS_ENABLE_FC_04 */
@@ -4,6 +4,8 @@
 
 #include <string.h>
 
+#if MODBUS_ENABLE_FC_17
+
 TEST_GROUP(modbus_handler_read_write_multiple_registers);
 
 static ModbusSlave slave;
@@ -73,12 +75,10 @@ TEST(modbus_handler_read_write_multiple_registers, test_handle_read_write_multip
         0x02, 0x00, 0x00, 0x02, // Write: addr=0x0200, count=2
         0x04, 0x12, 0x34, 0x56, 0x78 // Byte count=4, data
     };
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0100, last_read_addr);
@@ -107,12 +107,10 @@ TEST(modbus_handler_read_write_multiple_registers, test_handle_read_write_multip
         0x07, 0x00, 0x00, 0x02,
         0x04, 0x12, 0x34, 0x56, 0x78
     };
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
 }
@@ -127,12 +125,10 @@ TEST(modbus_handler_read_write_multiple_registers, test_handle_read_write_multip
         0x07, 0x00, 0x00, 0x02,
         0x04, 0x12, 0x34, 0x56, 0x78
     };
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -147,12 +143,10 @@ TEST(modbus_handler_read_write_multiple_registers, test_handle_read_write_multip
         0x07, 0x00, 0x00, 0x02,
         0x04, 0x12, 0x34, 0x56, 0x78
     };
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -167,12 +161,10 @@ TEST(modbus_handler_read_write_multiple_registers, test_handle_read_write_multip
         0x07, 0x00, 0x00, 0x00, // Write count = 0 (invalid)
         0x00 // Byte count = 0
     };
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -188,12 +180,10 @@ TEST(modbus_handler_read_write_multiple_registers, test_handle_read_write_multip
         0xF4, // Byte count = 244
         0x00 // Would need 244 bytes of data, but we don't have it
     };
-    memcpy(slave.frame, request, 12); // Only copy header
-    slave.frame_len = 12;
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -208,12 +198,10 @@ TEST(modbus_handler_read_write_multiple_registers, test_handle_read_write_multip
         0x07, 0x00, 0x00, 0x02,
         0x03, 0x12, 0x34, 0x56 // Byte count should be 4, but we have 3
     };
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -229,12 +217,10 @@ TEST(modbus_handler_read_write_multiple_registers, test_handle_read_write_multip
         0x07, 0x00, 0x00, 0x02,
         0x04, 0x12, 0x34, 0x56, 0x78
     };
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
 }
@@ -250,12 +236,12 @@ TEST(modbus_handler_read_write_multiple_registers, test_handle_read_write_multip
         0x03, 0xE9, 0x00, 0x02, // Write addr = 1001
         0x04, 0x12, 0x34, 0x56, 0x78
     };
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_read_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
-}
\ No newline at end of file
+}
+
+#endif /* MODBUS_ENABLE_FC_17 */
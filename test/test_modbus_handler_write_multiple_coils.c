@@ -4,6 +4,8 @@
 
 #include <string.h>
 
+#if MODBUS_ENABLE_FC_0F
+
 TEST_GROUP(modbus_handler_write_multiple_coils);
 
 static ModbusSlave slave;
@@ -54,12 +56,10 @@ TEST_TEAR_DOWN(modbus_handler_write_multiple_coils) {}
 TEST(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_valid) {
     // Build write multiple coils request: addr 0x0100 (256), count 0x0010, data 0x12, 0x34
     uint8_t request[] = {0x01, 0x0F, 0x01, 0x00, 0x00, 0x10, 0x02, 0x12, 0x34};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0100, last_multi_coil_addr);
@@ -78,12 +78,10 @@ TEST(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_unsup
     slave.config.write_multiple_coils = NULL;
     
     uint8_t request[] = {0x01, 0x0F, 0x04, 0x00, 0x00, 0x10, 0x02, 0x12, 0x34};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
 }
@@ -94,12 +92,10 @@ TEST(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_unsup
 TEST(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_invalid_byte_count) {
     // Incorrect byte count (should be 2 for 16 coils, but we have 3)
     uint8_t request[] = {0x01, 0x0F, 0x04, 0x00, 0x00, 0x10, 0x03, 0x12, 0x34, 0x56};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -109,12 +105,10 @@ TEST(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_inval
  */
 TEST(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_invalid_count_low) {
     uint8_t request[] = {0x01, 0x0F, 0x04, 0x00, 0x00, 0x00, 0x00}; // Count = 0
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -124,12 +118,10 @@ TEST(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_inval
  */
 TEST(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_invalid_count_high) {
     uint8_t request[] = {0x01, 0x0F, 0x04, 0x00, 0x07, 0xB1, 0x00}; // Count = 1969
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -140,12 +132,12 @@ TEST(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_inval
 TEST(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_address_error) {
     // Mock will return address error for addr > 1000
     uint8_t request[] = {0x01, 0x0F, 0x03, 0xE9, 0x00, 0x10, 0x02, 0x12, 0x34}; // Addr = 1001
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_coils(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_coils(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
-}
\ No newline at end of file
+}
+
+#endif /* MODBUS_ENABLE_FC_0F */
@@ -4,6 +4,8 @@
 
 #include <string.h>
 
+#if MODBUS_ENABLE_FC_10
+
 TEST_GROUP(modbus_handler_write_multiple_registers);
 
 static ModbusSlave slave;
@@ -54,12 +56,10 @@ TEST_TEAR_DOWN(modbus_handler_write_multiple_registers) {}
 TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_valid) {
     // Build write multiple registers request: addr 0x0064 (100), count 0x0002, data 0x1234, 0x5678
     uint8_t request[] = {0x01, 0x10, 0x00, 0x64, 0x00, 0x02, 0x04, 0x12, 0x34, 0x56, 0x78}; // Addr = 100
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0064, last_multi_write_addr);
@@ -80,12 +80,10 @@ TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registe
     slave.config.write_multiple_registers = NULL;
     
     uint8_t request[] = {0x01, 0x10, 0x04, 0x00, 0x00, 0x02, 0x04, 0x12, 0x34, 0x56, 0x78};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
 }
@@ -96,12 +94,10 @@ TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registe
 TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_invalid_byte_count) {
     // Build request with incorrect byte count (should be 4 for 2 registers, but we have 3)
     uint8_t request[] = {0x01, 0x10, 0x04, 0x00, 0x00, 0x02, 0x03, 0x12, 0x34, 0x56};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -111,12 +107,10 @@ TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registe
  */
 TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_invalid_count_low) {
     uint8_t request[] = {0x01, 0x10, 0x04, 0x00, 0x00, 0x00, 0x00}; // Count = 0
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -126,12 +120,10 @@ TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registe
  */
 TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_invalid_count_high) {
     uint8_t request[] = {0x01, 0x10, 0x04, 0x00, 0x00, 0x7C, 0x00}; // Count = 124
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -142,12 +134,26 @@ TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registe
 TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_address_error) {
     // Mock will return address error for addr > 1000
     uint8_t request[] = {0x01, 0x10, 0x03, 0xE9, 0x00, 0x01, 0x02, 0x12, 0x34}; // Addr = 1001
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_multiple_registers(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
-}
\ No newline at end of file
+}
+
+/**
+ * Test write multiple registers handler with fewer data bytes than announced
+ */
+TEST(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_truncated) {
+    uint8_t request[] = {0x01, 0x10, 0x00, 0x64, 0x00, 0x02, 0x04, 0x12, 0x34}; // Second register missing
+    
+    uint8_t response[256];
+    uint16_t response_len = 0;
+    ModbusExceptionCode result = handle_write_multiple_registers(&slave, &request[1], sizeof(request) - 1, response, &response_len);
+    
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
+    TEST_ASSERT_NULL(last_multi_write_data);
+}
+
+#endif /* MODBUS_ENABLE_FC_10 */
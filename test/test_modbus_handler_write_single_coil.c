@@ -4,6 +4,8 @@
 
 #include <string.h>
 
+#if MODBUS_ENABLE_FC_05
+
 TEST_GROUP(modbus_handler_write_single_coil);
 
 static ModbusSlave slave;
@@ -52,12 +54,10 @@ TEST_TEAR_DOWN(modbus_handler_write_single_coil) {}
 TEST(modbus_handler_write_single_coil, test_handle_write_single_coil_valid_on) {
     // Build write single coil request: addr 0x0300, value ON (0xFF00)
     uint8_t request[] = {0x01, 0x05, 0x03, 0x00, 0xFF, 0x00};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_single_coil(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_single_coil(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0300, last_coil_addr);
@@ -72,12 +72,10 @@ TEST(modbus_handler_write_single_coil, test_handle_write_single_coil_valid_on) {
 TEST(modbus_handler_write_single_coil, test_handle_write_single_coil_valid_off) {
     // Build write single coil request: addr 0x0300, value OFF (0x0000)
     uint8_t request[] = {0x01, 0x05, 0x03, 0x00, 0x00, 0x00};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_single_coil(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_single_coil(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0300, last_coil_addr);
@@ -93,12 +91,10 @@ TEST(modbus_handler_write_single_coil, test_handle_write_single_coil_unsupported
     slave.config.write_single_coil = NULL;
     
     uint8_t request[] = {0x01, 0x05, 0x03, 0x00, 0xFF, 0x00};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_single_coil(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_single_coil(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
 }
@@ -109,12 +105,10 @@ TEST(modbus_handler_write_single_coil, test_handle_write_single_coil_unsupported
 TEST(modbus_handler_write_single_coil, test_handle_write_single_coil_invalid_value) {
     // Invalid coil value (should be 0x0000 or 0xFF00)
     uint8_t request[] = {0x01, 0x05, 0x03, 0x00, 0x12, 0x34}; // Invalid value
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_single_coil(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_single_coil(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_VALUE, result);
 }
@@ -125,12 +119,12 @@ TEST(modbus_handler_write_single_coil, test_handle_write_single_coil_invalid_val
 TEST(modbus_handler_write_single_coil, test_handle_write_single_coil_address_error) {
     // Mock will return address error for addr > 1000
     uint8_t request[] = {0x01, 0x05, 0x03, 0xE9, 0xFF, 0x00}; // Addr = 1001
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_single_coil(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_single_coil(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
-}
\ No newline at end of file
+}
+
+#endif /* MODBUS_ENABLE_FC_05 */
@@ -4,6 +4,8 @@
 
 #include <string.h>
 
+#if MODBUS_ENABLE_FC_06
+
 TEST_GROUP(modbus_handler_write_single_register);
 
 static ModbusSlave slave;
@@ -50,12 +52,10 @@ TEST_TEAR_DOWN(modbus_handler_write_single_register) {}
 TEST(modbus_handler_write_single_register, test_handle_write_single_register_valid) {
     // Build write single register request: addr 0x0300, value 0x1234
     uint8_t request[] = {0x01, 0x06, 0x03, 0x00, 0x12, 0x34};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_single_register(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_single_register(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0300, last_write_addr);
@@ -72,12 +72,10 @@ TEST(modbus_handler_write_single_register, test_handle_write_single_register_uns
     slave.config.write_single_register = NULL;
     
     uint8_t request[] = {0x01, 0x06, 0x03, 0x00, 0x12, 0x34};
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_single_register(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_single_register(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, result);
 }
@@ -88,12 +86,10 @@ TEST(modbus_handler_write_single_register, test_handle_write_single_register_uns
 TEST(modbus_handler_write_single_register, test_handle_write_single_register_address_error) {
     // Mock will return address error for addr > 1000
     uint8_t request[] = {0x01, 0x06, 0x03, 0xE9, 0x12, 0x34}; // Addr = 1001
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_single_register(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_single_register(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, result);
 }
@@ -103,15 +99,15 @@ TEST(modbus_handler_write_single_register, test_handle_write_single_register_add
  */
 TEST(modbus_handler_write_single_register, test_handle_write_single_register_zero_values) {
     uint8_t request[] = {0x01, 0x06, 0x00, 0x00, 0x00, 0x00}; // Addr = 0, Value = 0
-    memcpy(slave.frame, request, sizeof(request));
-    slave.frame_len = sizeof(request);
     
     uint8_t response[256];
     uint16_t response_len = 0;
-    ModbusExceptionCode result = handle_write_single_register(&slave, response, &response_len);
+    ModbusExceptionCode result = handle_write_single_register(&slave, &request[1], sizeof(request) - 1, response, &response_len);
     
     TEST_ASSERT_EQUAL(MODBUS_EX_NONE, result);
     TEST_ASSERT_EQUAL(0x0000, last_write_addr);
     TEST_ASSERT_EQUAL(0x0000, last_write_value);
     TEST_ASSERT_EQUAL_HEX8_ARRAY(&request[1], response, 4);
-}
\ No newline at end of file
+}
+
+#endif /* MODBUS_ENABLE_FC_06 */
@@ -1,25 +1,33 @@
 #include "unity_fixture.h"
 #include "modbus_slave.h"
+#include "modbus_slave_handlers.h"
 #include "modbus_crc16.h"
 
 #include <string.h>
 
+#if MODBUS_ENABLE_FC_03
+
 TEST_GROUP(modbus_integration);
 
 static ModbusSlave slave;
 static ModbusSlaveConfig config;
 
 static uint8_t last_transmitted_data[256];
+static const uint8_t *last_transmitted_ptr;
 static uint16_t last_transmitted_len;
 static bool transmit_called;
 
 static void mock_write(const uint8_t *data, uint16_t length) {
     memcpy(last_transmitted_data, data, length);
+    last_transmitted_ptr = data;
     last_transmitted_len = length;
     transmit_called = true;
 }
 
+static int read_holding_registers_calls;
+
 static ModbusExceptionCode mock_read_holding_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    read_holding_registers_calls++;
     if (addr > 1000) return MODBUS_EX_ILLEGAL_DATA_ADDRESS;
     
     for (int i = 0; i < count; i++) {
@@ -32,8 +40,10 @@ TEST_SETUP(modbus_integration) {
     memset(&slave, 0, sizeof(slave));
     memset(&config, 0, sizeof(config));
     memset(last_transmitted_data, 0, sizeof(last_transmitted_data));
+    last_transmitted_ptr = NULL;
     last_transmitted_len = 0;
     transmit_called = false;
+    read_holding_registers_calls = 0;
     
     config.address = 0x01;
     config.write = mock_write;
@@ -45,6 +55,24 @@ TEST_SETUP(modbus_integration) {
 TEST_TEAR_DOWN(modbus_integration) {
 }
 
+/**
+ * Send a request with a freshly computed CRC through the receive path
+ */
+static void send_request(const uint8_t *pdu, uint16_t pdu_len) {
+    uint8_t request[MODBUS_MAX_FRAME_LENGTH];
+    memcpy(request, pdu, pdu_len);
+    uint16_t crc = modbus_crc16(request, pdu_len);
+    modbus_le16_set(&request[pdu_len], crc);
+    
+    for (int i = 0; i < pdu_len + 2; i++) {
+        modbus_slave_rx_byte(&slave, request[i]);
+    }
+    
+    modbus_slave_1_5t_elapsed(&slave);
+    modbus_slave_3_5t_elapsed(&slave);
+    modbus_slave_poll(&slave);
+}
+
 /**
  * Test complete frame processing with valid request
  */
@@ -148,4 +176,902 @@ TEST(modbus_integration, test_wrong_address_frame) {
     
     // No response for wrong address
     TEST_ASSERT_FALSE(transmit_called);
-}
\ No newline at end of file
+}
+
+/**
+ * Test unknown function code is answered with an illegal function exception
+ */
+TEST(modbus_integration, test_unknown_function_exception) {
+    const uint8_t request[] = {0x01, 0x41, 0x00, 0x00, 0x00, 0x02}; // 0x41 is not implemented
+    send_request(request, sizeof(request));
+    
+    TEST_ASSERT_TRUE(transmit_called);
+    TEST_ASSERT_EQUAL(5, last_transmitted_len);
+    TEST_ASSERT_EQUAL(0x01, last_transmitted_data[0]);
+    TEST_ASSERT_EQUAL(0x41 | MODBUS_FC_EXCEPTION_MASK, last_transmitted_data[1]);
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_FUNCTION, last_transmitted_data[2]);
+}
+
+/**
+ * Test a PDU is processed without address byte or CRC, as done by non-RTU transports
+ */
+TEST(modbus_integration, test_process_pdu) {
+    const uint8_t request[] = {0x03, 0x00, 0x00, 0x00, 0x02};
+    uint8_t response[MODBUS_MAX_PDU_LENGTH];
+    uint16_t response_len = 0xFFFF;
+    
+    TEST_ASSERT_EQUAL(0, modbus_process_pdu(&slave, 0x01, request, sizeof(request), response, &response_len));
+    
+    const uint8_t expected[] = {0x03, 0x04, 0x01, 0xF4, 0x01, 0xF5};
+    TEST_ASSERT_EQUAL(sizeof(expected), response_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+    TEST_ASSERT_FALSE(transmit_called);
+}
+
+/**
+ * Test PDU exceptions, broadcasts and foreign units
+ */
+TEST(modbus_integration, test_process_pdu_exception_broadcast_unit) {
+    const uint8_t unsupported[] = {0x01, 0x00, 0x00, 0x00, 0x01};
+    const uint8_t read[] = {0x03, 0x00, 0x00, 0x00, 0x01};
+    uint8_t response[MODBUS_MAX_PDU_LENGTH];
+    uint16_t response_len;
+    
+    TEST_ASSERT_EQUAL(0, modbus_process_pdu(&slave, 0x01, unsupported, sizeof(unsupported), response, &response_len));
+    TEST_ASSERT_EQUAL(2, response_len);
+    TEST_ASSERT_EQUAL_HEX8(0x81, response[0]);
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_EX_ILLEGAL_FUNCTION, response[1]);
+    
+    TEST_ASSERT_EQUAL(0, modbus_process_pdu(&slave, 0x00, read, sizeof(read), response, &response_len));
+    TEST_ASSERT_EQUAL(0, response_len);
+    TEST_ASSERT_EQUAL(1, read_holding_registers_calls);
+    
+    TEST_ASSERT_EQUAL(-1, modbus_process_pdu(&slave, 0x02, read, sizeof(read), response, &response_len));
+    TEST_ASSERT_EQUAL(0, response_len);
+    TEST_ASSERT_EQUAL(-1, modbus_process_pdu(&slave, 0x01, read, 0, response, &response_len));
+}
+
+#if MODBUS_ENABLE_COUNTERS
+
+/**
+ * Test counters of a request answered normally
+ */
+TEST(modbus_integration, test_counters_valid_request) {
+    uint8_t request[8] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x02};
+    send_request(request, 6);
+    
+    TEST_ASSERT_EQUAL(1, slave.counters.bus_message);
+    TEST_ASSERT_EQUAL(1, slave.counters.slave_message);
+    TEST_ASSERT_EQUAL(0, slave.counters.bus_comm_error);
+    TEST_ASSERT_EQUAL(0, slave.counters.bus_exception);
+    TEST_ASSERT_EQUAL(0, slave.counters.slave_no_response);
+}
+
+/**
+ * Test CRC errors are counted as communication errors only
+ */
+TEST(modbus_integration, test_counters_crc_error) {
+    uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x02, 0x12, 0x34}; // Wrong CRC
+    
+    for (int i = 0; i < 8; i++) {
+        modbus_slave_rx_byte(&slave, request[i]);
+    }
+    modbus_slave_1_5t_elapsed(&slave);
+    modbus_slave_3_5t_elapsed(&slave);
+    modbus_slave_poll(&slave);
+    
+    TEST_ASSERT_EQUAL(1, slave.counters.bus_comm_error);
+    TEST_ASSERT_EQUAL(0, slave.counters.bus_message);
+    TEST_ASSERT_EQUAL(0, slave.counters.slave_message);
+}
+
+/**
+ * Test frames for other slaves are bus messages only
+ */
+TEST(modbus_integration, test_counters_other_slave) {
+    uint8_t request[8] = {0x02, 0x03, 0x00, 0x00, 0x00, 0x02};
+    send_request(request, 6);
+    
+    TEST_ASSERT_EQUAL(1, slave.counters.bus_message);
+    TEST_ASSERT_EQUAL(0, slave.counters.slave_message);
+}
+
+/**
+ * Test broadcasts are counted as messages left without a response
+ */
+TEST(modbus_integration, test_counters_broadcast) {
+    uint8_t request[8] = {0x00, 0x03, 0x00, 0x00, 0x00, 0x02};
+    send_request(request, 6);
+    
+    TEST_ASSERT_EQUAL(1, slave.counters.slave_message);
+    TEST_ASSERT_EQUAL(1, slave.counters.slave_no_response);
+}
+
+/**
+ * Test exception responses are counted
+ */
+TEST(modbus_integration, test_counters_exception) {
+    uint8_t request[8] = {0x01, 0x03, 0x03, 0xE9, 0x00, 0x02}; // Addr = 1001
+    send_request(request, 6);
+    
+    TEST_ASSERT_TRUE(transmit_called);
+    TEST_ASSERT_EQUAL(1, slave.counters.bus_exception);
+}
+
+/**
+ * Test receive buffer overruns of frames addressed to this slave are counted
+ */
+TEST(modbus_integration, test_counters_overrun) {
+    for (int i = 0; i <= MODBUS_SLAVE_FRAME_SIZE(&slave); i++) {
+        modbus_slave_rx_byte(&slave, 0x01);
+    }
+    
+    TEST_ASSERT_EQUAL(1, slave.counters.bus_char_overrun);
+}
+
+/**
+ * Test bus message count reported through Diagnostics includes the request itself
+ */
+TEST(modbus_integration, test_counters_diagnostics_request) {
+    uint8_t request[8] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x02};
+    send_request(request, 6);
+    
+    uint8_t diag[8] = {0x01, 0x08, 0x00, 0x0B, 0x00, 0x00};
+    send_request(diag, 6);
+    
+    TEST_ASSERT_TRUE(transmit_called);
+    TEST_ASSERT_EQUAL(8, last_transmitted_len);
+    TEST_ASSERT_EQUAL(0x08, last_transmitted_data[1]);
+    TEST_ASSERT_EQUAL(2, modbus_be16_get(&last_transmitted_data[4]));
+}
+
+#endif /* MODBUS_ENABLE_COUNTERS */
+
+#if MODBUS_ENABLE_FC_2B && MODBUS_DEVICE_ID_CACHE_SIZE
+
+static const ModbusDeviceIdObject device_id_objects[] = {
+    {0x00, 4, "ACME"},
+    {0x01, 5, "PX-10"},
+    {0x02, 4, "V1.2"},
+};
+
+/**
+ * Send a Read Device Identification request through the receive path
+ */
+static void receive_device_id_request(uint8_t address, uint8_t code, uint8_t object_id) {
+    uint8_t request[7] = {address, 0x2B, 0x0E, code, object_id};
+    uint16_t crc = modbus_crc16(request, 5);
+    request[5] = crc & 0xFF;
+    request[6] = (crc >> 8) & 0xFF;
+    
+    for (int i = 0; i < 7; i++) {
+        modbus_slave_rx_byte(&slave, request[i]);
+    }
+    
+    modbus_slave_1_5t_elapsed(&slave);
+    modbus_slave_3_5t_elapsed(&slave);
+    modbus_slave_poll(&slave);
+}
+
+/**
+ * Test discovery requests are answered straight from the precomputed frame
+ */
+TEST(modbus_integration, test_device_id_cached_response) {
+    config.device_id_objects = device_id_objects;
+    config.device_id_object_count = 3;
+    modbus_slave_init(&slave, &config);
+    
+    receive_device_id_request(0x01, 0x01, 0x00);
+    
+    TEST_ASSERT_TRUE(transmit_called);
+    TEST_ASSERT_TRUE(last_transmitted_ptr >= slave.device_id_cache &&
+                     last_transmitted_ptr < slave.device_id_cache + sizeof(slave.device_id_cache));
+    
+    // The cached frame must match the one built on demand
+    uint8_t expected[256] = {0x01};
+    uint16_t expected_len = 1;
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, modbus_device_id_build(&slave.config, 0x01, 0x00, &expected[1], &expected_len));
+    uint16_t crc = modbus_crc16(expected, expected_len);
+    modbus_le16_set(&expected[expected_len], crc);
+    expected_len += 2;
+    
+    TEST_ASSERT_EQUAL(expected_len, last_transmitted_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, last_transmitted_data, expected_len);
+}
+
+/**
+ * Test requests outside the cache are still built on demand
+ */
+TEST(modbus_integration, test_device_id_uncached_response) {
+    config.device_id_objects = device_id_objects;
+    config.device_id_object_count = 3;
+    modbus_slave_init(&slave, &config);
+    
+    receive_device_id_request(0x01, 0x04, 0x01);
+    
+    TEST_ASSERT_TRUE(transmit_called);
+    TEST_ASSERT_TRUE(last_transmitted_ptr < slave.device_id_cache ||
+                     last_transmitted_ptr >= slave.device_id_cache + sizeof(slave.device_id_cache));
+    TEST_ASSERT_EQUAL(0x04, last_transmitted_data[3]);
+    TEST_ASSERT_EQUAL(0x01, last_transmitted_data[8]);
+}
+
+/**
+ * Test the cache follows address changes and ignores broadcasts
+ */
+TEST(modbus_integration, test_device_id_cache_address) {
+    config.device_id_objects = device_id_objects;
+    config.device_id_object_count = 3;
+    modbus_slave_init(&slave, &config);
+    modbus_slave_set_address(&slave, 0x11);
+    
+    receive_device_id_request(0x11, 0x01, 0x00);
+    
+    TEST_ASSERT_TRUE(transmit_called);
+    TEST_ASSERT_EQUAL(0x11, last_transmitted_data[0]);
+    uint16_t crc = modbus_crc16(last_transmitted_data, last_transmitted_len - 2);
+    TEST_ASSERT_EQUAL_HEX16(crc, modbus_le16_get(&last_transmitted_data[last_transmitted_len - 2]));
+    
+    transmit_called = false;
+    receive_device_id_request(0x00, 0x01, 0x00);
+    TEST_ASSERT_FALSE(transmit_called);
+}
+
+#endif /* MODBUS_ENABLE_FC_2B && MODBUS_DEVICE_ID_CACHE_SIZE */
+
+#if MODBUS_RESPONSE_CACHE_ENTRIES
+
+static ModbusExceptionCode mock_write_single_register(uint16_t addr, uint16_t value) {
+    (void)(addr);
+    (void)(value);
+    return MODBUS_EX_NONE;
+}
+
+/**
+ * Test a repeated read is answered from the cache without calling the application
+ */
+TEST(modbus_integration, test_response_cache_hit) {
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x04};
+    
+    send_request(request, sizeof(request));
+    uint8_t first[256];
+    uint16_t first_len = last_transmitted_len;
+    memcpy(first, last_transmitted_data, first_len);
+    
+    transmit_called = false;
+    send_request(request, sizeof(request));
+    
+    TEST_ASSERT_TRUE(transmit_called);
+    TEST_ASSERT_EQUAL(1, read_holding_registers_calls);
+    TEST_ASSERT_EQUAL(first_len, last_transmitted_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(first, last_transmitted_data, first_len);
+}
+
+/**
+ * Test a different request misses the cache
+ */
+TEST(modbus_integration, test_response_cache_different_request) {
+    const uint8_t request_a[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x04};
+    const uint8_t request_b[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x05};
+    
+    send_request(request_a, sizeof(request_a));
+    send_request(request_b, sizeof(request_b));
+    TEST_ASSERT_EQUAL(2, read_holding_registers_calls);
+    TEST_ASSERT_EQUAL(10, last_transmitted_data[2]);
+    
+    // Both requests are now cached
+    send_request(request_a, sizeof(request_a));
+    send_request(request_b, sizeof(request_b));
+    TEST_ASSERT_EQUAL(2, read_holding_registers_calls);
+}
+
+/**
+ * Test bumping the generation invalidates cached responses
+ */
+TEST(modbus_integration, test_response_cache_generation) {
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x04};
+    
+    send_request(request, sizeof(request));
+    modbus_slave_bump_generation(&slave);
+    send_request(request, sizeof(request));
+    
+    TEST_ASSERT_EQUAL(2, read_holding_registers_calls);
+}
+
+static bool bump_in_read; // Bump once from inside the next read callback
+
+static ModbusExceptionCode mock_read_interrupted(uint16_t addr, uint16_t count, uint8_t *dest) {
+    if (bump_in_read) { // As if an ISR changed the data while the response is built
+        bump_in_read = false;
+        modbus_slave_bump_generation(&slave);
+    }
+    return mock_read_holding_registers(addr, count, dest);
+}
+
+/**
+ * Test a bump while a response is built keeps that response from being reused
+ */
+TEST(modbus_integration, test_response_cache_bump_during_request) {
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x04};
+
+    config.read_holding_registers = mock_read_interrupted;
+    modbus_slave_init(&slave, &config);
+    bump_in_read = true;
+
+    send_request(request, sizeof(request));
+    send_request(request, sizeof(request)); // Built before the bump, not reused
+    send_request(request, sizeof(request)); // Cached again
+
+    TEST_ASSERT_EQUAL(2, read_holding_registers_calls);
+}
+
+/**
+ * Test a successful write invalidates cached responses
+ */
+TEST(modbus_integration, test_response_cache_write_invalidates) {
+    const uint8_t read[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x04};
+    const uint8_t write[] = {0x01, 0x06, 0x00, 0x11, 0x12, 0x34};
+    slave.config.write_single_register = mock_write_single_register;
+    
+    send_request(read, sizeof(read));
+    send_request(write, sizeof(write));
+    send_request(read, sizeof(read));
+    
+    TEST_ASSERT_EQUAL(2, read_holding_registers_calls);
+}
+
+/**
+ * Test exception responses are not cached
+ */
+TEST(modbus_integration, test_response_cache_skips_exceptions) {
+    const uint8_t request[] = {0x01, 0x03, 0x03, 0xE9, 0x00, 0x01}; // Addr = 1001
+    
+    send_request(request, sizeof(request));
+    send_request(request, sizeof(request));
+    
+    TEST_ASSERT_EQUAL(2, read_holding_registers_calls);
+    TEST_ASSERT_EQUAL(0x83, last_transmitted_data[1]);
+}
+
+#endif /* MODBUS_RESPONSE_CACHE_ENTRIES */
+
+#if MODBUS_DIRTY_COIL_COUNT && MODBUS_DIRTY_REGISTER_COUNT && \
+    MODBUS_ENABLE_FC_05 && MODBUS_ENABLE_FC_06 && MODBUS_ENABLE_FC_0F && \
+    MODBUS_ENABLE_FC_10 && MODBUS_ENABLE_FC_16 && MODBUS_ENABLE_FC_17
+
+static ModbusExceptionCode mock_accept_single(uint16_t addr, uint16_t value) {
+    (void)(value);
+    return addr > 1000 ? MODBUS_EX_ILLEGAL_DATA_ADDRESS : MODBUS_EX_NONE;
+}
+
+static ModbusExceptionCode mock_accept_multiple(uint16_t addr, uint16_t count, const uint8_t *src) {
+    (void)(addr);
+    (void)(count);
+    (void)(src);
+    return MODBUS_EX_NONE;
+}
+
+static ModbusExceptionCode mock_accept_mask(uint16_t addr, uint16_t and_mask, uint16_t or_mask) {
+    (void)(addr);
+    (void)(and_mask);
+    (void)(or_mask);
+    return MODBUS_EX_NONE;
+}
+
+static ModbusExceptionCode mock_accept_read_write(uint16_t read_addr, uint16_t read_count,
+                                                  uint16_t write_addr, uint16_t write_count,
+                                                  const uint8_t *write_data, uint8_t *read_data) {
+    (void)(read_addr);
+    (void)(write_addr);
+    (void)(write_count);
+    (void)(write_data);
+    memset(read_data, 0, read_count * 2);
+    return MODBUS_EX_NONE;
+}
+
+/**
+ * Enable every write path and re-initialize the slave
+ */
+static void enable_writes(void) {
+    config.write_single_coil = mock_accept_single;
+    config.write_single_register = mock_accept_single;
+    config.write_multiple_coils = mock_accept_multiple;
+    config.write_multiple_registers = mock_accept_multiple;
+    config.mask_write_register = mock_accept_mask;
+    config.read_write_multiple_registers = mock_accept_read_write;
+    modbus_slave_init(&slave, &config);
+}
+
+/**
+ * Test register writes of every function code are reported once, in address order
+ */
+TEST(modbus_integration, test_dirty_registers_written) {
+    enable_writes();
+
+    const uint8_t mask_write[] = {0x01, 0x16, 0x00, 0x63, 0x00, 0xF2, 0x00, 0x25};
+    const uint8_t single[] = {0x01, 0x06, 0x00, 0x05, 0x12, 0x34};
+    const uint8_t multiple[] = {0x01, 0x10, 0x00, 0x1E, 0x00, 0x03, 0x06, 0, 1, 0, 2, 0, 3};
+    const uint8_t read_write[] = {0x01, 0x17, 0x00, 0x00, 0x00, 0x01, 0x00, 0x40, 0x00, 0x02, 0x04, 0, 1, 0, 2};
+    send_request(mask_write, sizeof(mask_write));
+    send_request(single, sizeof(single));
+    send_request(multiple, sizeof(multiple));
+    send_request(read_write, sizeof(read_write));
+
+    const int32_t expected[] = {5, 30, 31, 32, 64, 65, 99};
+    ModbusDirtyCursor cursor = {0};
+    for (unsigned i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        TEST_ASSERT_EQUAL(expected[i], modbus_slave_next_dirty(&slave, 0x01, MODBUS_DIRTY_HOLDING_REGISTERS, &cursor));
+    }
+    TEST_ASSERT_EQUAL(-1, modbus_slave_next_dirty(&slave, 0x01, MODBUS_DIRTY_HOLDING_REGISTERS, &cursor));
+
+    ModbusDirtyCursor again = {0};
+    TEST_ASSERT_EQUAL(-1, modbus_slave_next_dirty(&slave, 0x01, MODBUS_DIRTY_HOLDING_REGISTERS, &again));
+    TEST_ASSERT_EQUAL(-1, modbus_slave_next_dirty(&slave, 0x01, MODBUS_DIRTY_COILS, &again));
+}
+
+/**
+ * Test coil writes are tracked up to MODBUS_DIRTY_COIL_COUNT
+ */
+TEST(modbus_integration, test_dirty_coils_written) {
+    enable_writes();
+
+    const uint8_t single[] = {0x01, 0x05, 0x00, 0x03, 0xFF, 0x00};
+    const uint8_t multiple[] = {0x01, 0x0F, 0x00, 0x24, 0x00, 0x0A, 0x02, 0xFF, 0x03};
+    send_request(single, sizeof(single));
+    send_request(multiple, sizeof(multiple));
+
+    const int32_t expected[] = {3, 36, 37, 38, 39};
+    ModbusDirtyCursor cursor = {0};
+    for (unsigned i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        TEST_ASSERT_EQUAL(expected[i], modbus_slave_next_dirty(&slave, 0x01, MODBUS_DIRTY_COILS, &cursor));
+    }
+    TEST_ASSERT_EQUAL(-1, modbus_slave_next_dirty(&slave, 0x01, MODBUS_DIRTY_COILS, &cursor));
+}
+
+/**
+ * Test rejected writes leave the bitmaps untouched
+ */
+TEST(modbus_integration, test_dirty_skips_failed_writes) {
+    enable_writes();
+
+    const uint8_t rejected[] = {0x01, 0x06, 0x07, 0xD0, 0x00, 0x01};
+    send_request(rejected, sizeof(rejected));
+    TEST_ASSERT_EQUAL_HEX8(0x86, last_transmitted_data[1]);
+
+    ModbusDirtyCursor cursor = {0};
+    TEST_ASSERT_EQUAL(-1, modbus_slave_next_dirty(&slave, 0x01, MODBUS_DIRTY_HOLDING_REGISTERS, &cursor));
+}
+
+#endif /* MODBUS_DIRTY_COIL_COUNT && MODBUS_DIRTY_REGISTER_COUNT && ... */
+
+#if MODBUS_STAGED_WRITES && MODBUS_ENABLE_FC_17
+
+static int commit_calls;
+static uint16_t commit_addr;
+static uint16_t commit_count;
+static ModbusExceptionCode commit_result;
+
+static ModbusExceptionCode mock_commit_registers(uint16_t addr, uint16_t count, const uint8_t *src) {
+    (void)(src);
+    commit_calls++;
+    commit_addr = addr;
+    commit_count = count;
+    return commit_result;
+}
+
+static ModbusExceptionCode mock_validate_register(uint16_t addr, uint16_t value) {
+    (void)(addr);
+    return value == 0xFFFF ? MODBUS_EX_ILLEGAL_DATA_VALUE : MODBUS_EX_NONE;
+}
+
+/**
+ * Enable staged writes and re-initialize the slave
+ */
+static void enable_staged_writes(void) {
+    commit_calls = 0;
+    commit_result = MODBUS_EX_NONE;
+    config.write_multiple_registers = mock_commit_registers;
+    config.validate_register = mock_validate_register;
+    config.staged_writes = true;
+    modbus_slave_init(&slave, &config);
+}
+
+/**
+ * Build a Write Multiple Registers request of count registers holding 0x0100 + i
+ */
+static uint16_t build_write_multiple(uint8_t *request, uint16_t addr, uint16_t count) {
+    request[0] = 0x01;
+    request[1] = 0x10;
+    modbus_be16_set(&request[2], addr);
+    modbus_be16_set(&request[4], count);
+    request[6] = (uint8_t)(count * 2);
+    for (uint16_t i = 0; i < count; i++) {
+        modbus_be16_set(&request[7 + i * 2], 0x0100 + i);
+    }
+    return 7 + count * 2;
+}
+
+/**
+ * Test a large write is committed in a single call after the request succeeded
+ */
+TEST(modbus_integration, test_staged_write_single_commit) {
+    enable_staged_writes();
+
+    uint8_t request[MODBUS_MAX_FRAME_LENGTH];
+    send_request(request, build_write_multiple(request, 0x0020, 100));
+
+    TEST_ASSERT_EQUAL(1, commit_calls);
+    TEST_ASSERT_EQUAL(0x0020, commit_addr);
+    TEST_ASSERT_EQUAL(100, commit_count);
+    TEST_ASSERT_EQUAL_HEX8(0x10, last_transmitted_data[1]);
+}
+
+/**
+ * Test a single invalid value rejects the whole request and applies nothing
+ */
+TEST(modbus_integration, test_staged_write_validation_rejects) {
+    enable_staged_writes();
+
+    uint8_t request[MODBUS_MAX_FRAME_LENGTH];
+    uint16_t len = build_write_multiple(request, 0x0020, 100);
+    modbus_be16_set(&request[7 + 50 * 2], 0xFFFF);
+    send_request(request, len);
+
+    TEST_ASSERT_EQUAL(0, commit_calls);
+    TEST_ASSERT_EQUAL_HEX8(0x90, last_transmitted_data[1]);
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_EX_ILLEGAL_DATA_VALUE, last_transmitted_data[2]);
+}
+
+/**
+ * Test 0x17 reads back the staged values and commits them afterwards
+ */
+TEST(modbus_integration, test_staged_read_write_overlay) {
+    enable_staged_writes();
+
+    // Read 0-3, write 2-4
+    const uint8_t request[] = {0x01, 0x17, 0x00, 0x00, 0x00, 0x04, 0x00, 0x02, 0x00, 0x03,
+                               0x06, 0xAA, 0xAA, 0xBB, 0xBB, 0xCC, 0xCC};
+    send_request(request, sizeof(request));
+
+    const uint8_t expected[] = {0x01, 0x17, 0x08, 0x01, 0xF4, 0x01, 0xF5, 0xAA, 0xAA, 0xBB, 0xBB};
+    TEST_ASSERT_EQUAL(sizeof(expected) + 2, last_transmitted_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, last_transmitted_data, sizeof(expected));
+    TEST_ASSERT_EQUAL(1, commit_calls);
+    TEST_ASSERT_EQUAL(2, commit_addr);
+    TEST_ASSERT_EQUAL(3, commit_count);
+}
+
+/**
+ * Test a failing read part of 0x17 drops the staged write
+ */
+TEST(modbus_integration, test_staged_read_write_read_error) {
+    enable_staged_writes();
+
+    const uint8_t request[] = {0x01, 0x17, 0x07, 0xD0, 0x00, 0x01, 0x00, 0x02, 0x00, 0x01,
+                               0x02, 0x12, 0x34};
+    send_request(request, sizeof(request));
+
+    TEST_ASSERT_EQUAL(0, commit_calls);
+    TEST_ASSERT_EQUAL_HEX8(0x97, last_transmitted_data[1]);
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_EX_ILLEGAL_DATA_ADDRESS, last_transmitted_data[2]);
+}
+
+/**
+ * Test a failing commit is reported instead of the normal response
+ */
+TEST(modbus_integration, test_staged_write_commit_error) {
+    enable_staged_writes();
+    commit_result = MODBUS_EX_SLAVE_DEVICE_FAILURE;
+
+    uint8_t request[MODBUS_MAX_FRAME_LENGTH];
+    send_request(request, build_write_multiple(request, 0x0000, 2));
+
+    TEST_ASSERT_EQUAL(1, commit_calls);
+    TEST_ASSERT_EQUAL_HEX8(0x90, last_transmitted_data[1]);
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_EX_SLAVE_DEVICE_FAILURE, last_transmitted_data[2]);
+}
+
+#endif /* MODBUS_STAGED_WRITES && MODBUS_ENABLE_FC_17 */
+
+#if MODBUS_ENABLE_TX_HOOKS
+
+static char tx_events[16]; // One letter per hook or write call, in call order
+static uint8_t tx_event_count;
+static uint16_t delayed_us;
+
+static void record_tx_event(char event) {
+    if (tx_event_count < sizeof(tx_events) - 1) tx_events[tx_event_count++] = event;
+}
+
+static void mock_tx_begin(void) { record_tx_event('B'); }
+static void mock_tx_end(void) { record_tx_event('E'); }
+
+static void mock_tx_write(const uint8_t *data, uint16_t length) {
+    record_tx_event('W');
+    mock_write(data, length);
+}
+
+static void mock_delay_us(uint16_t us) {
+    record_tx_event('D');
+    delayed_us = us;
+}
+
+/**
+ * Enable the transmit hooks with the given turnaround and re-initialize the slave
+ */
+static void enable_tx_hooks(uint16_t turnaround_us) {
+    memset(tx_events, 0, sizeof(tx_events));
+    tx_event_count = 0;
+    delayed_us = 0;
+    config.write = mock_tx_write;
+    config.tx_begin = mock_tx_begin;
+    config.tx_end = mock_tx_end;
+    config.delay_us = mock_delay_us;
+    config.turnaround_us = turnaround_us;
+    TEST_ASSERT_EQUAL(0, modbus_slave_init(&slave, &config));
+}
+
+/**
+ * Test the response is sent after the turnaround delay and framed by the hooks
+ */
+TEST(modbus_integration, test_tx_hooks_order) {
+    enable_tx_hooks(300);
+
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x01};
+    send_request(request, sizeof(request));
+    TEST_ASSERT_EQUAL_STRING("DBWE", tx_events);
+    TEST_ASSERT_EQUAL(300, delayed_us);
+
+    // Exceptions go through the same path, without turnaround no delay is requested
+    enable_tx_hooks(0);
+    const uint8_t unknown[] = {0x01, 0x41};
+    send_request(unknown, sizeof(unknown));
+    TEST_ASSERT_EQUAL_STRING("BWE", tx_events);
+    TEST_ASSERT_EQUAL_HEX8(0xC1, last_transmitted_data[1]);
+}
+
+/**
+ * Test the bus is never driven for frames left without a response
+ */
+TEST(modbus_integration, test_tx_hooks_no_response) {
+    enable_tx_hooks(300);
+
+    const uint8_t broadcast[] = {0x00, 0x03, 0x00, 0x00, 0x00, 0x01};
+    send_request(broadcast, sizeof(broadcast));
+    const uint8_t other_slave[] = {0x02, 0x03, 0x00, 0x00, 0x00, 0x01};
+    send_request(other_slave, sizeof(other_slave));
+
+    TEST_ASSERT_EQUAL(0, tx_event_count);
+}
+
+/**
+ * Test a turnaround delay without a delay function is refused
+ */
+TEST(modbus_integration, test_tx_hooks_turnaround_requires_delay) {
+    config.turnaround_us = 300;
+    TEST_ASSERT_EQUAL(-1, modbus_slave_init(&slave, &config));
+
+    config.turnaround_us = 0;
+    TEST_ASSERT_EQUAL(0, modbus_slave_init(&slave, &config));
+}
+
+#endif /* MODBUS_ENABLE_TX_HOOKS */
+
+#if MODBUS_ENABLE_DEADLINE
+
+static uint32_t clock_now;
+
+static uint32_t mock_now_ms(void) {
+    return clock_now;
+}
+
+/**
+ * Enable a response deadline and re-initialize the slave
+ */
+static void enable_deadline(uint16_t deadline_ms) {
+    config.now_ms = mock_now_ms;
+    config.response_deadline_ms = deadline_ms;
+    TEST_ASSERT_EQUAL(0, modbus_slave_init(&slave, &config));
+}
+
+/**
+ * Receive a request at the current clock without processing it
+ */
+static void receive_request(const uint8_t *pdu, uint16_t pdu_len) {
+    uint8_t request[MODBUS_MAX_FRAME_LENGTH];
+    memcpy(request, pdu, pdu_len);
+    modbus_le16_set(&request[pdu_len], modbus_crc16(request, pdu_len));
+
+    for (int i = 0; i < pdu_len + 2; i++) {
+        modbus_slave_rx_byte(&slave, request[i]);
+    }
+    modbus_slave_1_5t_elapsed(&slave);
+    modbus_slave_3_5t_elapsed(&slave);
+}
+
+/**
+ * Test a request processed within its deadline is answered and a late one
+ * is dropped and counted
+ */
+TEST(modbus_integration, test_deadline_drops_stale_request) {
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x01};
+
+    enable_deadline(50);
+
+    clock_now = 1000;
+    receive_request(request, sizeof(request));
+    clock_now = 1050;
+    modbus_slave_poll(&slave);
+    TEST_ASSERT_TRUE(transmit_called);
+    TEST_ASSERT_EQUAL(1, read_holding_registers_calls);
+
+    transmit_called = false;
+    receive_request(request, sizeof(request));
+    clock_now = 1101;
+    modbus_slave_poll(&slave);
+    TEST_ASSERT_FALSE(transmit_called);
+    TEST_ASSERT_EQUAL(1, read_holding_registers_calls);
+    TEST_ASSERT_EQUAL(1, slave.stale_frames);
+#if MODBUS_ENABLE_COUNTERS
+    TEST_ASSERT_EQUAL(1, slave.counters.slave_no_response);
+#endif
+
+    // The age is taken modulo the clock width
+    clock_now = 0xFFFFFFF0u;
+    receive_request(request, sizeof(request));
+    clock_now = 0x00000010u;
+    modbus_slave_poll(&slave);
+    TEST_ASSERT_TRUE(transmit_called);
+}
+
+/**
+ * Test frames for other slaves and broadcasts are not counted as stale
+ */
+TEST(modbus_integration, test_deadline_ignores_unanswered_frames) {
+    enable_deadline(50);
+
+    clock_now = 0;
+    const uint8_t other_slave[] = {0x02, 0x03, 0x00, 0x00, 0x00, 0x01};
+    receive_request(other_slave, sizeof(other_slave));
+    clock_now = 500;
+    modbus_slave_poll(&slave);
+
+    const uint8_t broadcast[] = {0x00, 0x03, 0x00, 0x00, 0x00, 0x01};
+    receive_request(broadcast, sizeof(broadcast));
+    clock_now = 1000;
+    modbus_slave_poll(&slave);
+
+    TEST_ASSERT_EQUAL(0, slave.stale_frames);
+    TEST_ASSERT_EQUAL(1, read_holding_registers_calls); // The broadcast was still executed
+}
+
+/**
+ * Test a deadline without a clock is refused
+ */
+TEST(modbus_integration, test_deadline_requires_clock) {
+    config.response_deadline_ms = 50;
+    TEST_ASSERT_EQUAL(-1, modbus_slave_init(&slave, &config));
+}
+
+#endif /* MODBUS_ENABLE_DEADLINE */
+
+#if MODBUS_MAX_UNITS > 1 && MODBUS_ENABLE_FC_06
+
+static ModbusSlaveConfig second_unit;
+static uint16_t unit_writes[2];
+
+static ModbusExceptionCode mock_read_unit_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    for (int i = 0; i < count; i++) {
+        modbus_be16_set(&dest[i * 2], 0x7000 + addr + i);
+    }
+    return MODBUS_EX_NONE;
+}
+
+static ModbusExceptionCode mock_write_primary(uint16_t addr, uint16_t value) {
+    (void)(addr);
+    unit_writes[0] = value;
+    return MODBUS_EX_NONE;
+}
+
+static ModbusExceptionCode mock_write_second(uint16_t addr, uint16_t value) {
+    (void)(addr);
+    unit_writes[1] = value;
+    return MODBUS_EX_NONE;
+}
+
+/**
+ * Serve a second unit at address 0x05 with its own callbacks
+ */
+static void add_second_unit(void) {
+    memset(&second_unit, 0, sizeof(second_unit));
+    memset(unit_writes, 0, sizeof(unit_writes));
+    second_unit.address = 0x05;
+    second_unit.read_holding_registers = mock_read_unit_registers;
+    second_unit.write_single_register = mock_write_second;
+    config.write_single_register = mock_write_primary;
+    modbus_slave_init(&slave, &config);
+    TEST_ASSERT_EQUAL(0, modbus_slave_add_unit(&slave, &second_unit));
+}
+
+/**
+ * Test requests are routed to the callbacks of the addressed unit
+ */
+TEST(modbus_integration, test_unit_routing) {
+    add_second_unit();
+
+    const uint8_t to_second[] = {0x05, 0x03, 0x00, 0x01, 0x00, 0x01};
+    send_request(to_second, sizeof(to_second));
+    const uint8_t second_response[] = {0x05, 0x03, 0x02, 0x70, 0x01};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(second_response, last_transmitted_data, sizeof(second_response));
+    TEST_ASSERT_EQUAL(0, read_holding_registers_calls);
+
+    const uint8_t to_primary[] = {0x01, 0x03, 0x00, 0x01, 0x00, 0x01};
+    send_request(to_primary, sizeof(to_primary));
+    const uint8_t primary_response[] = {0x01, 0x03, 0x02, 0x01, 0xF4};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(primary_response, last_transmitted_data, sizeof(primary_response));
+    TEST_ASSERT_EQUAL(1, read_holding_registers_calls);
+
+    // A unit without the callback answers with its own exception
+    const uint8_t unsupported[] = {0x05, 0x04, 0x00, 0x00, 0x00, 0x01};
+    send_request(unsupported, sizeof(unsupported));
+    TEST_ASSERT_EQUAL_HEX8(0x05, last_transmitted_data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x84, last_transmitted_data[1]);
+}
+
+/**
+ * Test addresses without a unit are ignored
+ */
+TEST(modbus_integration, test_unit_unknown_address) {
+    add_second_unit();
+
+    const uint8_t request[] = {0x06, 0x03, 0x00, 0x00, 0x00, 0x01};
+    send_request(request, sizeof(request));
+
+    TEST_ASSERT_FALSE(transmit_called);
+}
+
+/**
+ * Test a broadcast write is executed by every unit
+ */
+TEST(modbus_integration, test_unit_broadcast) {
+    add_second_unit();
+
+    const uint8_t request[] = {0x00, 0x06, 0x00, 0x02, 0x12, 0x34};
+    send_request(request, sizeof(request));
+
+    TEST_ASSERT_FALSE(transmit_called);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, unit_writes[0]);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, unit_writes[1]);
+}
+
+#if MODBUS_DIRTY_REGISTER_COUNT
+/**
+ * Test writes are tracked per unit, a broadcast for every unit
+ */
+TEST(modbus_integration, test_unit_dirty_tracking) {
+    add_second_unit();
+
+    const uint8_t to_second[] = {0x05, 0x06, 0x00, 0x02, 0x12, 0x34};
+    send_request(to_second, sizeof(to_second));
+
+    ModbusDirtyCursor primary = {0};
+    ModbusDirtyCursor second = {0};
+    TEST_ASSERT_EQUAL(-1, modbus_slave_next_dirty(&slave, 0x01, MODBUS_DIRTY_HOLDING_REGISTERS, &primary));
+    TEST_ASSERT_EQUAL(2, modbus_slave_next_dirty(&slave, 0x05, MODBUS_DIRTY_HOLDING_REGISTERS, &second));
+    TEST_ASSERT_EQUAL(-1, modbus_slave_next_dirty(&slave, 0x05, MODBUS_DIRTY_HOLDING_REGISTERS, &second));
+
+    const uint8_t broadcast[] = {0x00, 0x06, 0x00, 0x07, 0x12, 0x34};
+    send_request(broadcast, sizeof(broadcast));
+
+    ModbusDirtyCursor primary_again = {0};
+    ModbusDirtyCursor second_again = {0};
+    ModbusDirtyCursor unknown = {0};
+    TEST_ASSERT_EQUAL(7, modbus_slave_next_dirty(&slave, 0x01, MODBUS_DIRTY_HOLDING_REGISTERS, &primary_again));
+    TEST_ASSERT_EQUAL(7, modbus_slave_next_dirty(&slave, 0x05, MODBUS_DIRTY_HOLDING_REGISTERS, &second_again));
+    TEST_ASSERT_EQUAL(-1, modbus_slave_next_dirty(&slave, 0x06, MODBUS_DIRTY_HOLDING_REGISTERS, &unknown));
+}
+#endif
+
+#endif /* MODBUS_MAX_UNITS > 1 && MODBUS_ENABLE_FC_06 */
+
+#endif /* MODBUS_ENABLE_FC_03 */
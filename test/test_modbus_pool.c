@@ -0,0 +1,94 @@
+#include "unity_fixture.h"
+#include "modbus_pool.h"
+
+#include <string.h>
+
+TEST_GROUP(modbus_pool);
+
+typedef struct {
+    uint32_t id;
+    uint8_t payload[13];
+} PoolObject;
+
+#define POOL_CAPACITY 4
+
+static ModbusPool pool;
+static uint64_t storage[(sizeof(PoolObject) + 8) * POOL_CAPACITY / sizeof(uint64_t) + 1];
+
+TEST_SETUP(modbus_pool) {
+    TEST_ASSERT_TRUE(modbus_pool_storage_size(sizeof(PoolObject), POOL_CAPACITY) <= sizeof(storage));
+    TEST_ASSERT_EQUAL(0, modbus_pool_init(&pool, storage, sizeof(PoolObject), POOL_CAPACITY));
+}
+
+TEST_TEAR_DOWN(modbus_pool) {}
+
+/**
+ * Test that the pool hands out distinct aligned objects until it is
+ * exhausted, and counts the refusals
+ */
+TEST(modbus_pool, test_pool_exhaustion) {
+    PoolObject *objects[POOL_CAPACITY];
+
+    for (uint32_t i = 0; i < POOL_CAPACITY; i++) {
+        objects[i] = modbus_pool_alloc(&pool);
+        TEST_ASSERT_NOT_NULL(objects[i]);
+        TEST_ASSERT_EQUAL(0, (uintptr_t)objects[i] & (MODBUS_POOL_ALIGN - 1u));
+        TEST_ASSERT_EQUAL(i, modbus_pool_index(&pool, objects[i]));
+        TEST_ASSERT_EQUAL_PTR(objects[i], modbus_pool_object(&pool, i));
+        memset(objects[i], 0xA5, sizeof(PoolObject));
+    }
+
+    TEST_ASSERT_NULL(modbus_pool_alloc(&pool));
+    TEST_ASSERT_NULL(modbus_pool_alloc(&pool));
+    TEST_ASSERT_EQUAL(POOL_CAPACITY, pool.in_use);
+    TEST_ASSERT_EQUAL(POOL_CAPACITY, pool.peak);
+    TEST_ASSERT_EQUAL(2, pool.exhausted);
+
+    modbus_pool_free(&pool, objects[2]);
+    TEST_ASSERT_EQUAL(POOL_CAPACITY - 1, pool.in_use);
+    TEST_ASSERT_EQUAL_PTR(objects[2], modbus_pool_alloc(&pool));
+}
+
+/**
+ * Test that freed objects are reused most recently freed first, keep their
+ * contents, and that churn does not grow the pool
+ */
+TEST(modbus_pool, test_pool_reuse) {
+    PoolObject *a = modbus_pool_alloc(&pool);
+    PoolObject *b = modbus_pool_alloc(&pool);
+    a->id = 1;
+    b->id = 2;
+
+    modbus_pool_free(&pool, a);
+    modbus_pool_free(&pool, b);
+    TEST_ASSERT_EQUAL(0, pool.in_use);
+    TEST_ASSERT_EQUAL(1, a->id);
+    TEST_ASSERT_EQUAL(2, b->id);
+
+    TEST_ASSERT_EQUAL_PTR(b, modbus_pool_alloc(&pool));
+    TEST_ASSERT_EQUAL_PTR(a, modbus_pool_alloc(&pool));
+    modbus_pool_free(&pool, a);
+    modbus_pool_free(&pool, b);
+
+    for (int i = 0; i < 100; i++) {
+        PoolObject *object = modbus_pool_alloc(&pool);
+        TEST_ASSERT_NOT_NULL(object);
+        modbus_pool_free(&pool, object);
+    }
+
+    TEST_ASSERT_EQUAL(2, pool.used);
+    TEST_ASSERT_EQUAL(2, pool.peak);
+    TEST_ASSERT_EQUAL(0, pool.exhausted);
+}
+
+/**
+ * Test that invalid storage is rejected
+ */
+TEST(modbus_pool, test_pool_invalid) {
+    ModbusPool other;
+
+    TEST_ASSERT_EQUAL(-1, modbus_pool_init(&other, NULL, sizeof(PoolObject), 1));
+    TEST_ASSERT_EQUAL(-1, modbus_pool_init(&other, storage, 0, 1));
+    TEST_ASSERT_EQUAL(-1, modbus_pool_init(&other, storage, sizeof(PoolObject), 0));
+    TEST_ASSERT_EQUAL(-1, modbus_pool_init(&other, (uint8_t *)storage + 1, sizeof(PoolObject), 1));
+}
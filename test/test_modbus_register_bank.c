@@ -0,0 +1,238 @@
+#include "unity_fixture.h"
+#include "modbus_register_bank.h"
+
+#if MODBUS_ENABLE_REGISTER_BANK
+
+#if MODBUS_REGISTER_BANK_THREADS
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#endif
+
+#define CONTENDED_REGISTERS 125 /* Largest block a read request can ask for */
+
+static ModbusRegisterBank bank;
+static _Atomic uint16_t storage[8];
+
+TEST_GROUP(modbus_register_bank);
+
+TEST_SETUP(modbus_register_bank) {
+    for (unsigned i = 0; i < 8; i++) {
+        atomic_init(&storage[i], 0);
+    }
+    modbus_register_bank_init(&bank, storage, 100, 8);
+}
+
+TEST_TEAR_DOWN(modbus_register_bank) {}
+
+/**
+ * Test initialization argument checks
+ */
+TEST(modbus_register_bank, test_register_bank_init) {
+    ModbusRegisterBank other;
+
+    TEST_ASSERT_EQUAL(-1, modbus_register_bank_init(NULL, storage, 0, 8));
+    TEST_ASSERT_EQUAL(-1, modbus_register_bank_init(&other, NULL, 0, 8));
+    TEST_ASSERT_EQUAL(-1, modbus_register_bank_init(&other, storage, 0xFFFC, 8));
+    TEST_ASSERT_EQUAL(0, modbus_register_bank_init(&other, storage, 0xFFF8, 8));
+}
+
+/**
+ * Test publishing and snapshotting registers in host byte order
+ */
+TEST(modbus_register_bank, test_register_bank_write_snapshot) {
+    const uint16_t values[2] = {0x1234, 0x5678};
+    uint16_t copy[2];
+
+    TEST_ASSERT_EQUAL(0, modbus_register_bank_write(&bank, 102, values, 2));
+    TEST_ASSERT_EQUAL_HEX16(0x1234, storage[2]);
+    TEST_ASSERT_EQUAL_HEX16(0x5678, storage[3]);
+
+    TEST_ASSERT_EQUAL(0, modbus_register_bank_snapshot(&bank, 102, 2, copy));
+    TEST_ASSERT_EQUAL_HEX16(0x1234, copy[0]);
+    TEST_ASSERT_EQUAL_HEX16(0x5678, copy[1]);
+}
+
+/**
+ * Test Modbus side read and store in big-endian byte order
+ */
+TEST(modbus_register_bank, test_register_bank_read_store) {
+    const uint8_t request[4] = {0xAB, 0xCD, 0x00, 0x01};
+    uint8_t response[4];
+
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, modbus_register_bank_store(&bank, 106, 2, request));
+    TEST_ASSERT_EQUAL_HEX16(0xABCD, storage[6]);
+    TEST_ASSERT_EQUAL_HEX16(0x0001, storage[7]);
+
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, modbus_register_bank_read(&bank, 106, 2, response));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(request, response, 4);
+}
+
+/**
+ * Test accesses outside the bank
+ */
+TEST(modbus_register_bank, test_register_bank_out_of_range) {
+    uint8_t data[4] = {0};
+    uint16_t values[2] = {0};
+
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, modbus_register_bank_read(&bank, 99, 2, data));
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, modbus_register_bank_read(&bank, 107, 2, data));
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, modbus_register_bank_store(&bank, 108, 1, data));
+    TEST_ASSERT_EQUAL(-1, modbus_register_bank_write(&bank, 107, values, 2));
+    TEST_ASSERT_EQUAL(-1, modbus_register_bank_snapshot(&bank, 0, 1, values));
+}
+
+/**
+ * Test that block readers and writers back off while a publication is in progress
+ */
+TEST(modbus_register_bank, test_register_bank_busy_while_publishing) {
+    uint8_t data[4] = {0x00, 0x01, 0x00, 0x02};
+    uint16_t values[2] = {1, 2};
+
+    TEST_ASSERT_EQUAL(0, modbus_register_bank_write_begin(&bank));
+    atomic_store(&storage[0], 0xFFFF);
+
+    TEST_ASSERT_EQUAL(MODBUS_EX_SLAVE_DEVICE_BUSY, modbus_register_bank_read(&bank, 100, 2, data));
+    TEST_ASSERT_EQUAL(MODBUS_EX_SLAVE_DEVICE_BUSY, modbus_register_bank_store(&bank, 102, 2, data));
+    TEST_ASSERT_EQUAL(-1, modbus_register_bank_write(&bank, 102, values, 2));
+    TEST_ASSERT_EQUAL(-1, modbus_register_bank_snapshot(&bank, 100, 2, values));
+
+    modbus_register_bank_write_end(&bank);
+
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, modbus_register_bank_read(&bank, 100, 2, data));
+    TEST_ASSERT_EQUAL_HEX8(0xFF, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, data[1]);
+    TEST_ASSERT_EQUAL(0, modbus_register_bank_write(&bank, 102, values, 2));
+}
+
+/**
+ * Test that single register accesses do not wait for block publications
+ */
+TEST(modbus_register_bank, test_register_bank_single_register_lock_free) {
+    uint8_t data[2] = {0x12, 0x34};
+    uint16_t value = 0;
+
+    atomic_store(&storage[1], 0xBEEF);
+    TEST_ASSERT_EQUAL(0, modbus_register_bank_write_begin(&bank));
+
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, modbus_register_bank_write_single(&bank, 100, 0x0102));
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, modbus_register_bank_store(&bank, 102, 1, data));
+    TEST_ASSERT_EQUAL(0, modbus_register_bank_snapshot(&bank, 101, 1, &value));
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, modbus_register_bank_read(&bank, 100, 1, data));
+
+    modbus_register_bank_write_end(&bank);
+
+    TEST_ASSERT_EQUAL_HEX16(0xBEEF, value);
+    TEST_ASSERT_EQUAL_HEX8(0x01, data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x02, data[1]);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, atomic_load(&storage[2]));
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, modbus_register_bank_write_single(&bank, 108, 0));
+}
+
+/**
+ * Test mask write semantics (result = (current AND and_mask) OR (or_mask AND NOT and_mask))
+ */
+TEST(modbus_register_bank, test_register_bank_mask_write) {
+    atomic_store(&storage[4], 0x0012);
+
+    TEST_ASSERT_EQUAL(MODBUS_EX_NONE, modbus_register_bank_mask_write(&bank, 104, 0x00F2, 0x0025));
+    TEST_ASSERT_EQUAL_HEX16(0x0017, atomic_load(&storage[4]));
+    TEST_ASSERT_EQUAL(MODBUS_EX_ILLEGAL_DATA_ADDRESS, modbus_register_bank_mask_write(&bank, 99, 0, 0));
+}
+
+#if MODBUS_REGISTER_BANK_THREADS
+static ModbusRegisterBank contended_bank;
+static _Atomic uint16_t contended_storage[CONTENDED_REGISTERS];
+static atomic_bool contended_stop;
+
+/**
+ * Publish the full block over and over, every register holding the pass number
+ */
+static void *contended_writer(void *arg) {
+    uint16_t values[CONTENDED_REGISTERS];
+    int failures = 0;
+
+    for (uint16_t pass = 1; !atomic_load(&contended_stop); pass++) {
+        for (unsigned i = 0; i < CONTENDED_REGISTERS; i++) {
+            values[i] = pass;
+        }
+        if (modbus_register_bank_write(&contended_bank, 0, values, CONTENDED_REGISTERS) != 0) failures++;
+    }
+
+    *(int *)arg = failures;
+    return NULL;
+}
+
+/**
+ * Test that Modbus reads of a block an application thread keeps rewriting
+ * wait for a stable copy instead of answering SLAVE DEVICE BUSY
+ */
+TEST(modbus_register_bank, test_register_bank_contended_read) {
+    uint8_t data[CONTENDED_REGISTERS * 2];
+    pthread_t writer;
+    int write_failures = 0;
+
+    for (unsigned i = 0; i < CONTENDED_REGISTERS; i++) {
+        atomic_init(&contended_storage[i], 0);
+    }
+    modbus_register_bank_init(&contended_bank, contended_storage, 0, CONTENDED_REGISTERS);
+    atomic_store(&contended_stop, false);
+    TEST_ASSERT_EQUAL(0, pthread_create(&writer, NULL, contended_writer, &write_failures));
+
+    int busy = 0;
+    int torn = 0;
+    for (int n = 0; n < 20000; n++) {
+        if (modbus_register_bank_read(&contended_bank, 0, CONTENDED_REGISTERS, data) != MODBUS_EX_NONE) {
+            busy++;
+            continue;
+        }
+        for (unsigned i = 1; i < CONTENDED_REGISTERS; i++) {
+            if (data[i * 2] != data[0] || data[i * 2 + 1] != data[1]) {
+                torn++;
+                break;
+            }
+        }
+    }
+
+    atomic_store(&contended_stop, true);
+    pthread_join(writer, NULL);
+    TEST_ASSERT_EQUAL(0, busy);
+    TEST_ASSERT_EQUAL(0, torn);
+    TEST_ASSERT_EQUAL(0, write_failures);
+}
+
+/**
+ * Test that block writers contending for the bank wait for each other
+ * instead of failing with SLAVE DEVICE BUSY
+ */
+TEST(modbus_register_bank, test_register_bank_contended_writers) {
+    uint8_t data[CONTENDED_REGISTERS * 2];
+    pthread_t writers[2];
+    int write_failures[2] = {0, 0};
+
+    memset(data, 0xA5, sizeof(data));
+    for (unsigned i = 0; i < CONTENDED_REGISTERS; i++) {
+        atomic_init(&contended_storage[i], 0);
+    }
+    modbus_register_bank_init(&contended_bank, contended_storage, 0, CONTENDED_REGISTERS);
+    atomic_store(&contended_stop, false);
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_create(&writers[i], NULL, contended_writer, &write_failures[i]));
+    }
+
+    int busy = 0;
+    for (int n = 0; n < 20000; n++) {
+        if (modbus_register_bank_store(&contended_bank, 0, CONTENDED_REGISTERS, data) != MODBUS_EX_NONE) busy++;
+    }
+
+    atomic_store(&contended_stop, true);
+    for (int i = 0; i < 2; i++) {
+        pthread_join(writers[i], NULL);
+    }
+    TEST_ASSERT_EQUAL(0, busy);
+    TEST_ASSERT_EQUAL(0, write_failures[0]);
+    TEST_ASSERT_EQUAL(0, write_failures[1]);
+}
+#endif
+
+#endif /* MODBUS_ENABLE_REGISTER_BANK */
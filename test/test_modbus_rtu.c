@@ -0,0 +1,144 @@
+#include "unity_fixture.h"
+#include "modbus_rtu.h"
+#include "modbus_crc16.h"
+
+#include <string.h>
+
+#if MODBUS_ENABLE_FC_03
+
+TEST_GROUP(modbus_rtu);
+
+static ModbusSlave slave;
+static ModbusSlaveConfig config;
+
+static void mock_write(const uint8_t *data, uint16_t length) {
+    (void)data;
+    (void)length;
+}
+
+static ModbusExceptionCode mock_read_holding_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    (void)addr;
+
+    for (int i = 0; i < count; i++) {
+        modbus_be16_set(&dest[i * 2], 500 + i);
+    }
+    return MODBUS_EX_NONE;
+}
+
+/**
+ * Append the CRC to a frame
+ * @return Frame length with the CRC
+ */
+static uint16_t append_crc(uint8_t *frame, uint16_t length) {
+    modbus_le16_set(&frame[length], modbus_crc16(frame, length));
+    return (uint16_t)(length + 2);
+}
+
+TEST_SETUP(modbus_rtu) {
+    memset(&slave, 0, sizeof(slave));
+    memset(&config, 0, sizeof(config));
+
+    config.address = 0x01;
+    config.write = mock_write;
+    config.read_holding_registers = mock_read_holding_registers;
+
+    modbus_slave_init(&slave, &config);
+}
+
+TEST_TEAR_DOWN(modbus_rtu) {}
+
+/**
+ * Test frames delimited by the length rules of their function code
+ */
+TEST(modbus_rtu, test_rtu_request_length_rules) {
+    const uint8_t read[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x02, 0xC4, 0x0B};
+    uint8_t write[32] = {0x11, 0x10, 0x00, 0x01, 0x00, 0x02, 0x04, 0x00, 0x0A, 0x01, 0x02};
+    uint16_t write_len = append_crc(write, 11);
+
+    TEST_ASSERT_EQUAL(0, modbus_rtu_request_length(read, 3));
+    TEST_ASSERT_EQUAL(0, modbus_rtu_request_length(read, 7));
+    TEST_ASSERT_EQUAL(8, modbus_rtu_request_length(read, sizeof(read)));
+
+    TEST_ASSERT_EQUAL(0, modbus_rtu_request_length(write, 6)); // Byte count not received yet
+    TEST_ASSERT_EQUAL(0, modbus_rtu_request_length(write, write_len - 1));
+    TEST_ASSERT_EQUAL(13, modbus_rtu_request_length(write, write_len + 5)); // Next frame behind it
+
+    write[8] ^= 0x01;
+    TEST_ASSERT_EQUAL(-1, modbus_rtu_request_length(write, write_len));
+}
+
+/**
+ * Test that function codes without a length rule are delimited by their
+ * CRC, and that garbage is eventually rejected
+ */
+TEST(modbus_rtu, test_rtu_request_length_crc_scan) {
+    uint8_t frame[MODBUS_MAX_FRAME_LENGTH + 4] = {0x01, 0x41, 0x05, 0x06, 0x07};
+    uint16_t frame_len = append_crc(frame, 5);
+
+    TEST_ASSERT_EQUAL(0, modbus_rtu_request_length(frame, frame_len - 1));
+    TEST_ASSERT_EQUAL(frame_len, modbus_rtu_request_length(frame, frame_len));
+
+    memset(frame, 0x41, sizeof(frame));
+    TEST_ASSERT_EQUAL(0, modbus_rtu_request_length(frame, 100));
+    TEST_ASSERT_EQUAL(-1, modbus_rtu_request_length(frame, sizeof(frame)));
+}
+
+/**
+ * Test responses delimited by the length rules of their function code,
+ * exceptions included
+ */
+TEST(modbus_rtu, test_rtu_response_length) {
+    uint8_t read[16] = {0x01, 0x03, 0x04, 0x01, 0xF4, 0x01, 0xF5};
+    uint8_t echo[16] = {0x01, 0x06, 0x00, 0x01, 0x00, 0x0A};
+    uint8_t exception[16] = {0x01, 0x83, 0x02};
+    uint16_t read_len = append_crc(read, 7);
+    uint16_t echo_len = append_crc(echo, 6);
+    uint16_t exception_len = append_crc(exception, 3);
+
+    TEST_ASSERT_EQUAL(0, modbus_rtu_response_length(read, 2));
+    TEST_ASSERT_EQUAL(0, modbus_rtu_response_length(read, read_len - 1));
+    TEST_ASSERT_EQUAL(read_len, modbus_rtu_response_length(read, read_len));
+    TEST_ASSERT_EQUAL(echo_len, modbus_rtu_response_length(echo, echo_len));
+    TEST_ASSERT_EQUAL(exception_len, modbus_rtu_response_length(exception, exception_len));
+
+    // Read as a response, the request fails the CRC at the length its byte count gives
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x02, 0xC4, 0x0B};
+    TEST_ASSERT_EQUAL(-1, modbus_rtu_response_length(request, sizeof(request)));
+}
+
+/**
+ * Test a request answered with address and CRC
+ */
+TEST(modbus_rtu, test_rtu_process_adu) {
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x02, 0xC4, 0x0B};
+    uint8_t expected[16] = {0x01, 0x03, 0x04, 0x01, 0xF4, 0x01, 0xF5};
+    uint16_t expected_len = append_crc(expected, 7);
+    uint8_t response[MODBUS_MAX_FRAME_LENGTH];
+    uint16_t response_len;
+
+    TEST_ASSERT_EQUAL(0, modbus_rtu_process_adu(&slave, request, sizeof(request), response, &response_len));
+    TEST_ASSERT_EQUAL(expected_len, response_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, expected_len);
+}
+
+/**
+ * Test that broadcasts and other units get no response
+ */
+TEST(modbus_rtu, test_rtu_process_adu_no_response) {
+    uint8_t request[16] = {0x00, 0x03, 0x00, 0x00, 0x00, 0x01};
+    uint8_t response[MODBUS_MAX_FRAME_LENGTH];
+    uint16_t response_len;
+
+    uint16_t request_len = append_crc(request, 6);
+    TEST_ASSERT_EQUAL(0, modbus_rtu_process_adu(&slave, request, request_len, response, &response_len));
+    TEST_ASSERT_EQUAL(0, response_len);
+
+    request[0] = 0x09;
+    request_len = append_crc(request, 6);
+    TEST_ASSERT_EQUAL(0, modbus_rtu_process_adu(&slave, request, request_len, response, &response_len));
+    TEST_ASSERT_EQUAL(0, response_len);
+
+    TEST_ASSERT_EQUAL(-1, modbus_rtu_process_adu(&slave, request, 3, response, &response_len));
+}
+
+#endif /* MODBUS_ENABLE_FC_03 */
@@ -0,0 +1,197 @@
+#define _GNU_SOURCE
+
+#include "unity_fixture.h"
+#include "modbus_config.h"
+
+#if defined(__linux__) && MODBUS_ENABLE_FC_03
+
+#include "modbus_serial.h"
+#include "modbus_crc16.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+TEST_GROUP(modbus_serial);
+
+static ModbusSlave slave;
+static ModbusSlaveConfig config;
+static ModbusSerialPort port;
+static int master = -1; // Master side of the pty, the port under test opens the other side
+static char path[64];
+
+static ModbusExceptionCode mock_read_holding_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    for (int i = 0; i < count; i++) {
+        modbus_be16_set(&dest[i * 2], (uint16_t)(addr + i));
+    }
+    return MODBUS_EX_NONE;
+}
+
+static uint64_t clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/**
+ * Serve the port until the master side received length bytes or for
+ * timeout_ms
+ * @return Number of bytes received
+ */
+static int serve(uint8_t *response, int length, uint32_t timeout_ms) {
+    uint64_t end = clock_ms() + timeout_ms;
+    int received = 0;
+
+    while (received < length && clock_ms() < end) {
+        TEST_ASSERT_TRUE(modbus_serial_poll(&port, 5) >= 0);
+
+        ssize_t n = read(master, &response[received], (size_t)(length - received));
+        if (n > 0) received += (int)n;
+    }
+    return received;
+}
+
+static void write_master(const uint8_t *data, size_t length) {
+    TEST_ASSERT_EQUAL(length, write(master, data, length));
+}
+
+static void open_port(uint32_t baud) {
+    ModbusSerialConfig serial_config = { .path = path, .baud = baud, .low_latency = true };
+
+    TEST_ASSERT_EQUAL(0, modbus_serial_open(&port, &slave, &serial_config));
+}
+
+TEST_SETUP(modbus_serial) {
+    memset(&slave, 0, sizeof(slave));
+    memset(&config, 0, sizeof(config));
+
+    config.address = 0x01;
+    config.write = modbus_serial_write;
+    config.read_holding_registers = mock_read_holding_registers;
+    modbus_slave_init(&slave, &config);
+
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    TEST_ASSERT_TRUE(master >= 0);
+    TEST_ASSERT_EQUAL(0, grantpt(master));
+    TEST_ASSERT_EQUAL(0, unlockpt(master));
+    TEST_ASSERT_EQUAL(0, ptsname_r(master, path, sizeof(path)));
+    port.fd = -1;
+    port.timer_fd = -1;
+}
+
+TEST_TEAR_DOWN(modbus_serial) {
+    modbus_serial_close(&port);
+    close(master);
+}
+
+/**
+ * Test that a request is answered on the line, and that bytes of one frame
+ * read in several chunks stay one frame
+ */
+TEST(modbus_serial, test_serial_request_response) {
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x02, 0xC5, 0xCE};
+    uint8_t expected[16] = {0x01, 0x03, 0x04, 0x00, 0x10, 0x00, 0x11};
+    uint8_t response[16];
+
+    modbus_le16_set(&expected[7], modbus_crc16(expected, 7));
+    open_port(1200); // 32 ms frame gap, ample for the chunks below
+
+    write_master(request, 3);
+    TEST_ASSERT_EQUAL(1, modbus_serial_poll(&port, 100)); // First chunk read, frame timer running
+    write_master(&request[3], sizeof(request) - 3);
+
+    TEST_ASSERT_EQUAL(9, serve(response, 9, 1000));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, 9);
+    TEST_ASSERT_EQUAL(2, port.stats.reads);
+    TEST_ASSERT_EQUAL(8, port.stats.bytes);
+    TEST_ASSERT_EQUAL(1, port.stats.frames);
+    TEST_ASSERT_EQUAL(1, port.stats.responses);
+}
+
+/**
+ * Test that frames with a bad CRC or for another unit are not answered and
+ * do not disturb the next request
+ */
+TEST(modbus_serial, test_serial_ignored_frames) {
+    const uint8_t corrupted[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x02, 0xC5, 0xCF};
+    uint8_t other_unit[8] = {0x07, 0x03, 0x00, 0x10, 0x00, 0x02};
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x01, 0x84, 0x0A};
+    uint8_t response[16];
+
+    modbus_le16_set(&other_unit[6], modbus_crc16(other_unit, 6));
+    open_port(115200);
+
+    write_master(corrupted, sizeof(corrupted));
+    TEST_ASSERT_EQUAL(0, serve(response, 1, 50));
+    write_master(other_unit, sizeof(other_unit));
+    TEST_ASSERT_EQUAL(0, serve(response, 1, 50));
+    TEST_ASSERT_EQUAL(2, port.stats.frames);
+    TEST_ASSERT_EQUAL(1, port.stats.timed_frames); // The corrupted one, the other ends by its length
+
+    write_master(request, sizeof(request));
+    TEST_ASSERT_EQUAL(7, serve(response, 7, 1000));
+    TEST_ASSERT_EQUAL_HEX8(0x01, response[0]);
+    TEST_ASSERT_EQUAL(1, port.stats.responses);
+}
+
+/**
+ * Test that a request delivered in packets further apart than 3.5 character
+ * times, as by a USB adapter, stays one frame: a recognized request ends by
+ * its length, anything else by the configured frame gap
+ */
+TEST(modbus_serial, test_serial_usb_packets) {
+    const struct timespec packet_interval = { .tv_nsec = 16 * 1000 * 1000 };
+    const uint8_t corrupted[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x02, 0xC5, 0xCF};
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x02, 0xC5, 0xCE};
+    ModbusSerialConfig serial_config = { .path = path, .baud = 115200, .frame_gap_us = 50000 };
+    uint8_t response[16];
+
+    TEST_ASSERT_EQUAL(0, modbus_serial_open(&port, &slave, &serial_config));
+    TEST_ASSERT_EQUAL(50000, port.gap_us);
+
+    write_master(corrupted, 4);
+    TEST_ASSERT_EQUAL(1, modbus_serial_poll(&port, 100));
+    nanosleep(&packet_interval, NULL);
+    write_master(&corrupted[4], sizeof(corrupted) - 4);
+    TEST_ASSERT_EQUAL(0, serve(response, 1, 100));
+    TEST_ASSERT_EQUAL(1, port.stats.frames);
+    TEST_ASSERT_EQUAL(1, port.stats.timed_frames);
+
+    write_master(request, 4);
+    TEST_ASSERT_EQUAL(1, modbus_serial_poll(&port, 100));
+    nanosleep(&packet_interval, NULL);
+    write_master(&request[4], sizeof(request) - 4);
+    TEST_ASSERT_EQUAL(9, serve(response, 9, 1000));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(request, response, 2);
+    TEST_ASSERT_EQUAL(2, port.stats.frames);
+    TEST_ASSERT_EQUAL(1, port.stats.timed_frames);
+}
+
+/**
+ * Test that unsupported settings are refused, RS-485 mode included on a
+ * tty without it
+ */
+TEST(modbus_serial, test_serial_open_errors) {
+    ModbusSerialConfig serial_config = { .path = path, .baud = 12345 };
+
+    TEST_ASSERT_EQUAL(-1, modbus_serial_open(&port, &slave, &serial_config));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+
+    serial_config.baud = 9600;
+    serial_config.parity = 'X';
+    TEST_ASSERT_EQUAL(-1, modbus_serial_open(&port, &slave, &serial_config));
+
+    serial_config.parity = 'N';
+    serial_config.rs485 = true;
+    TEST_ASSERT_EQUAL(-1, modbus_serial_open(&port, &slave, &serial_config));
+    TEST_ASSERT_EQUAL(-1, port.fd);
+
+    serial_config.rs485 = false;
+    TEST_ASSERT_EQUAL(0, modbus_serial_open(&port, &slave, &serial_config));
+}
+
+#endif /* __linux__ && MODBUS_ENABLE_FC_03 */
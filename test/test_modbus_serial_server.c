@@ -0,0 +1,187 @@
+#define _GNU_SOURCE
+
+#include "unity_fixture.h"
+#include "modbus_config.h"
+
+#if defined(__linux__) && MODBUS_ENABLE_FC_03
+
+#include "modbus_serial_server.h"
+#include "modbus_crc16.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEST_PORTS 4
+
+TEST_GROUP(modbus_serial_server);
+
+static ModbusSlave slaves[TEST_PORTS];
+static ModbusSlaveConfig config;
+static ModbusSerialPort ports[TEST_PORTS];
+static int masters[TEST_PORTS]; // Master sides of the ptys, the ports under test open the other sides
+static ModbusSerialServer server;
+
+static const uint8_t request[] = {0x01, 0x03, 0x00, 0x10, 0x00, 0x02, 0xC5, 0xCE};
+
+static ModbusExceptionCode mock_read_holding_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    for (int i = 0; i < count; i++) {
+        modbus_be16_set(&dest[i * 2], (uint16_t)(addr + i));
+    }
+    return MODBUS_EX_NONE;
+}
+
+static uint64_t clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/**
+ * Open a pty and serve its slave side as port i of the server
+ */
+static void open_port(int i) {
+    ModbusSerialConfig serial_config = { .baud = 115200 };
+    char path[64];
+
+    masters[i] = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    TEST_ASSERT_TRUE(masters[i] >= 0);
+    TEST_ASSERT_EQUAL(0, grantpt(masters[i]));
+    TEST_ASSERT_EQUAL(0, unlockpt(masters[i]));
+    TEST_ASSERT_EQUAL(0, ptsname_r(masters[i], path, sizeof(path)));
+
+    serial_config.path = path;
+    TEST_ASSERT_EQUAL(0, modbus_serial_open(&ports[i], &slaves[i], &serial_config));
+    TEST_ASSERT_EQUAL(0, modbus_serial_server_add(&server, &ports[i]));
+}
+
+/**
+ * Wait until every listed port answered the request, polling the server
+ * unless workers serve it
+ * @return Number of ports that answered
+ */
+static int collect(const int *list, int count, uint32_t timeout_ms) {
+    uint8_t responses[TEST_PORTS][9];
+    int received[TEST_PORTS] = {0};
+    uint64_t end = clock_ms() + timeout_ms;
+    int done = 0;
+
+    while (done < count && clock_ms() < end) {
+        if (!server.threaded) TEST_ASSERT_TRUE(modbus_serial_server_poll(&server, 5) >= 0);
+        else usleep(1000);
+
+        done = 0;
+        for (int i = 0; i < count; ++i) {
+            int p = list[i];
+            ssize_t n = read(masters[p], &responses[p][received[p]], (size_t)(9 - received[p]));
+            if (n > 0) received[p] += (int)n;
+            if (received[p] == 9) done++;
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        int p = list[i];
+        if (received[p] != 9) continue;
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(request, responses[p], 2);
+        TEST_ASSERT_EQUAL_HEX16(modbus_crc16(responses[p], 7), modbus_le16_get(&responses[p][7]));
+    }
+    return done;
+}
+
+TEST_SETUP(modbus_serial_server) {
+    memset(&config, 0, sizeof(config));
+    config.address = 0x01;
+    config.write = modbus_serial_write;
+    config.read_holding_registers = mock_read_holding_registers;
+
+    for (int i = 0; i < TEST_PORTS; ++i) {
+        memset(&slaves[i], 0, sizeof(slaves[i]));
+        modbus_slave_init(&slaves[i], &config);
+        ports[i].fd = -1;
+        ports[i].timer_fd = -1;
+        masters[i] = -1;
+    }
+}
+
+TEST_TEAR_DOWN(modbus_serial_server) {
+    modbus_serial_server_close(&server);
+    for (int i = 0; i < TEST_PORTS; ++i) {
+        modbus_serial_close(&ports[i]);
+        if (masters[i] >= 0) close(masters[i]);
+    }
+}
+
+/**
+ * Test that one loop polled by the caller answers every port, each through
+ * its own slave
+ */
+TEST(modbus_serial_server, test_serial_server_ports) {
+    const int all[] = {0, 1, 2};
+
+    TEST_ASSERT_EQUAL(0, modbus_serial_server_init(&server, NULL));
+    for (int i = 0; i < 3; ++i) open_port(i);
+    TEST_ASSERT_EQUAL(3, server.loops[0].ports);
+
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL(sizeof(request), write(masters[i], request, sizeof(request)));
+    }
+    TEST_ASSERT_EQUAL(3, collect(all, 3, 1000));
+
+    for (int i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL(1, ports[i].stats.frames);
+        TEST_ASSERT_EQUAL(1, ports[i].stats.responses);
+    }
+    TEST_ASSERT_EQUAL(-1, modbus_serial_server_start(&server)); // No workers to start
+}
+
+/**
+ * Test that the ports are spread over the workers and served by them
+ */
+TEST(modbus_serial_server, test_serial_server_workers) {
+    const ModbusSerialServerConfig server_config = { .workers = 2 };
+    const int all[] = {0, 1, 2, 3};
+
+    TEST_ASSERT_EQUAL(0, modbus_serial_server_init(&server, &server_config));
+    for (int i = 0; i < TEST_PORTS; ++i) open_port(i);
+    TEST_ASSERT_EQUAL(2, server.loops[0].ports);
+    TEST_ASSERT_EQUAL(2, server.loops[1].ports);
+    TEST_ASSERT_EQUAL(-1, modbus_serial_server_poll(&server, 0)); // The workers poll
+
+    TEST_ASSERT_EQUAL(0, modbus_serial_server_start(&server));
+    TEST_ASSERT_EQUAL(-1, modbus_serial_server_add(&server, &ports[0]));
+
+    for (int i = 0; i < TEST_PORTS; ++i) {
+        TEST_ASSERT_EQUAL(sizeof(request), write(masters[i], request, sizeof(request)));
+    }
+    TEST_ASSERT_EQUAL(TEST_PORTS, collect(all, TEST_PORTS, 1000));
+
+    modbus_serial_server_close(&server);
+    for (int i = 0; i < TEST_PORTS; ++i) {
+        TEST_ASSERT_EQUAL(1, ports[i].stats.responses);
+    }
+}
+
+/**
+ * Test that a port whose line hangs up is dropped and the others are still
+ * served
+ */
+TEST(modbus_serial_server, test_serial_server_lost_port) {
+    const int remaining[] = {1};
+
+    TEST_ASSERT_EQUAL(0, modbus_serial_server_init(&server, NULL));
+    open_port(0);
+    open_port(1);
+
+    close(masters[0]);
+    masters[0] = -1;
+    TEST_ASSERT_TRUE(modbus_serial_server_poll(&server, 100) > 0);
+    TEST_ASSERT_EQUAL(1, atomic_load(&server.lost));
+    TEST_ASSERT_EQUAL(1, server.loops[0].ports);
+
+    TEST_ASSERT_EQUAL(sizeof(request), write(masters[1], request, sizeof(request)));
+    TEST_ASSERT_EQUAL(1, collect(remaining, 1, 1000));
+}
+
+#endif /* __linux__ && MODBUS_ENABLE_FC_03 */
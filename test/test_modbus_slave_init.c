@@ -71,11 +71,70 @@ TEST(modbus_slave_init, test_slave_init_null_write_function) {
  * Test initialization preserves provided configuration
  */
 TEST(modbus_slave_init, test_slave_init_preserves_config) {
+#if MODBUS_ENABLE_FC_01
     config.read_coils = (ModbusReadCoilsCb)0x12345678;
+#endif
+#if MODBUS_ENABLE_FC_06
     config.write_single_register = (ModbusWriteSingleRegisterCb)0x87654321;
+#endif
     
     int result = modbus_slave_init(&slave, &config);
     TEST_ASSERT_EQUAL(0, result);
+    TEST_ASSERT_EQUAL_PTR(config.write, slave.config.write);
+#if MODBUS_ENABLE_FC_01
     TEST_ASSERT_EQUAL_PTR(config.read_coils, slave.config.read_coils);
+#endif
+#if MODBUS_ENABLE_FC_06
     TEST_ASSERT_EQUAL_PTR(config.write_single_register, slave.config.write_single_register);
-}
\ No newline at end of file
+#endif
+}
+
+/**
+ * Test changing the slave address after initialization
+ */
+TEST(modbus_slave_init, test_slave_set_address) {
+    modbus_slave_init(&slave, &config);
+
+    TEST_ASSERT_EQUAL(0, modbus_slave_set_address(&slave, 0x2A));
+    TEST_ASSERT_EQUAL(0x2A, MODBUS_SLAVE_ADDRESS(&slave));
+
+    // Broadcast address can not be assigned
+    TEST_ASSERT_EQUAL(-1, modbus_slave_set_address(&slave, 0x00));
+    TEST_ASSERT_EQUAL(0x2A, MODBUS_SLAVE_ADDRESS(&slave));
+
+    TEST_ASSERT_EQUAL(-1, modbus_slave_set_address(NULL, 0x01));
+}
+
+#if MODBUS_MAX_UNITS > 1
+/**
+ * Test registering additional unit addresses
+ */
+TEST(modbus_slave_init, test_slave_add_unit) {
+    ModbusSlaveConfig units[MODBUS_MAX_UNITS];
+    memset(units, 0, sizeof(units));
+
+    modbus_slave_init(&slave, &config);
+
+    for (int i = 0; i < MODBUS_MAX_UNITS; i++) units[i].address = 0x10 + i;
+    for (int i = 0; i < MODBUS_MAX_UNITS - 1; i++) {
+        TEST_ASSERT_EQUAL(0, modbus_slave_add_unit(&slave, &units[i]));
+    }
+
+    // Table full
+    TEST_ASSERT_EQUAL(-1, modbus_slave_add_unit(&slave, &units[MODBUS_MAX_UNITS - 1]));
+
+    // Taken, broadcast and missing addresses
+    modbus_slave_init(&slave, &config);
+    units[0].address = config.address;
+    TEST_ASSERT_EQUAL(-1, modbus_slave_add_unit(&slave, &units[0]));
+    units[0].address = 0x00;
+    TEST_ASSERT_EQUAL(-1, modbus_slave_add_unit(&slave, &units[0]));
+    TEST_ASSERT_EQUAL(-1, modbus_slave_add_unit(&slave, NULL));
+
+    // The primary address can not move onto another unit
+    units[1].address = 0x20;
+    TEST_ASSERT_EQUAL(0, modbus_slave_add_unit(&slave, &units[1]));
+    TEST_ASSERT_EQUAL(-1, modbus_slave_set_address(&slave, 0x20));
+    TEST_ASSERT_EQUAL(0, modbus_slave_set_address(&slave, 0x21));
+}
+#endif
@@ -60,11 +60,11 @@ TEST(modbus_slave_rx, test_rx_multiple_bytes) {
  */
 TEST(modbus_slave_rx, test_rx_frame_overflow) {
     // Fill buffer to maximum
-    for (int i = 0; i < MODBUS_MAX_FRAME_LENGTH; i++) {
+    for (int i = 0; i < MODBUS_SLAVE_FRAME_SIZE(&slave); i++) {
         modbus_slave_rx_byte(&slave, i & 0xFF);
     }
     
-    TEST_ASSERT_EQUAL(MODBUS_MAX_FRAME_LENGTH, slave.frame_len);
+    TEST_ASSERT_EQUAL(MODBUS_SLAVE_FRAME_SIZE(&slave), slave.frame_len);
     TEST_ASSERT_TRUE(slave.frame_ok);
     
     // One more byte should cause overflow
@@ -0,0 +1,126 @@
+#include "unity_fixture.h"
+#include "modbus_tcp.h"
+
+#include <string.h>
+
+#if MODBUS_ENABLE_FC_03
+
+TEST_GROUP(modbus_tcp);
+
+static ModbusSlave slave;
+static ModbusSlaveConfig config;
+
+static void mock_write(const uint8_t *data, uint16_t length) {
+    (void)data;
+    (void)length;
+}
+
+static ModbusExceptionCode mock_read_holding_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    if (addr > 1000) return MODBUS_EX_ILLEGAL_DATA_ADDRESS;
+
+    for (int i = 0; i < count; i++) {
+        modbus_be16_set(&dest[i * 2], 500 + i);
+    }
+    return MODBUS_EX_NONE;
+}
+
+TEST_SETUP(modbus_tcp) {
+    memset(&slave, 0, sizeof(slave));
+    memset(&config, 0, sizeof(config));
+
+    config.address = 0x01;
+    config.write = mock_write;
+    config.read_holding_registers = mock_read_holding_registers;
+
+    modbus_slave_init(&slave, &config);
+}
+
+TEST_TEAR_DOWN(modbus_tcp) {}
+
+/**
+ * Test ADU length detection on partial, complete and malformed headers
+ */
+TEST(modbus_tcp, test_tcp_adu_length) {
+    const uint8_t request[] = {0x12, 0x34, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x00, 0x00, 0x02};
+    const uint8_t bad_protocol[] = {0x12, 0x34, 0x00, 0x01, 0x00, 0x06, 0x01};
+    const uint8_t bad_length_low[] = {0x12, 0x34, 0x00, 0x00, 0x00, 0x01, 0x01};
+    const uint8_t bad_length_high[] = {0x12, 0x34, 0x00, 0x00, 0x00, 0xFF, 0x01};
+
+    TEST_ASSERT_EQUAL(0, modbus_tcp_adu_length(request, 6));
+    TEST_ASSERT_EQUAL(12, modbus_tcp_adu_length(request, 7));
+    TEST_ASSERT_EQUAL(12, modbus_tcp_adu_length(request, sizeof(request)));
+    TEST_ASSERT_EQUAL(-1, modbus_tcp_adu_length(bad_protocol, sizeof(bad_protocol)));
+    TEST_ASSERT_EQUAL(-1, modbus_tcp_adu_length(bad_length_low, sizeof(bad_length_low)));
+    TEST_ASSERT_EQUAL(-1, modbus_tcp_adu_length(bad_length_high, sizeof(bad_length_high)));
+}
+
+/**
+ * Test a request answered with the MBAP header echoed
+ */
+TEST(modbus_tcp, test_tcp_process_adu) {
+    const uint8_t request[] = {0x12, 0x34, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x00, 0x00, 0x02};
+    const uint8_t expected[] = {0x12, 0x34, 0x00, 0x00, 0x00, 0x07, 0x01, 0x03, 0x04, 0x01, 0xF4, 0x01, 0xF5};
+    uint8_t response[MODBUS_TCP_MAX_ADU_LENGTH];
+    uint16_t response_len;
+
+    TEST_ASSERT_EQUAL(0, modbus_tcp_process_adu(&slave, request, sizeof(request), response, &response_len));
+    TEST_ASSERT_EQUAL(sizeof(expected), response_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+}
+
+/**
+ * Test unit identifiers 0xFF and 0x00 addressing the server itself
+ */
+TEST(modbus_tcp, test_tcp_process_adu_server_unit) {
+    uint8_t request[] = {0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0xFF, 0x03, 0x00, 0x00, 0x00, 0x01};
+    uint8_t response[MODBUS_TCP_MAX_ADU_LENGTH];
+    uint16_t response_len;
+
+    TEST_ASSERT_EQUAL(0, modbus_tcp_process_adu(&slave, request, sizeof(request), response, &response_len));
+    TEST_ASSERT_EQUAL(11, response_len);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, response[6]);
+    TEST_ASSERT_EQUAL_HEX8(0x03, response[7]);
+
+    request[6] = 0x00; // Not a broadcast on TCP, still answered
+    TEST_ASSERT_EQUAL(0, modbus_tcp_process_adu(&slave, request, sizeof(request), response, &response_len));
+    TEST_ASSERT_EQUAL(11, response_len);
+    TEST_ASSERT_EQUAL_HEX8(0x00, response[6]);
+}
+
+/**
+ * Test exception responses for an unknown unit and a failing request
+ */
+TEST(modbus_tcp, test_tcp_process_adu_exceptions) {
+    uint8_t request[] = {0x00, 0x07, 0x00, 0x00, 0x00, 0x06, 0x09, 0x03, 0x00, 0x00, 0x00, 0x01};
+    const uint8_t unknown_unit[] = {0x00, 0x07, 0x00, 0x00, 0x00, 0x03, 0x09, 0x83, 0x0A};
+    const uint8_t bad_address[] = {0x00, 0x07, 0x00, 0x00, 0x00, 0x03, 0x01, 0x83, 0x02};
+    uint8_t response[MODBUS_TCP_MAX_ADU_LENGTH];
+    uint16_t response_len;
+
+    TEST_ASSERT_EQUAL(0, modbus_tcp_process_adu(&slave, request, sizeof(request), response, &response_len));
+    TEST_ASSERT_EQUAL(sizeof(unknown_unit), response_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(unknown_unit, response, sizeof(unknown_unit));
+
+    request[6] = 0x01;
+    request[8] = 0x04; // Address 0x0400 is rejected by the callback
+    TEST_ASSERT_EQUAL(0, modbus_tcp_process_adu(&slave, request, sizeof(request), response, &response_len));
+    TEST_ASSERT_EQUAL(sizeof(bad_address), response_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bad_address, response, sizeof(bad_address));
+#if MODBUS_ENABLE_COUNTERS
+    TEST_ASSERT_EQUAL(0, slave.counters.bus_exception); // Serial line counters only
+#endif
+}
+
+/**
+ * Test that a truncated ADU is rejected
+ */
+TEST(modbus_tcp, test_tcp_process_adu_truncated) {
+    const uint8_t request[] = {0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x00};
+    uint8_t response[MODBUS_TCP_MAX_ADU_LENGTH];
+    uint16_t response_len;
+
+    TEST_ASSERT_EQUAL(-1, modbus_tcp_process_adu(&slave, request, sizeof(request), response, &response_len));
+    TEST_ASSERT_EQUAL(0, response_len);
+}
+
+#endif /* MODBUS_ENABLE_FC_03 */
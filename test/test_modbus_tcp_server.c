@@ -0,0 +1,292 @@
+#include "unity_fixture.h"
+#include "modbus_config.h"
+
+#if defined(__linux__) && MODBUS_ENABLE_FC_03
+
+#include "modbus_tcp_server.h"
+#include "modbus_crc16.h"
+#include "test_tcp_helpers.h"
+
+#include <string.h>
+
+TEST_GROUP(modbus_tcp_server);
+
+static ModbusSlave slave;
+static ModbusSlaveConfig config;
+static ModbusTcpServer server;
+
+/**
+ * Run the server loop until it has nothing left to do
+ */
+static void serve(void) {
+    while (modbus_tcp_server_poll(&server, 50) > 0) {
+    }
+}
+
+/**
+ * Run the server loop for a while, whether or not there is work
+ */
+static void serve_for(uint32_t ms) {
+    uint64_t end = modbus_tcp_clock_ms() + ms;
+
+    while (modbus_tcp_clock_ms() < end) {
+        modbus_tcp_server_poll(&server, 10);
+    }
+}
+
+TEST_SETUP(modbus_tcp_server) {
+    memset(&slave, 0, sizeof(slave));
+    memset(&config, 0, sizeof(config));
+
+    config.address = 0x01;
+    config.write = mock_write;
+    config.read_holding_registers = mock_read_holding_registers;
+    modbus_slave_init(&slave, &config);
+
+    ModbusTcpServerConfig server_config = { .address = "127.0.0.1", .port = 0, .max_connections = 2 };
+    TEST_ASSERT_EQUAL(0, modbus_tcp_server_init(&server, &slave, &server_config));
+}
+
+TEST_TEAR_DOWN(modbus_tcp_server) {
+    modbus_tcp_server_close(&server);
+}
+
+/**
+ * Test pipelined requests split across TCP segments
+ */
+TEST(modbus_tcp_server, test_tcp_server_pipelined_requests) {
+    const uint8_t requests[] = {
+        0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00, 0x01,
+        0x00, 0x02, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x20, 0x00, 0x01,
+    };
+    const uint8_t expected[] = {
+        0x00, 0x01, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0x00, 0x10,
+        0x00, 0x02, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0x00, 0x20,
+    };
+    uint8_t response[sizeof(expected)];
+
+    int fd = connect_client(modbus_tcp_server_port(&server));
+    serve();
+    TEST_ASSERT_EQUAL(1, server.connection_count);
+
+    // First request and the header of the second, then the rest
+    TEST_ASSERT_EQUAL(19, send(fd, requests, 19, 0));
+    serve();
+    TEST_ASSERT_EQUAL(5, send(fd, &requests[19], 5, 0));
+    serve();
+
+    recv_all(fd, response, sizeof(response));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+    TEST_ASSERT_EQUAL(2, server.stats.requests);
+
+    close(fd);
+    serve();
+    TEST_ASSERT_EQUAL(0, server.connection_count);
+}
+
+/**
+ * Test that the responses to a batch of requests leave in one send
+ */
+TEST(modbus_tcp_server, test_tcp_server_coalesced_responses) {
+    uint8_t requests[3 * 12];
+    uint8_t response[3 * 11];
+
+    for (int i = 0; i < 3; i++) {
+        const uint8_t request[] = {0x00, (uint8_t)i, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, (uint8_t)(0x10 * i), 0x00, 0x01};
+        memcpy(&requests[i * 12], request, 12);
+    }
+
+    int fd = connect_client(modbus_tcp_server_port(&server));
+    serve();
+    TEST_ASSERT_EQUAL(sizeof(requests), send(fd, requests, sizeof(requests), 0));
+    serve();
+
+    recv_all(fd, response, sizeof(response));
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_HEX8(i, response[i * 11 + 1]);
+        TEST_ASSERT_EQUAL_HEX8(0x10 * i, response[i * 11 + 10]);
+    }
+    TEST_ASSERT_EQUAL(3, server.stats.requests);
+    TEST_ASSERT_EQUAL(1, server.stats.sends);
+    close(fd);
+}
+
+/**
+ * Test requests that wrap around the end of the receive ring
+ */
+TEST(modbus_tcp_server, test_tcp_server_receive_ring_wrap) {
+    enum { REQUESTS = 200, CHUNK = 199 }; // Chunks rarely end on a request, the ring keeps a partial one
+    static uint8_t requests[REQUESTS * 12];
+    static uint8_t responses[REQUESTS * 11];
+
+    for (int i = 0; i < REQUESTS; i++) {
+        const uint8_t request[] = {0x00, (uint8_t)i, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x01, (uint8_t)i, 0x00, 0x01};
+        memcpy(&requests[i * 12], request, 12);
+    }
+
+    int fd = connect_client(modbus_tcp_server_port(&server));
+    serve();
+    for (size_t sent = 0; sent < sizeof(requests); sent += CHUNK) {
+        size_t length = sizeof(requests) - sent < CHUNK ? sizeof(requests) - sent : CHUNK;
+        TEST_ASSERT_EQUAL(length, send(fd, &requests[sent], length, 0));
+        serve();
+    }
+
+    recv_all(fd, responses, sizeof(responses));
+    for (int i = 0; i < REQUESTS; i++) {
+        TEST_ASSERT_EQUAL_HEX8(i, responses[i * 11 + 1]);
+        TEST_ASSERT_EQUAL_HEX16(0x0100 + i, modbus_be16_get(&responses[i * 11 + 9]));
+    }
+    TEST_ASSERT_EQUAL(REQUESTS, server.stats.requests);
+    close(fd);
+}
+
+/**
+ * Test that a malformed MBAP header closes the connection
+ */
+TEST(modbus_tcp_server, test_tcp_server_malformed_header) {
+    const uint8_t request[] = {0x00, 0x01, 0x00, 0x05, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00, 0x01};
+    uint8_t byte;
+
+    int fd = connect_client(modbus_tcp_server_port(&server));
+    serve();
+    TEST_ASSERT_EQUAL(sizeof(request), send(fd, request, sizeof(request), 0));
+    serve();
+
+    TEST_ASSERT_EQUAL(0, recv(fd, &byte, 1, 0));
+    TEST_ASSERT_EQUAL(1, server.stats.dropped);
+    TEST_ASSERT_EQUAL(0, server.connection_count);
+    close(fd);
+}
+
+/**
+ * Test that clients beyond max_connections are refused and that sessions
+ * are reused as clients come and go
+ */
+TEST(modbus_tcp_server, test_tcp_server_connection_limit) {
+    uint8_t byte;
+
+    int fds[3];
+    for (int i = 0; i < 3; i++) {
+        fds[i] = connect_client(modbus_tcp_server_port(&server));
+    }
+    serve();
+
+    TEST_ASSERT_EQUAL(2, server.connection_count);
+    TEST_ASSERT_EQUAL(2, server.stats.accepted);
+    TEST_ASSERT_EQUAL(1, server.stats.refused);
+    TEST_ASSERT_EQUAL(1, server.sessions.exhausted);
+    TEST_ASSERT_EQUAL(0, recv(fds[2], &byte, 1, 0));
+
+    for (int i = 0; i < 3; i++) {
+        close(fds[i]);
+    }
+
+    for (int i = 0; i < 5; i++) {
+        serve();
+        fds[0] = connect_client(modbus_tcp_server_port(&server));
+        serve();
+        TEST_ASSERT_EQUAL(1, server.connection_count);
+        close(fds[0]);
+    }
+    serve();
+
+    TEST_ASSERT_EQUAL(0, server.sessions.in_use);
+    TEST_ASSERT_EQUAL(2, server.sessions.used);
+    TEST_ASSERT_EQUAL(2, server.sessions.peak);
+    TEST_ASSERT_EQUAL(7, server.stats.accepted);
+}
+
+/**
+ * Test that silent clients are closed while active ones are kept
+ */
+TEST(modbus_tcp_server, test_tcp_server_idle_timeout) {
+    const uint8_t request[] = {0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00, 0x01};
+    uint8_t response[11];
+    uint8_t byte;
+
+    modbus_tcp_server_close(&server);
+    ModbusTcpServerConfig server_config = { .address = "127.0.0.1", .port = 0, .idle_timeout_ms = 100 };
+    TEST_ASSERT_EQUAL(0, modbus_tcp_server_init(&server, &slave, &server_config));
+
+    int silent = connect_client(modbus_tcp_server_port(&server));
+    int active = connect_client(modbus_tcp_server_port(&server));
+    serve();
+    TEST_ASSERT_EQUAL(2, server.connection_count);
+
+    for (int i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL(sizeof(request), send(active, request, sizeof(request), 0));
+        serve_for(40);
+        recv_all(active, response, sizeof(response));
+    }
+
+    TEST_ASSERT_EQUAL(0, recv(silent, &byte, 1, 0));
+    TEST_ASSERT_EQUAL(1, server.connection_count);
+    TEST_ASSERT_EQUAL(1, server.stats.timeouts);
+
+    serve_for(150);
+    TEST_ASSERT_EQUAL(0, server.connection_count);
+    TEST_ASSERT_EQUAL(2, server.stats.timeouts);
+
+    close(silent);
+    close(active);
+}
+
+/**
+ * Test that a client stalled in the middle of a request is closed
+ */
+TEST(modbus_tcp_server, test_tcp_server_request_timeout) {
+    const uint8_t partial[] = {0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01};
+    uint8_t byte;
+
+    modbus_tcp_server_close(&server);
+    ModbusTcpServerConfig server_config = { .address = "127.0.0.1", .port = 0, .request_timeout_ms = 50,
+                                            .keepalive_s = 30 };
+    TEST_ASSERT_EQUAL(0, modbus_tcp_server_init(&server, &slave, &server_config));
+
+    int idle = connect_client(modbus_tcp_server_port(&server));
+    int stalled = connect_client(modbus_tcp_server_port(&server));
+    TEST_ASSERT_EQUAL(sizeof(partial), send(stalled, partial, sizeof(partial), 0));
+    serve_for(150);
+
+    TEST_ASSERT_EQUAL(0, recv(stalled, &byte, 1, 0));
+    TEST_ASSERT_EQUAL(1, server.connection_count); // No idle timeout configured
+    TEST_ASSERT_EQUAL(1, server.stats.timeouts);
+
+    close(idle);
+    close(stalled);
+}
+
+/**
+ * Test RTU frames tunneled over TCP, pipelined, split across segments and
+ * behind a stray byte
+ */
+TEST(modbus_tcp_server, test_tcp_server_rtu_framing) {
+    uint8_t requests[17] = {0x55, 0x01, 0x03, 0x00, 0x10, 0x00, 0x01, 0, 0, 0x01, 0x03, 0x00, 0x20, 0x00, 0x01};
+    uint8_t expected[14] = {0x01, 0x03, 0x02, 0x00, 0x10, 0, 0, 0x01, 0x03, 0x02, 0x00, 0x20};
+    uint8_t response[sizeof(expected)];
+
+    modbus_le16_set(&requests[7], modbus_crc16(&requests[1], 6));
+    modbus_le16_set(&requests[15], modbus_crc16(&requests[9], 6));
+    modbus_le16_set(&expected[5], modbus_crc16(expected, 5));
+    modbus_le16_set(&expected[12], modbus_crc16(&expected[7], 5));
+
+    modbus_tcp_server_close(&server);
+    ModbusTcpServerConfig server_config = { .address = "127.0.0.1", .port = 0, .framing = MODBUS_TCP_FRAMING_RTU };
+    TEST_ASSERT_EQUAL(0, modbus_tcp_server_init(&server, &slave, &server_config));
+
+    int fd = connect_client(modbus_tcp_server_port(&server));
+    TEST_ASSERT_EQUAL(12, send(fd, requests, 12, 0));
+    serve();
+    TEST_ASSERT_EQUAL(5, send(fd, &requests[12], 5, 0));
+    serve();
+
+    recv_all(fd, response, sizeof(response));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+    TEST_ASSERT_EQUAL(2, server.stats.requests);
+    TEST_ASSERT_EQUAL(1, server.stats.skipped);
+
+    close(fd);
+}
+
+#endif /* __linux__ && MODBUS_ENABLE_FC_03 */
@@ -0,0 +1,209 @@
+#include "unity_fixture.h"
+#include "modbus_config.h"
+
+#if defined(__linux__) && MODBUS_ENABLE_FC_03 && MODBUS_ENABLE_FC_17 && MODBUS_ENABLE_REGISTER_BANK
+
+#include "modbus_register_bank.h"
+#include "modbus_tcp_shard.h"
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define CLIENTS 4
+
+TEST_GROUP(modbus_tcp_shard);
+
+static ModbusSlaveConfig config;
+static ModbusTcpShardedServer server;
+static ModbusRegisterBank bank;
+static _Atomic uint16_t storage[16];
+
+static void mock_write(const uint8_t *data, uint16_t length) {
+    (void)data;
+    (void)length;
+}
+
+static ModbusExceptionCode bank_read_holding_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    return modbus_register_bank_read(&bank, addr, count, dest);
+}
+
+static ModbusExceptionCode bank_read_write_multiple_registers(uint16_t read_addr, uint16_t read_count,
+                                                              uint16_t write_addr, uint16_t write_count,
+                                                              const uint8_t *write_data, uint8_t *read_data) {
+    ModbusExceptionCode ex = modbus_register_bank_store(&bank, write_addr, write_count, write_data);
+    if (ex != MODBUS_EX_NONE) return ex;
+    return modbus_register_bank_read(&bank, read_addr, read_count, read_data);
+}
+
+/**
+ * Connect a blocking client to the server under test
+ */
+static int connect_client(void) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(modbus_tcp_sharded_server_port(&server)) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+
+    struct timeval timeout = { .tv_sec = 1 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+/**
+ * Send a request and receive a response of exactly length bytes
+ */
+static void transact(int fd, const uint8_t *request, size_t request_len, uint8_t *response, size_t length) {
+    TEST_ASSERT_EQUAL((ssize_t)request_len, send(fd, request, request_len, 0));
+
+    size_t received = 0;
+    while (received < length) {
+        ssize_t n = recv(fd, &response[received], length - received, 0);
+        TEST_ASSERT_TRUE(n > 0);
+        received += (size_t)n;
+    }
+}
+
+/**
+ * Wait until the shards have published the expected request count
+ */
+static void wait_for_requests(uint64_t requests, ModbusTcpServerStats *stats) {
+    const struct timespec delay = { .tv_nsec = 10 * 1000 * 1000 };
+
+    for (int i = 0; i < 100; i++) {
+        modbus_tcp_sharded_server_stats(&server, stats);
+        if (stats->requests >= requests) return;
+        nanosleep(&delay, NULL);
+    }
+}
+
+TEST_SETUP(modbus_tcp_shard) {
+    memset(&config, 0, sizeof(config));
+    for (unsigned i = 0; i < 16; i++) {
+        atomic_init(&storage[i], 0);
+    }
+    modbus_register_bank_init(&bank, storage, 0x0010, 16);
+
+    config.address = 0x01;
+    config.write = mock_write;
+    config.read_holding_registers = bank_read_holding_registers;
+    config.read_write_multiple_registers = bank_read_write_multiple_registers;
+
+    ModbusTcpShardedConfig sharded_config = {
+        .server = { .address = "127.0.0.1", .port = 0 },
+        .slave = &config,
+        .shards = 2,
+        .pin = true,
+    };
+    TEST_ASSERT_EQUAL(0, modbus_tcp_sharded_server_start(&server, &sharded_config));
+}
+
+TEST_TEAR_DOWN(modbus_tcp_shard) {
+    modbus_tcp_sharded_server_stop(&server);
+}
+
+/**
+ * Test that the shards listen on one port and serve one register bank
+ */
+TEST(modbus_tcp_shard, test_tcp_shard_shared_registers) {
+    const uint8_t write[] = {
+        0x00, 0x01, 0x00, 0x00, 0x00, 0x0D, 0x01, 0x17, 0x00, 0x12, 0x00, 0x01, 0x00, 0x12, 0x00, 0x01, 0x02, 0xBE, 0xEF,
+    };
+    const uint8_t written[] = { 0x00, 0x01, 0x00, 0x00, 0x00, 0x05, 0x01, 0x17, 0x02, 0xBE, 0xEF };
+    const uint8_t read[] = { 0x00, 0x02, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x12, 0x00, 0x01 };
+    const uint8_t expected[] = { 0x00, 0x02, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0xBE, 0xEF };
+    uint8_t response[sizeof(written)];
+    int fds[CLIENTS];
+
+    TEST_ASSERT_EQUAL(2, server.shard_count);
+    TEST_ASSERT_TRUE(modbus_tcp_sharded_server_port(&server) != 0);
+
+    for (int i = 0; i < CLIENTS; i++) {
+        fds[i] = connect_client();
+    }
+
+    // Every client reads the write back, whichever shard serves it
+    transact(fds[0], write, sizeof(write), response, sizeof(written));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(written, response, sizeof(written));
+    TEST_ASSERT_EQUAL_HEX16(0xBEEF, storage[2]);
+
+    for (int i = 0; i < CLIENTS; i++) {
+        transact(fds[i], read, sizeof(read), response, sizeof(expected));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+    }
+
+    ModbusTcpServerStats stats;
+    wait_for_requests(CLIENTS + 1, &stats);
+    TEST_ASSERT_EQUAL(CLIENTS + 1, stats.requests);
+    TEST_ASSERT_EQUAL(CLIENTS, stats.accepted);
+    TEST_ASSERT_EQUAL(0, stats.refused);
+
+    for (int i = 0; i < CLIENTS; i++) {
+        close(fds[i]);
+    }
+}
+
+#if MODBUS_MAX_UNITS > 1
+/**
+ * Test that every shard serves the units listed in the configuration
+ */
+TEST(modbus_tcp_shard, test_tcp_shard_units) {
+    const uint8_t read[] = { 0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x02, 0x03, 0x00, 0x12, 0x00, 0x01 };
+    const uint8_t expected[] = { 0x00, 0x01, 0x00, 0x00, 0x00, 0x05, 0x02, 0x03, 0x02, 0x12, 0x34 };
+    uint8_t response[sizeof(expected)];
+    ModbusSlaveConfig unit = config;
+    const ModbusSlaveConfig *const units[] = { &unit };
+    int fds[CLIENTS];
+
+    unit.address = 0x02;
+    atomic_store(&storage[2], 0x1234);
+
+    modbus_tcp_sharded_server_stop(&server);
+    ModbusTcpShardedConfig sharded_config = {
+        .server = { .address = "127.0.0.1", .port = 0 },
+        .slave = &config,
+        .units = units,
+        .unit_count = 1,
+        .shards = 2,
+    };
+    TEST_ASSERT_EQUAL(0, modbus_tcp_sharded_server_start(&server, &sharded_config));
+
+    for (int i = 0; i < CLIENTS; i++) {
+        fds[i] = connect_client();
+        transact(fds[i], read, sizeof(read), response, sizeof(expected));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+    }
+
+    for (int i = 0; i < CLIENTS; i++) {
+        close(fds[i]);
+    }
+    modbus_tcp_sharded_server_stop(&server); // Before unit goes out of scope
+}
+#endif
+
+/**
+ * Test that a port taken by a listener without SO_REUSEPORT fails the start
+ */
+TEST(modbus_tcp_shard, test_tcp_shard_port_in_use) {
+    ModbusTcpServerConfig other_config = { .address = "127.0.0.1", .port = 0 };
+    int fd = modbus_tcp_listen(&other_config);
+    TEST_ASSERT_TRUE(fd >= 0);
+
+    ModbusTcpShardedServer other;
+    ModbusTcpShardedConfig sharded_config = {
+        .server = { .address = "127.0.0.1", .port = modbus_tcp_local_port(fd) },
+        .slave = &config,
+        .shards = 2,
+    };
+    TEST_ASSERT_EQUAL(-1, modbus_tcp_sharded_server_start(&other, &sharded_config));
+    TEST_ASSERT_NULL(other.shards);
+
+    close(fd);
+}
+
+#endif
@@ -0,0 +1,301 @@
+#include "unity_fixture.h"
+#include "modbus_config.h"
+
+#if defined(__linux__) && MODBUS_ENABLE_FC_03
+
+#include "modbus_tcp_uring.h"
+
+#if MODBUS_ENABLE_TCP_URING
+
+#include "test_tcp_helpers.h"
+
+#include <string.h>
+
+TEST_GROUP(modbus_tcp_uring);
+
+static ModbusSlave slave;
+static ModbusSlaveConfig config;
+static ModbusTcpUringServer server;
+static bool available;
+
+/**
+ * Run the server loop until it has nothing left to do
+ */
+static void serve(void) {
+    while (modbus_tcp_uring_server_poll(&server, 50) > 0) {
+    }
+}
+
+/**
+ * Run the server loop for a while, whether or not there is work
+ */
+static void serve_for(uint32_t ms) {
+    uint64_t end = modbus_tcp_clock_ms() + ms;
+
+    while (modbus_tcp_clock_ms() < end) {
+        modbus_tcp_uring_server_poll(&server, 10);
+    }
+}
+
+/**
+ * Count the receive buffers the connections hold
+ */
+static unsigned held_buffers(void) {
+    unsigned held = 0;
+
+    for (uint32_t i = 0; i < server.max_connections; i++) {
+        const ModbusTcpUringConnection *conn = &server.connections[i];
+        if (conn->fd < 0) continue;
+        for (uint16_t bid = conn->held_first; bid != 0xFFFF; bid = server.rx_held_next[bid]) held++;
+    }
+    return held;
+}
+
+/**
+ * Connect a client that pipelines requests without reading the responses,
+ * with small socket buffers on both ends, until the server stops receiving
+ * from it and holds a receive buffer for it
+ */
+static int connect_paused_client(uint16_t port) {
+    static uint8_t requests[256 * 12];
+    int window = 4096;
+
+    for (int i = 0; i < 256; i++) {
+        const uint8_t request[] = {0x00, (uint8_t)i, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, (uint8_t)i, 0x00, 0x01};
+        memcpy(&requests[i * 12], request, 12);
+    }
+
+    const ModbusTcpUringConnection *conn = &server.connections[server.free_head];
+    int fd = connect_client(port);
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &window, sizeof(window));
+    serve();
+    TEST_ASSERT_TRUE(conn->fd >= 0);
+    setsockopt(conn->fd, SOL_SOCKET, SO_SNDBUF, &window, sizeof(window));
+
+    // Until the server stopped reading, so the client cannot send any more
+    for (int i = 0; i < 10000; i++) {
+        if (send(fd, requests, sizeof(requests), MSG_DONTWAIT) < 0 && conn->held_first != 0xFFFF) break;
+        modbus_tcp_uring_server_poll(&server, 0);
+    }
+    serve();
+    TEST_ASSERT_TRUE(conn->held_first != 0xFFFF);
+    TEST_ASSERT_FALSE(conn->receiving);
+    return fd;
+}
+
+TEST_SETUP(modbus_tcp_uring) {
+    memset(&slave, 0, sizeof(slave));
+    memset(&config, 0, sizeof(config));
+
+    config.address = 0x01;
+    config.write = mock_write;
+    config.read_holding_registers = mock_read_holding_registers;
+    modbus_slave_init(&slave, &config);
+
+    // Kernels without io_uring (or with it disabled) skip the group
+    ModbusTcpServerConfig server_config = { .address = "127.0.0.1", .port = 0, .max_connections = 2 };
+    available = modbus_tcp_uring_server_init(&server, &slave, &server_config) == 0;
+}
+
+TEST_TEAR_DOWN(modbus_tcp_uring) {
+    if (available) modbus_tcp_uring_server_close(&server);
+}
+
+/**
+ * Test pipelined requests split across TCP segments
+ */
+TEST(modbus_tcp_uring, test_tcp_uring_pipelined_requests) {
+    const uint8_t requests[] = {
+        0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00, 0x01,
+        0x00, 0x02, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x20, 0x00, 0x01,
+    };
+    const uint8_t expected[] = {
+        0x00, 0x01, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0x00, 0x10,
+        0x00, 0x02, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0x00, 0x20,
+    };
+    uint8_t response[sizeof(expected)];
+
+    if (!available) TEST_IGNORE_MESSAGE("io_uring not available");
+
+    int fd = connect_client(modbus_tcp_uring_server_port(&server));
+    serve();
+    TEST_ASSERT_EQUAL(1, server.connection_count);
+
+    // First request and the header of the second, then the rest
+    TEST_ASSERT_EQUAL(19, send(fd, requests, 19, 0));
+    serve();
+    TEST_ASSERT_EQUAL(5, send(fd, &requests[19], 5, 0));
+    serve();
+
+    recv_all(fd, response, sizeof(response));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+    TEST_ASSERT_EQUAL(2, server.stats.requests);
+
+    close(fd);
+    serve();
+    TEST_ASSERT_EQUAL(0, server.connection_count);
+}
+
+/**
+ * Test that a client pipelining more requests than the transmit buffer can
+ * answer at once is slowed down rather than disconnected
+ */
+TEST(modbus_tcp_uring, test_tcp_uring_backpressure) {
+    enum { REQUESTS = 1000 };
+    static uint8_t requests[REQUESTS * 12];
+    static uint8_t responses[REQUESTS * 11];
+
+    if (!available) TEST_IGNORE_MESSAGE("io_uring not available");
+
+    for (int i = 0; i < REQUESTS; i++) {
+        const uint8_t request[] = {(uint8_t)(i >> 8), (uint8_t)i, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03,
+                                   (uint8_t)(i >> 8), (uint8_t)i, 0x00, 0x01};
+        memcpy(&requests[i * 12], request, 12);
+    }
+
+    int fd = connect_client(modbus_tcp_uring_server_port(&server));
+    serve();
+    TEST_ASSERT_EQUAL(sizeof(requests), send(fd, requests, sizeof(requests), 0));
+    serve();
+
+    recv_all(fd, responses, sizeof(responses));
+    for (int i = 0; i < REQUESTS; i++) {
+        const uint8_t expected[] = {(uint8_t)(i >> 8), (uint8_t)i, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02,
+                                    (uint8_t)(i >> 8), (uint8_t)i};
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &responses[i * 11], sizeof(expected));
+    }
+    TEST_ASSERT_EQUAL(REQUESTS, server.stats.requests);
+    TEST_ASSERT_EQUAL(0, server.stats.dropped);
+    TEST_ASSERT_EQUAL(1, server.connection_count);
+
+    close(fd);
+    serve();
+    TEST_ASSERT_EQUAL(0, server.connection_count);
+}
+
+/**
+ * Test that a malformed MBAP header closes the connection
+ */
+TEST(modbus_tcp_uring, test_tcp_uring_malformed_header) {
+    const uint8_t request[] = {0x00, 0x01, 0x00, 0x05, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00, 0x01};
+    uint8_t byte;
+
+    if (!available) TEST_IGNORE_MESSAGE("io_uring not available");
+
+    int fd = connect_client(modbus_tcp_uring_server_port(&server));
+    serve();
+    TEST_ASSERT_EQUAL(sizeof(request), send(fd, request, sizeof(request), 0));
+    serve();
+
+    TEST_ASSERT_EQUAL(0, recv(fd, &byte, 1, 0));
+    TEST_ASSERT_EQUAL(1, server.stats.dropped);
+    TEST_ASSERT_EQUAL(0, server.connection_count);
+    close(fd);
+}
+
+/**
+ * Test that clients beyond max_connections are refused and slots are reused
+ */
+TEST(modbus_tcp_uring, test_tcp_uring_connection_limit) {
+    uint8_t byte;
+
+    if (!available) TEST_IGNORE_MESSAGE("io_uring not available");
+
+    int fds[3];
+    for (int i = 0; i < 3; i++) {
+        fds[i] = connect_client(modbus_tcp_uring_server_port(&server));
+    }
+    serve();
+
+    TEST_ASSERT_EQUAL(2, server.connection_count);
+    TEST_ASSERT_EQUAL(1, server.stats.refused);
+    TEST_ASSERT_EQUAL(0, recv(fds[2], &byte, 1, 0));
+
+    close(fds[0]);
+    close(fds[2]);
+    serve();
+    fds[0] = connect_client(modbus_tcp_uring_server_port(&server));
+    serve();
+    TEST_ASSERT_EQUAL(2, server.connection_count);
+    TEST_ASSERT_EQUAL(3, server.stats.accepted);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/**
+ * Test that silent clients are closed
+ */
+TEST(modbus_tcp_uring, test_tcp_uring_idle_timeout) {
+    if (!available) TEST_IGNORE_MESSAGE("io_uring not available");
+    uint8_t byte;
+
+    modbus_tcp_uring_server_close(&server);
+    ModbusTcpServerConfig server_config = { .address = "127.0.0.1", .port = 0, .idle_timeout_ms = 50 };
+    available = modbus_tcp_uring_server_init(&server, &slave, &server_config) == 0;
+    TEST_ASSERT_TRUE(available);
+
+    int fd = connect_client(modbus_tcp_uring_server_port(&server));
+    serve_for(150);
+
+    TEST_ASSERT_EQUAL(0, recv(fd, &byte, 1, 0));
+    TEST_ASSERT_EQUAL(0, server.connection_count);
+    TEST_ASSERT_EQUAL(1, server.stats.timeouts);
+    close(fd);
+}
+
+/**
+ * Test that a client finding every receive buffer held by paused clients
+ * waits for one to return instead of spinning on ENOBUFS, and is served
+ * once the paused clients go away
+ */
+TEST(modbus_tcp_uring, test_tcp_uring_buffers_exhausted) {
+    enum { CLIENTS = 8 };
+    const uint8_t request[] = {0x00, 0x07, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00, 0x01};
+    const uint8_t expected[] = {0x00, 0x07, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0x00, 0x10};
+    uint8_t response[sizeof(expected)];
+    int paused[CLIENTS];
+    int count = 0;
+
+    if (!available) TEST_IGNORE_MESSAGE("io_uring not available");
+
+    modbus_tcp_uring_server_close(&server);
+    ModbusTcpServerConfig server_config = { .address = "127.0.0.1", .port = 0, .max_connections = CLIENTS + 1 };
+    available = modbus_tcp_uring_server_init(&server, &slave, &server_config) == 0;
+    TEST_ASSERT_TRUE(available);
+    uint16_t port = modbus_tcp_uring_server_port(&server);
+
+    while (held_buffers() < MODBUS_TCP_URING_RX_BUFFERS) {
+        TEST_ASSERT_TRUE(count < CLIENTS);
+        paused[count++] = connect_paused_client(port);
+    }
+
+    int fd = connect_client(port);
+    serve_for(20);
+    TEST_ASSERT_EQUAL(sizeof(request), send(fd, request, sizeof(request), 0));
+
+    int handled = 0;
+    uint64_t end = modbus_tcp_clock_ms() + 50;
+    while (modbus_tcp_clock_ms() < end) {
+        handled += modbus_tcp_uring_server_poll(&server, 10);
+    }
+    TEST_ASSERT_TRUE(handled <= 2); // The receive ended by ENOBUFS, not one per retry
+    TEST_ASSERT_TRUE(server.starved_head != server.max_connections);
+
+    for (int i = 0; i < count; i++) {
+        close(paused[i]);
+    }
+    serve();
+
+    recv_all(fd, response, sizeof(response));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, response, sizeof(expected));
+    TEST_ASSERT_EQUAL(server.max_connections, server.starved_head);
+    TEST_ASSERT_EQUAL(1, server.connection_count);
+
+    close(fd);
+    serve();
+    TEST_ASSERT_EQUAL(0, server.connection_count);
+}
+
+#endif /* MODBUS_ENABLE_TCP_URING */
+#endif /* __linux__ && MODBUS_ENABLE_FC_03 */
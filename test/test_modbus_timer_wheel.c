@@ -0,0 +1,107 @@
+#include "unity_fixture.h"
+#include "modbus_timer_wheel.h"
+
+#include <string.h>
+
+TEST_GROUP(modbus_timer_wheel);
+
+static ModbusTimerWheel wheel;
+static ModbusTimer timers[8];
+
+/**
+ * Advance the wheel to now and count the timers that expire
+ */
+static int expire_count(uint64_t now) {
+    int count = 0;
+
+    while (modbus_timer_wheel_expire(&wheel, now)) {
+        count++;
+    }
+    return count;
+}
+
+TEST_SETUP(modbus_timer_wheel) {
+    modbus_timer_wheel_init(&wheel, 1000);
+    for (unsigned i = 0; i < 8; i++) {
+        modbus_timer_init(&timers[i]);
+    }
+}
+
+TEST_TEAR_DOWN(modbus_timer_wheel) {}
+
+/**
+ * Test that timers expire at their tick and not before, on every level
+ */
+TEST(modbus_timer_wheel, test_timer_wheel_expiry_levels) {
+    const uint64_t delays[] = {0, 1, 63, 64, 100, 4095, 4096, 300000};
+
+    for (unsigned i = 0; i < 8; i++) {
+        modbus_timer_wheel_add(&wheel, &timers[i], 1000 + delays[i]);
+    }
+    TEST_ASSERT_EQUAL(8, wheel.count);
+
+    for (unsigned i = 0; i < 8; i++) {
+        if (delays[i] > 0) {
+            TEST_ASSERT_EQUAL(0, expire_count(1000 + delays[i] - 1));
+        }
+        TEST_ASSERT_TRUE(modbus_timer_wheel_next(&wheel) <= 1000 + delays[i]);
+
+        TEST_ASSERT_EQUAL_PTR(&timers[i], modbus_timer_wheel_expire(&wheel, 1000 + delays[i]));
+        TEST_ASSERT_FALSE(modbus_timer_pending(&timers[i]));
+        TEST_ASSERT_NULL(modbus_timer_wheel_expire(&wheel, 1000 + delays[i]));
+    }
+
+    TEST_ASSERT_EQUAL(0, wheel.count);
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, modbus_timer_wheel_next(&wheel));
+}
+
+/**
+ * Test cancelling and moving pending timers
+ */
+TEST(modbus_timer_wheel, test_timer_wheel_cancel_move) {
+    modbus_timer_wheel_add(&wheel, &timers[0], 1010);
+    modbus_timer_wheel_add(&wheel, &timers[1], 1010);
+    modbus_timer_wheel_add(&wheel, &timers[2], 1500);
+
+    modbus_timer_wheel_cancel(&wheel, &timers[0]);
+    modbus_timer_wheel_cancel(&wheel, &timers[0]); // Not pending anymore, no effect
+    TEST_ASSERT_FALSE(modbus_timer_pending(&timers[0]));
+    TEST_ASSERT_EQUAL(2, wheel.count);
+
+    // Moved from level 1 to level 0 and the other way round
+    modbus_timer_wheel_add(&wheel, &timers[2], 1020);
+    modbus_timer_wheel_add(&wheel, &timers[1], 1200);
+    TEST_ASSERT_EQUAL(2, wheel.count);
+
+    TEST_ASSERT_EQUAL(0, expire_count(1019));
+    TEST_ASSERT_EQUAL_PTR(&timers[2], modbus_timer_wheel_expire(&wheel, 1020));
+    TEST_ASSERT_EQUAL(0, expire_count(1199));
+    TEST_ASSERT_EQUAL_PTR(&timers[1], modbus_timer_wheel_expire(&wheel, 1300));
+    TEST_ASSERT_EQUAL(0, wheel.count);
+}
+
+/**
+ * Test that overdue timers expire at once and late polls catch up
+ */
+TEST(modbus_timer_wheel, test_timer_wheel_overdue) {
+    modbus_timer_wheel_add(&wheel, &timers[0], 500);
+    TEST_ASSERT_EQUAL_UINT64(1000, modbus_timer_wheel_next(&wheel));
+    TEST_ASSERT_EQUAL(1, expire_count(1000));
+
+    for (unsigned i = 0; i < 8; i++) {
+        modbus_timer_wheel_add(&wheel, &timers[i], 1000 + 37 * i * i * i);
+    }
+    TEST_ASSERT_EQUAL(5, expire_count(1000 + 37 * 64));
+    TEST_ASSERT_EQUAL(3, expire_count(1000000));
+}
+
+/**
+ * Test expiries beyond the range of the wheel
+ */
+TEST(modbus_timer_wheel, test_timer_wheel_far_future) {
+    const uint64_t far = 1000 + 3 * ((uint64_t)1 << 24);
+
+    modbus_timer_wheel_add(&wheel, &timers[0], far);
+    TEST_ASSERT_EQUAL(0, expire_count(far - 1));
+    TEST_ASSERT_EQUAL(1, expire_count(far));
+}
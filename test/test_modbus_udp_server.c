@@ -0,0 +1,131 @@
+#include "unity_fixture.h"
+#include "modbus_config.h"
+
+#if defined(__linux__) && MODBUS_ENABLE_FC_03
+
+#include "modbus_udp_server.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+TEST_GROUP(modbus_udp_server);
+
+static ModbusSlave slave;
+static ModbusSlaveConfig config;
+static ModbusUdpServer server;
+
+static void mock_write(const uint8_t *data, uint16_t length) {
+    (void)data;
+    (void)length;
+}
+
+static ModbusExceptionCode mock_read_holding_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    for (int i = 0; i < count; i++) {
+        modbus_be16_set(&dest[i * 2], (uint16_t)(addr + i));
+    }
+    return MODBUS_EX_NONE;
+}
+
+/**
+ * Open a blocking client socket connected to the server under test
+ */
+static int connect_client(void) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(modbus_udp_server_port(&server)) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+
+    struct timeval timeout = { .tv_sec = 1 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+TEST_SETUP(modbus_udp_server) {
+    memset(&slave, 0, sizeof(slave));
+    memset(&config, 0, sizeof(config));
+
+    config.address = 0x01;
+    config.write = mock_write;
+    config.read_holding_registers = mock_read_holding_registers;
+    modbus_slave_init(&slave, &config);
+
+    ModbusUdpServerConfig server_config = { .address = "127.0.0.1", .port = 0 };
+    TEST_ASSERT_EQUAL(0, modbus_udp_server_init(&server, &slave, &server_config));
+}
+
+TEST_TEAR_DOWN(modbus_udp_server) {
+    modbus_udp_server_close(&server);
+}
+
+/**
+ * Test that datagrams queued by several clients are answered in one batch,
+ * each response going back to the client that asked
+ */
+TEST(modbus_udp_server, test_udp_server_batch) {
+    const uint8_t request_a[] = {0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00, 0x01};
+    const uint8_t request_b[] = {0x00, 0x02, 0x00, 0x00, 0x00, 0x06, 0xFF, 0x03, 0x00, 0x20, 0x00, 0x01};
+    const uint8_t expected_a[] = {0x00, 0x01, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0x00, 0x10};
+    const uint8_t expected_b[] = {0x00, 0x02, 0x00, 0x00, 0x00, 0x05, 0xFF, 0x03, 0x02, 0x00, 0x20};
+    uint8_t response[32];
+
+    int a = connect_client();
+    int b = connect_client();
+    TEST_ASSERT_EQUAL(sizeof(request_a), send(a, request_a, sizeof(request_a), 0));
+    TEST_ASSERT_EQUAL(sizeof(request_b), send(b, request_b, sizeof(request_b), 0));
+    TEST_ASSERT_EQUAL(sizeof(request_a), send(a, request_a, sizeof(request_a), 0));
+
+    TEST_ASSERT_EQUAL(3, modbus_udp_server_poll(&server, 100));
+    TEST_ASSERT_EQUAL(1, server.stats.receives);
+    TEST_ASSERT_EQUAL(1, server.stats.sends);
+    TEST_ASSERT_EQUAL(3, server.stats.requests);
+
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL(sizeof(expected_a), recv(a, response, sizeof(response), 0));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_a, response, sizeof(expected_a));
+    }
+    TEST_ASSERT_EQUAL(sizeof(expected_b), recv(b, response, sizeof(response), 0));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_b, response, sizeof(expected_b));
+
+    TEST_ASSERT_EQUAL(0, modbus_udp_server_poll(&server, 0));
+
+    close(a);
+    close(b);
+}
+
+/**
+ * Test that datagrams that are not exactly one valid ADU are ignored
+ */
+TEST(modbus_udp_server, test_udp_server_malformed_datagrams) {
+    const uint8_t short_request[] = {0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00};
+    const uint8_t bad_protocol[] = {0x00, 0x01, 0x00, 0x01, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00, 0x01};
+    const uint8_t request[] = {0x00, 0x03, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x10, 0x00, 0x01};
+    uint8_t oversized[MODBUS_TCP_MAX_ADU_LENGTH + 8];
+    uint8_t response[32];
+
+    memcpy(oversized, request, sizeof(request));
+    memset(&oversized[sizeof(request)], 0, sizeof(oversized) - sizeof(request));
+    modbus_be16_set(&oversized[4], MODBUS_MAX_PDU_LENGTH + 1);
+
+    int fd = connect_client();
+    TEST_ASSERT_EQUAL(sizeof(short_request), send(fd, short_request, sizeof(short_request), 0));
+    TEST_ASSERT_EQUAL(sizeof(bad_protocol), send(fd, bad_protocol, sizeof(bad_protocol), 0));
+    TEST_ASSERT_EQUAL(sizeof(oversized), send(fd, oversized, sizeof(oversized), 0));
+    TEST_ASSERT_EQUAL(sizeof(request), send(fd, request, sizeof(request), 0));
+
+    TEST_ASSERT_EQUAL(4, modbus_udp_server_poll(&server, 100));
+    TEST_ASSERT_EQUAL(3, server.stats.dropped);
+    TEST_ASSERT_EQUAL(1, server.stats.requests);
+
+    // Only the valid request is answered
+    TEST_ASSERT_EQUAL(11, recv(fd, response, sizeof(response), 0));
+    TEST_ASSERT_EQUAL_HEX8(0x03, response[1]);
+
+    close(fd);
+}
+
+#endif
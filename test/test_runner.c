@@ -1,4 +1,10 @@
 #include "unity_fixture.h"
+#include "modbus_config.h"
+#include "modbus_gateway.h"
+
+#ifdef __linux__
+#include "modbus_tcp_uring.h"
+#endif
 
 // Test group declarations
 TEST_GROUP_RUNNER(modbus_crc16) {
@@ -26,6 +32,10 @@ TEST_GROUP_RUNNER(modbus_slave_init) {
     RUN_TEST_CASE(modbus_slave_init, test_slave_init_null_config);
     RUN_TEST_CASE(modbus_slave_init, test_slave_init_null_write_function);
     RUN_TEST_CASE(modbus_slave_init, test_slave_init_preserves_config);
+    RUN_TEST_CASE(modbus_slave_init, test_slave_set_address);
+#if MODBUS_MAX_UNITS > 1
+    RUN_TEST_CASE(modbus_slave_init, test_slave_add_unit);
+#endif
 }
 
 TEST_GROUP_RUNNER(modbus_slave_rx) {
@@ -41,6 +51,7 @@ TEST_GROUP_RUNNER(modbus_slave_rx) {
 }
 
 // Handler test groups
+#if MODBUS_ENABLE_FC_01
 TEST_GROUP_RUNNER(modbus_handler_read_coils) {
     RUN_TEST_CASE(modbus_handler_read_coils, test_handle_read_coils_valid);
     RUN_TEST_CASE(modbus_handler_read_coils, test_handle_read_coils_unsupported);
@@ -48,7 +59,9 @@ TEST_GROUP_RUNNER(modbus_handler_read_coils) {
     RUN_TEST_CASE(modbus_handler_read_coils, test_handle_read_coils_invalid_count_high);
     RUN_TEST_CASE(modbus_handler_read_coils, test_handle_read_coils_address_error);
 }
+#endif
 
+#if MODBUS_ENABLE_FC_02
 TEST_GROUP_RUNNER(modbus_handler_read_discrete_inputs) {
     RUN_TEST_CASE(modbus_handler_read_discrete_inputs, test_handle_read_discrete_inputs_valid);
     RUN_TEST_CASE(modbus_handler_read_discrete_inputs, test_handle_read_discrete_inputs_unsupported);
@@ -56,15 +69,20 @@ TEST_GROUP_RUNNER(modbus_handler_read_discrete_inputs) {
     RUN_TEST_CASE(modbus_handler_read_discrete_inputs, test_handle_read_discrete_inputs_invalid_count_high);
     RUN_TEST_CASE(modbus_handler_read_discrete_inputs, test_handle_read_discrete_inputs_address_error);
 }
+#endif
 
+#if MODBUS_ENABLE_FC_03
 TEST_GROUP_RUNNER(modbus_handler_read_holding_registers) {
     RUN_TEST_CASE(modbus_handler_read_holding_registers, test_handle_read_holding_registers_valid);
     RUN_TEST_CASE(modbus_handler_read_holding_registers, test_handle_read_holding_registers_unsupported);
     RUN_TEST_CASE(modbus_handler_read_holding_registers, test_handle_read_holding_registers_invalid_count_low);
     RUN_TEST_CASE(modbus_handler_read_holding_registers, test_handle_read_holding_registers_invalid_count_high);
+    RUN_TEST_CASE(modbus_handler_read_holding_registers, test_handle_read_holding_registers_invalid_length);
     RUN_TEST_CASE(modbus_handler_read_holding_registers, test_handle_read_holding_registers_address_error);
 }
+#endif
 
+#if MODBUS_ENABLE_FC_04
 TEST_GROUP_RUNNER(modbus_handler_read_input_registers) {
     RUN_TEST_CASE(modbus_handler_read_input_registers, test_handle_read_input_registers_valid);
     RUN_TEST_CASE(modbus_handler_read_input_registers, test_handle_read_input_registers_unsupported);
@@ -72,7 +90,9 @@ TEST_GROUP_RUNNER(modbus_handler_read_input_registers) {
     RUN_TEST_CASE(modbus_handler_read_input_registers, test_handle_read_input_registers_invalid_count_high);
     RUN_TEST_CASE(modbus_handler_read_input_registers, test_handle_read_input_registers_address_error);
 }
+#endif
 
+#if MODBUS_ENABLE_FC_05
 TEST_GROUP_RUNNER(modbus_handler_write_single_coil) {
     RUN_TEST_CASE(modbus_handler_write_single_coil, test_handle_write_single_coil_valid_on);
     RUN_TEST_CASE(modbus_handler_write_single_coil, test_handle_write_single_coil_valid_off);
@@ -80,14 +100,18 @@ TEST_GROUP_RUNNER(modbus_handler_write_single_coil) {
     RUN_TEST_CASE(modbus_handler_write_single_coil, test_handle_write_single_coil_invalid_value);
     RUN_TEST_CASE(modbus_handler_write_single_coil, test_handle_write_single_coil_address_error);
 }
+#endif
 
+#if MODBUS_ENABLE_FC_06
 TEST_GROUP_RUNNER(modbus_handler_write_single_register) {
     RUN_TEST_CASE(modbus_handler_write_single_register, test_handle_write_single_register_valid);
     RUN_TEST_CASE(modbus_handler_write_single_register, test_handle_write_single_register_unsupported);
     RUN_TEST_CASE(modbus_handler_write_single_register, test_handle_write_single_register_address_error);
     RUN_TEST_CASE(modbus_handler_write_single_register, test_handle_write_single_register_zero_values);
 }
+#endif
 
+#if MODBUS_ENABLE_FC_0F
 TEST_GROUP_RUNNER(modbus_handler_write_multiple_coils) {
     RUN_TEST_CASE(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_valid);
     RUN_TEST_CASE(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_unsupported);
@@ -96,7 +120,9 @@ TEST_GROUP_RUNNER(modbus_handler_write_multiple_coils) {
     RUN_TEST_CASE(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_invalid_count_high);
     RUN_TEST_CASE(modbus_handler_write_multiple_coils, test_handle_write_multiple_coils_address_error);
 }
+#endif
 
+#if MODBUS_ENABLE_FC_10
 TEST_GROUP_RUNNER(modbus_handler_write_multiple_registers) {
     RUN_TEST_CASE(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_valid);
     RUN_TEST_CASE(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_unsupported);
@@ -104,15 +130,40 @@ TEST_GROUP_RUNNER(modbus_handler_write_multiple_registers) {
     RUN_TEST_CASE(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_invalid_count_low);
     RUN_TEST_CASE(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_invalid_count_high);
     RUN_TEST_CASE(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_address_error);
+    RUN_TEST_CASE(modbus_handler_write_multiple_registers, test_handle_write_multiple_registers_truncated);
+}
+#endif
+
+#if MODBUS_ENABLE_FC_07
+TEST_GROUP_RUNNER(modbus_handler_read_exception_status) {
+    RUN_TEST_CASE(modbus_handler_read_exception_status, test_handle_read_exception_status_valid);
+    RUN_TEST_CASE(modbus_handler_read_exception_status, test_handle_read_exception_status_unsupported);
+    RUN_TEST_CASE(modbus_handler_read_exception_status, test_handle_read_exception_status_device_failure);
+}
+#endif
+
+#if MODBUS_ENABLE_FC_08
+TEST_GROUP_RUNNER(modbus_handler_diagnostics) {
+    RUN_TEST_CASE(modbus_handler_diagnostics, test_handle_diagnostics_return_query_data);
+    RUN_TEST_CASE(modbus_handler_diagnostics, test_handle_diagnostics_counters);
+    RUN_TEST_CASE(modbus_handler_diagnostics, test_handle_diagnostics_clear_counters);
+    RUN_TEST_CASE(modbus_handler_diagnostics, test_handle_diagnostics_clear_overrun);
+    RUN_TEST_CASE(modbus_handler_diagnostics, test_handle_diagnostics_unsupported_sub_function);
+    RUN_TEST_CASE(modbus_handler_diagnostics, test_handle_diagnostics_invalid_data);
+    RUN_TEST_CASE(modbus_handler_diagnostics, test_handle_diagnostics_short_request);
 }
+#endif
 
+#if MODBUS_ENABLE_FC_16
 TEST_GROUP_RUNNER(modbus_handler_mask_write_register) {
     RUN_TEST_CASE(modbus_handler_mask_write_register, test_handle_mask_write_register_valid);
     RUN_TEST_CASE(modbus_handler_mask_write_register, test_handle_mask_write_register_unsupported);
     RUN_TEST_CASE(modbus_handler_mask_write_register, test_handle_mask_write_register_address_error);
     RUN_TEST_CASE(modbus_handler_mask_write_register, test_handle_mask_write_register_zero_masks);
 }
+#endif
 
+#if MODBUS_ENABLE_FC_17
 TEST_GROUP_RUNNER(modbus_handler_read_write_multiple_registers) {
     RUN_TEST_CASE(modbus_handler_read_write_multiple_registers, test_handle_read_write_multiple_registers_valid);
     RUN_TEST_CASE(modbus_handler_read_write_multiple_registers, test_handle_read_write_multiple_registers_unsupported);
@@ -124,13 +175,204 @@ TEST_GROUP_RUNNER(modbus_handler_read_write_multiple_registers) {
     RUN_TEST_CASE(modbus_handler_read_write_multiple_registers, test_handle_read_write_multiple_registers_read_address_error);
     RUN_TEST_CASE(modbus_handler_read_write_multiple_registers, test_handle_read_write_multiple_registers_write_address_error);
 }
+#endif
+
+#if MODBUS_ENABLE_FC_2B
+TEST_GROUP_RUNNER(modbus_handler_read_device_identification) {
+    RUN_TEST_CASE(modbus_handler_read_device_identification, test_handle_read_device_identification_basic);
+    RUN_TEST_CASE(modbus_handler_read_device_identification, test_handle_read_device_identification_regular);
+    RUN_TEST_CASE(modbus_handler_read_device_identification, test_handle_read_device_identification_extended_more_follows);
+    RUN_TEST_CASE(modbus_handler_read_device_identification, test_handle_read_device_identification_unknown_object_restarts);
+    RUN_TEST_CASE(modbus_handler_read_device_identification, test_handle_read_device_identification_individual);
+    RUN_TEST_CASE(modbus_handler_read_device_identification, test_handle_read_device_identification_individual_unknown);
+    RUN_TEST_CASE(modbus_handler_read_device_identification, test_handle_read_device_identification_invalid_code);
+    RUN_TEST_CASE(modbus_handler_read_device_identification, test_handle_read_device_identification_unsupported);
+    RUN_TEST_CASE(modbus_handler_read_device_identification, test_device_id_validate);
+}
+#endif
+
+TEST_GROUP_RUNNER(modbus_timer_wheel) {
+    RUN_TEST_CASE(modbus_timer_wheel, test_timer_wheel_expiry_levels);
+    RUN_TEST_CASE(modbus_timer_wheel, test_timer_wheel_cancel_move);
+    RUN_TEST_CASE(modbus_timer_wheel, test_timer_wheel_overdue);
+    RUN_TEST_CASE(modbus_timer_wheel, test_timer_wheel_far_future);
+}
+
+TEST_GROUP_RUNNER(modbus_pool) {
+    RUN_TEST_CASE(modbus_pool, test_pool_exhaustion);
+    RUN_TEST_CASE(modbus_pool, test_pool_reuse);
+    RUN_TEST_CASE(modbus_pool, test_pool_invalid);
+}
+
+TEST_GROUP_RUNNER(modbus_gateway) {
+    RUN_TEST_CASE(modbus_gateway, test_gateway_round_trip);
+    RUN_TEST_CASE(modbus_gateway, test_gateway_timeout);
+    RUN_TEST_CASE(modbus_gateway, test_gateway_fair_round_robin);
+    RUN_TEST_CASE(modbus_gateway, test_gateway_priority);
+    RUN_TEST_CASE(modbus_gateway, test_gateway_rejections);
+    RUN_TEST_CASE(modbus_gateway, test_gateway_broadcast_turnaround);
+    RUN_TEST_CASE(modbus_gateway, test_gateway_cancel);
+    RUN_TEST_CASE(modbus_gateway, test_gateway_coalescing);
+#if MODBUS_GATEWAY_CACHE_ENTRIES
+    RUN_TEST_CASE(modbus_gateway, test_gateway_cache);
+    RUN_TEST_CASE(modbus_gateway, test_gateway_read_after_write);
+#endif
+    RUN_TEST_CASE(modbus_gateway, test_gateway_cancel_shared);
+    RUN_TEST_CASE(modbus_gateway, test_gateway_frame_gap);
+    RUN_TEST_CASE(modbus_gateway, test_gateway_late_response);
+}
+
+#if MODBUS_ENABLE_REGISTER_BANK
+TEST_GROUP_RUNNER(modbus_register_bank) {
+    RUN_TEST_CASE(modbus_register_bank, test_register_bank_init);
+    RUN_TEST_CASE(modbus_register_bank, test_register_bank_write_snapshot);
+    RUN_TEST_CASE(modbus_register_bank, test_register_bank_read_store);
+    RUN_TEST_CASE(modbus_register_bank, test_register_bank_out_of_range);
+    RUN_TEST_CASE(modbus_register_bank, test_register_bank_busy_while_publishing);
+    RUN_TEST_CASE(modbus_register_bank, test_register_bank_single_register_lock_free);
+    RUN_TEST_CASE(modbus_register_bank, test_register_bank_mask_write);
+#if MODBUS_REGISTER_BANK_THREADS
+    RUN_TEST_CASE(modbus_register_bank, test_register_bank_contended_read);
+    RUN_TEST_CASE(modbus_register_bank, test_register_bank_contended_writers);
+#endif
+}
+#endif
 
+#if MODBUS_ENABLE_FC_03
 TEST_GROUP_RUNNER(modbus_integration) {
     RUN_TEST_CASE(modbus_integration, test_complete_frame_processing);
     RUN_TEST_CASE(modbus_integration, test_frame_invalid_crc);
     RUN_TEST_CASE(modbus_integration, test_broadcast_frame_no_response);
     RUN_TEST_CASE(modbus_integration, test_wrong_address_frame);
+    RUN_TEST_CASE(modbus_integration, test_unknown_function_exception);
+    RUN_TEST_CASE(modbus_integration, test_process_pdu);
+    RUN_TEST_CASE(modbus_integration, test_process_pdu_exception_broadcast_unit);
+#if MODBUS_ENABLE_COUNTERS
+    RUN_TEST_CASE(modbus_integration, test_counters_valid_request);
+    RUN_TEST_CASE(modbus_integration, test_counters_crc_error);
+    RUN_TEST_CASE(modbus_integration, test_counters_other_slave);
+    RUN_TEST_CASE(modbus_integration, test_counters_broadcast);
+    RUN_TEST_CASE(modbus_integration, test_counters_exception);
+    RUN_TEST_CASE(modbus_integration, test_counters_overrun);
+    RUN_TEST_CASE(modbus_integration, test_counters_diagnostics_request);
+#endif
+#if MODBUS_ENABLE_FC_2B && MODBUS_DEVICE_ID_CACHE_SIZE
+    RUN_TEST_CASE(modbus_integration, test_device_id_cached_response);
+    RUN_TEST_CASE(modbus_integration, test_device_id_uncached_response);
+    RUN_TEST_CASE(modbus_integration, test_device_id_cache_address);
+#endif
+#if MODBUS_RESPONSE_CACHE_ENTRIES
+    RUN_TEST_CASE(modbus_integration, test_response_cache_hit);
+    RUN_TEST_CASE(modbus_integration, test_response_cache_different_request);
+    RUN_TEST_CASE(modbus_integration, test_response_cache_generation);
+    RUN_TEST_CASE(modbus_integration, test_response_cache_bump_during_request);
+    RUN_TEST_CASE(modbus_integration, test_response_cache_write_invalidates);
+    RUN_TEST_CASE(modbus_integration, test_response_cache_skips_exceptions);
+#endif
+#if MODBUS_DIRTY_COIL_COUNT && MODBUS_DIRTY_REGISTER_COUNT && \
+    MODBUS_ENABLE_FC_05 && MODBUS_ENABLE_FC_06 && MODBUS_ENABLE_FC_0F && \
+    MODBUS_ENABLE_FC_10 && MODBUS_ENABLE_FC_16 && MODBUS_ENABLE_FC_17
+    RUN_TEST_CASE(modbus_integration, test_dirty_registers_written);
+    RUN_TEST_CASE(modbus_integration, test_dirty_coils_written);
+    RUN_TEST_CASE(modbus_integration, test_dirty_skips_failed_writes);
+#endif
+#if MODBUS_STAGED_WRITES && MODBUS_ENABLE_FC_17
+    RUN_TEST_CASE(modbus_integration, test_staged_write_single_commit);
+    RUN_TEST_CASE(modbus_integration, test_staged_write_validation_rejects);
+    RUN_TEST_CASE(modbus_integration, test_staged_read_write_overlay);
+    RUN_TEST_CASE(modbus_integration, test_staged_read_write_read_error);
+    RUN_TEST_CASE(modbus_integration, test_staged_write_commit_error);
+#endif
+#if MODBUS_ENABLE_TX_HOOKS
+    RUN_TEST_CASE(modbus_integration, test_tx_hooks_order);
+    RUN_TEST_CASE(modbus_integration, test_tx_hooks_no_response);
+    RUN_TEST_CASE(modbus_integration, test_tx_hooks_turnaround_requires_delay);
+#endif
+#if MODBUS_ENABLE_DEADLINE
+    RUN_TEST_CASE(modbus_integration, test_deadline_drops_stale_request);
+    RUN_TEST_CASE(modbus_integration, test_deadline_ignores_unanswered_frames);
+    RUN_TEST_CASE(modbus_integration, test_deadline_requires_clock);
+#endif
+#if MODBUS_MAX_UNITS > 1 && MODBUS_ENABLE_FC_06
+    RUN_TEST_CASE(modbus_integration, test_unit_routing);
+    RUN_TEST_CASE(modbus_integration, test_unit_unknown_address);
+    RUN_TEST_CASE(modbus_integration, test_unit_broadcast);
+#if MODBUS_DIRTY_REGISTER_COUNT
+    RUN_TEST_CASE(modbus_integration, test_unit_dirty_tracking);
+#endif
+#endif
+}
+#endif
+
+#if MODBUS_ENABLE_FC_03
+TEST_GROUP_RUNNER(modbus_tcp) {
+    RUN_TEST_CASE(modbus_tcp, test_tcp_adu_length);
+    RUN_TEST_CASE(modbus_tcp, test_tcp_process_adu);
+    RUN_TEST_CASE(modbus_tcp, test_tcp_process_adu_server_unit);
+    RUN_TEST_CASE(modbus_tcp, test_tcp_process_adu_exceptions);
+    RUN_TEST_CASE(modbus_tcp, test_tcp_process_adu_truncated);
+}
+
+TEST_GROUP_RUNNER(modbus_rtu) {
+    RUN_TEST_CASE(modbus_rtu, test_rtu_request_length_rules);
+    RUN_TEST_CASE(modbus_rtu, test_rtu_request_length_crc_scan);
+    RUN_TEST_CASE(modbus_rtu, test_rtu_response_length);
+    RUN_TEST_CASE(modbus_rtu, test_rtu_process_adu);
+    RUN_TEST_CASE(modbus_rtu, test_rtu_process_adu_no_response);
+}
+#endif
+
+#if defined(__linux__) && MODBUS_ENABLE_FC_03
+TEST_GROUP_RUNNER(modbus_tcp_server) {
+    RUN_TEST_CASE(modbus_tcp_server, test_tcp_server_pipelined_requests);
+    RUN_TEST_CASE(modbus_tcp_server, test_tcp_server_coalesced_responses);
+    RUN_TEST_CASE(modbus_tcp_server, test_tcp_server_receive_ring_wrap);
+    RUN_TEST_CASE(modbus_tcp_server, test_tcp_server_malformed_header);
+    RUN_TEST_CASE(modbus_tcp_server, test_tcp_server_connection_limit);
+    RUN_TEST_CASE(modbus_tcp_server, test_tcp_server_idle_timeout);
+    RUN_TEST_CASE(modbus_tcp_server, test_tcp_server_request_timeout);
+    RUN_TEST_CASE(modbus_tcp_server, test_tcp_server_rtu_framing);
+}
+
+TEST_GROUP_RUNNER(modbus_udp_server) {
+    RUN_TEST_CASE(modbus_udp_server, test_udp_server_batch);
+    RUN_TEST_CASE(modbus_udp_server, test_udp_server_malformed_datagrams);
+}
+
+TEST_GROUP_RUNNER(modbus_serial) {
+    RUN_TEST_CASE(modbus_serial, test_serial_request_response);
+    RUN_TEST_CASE(modbus_serial, test_serial_ignored_frames);
+    RUN_TEST_CASE(modbus_serial, test_serial_usb_packets);
+    RUN_TEST_CASE(modbus_serial, test_serial_open_errors);
+}
+
+TEST_GROUP_RUNNER(modbus_serial_server) {
+    RUN_TEST_CASE(modbus_serial_server, test_serial_server_ports);
+    RUN_TEST_CASE(modbus_serial_server, test_serial_server_workers);
+    RUN_TEST_CASE(modbus_serial_server, test_serial_server_lost_port);
+}
+
+#if MODBUS_ENABLE_TCP_URING
+TEST_GROUP_RUNNER(modbus_tcp_uring) {
+    RUN_TEST_CASE(modbus_tcp_uring, test_tcp_uring_pipelined_requests);
+    RUN_TEST_CASE(modbus_tcp_uring, test_tcp_uring_backpressure);
+    RUN_TEST_CASE(modbus_tcp_uring, test_tcp_uring_malformed_header);
+    RUN_TEST_CASE(modbus_tcp_uring, test_tcp_uring_connection_limit);
+    RUN_TEST_CASE(modbus_tcp_uring, test_tcp_uring_idle_timeout);
+    RUN_TEST_CASE(modbus_tcp_uring, test_tcp_uring_buffers_exhausted);
+}
+#endif
+
+#if MODBUS_ENABLE_FC_17 && MODBUS_ENABLE_REGISTER_BANK
+TEST_GROUP_RUNNER(modbus_tcp_shard) {
+    RUN_TEST_CASE(modbus_tcp_shard, test_tcp_shard_shared_registers);
+#if MODBUS_MAX_UNITS > 1
+    RUN_TEST_CASE(modbus_tcp_shard, test_tcp_shard_units);
+#endif
+    RUN_TEST_CASE(modbus_tcp_shard, test_tcp_shard_port_in_use);
 }
+#endif
+#endif
 
 static void run_all_tests(void) {
     RUN_TEST_GROUP(modbus_crc16);
@@ -139,18 +381,70 @@ static void run_all_tests(void) {
     RUN_TEST_GROUP(modbus_slave_rx);
     
     // All handler test groups
+#if MODBUS_ENABLE_FC_01
     RUN_TEST_GROUP(modbus_handler_read_coils);
+#endif
+#if MODBUS_ENABLE_FC_02
     RUN_TEST_GROUP(modbus_handler_read_discrete_inputs);
+#endif
+#if MODBUS_ENABLE_FC_03
     RUN_TEST_GROUP(modbus_handler_read_holding_registers);
+#endif
+#if MODBUS_ENABLE_FC_04
     RUN_TEST_GROUP(modbus_handler_read_input_registers);
+#endif
+#if MODBUS_ENABLE_FC_05
     RUN_TEST_GROUP(modbus_handler_write_single_coil);
+#endif
+#if MODBUS_ENABLE_FC_06
     RUN_TEST_GROUP(modbus_handler_write_single_register);
+#endif
+#if MODBUS_ENABLE_FC_0F
     RUN_TEST_GROUP(modbus_handler_write_multiple_coils);
+#endif
+#if MODBUS_ENABLE_FC_10
     RUN_TEST_GROUP(modbus_handler_write_multiple_registers);
+#endif
+#if MODBUS_ENABLE_FC_07
+    RUN_TEST_GROUP(modbus_handler_read_exception_status);
+#endif
+#if MODBUS_ENABLE_FC_08
+    RUN_TEST_GROUP(modbus_handler_diagnostics);
+#endif
+#if MODBUS_ENABLE_FC_16
     RUN_TEST_GROUP(modbus_handler_mask_write_register);
+#endif
+#if MODBUS_ENABLE_FC_17
     RUN_TEST_GROUP(modbus_handler_read_write_multiple_registers);
+#endif
+#if MODBUS_ENABLE_FC_2B
+    RUN_TEST_GROUP(modbus_handler_read_device_identification);
+#endif
+
+#if MODBUS_ENABLE_REGISTER_BANK
+    RUN_TEST_GROUP(modbus_register_bank);
+#endif
+    RUN_TEST_GROUP(modbus_timer_wheel);
+    RUN_TEST_GROUP(modbus_pool);
+    RUN_TEST_GROUP(modbus_gateway);
     
+#if MODBUS_ENABLE_FC_03
     RUN_TEST_GROUP(modbus_integration);
+    RUN_TEST_GROUP(modbus_tcp);
+    RUN_TEST_GROUP(modbus_rtu);
+#endif
+#if defined(__linux__) && MODBUS_ENABLE_FC_03
+    RUN_TEST_GROUP(modbus_tcp_server);
+#if MODBUS_ENABLE_TCP_URING
+    RUN_TEST_GROUP(modbus_tcp_uring);
+#endif
+    RUN_TEST_GROUP(modbus_udp_server);
+    RUN_TEST_GROUP(modbus_serial);
+    RUN_TEST_GROUP(modbus_serial_server);
+#if MODBUS_ENABLE_FC_17 && MODBUS_ENABLE_REGISTER_BANK
+    RUN_TEST_GROUP(modbus_tcp_shard);
+#endif
+#endif
 }
 
 int main(int argc, const char * argv[]) {
@@ -0,0 +1,58 @@
+#ifndef TEST_TCP_HELPERS_H
+#define TEST_TCP_HELPERS_H
+
+/*
+ * Slave callbacks and client side helpers shared by the TCP server tests
+ */
+
+#include "unity_fixture.h"
+#include "modbus_slave.h"
+#include "modbus_bytes.h"
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static inline void mock_write(const uint8_t *data, uint16_t length) {
+    (void)data;
+    (void)length;
+}
+
+static inline ModbusExceptionCode mock_read_holding_registers(uint16_t addr, uint16_t count, uint8_t *dest) {
+    for (int i = 0; i < count; i++) {
+        modbus_be16_set(&dest[i * 2], (uint16_t)(addr + i));
+    }
+    return MODBUS_EX_NONE;
+}
+
+/**
+ * Connect a blocking client to a server listening on the loopback port
+ */
+static inline int connect_client(uint16_t port) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(0, connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+
+    struct timeval timeout = { .tv_sec = 1 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+/**
+ * Receive exactly length bytes from a client socket
+ */
+static inline void recv_all(int fd, uint8_t *data, size_t length) {
+    size_t received = 0;
+
+    while (received < length) {
+        ssize_t n = recv(fd, &data[received], length - received, 0);
+        TEST_ASSERT_TRUE(n > 0);
+        received += (size_t)n;
+    }
+}
+
+#endif /* TEST_TCP_HELPERS_H */